@@ -0,0 +1,347 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#include "ncstreamer_cef/src/bandwidth_test.h"
+
+#include <algorithm>
+#include <cassert>
+#include <ctime>
+#include <future>  // NOLINT
+#include <memory>
+
+#include "ncstreamer_cef/src/lib/rtmp_ingest_server.h"
+#include "ncstreamer_cef/src/local_storage.h"
+#include "ncstreamer_cef/src/obs.h"
+
+
+namespace {
+// a step holds if the buffer of the output stays this empty, on average.
+const double kMaxCongestion{0.1};
+// of the video and audio bitrates together.
+const double kMinThroughputRatio{0.85};
+}  // unnamed namespace
+
+
+namespace ncstreamer {
+void BandwidthTest::SetUp() {
+  assert(!static_instance);
+  static_instance = new BandwidthTest{};
+}
+
+
+void BandwidthTest::ShutDown() {
+  assert(static_instance);
+  delete static_instance;
+  static_instance = nullptr;
+}
+
+
+BandwidthTest *BandwidthTest::Get() {
+  assert(static_instance);
+  return static_instance;
+}
+
+
+std::vector<uint32_t> BandwidthTest::GetDefaultBitrates() {
+  return {1000, 2500, 4000, 6000};
+}
+
+
+bool BandwidthTest::Start(
+    const std::string &service_provider,
+    const std::string &stream_url,
+    const std::vector<uint32_t> &bitrates,
+    const std::chrono::seconds &step_duration) {
+  if (bitrates.empty() == true || Obs::Get()->IsCapturing() == true) {
+    return false;
+  }
+
+  std::string provider{service_provider};
+  std::string url{stream_url};
+  if (url.empty() == true) {
+    provider = "Custom RTMP";
+    url = RtmpIngestServer::Get()->GetStreamUrl();
+    if (url.empty() == true) {
+      return false;
+    }
+  }
+
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    if (running_ == true) {
+      return false;
+    }
+    quit_ = false;
+    running_ = true;
+    service_provider_ = provider;
+    server_ = url.substr(0, url.find_last_of('/') + 1);
+    steps_.clear();
+    recommended_bitrate_ = 0;
+    error_.clear();
+  }
+
+  // the last test is over, but its thread may not have returned yet.
+  if (test_thread_.joinable() == true) {
+    test_thread_.join();
+  }
+  test_thread_ = std::thread{
+      &BandwidthTest::Run, this, provider, url, bitrates, step_duration};
+  return true;
+}
+
+
+void BandwidthTest::Stop() {
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    quit_ = true;
+  }
+  quit_condition_.notify_all();
+}
+
+
+bool BandwidthTest::IsRunning() const {
+  std::lock_guard<std::mutex> lock{mutex_};
+  return running_;
+}
+
+
+boost::property_tree::ptree BandwidthTest::ToTree() const {
+  std::lock_guard<std::mutex> lock{mutex_};
+
+  boost::property_tree::ptree tree;
+  tree.put("running", running_);
+  tree.put("serviceProvider", service_provider_);
+  tree.put("server", server_);
+  tree.add_child("steps", steps_);
+  tree.put("recommendedBitrate", recommended_bitrate_);
+  tree.put("error", error_);
+  tree.add_child("stored", LocalStorage::Get()->GetBandwidthTest());
+  return std::move(tree);
+}
+
+
+BandwidthTest::BandwidthTest()
+    : mutex_{},
+      quit_condition_{},
+      quit_{false},
+      running_{false},
+      service_provider_{},
+      server_{},
+      steps_{},
+      recommended_bitrate_{0},
+      error_{},
+      test_thread_{} {
+}
+
+
+BandwidthTest::~BandwidthTest() {
+  Stop();
+  if (test_thread_.joinable() == true) {
+    test_thread_.join();
+  }
+}
+
+
+uint32_t BandwidthTest::Recommend(
+    const boost::property_tree::ptree &steps,
+    uint32_t audio_bitrate) {
+  uint32_t recommended{0};
+  for (const auto &elem : steps) {
+    const auto &step = elem.second;
+    if (step.get("sustained", false) == true) {
+      recommended = (std::max)(recommended, step.get("bitrate", 0u));
+    }
+  }
+  if (recommended != 0 || steps.empty() == true) {
+    return recommended;
+  }
+
+  // not even the lowest held; three quarters of what went through.
+  double throughput = steps.front().second.get("throughputKbps", 0.0);
+  double estimated = throughput * 0.75 - audio_bitrate;
+  return (estimated > 0.0) ? static_cast<uint32_t>(estimated) : 0;
+}
+
+
+void BandwidthTest::Run(
+    const std::string &service_provider,
+    const std::string &stream_url,
+    const std::vector<uint32_t> &bitrates,
+    const std::chrono::seconds &step_duration) {
+  // twitch takes the stream without putting it on the channel; for the
+  // others, the url of a live video not yet published does the same.
+  std::string test_url{stream_url};
+  if (service_provider == "Twitch") {
+    test_url += "?bandwidthtest=true";
+  }
+
+  if (Obs::Get()->StartBandwidthTest(
+          service_provider, test_url, bitrates.front()) == false) {
+    Finish("obs internal");
+    return;
+  }
+
+  std::string error = WaitForConnected();
+  uint32_t audio_bitrate =
+      Obs::Get()->GetBandwidthTestStatus().get("audioBitrate", 0u);
+  boost::property_tree::ptree steps;
+  if (error.empty() == true) {
+    for (uint32_t bitrate : bitrates) {
+      const auto &step = MeasureStep(bitrate, step_duration);
+      if (step.empty() == true) {
+        error = "cancelled";
+        break;
+      }
+      steps.push_back(std::make_pair("", step));
+      {
+        std::lock_guard<std::mutex> lock{mutex_};
+        steps_ = steps;
+      }
+      // the higher ones would not fare better.
+      if (step.get("sustained", false) == false) {
+        break;
+      }
+    }
+  }
+  StopOutput();
+
+  if (error.empty() == false) {
+    Finish(error);
+    return;
+  }
+
+  uint32_t recommended_bitrate = Recommend(steps, audio_bitrate);
+
+  boost::property_tree::ptree stored;
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    stored.put("serviceProvider", service_provider_);
+    stored.put("server", server_);
+    recommended_bitrate_ = recommended_bitrate;
+  }
+  stored.put("recommendedBitrate", recommended_bitrate);
+  stored.put("testedAt", static_cast<int64_t>(std::time(nullptr)));
+  stored.add_child("steps", steps);
+  LocalStorage::Get()->SetBandwidthTest(stored);
+
+  Finish("");
+}
+
+
+std::string BandwidthTest::WaitForConnected() {
+  static const std::chrono::seconds kTimeout{10};
+  static const std::chrono::milliseconds kPollInterval{100};
+
+  for (auto elapsed = std::chrono::milliseconds::zero();
+       elapsed < kTimeout;
+       elapsed += kPollInterval) {
+    if (Sleep(kPollInterval) == false) {
+      return "cancelled";
+    }
+    const auto &status = Obs::Get()->GetBandwidthTestStatus();
+    if (status.get("active", false) == true) {
+      return "";
+    }
+    if (status.get("lastStopCode", 0) != 0) {
+      return "connect";
+    }
+  }
+  return "connect timeout";
+}
+
+
+boost::property_tree::ptree BandwidthTest::MeasureStep(
+    uint32_t bitrate,
+    const std::chrono::seconds &duration) {
+  // the encoder takes a moment to the new rate, and the buffer of the
+  // last step to drain.
+  static const std::chrono::seconds kSettle{2};
+  static const std::chrono::milliseconds kSampleInterval{250};
+
+  Obs::Get()->UpdateBandwidthTestBitrate(bitrate);
+  if (Sleep(kSettle) == false) {
+    return {};
+  }
+
+  const auto &begin = Obs::Get()->GetBandwidthTestStatus();
+  auto begin_time = std::chrono::steady_clock::now();
+
+  double congestion_sum{0.0};
+  double max_congestion{0.0};
+  int samples{0};
+  bool disconnected{false};
+  boost::property_tree::ptree end{begin};
+  for (auto elapsed = std::chrono::milliseconds::zero();
+       elapsed < duration;
+       elapsed += kSampleInterval) {
+    if (Sleep(kSampleInterval) == false) {
+      return {};
+    }
+    end = Obs::Get()->GetBandwidthTestStatus();
+    if (end.get("active", false) == false) {
+      disconnected = true;
+      break;
+    }
+    double congestion = end.get("congestion", 0.0);
+    congestion_sum += congestion;
+    max_congestion = (std::max)(max_congestion, congestion);
+    ++samples;
+  }
+
+  double seconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - begin_time).count();
+  uint64_t bytes = end.get("totalBytes", 0ull) - begin.get("totalBytes", 0ull);
+  double throughput = (seconds <= 0.0) ? 0.0 : bytes * 8 / 1000.0 / seconds;
+  int dropped = end.get("framesDropped", 0) - begin.get("framesDropped", 0);
+  double congestion = (samples == 0) ? 0.0 : congestion_sum / samples;
+  uint32_t audio_bitrate = end.get("audioBitrate", 0u);
+
+  bool sustained = (disconnected == false &&
+                    dropped == 0 &&
+                    congestion < kMaxCongestion &&
+                    throughput >=
+                        kMinThroughputRatio * (bitrate + audio_bitrate));
+
+  boost::property_tree::ptree step;
+  step.put("bitrate", bitrate);
+  step.put("throughputKbps", throughput);
+  step.put("congestion", congestion);
+  step.put("maxCongestion", max_congestion);
+  step.put("framesDropped", dropped);
+  step.put("disconnected", disconnected);
+  step.put("sustained", sustained);
+  return std::move(step);
+}
+
+
+bool BandwidthTest::Sleep(const std::chrono::milliseconds &duration) {
+  std::unique_lock<std::mutex> lock{mutex_};
+  return quit_condition_.wait_for(
+      lock, duration, [this]() { return quit_; }) == false;
+}
+
+
+void BandwidthTest::StopOutput() {
+  static const std::chrono::seconds kTimeout{5};
+
+  // the stop may come after the test has given up on it.
+  std::shared_ptr<std::promise<void>> stopped{new std::promise<void>{}};
+  std::future<void> stopped_future{stopped->get_future()};
+  Obs::Get()->StopBandwidthTest([stopped]() {
+    stopped->set_value();
+  });
+  stopped_future.wait_for(kTimeout);
+}
+
+
+void BandwidthTest::Finish(const std::string &error) {
+  std::lock_guard<std::mutex> lock{mutex_};
+  running_ = false;
+  error_ = error;
+}
+
+
+BandwidthTest *BandwidthTest::static_instance{nullptr};
+}  // namespace ncstreamer
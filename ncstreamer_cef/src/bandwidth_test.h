@@ -0,0 +1,89 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#ifndef NCSTREAMER_CEF_SRC_BANDWIDTH_TEST_H_
+#define NCSTREAMER_CEF_SRC_BANDWIDTH_TEST_H_
+
+
+#include <chrono>  // NOLINT
+#include <condition_variable>  // NOLINT
+#include <mutex>  // NOLINT
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "boost/property_tree/ptree.hpp"
+
+
+namespace ncstreamer {
+// how much the upstream to an ingest carries; streams at rising bitrates
+// for a few seconds each before going live, and keeps the bitrate it
+// recommends in the local storage.
+class BandwidthTest {
+ public:
+  // after the local storage, obs and the rtmp ingest server.
+  static void SetUp();
+  static void ShutDown();
+  static BandwidthTest *Get();
+
+  static std::vector<uint32_t> GetDefaultBitrates();
+
+  // an empty stream url tests against the local ingest server.
+  // returns false if a test runs already, or obs is capturing.
+  bool Start(
+      const std::string &service_provider,
+      const std::string &stream_url,
+      const std::vector<uint32_t> &bitrates,
+      const std::chrono::seconds &step_duration);
+  void Stop();
+  bool IsRunning() const;
+
+  // the test running or last run, and the result last stored.
+  boost::property_tree::ptree ToTree() const;
+
+ private:
+  BandwidthTest();
+  virtual ~BandwidthTest();
+
+  // returns the recommended video bitrate in kbps.
+  static uint32_t Recommend(
+      const boost::property_tree::ptree &steps,
+      uint32_t audio_bitrate);
+
+  void Run(
+      const std::string &service_provider,
+      const std::string &stream_url,
+      const std::vector<uint32_t> &bitrates,
+      const std::chrono::seconds &step_duration);
+  // returns an error, or empty.
+  std::string WaitForConnected();
+  boost::property_tree::ptree MeasureStep(
+      uint32_t bitrate,
+      const std::chrono::seconds &duration);
+  // false if stopped meanwhile.
+  bool Sleep(const std::chrono::milliseconds &duration);
+  // waits for the output of the test to stop, for a while at most.
+  void StopOutput();
+  void Finish(const std::string &error);
+
+  static BandwidthTest *static_instance;
+
+  mutable std::mutex mutex_;
+  std::condition_variable quit_condition_;
+  bool quit_;
+  bool running_;
+  std::string service_provider_;
+  // with no stream key.
+  std::string server_;
+  boost::property_tree::ptree steps_;
+  uint32_t recommended_bitrate_;
+  std::string error_;
+
+  std::thread test_thread_;
+};
+}  // namespace ncstreamer
+
+
+#endif  // NCSTREAMER_CEF_SRC_BANDWIDTH_TEST_H_
@@ -0,0 +1,241 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#include "ncstreamer_cef/src/benchmark.h"
+
+#include <sstream>
+#include <thread>  // NOLINT
+
+#include "boost/property_tree/json_parser.hpp"
+
+#include "ncstreamer_cef/src/obs.h"
+
+
+namespace ncstreamer {
+std::vector<Benchmark::Preset> Benchmark::ParsePresets(
+    const std::string &json) {
+  std::vector<Preset> presets;
+  if (json.empty() == true) {
+    return presets;
+  }
+
+  boost::property_tree::ptree root;
+  std::stringstream root_ss{json};
+  try {
+    boost::property_tree::read_json(root_ss, root);
+    const auto &arr = root.get_child("presets", {});
+    for (const auto &elem : arr) {
+      const boost::property_tree::ptree &obj = elem.second;
+      presets.emplace_back(
+          obj.get<std::string>("name"),
+          Dimension<uint32_t>{
+              obj.get<uint32_t>("width"),
+              obj.get<uint32_t>("height")},
+          obj.get<uint32_t>("fps", 30),
+          obj.get<uint32_t>("bitrate"),
+          obj.get<std::string>("pattern", "scroll"),
+          obj.get<std::string>("signal", "tone"),
+          obj.get<uint32_t>("audioSampleRate", 0),
+          obj.get<uint32_t>("toneSampleRate", 0));
+    }
+  } catch (const std::exception &/*e*/) {
+    presets.clear();
+  }
+  return presets;
+}
+
+
+std::vector<Benchmark::Preset> Benchmark::GetDefaultPresets() {
+  static const struct {
+    const char *name;
+    uint32_t width;
+    uint32_t height;
+    uint32_t bitrate;
+  } kSizes[]{
+      {"1080p", 1920, 1080, 6000},
+      {"720p", 1280, 720, 3000},
+      {"480p", 854, 480, 1000}};
+  static const char *kPatterns[]{"static", "scroll", "noise"};
+
+  std::vector<Preset> presets;
+  for (const auto &size : kSizes) {
+    for (const auto &pattern : kPatterns) {
+      presets.emplace_back(
+          std::string{size.name} + "-" + pattern,
+          Dimension<uint32_t>{size.width, size.height},
+          30,
+          size.bitrate,
+          pattern,
+          (std::string{pattern} == "noise") ? "noise" : "tone",
+          0,
+          0);
+    }
+  }
+
+  // the same tone, resampled or not; the video is kept cheap so that
+  // the difference in cpu is mostly the resampler.
+  static const struct {
+    const char *name;
+    uint32_t audio_samples_per_sec;
+  } kAudioRates[]{
+      {"audio-resampled", 44100},
+      {"audio-native", 48000}};
+  for (const auto &rate : kAudioRates) {
+    presets.emplace_back(
+        rate.name,
+        Dimension<uint32_t>{854, 480},
+        30,
+        1000,
+        "static",
+        "tone",
+        rate.audio_samples_per_sec,
+        48000);
+  }
+  return presets;
+}
+
+
+Benchmark::Benchmark(
+    const std::vector<Preset> &presets,
+    const std::chrono::seconds &duration)
+    : presets_{presets},
+      duration_{duration} {
+}
+
+
+Benchmark::~Benchmark() {
+}
+
+
+boost::property_tree::ptree Benchmark::Run() const {
+  boost::property_tree::ptree results;
+  std::string error{};
+  for (const auto &preset : presets_) {
+    const auto &result = RunPreset(preset);
+    results.push_back({"", result});
+    // the next preset can not reset the video under the output.
+    if (result.get("error", "") == "stop timeout") {
+      error = "stop timeout";
+      break;
+    }
+  }
+
+  boost::property_tree::ptree tree;
+  tree.put("durationSec", duration_.count());
+  tree.add_child("results", results);
+  if (error.empty() == false) {
+    tree.put("error", error);
+  }
+  return std::move(tree);
+}
+
+
+boost::property_tree::ptree Benchmark::RunPreset(const Preset &preset) const {
+  static const std::chrono::seconds kWarmUp{2};
+  static const std::chrono::seconds kSampleInterval{1};
+
+  boost::property_tree::ptree tree;
+  tree.put("name", preset.name());
+  tree.put("width", preset.output_size().width());
+  tree.put("height", preset.output_size().height());
+  tree.put("fps", preset.fps());
+  tree.put("bitrate", preset.bitrate());
+  tree.put("pattern", preset.pattern());
+
+  Obs::Get()->UpdateVideoQuality(
+      preset.output_size(), preset.fps(), preset.bitrate());
+  if (Obs::Get()->StartBenchmark(
+          preset.pattern(),
+          preset.signal(),
+          preset.audio_samples_per_sec(),
+          preset.tone_samples_per_sec()) == false) {
+    tree.put("error", "obs internal");
+    return std::move(tree);
+  }
+
+  uint32_t audio_samples_per_sec =
+      Obs::Get()->GetAudioStatus().get<uint32_t>("sampleRate", 0);
+  uint32_t tone_samples_per_sec = (preset.tone_samples_per_sec() == 0) ?
+      audio_samples_per_sec : preset.tone_samples_per_sec();
+  tree.put("audioSampleRate", audio_samples_per_sec);
+  tree.put("toneSampleRate", tone_samples_per_sec);
+  tree.put("resampling", tone_samples_per_sec != audio_samples_per_sec);
+
+  // the first frames pay for the encoder start-up.
+  std::this_thread::sleep_for(kWarmUp);
+  const auto &begin = Obs::Get()->GetBenchmarkStatus();
+
+  double cpu_sum{0.0};
+  int64_t cpu_samples{0};
+  for (auto elapsed = std::chrono::seconds::zero();
+       elapsed < duration_;
+       elapsed += kSampleInterval) {
+    std::this_thread::sleep_for(kSampleInterval);
+    cpu_sum += Obs::Get()->GetCpuUsage();
+    ++cpu_samples;
+  }
+  const auto &end = Obs::Get()->GetBenchmarkStatus();
+
+  Obs::Get()->StopBenchmark();
+  if (WaitForStopped() == false) {
+    tree.put("error", "stop timeout");
+    return std::move(tree);
+  }
+
+  auto delta = [&begin, &end](const std::string &path) {
+    return end.get<int64_t>(path, 0) - begin.get<int64_t>(path, 0);
+  };
+  double seconds = static_cast<double>(duration_.count());
+
+  tree.put("encodedFps", delta("encoder.video.packets") / seconds);
+  tree.put("videoKbps", delta("encoder.video.bytes") * 8 / 1000.0 / seconds);
+  tree.put("encodeLatencyMs", end.get<double>("encoder.video.averageMs", -1));
+  tree.put("encodeLatencyMaxMs", end.get<double>("encoder.video.maxMs", -1));
+  tree.put("skippedFrames", delta("frames.skipped"));
+  tree.put("laggedFrames", delta("frames.lagged"));
+  tree.put("cpu", cpu_samples == 0 ? -1.0 : cpu_sum / cpu_samples);
+  return std::move(tree);
+}
+
+
+bool Benchmark::WaitForStopped() {
+  static const std::chrono::milliseconds kPollInterval{100};
+  static const std::chrono::seconds kTimeout{10};
+
+  // the next preset resets the video, which fails under an active output.
+  const auto deadline = std::chrono::steady_clock::now() + kTimeout;
+  while (Obs::Get()->IsBenchmarking() == true) {
+    if (std::chrono::steady_clock::now() >= deadline) {
+      return false;
+    }
+    std::this_thread::sleep_for(kPollInterval);
+  }
+  return true;
+}
+
+
+Benchmark::Preset::Preset(
+    const std::string &name,
+    const Dimension<uint32_t> &output_size,
+    uint32_t fps,
+    uint32_t bitrate,
+    const std::string &pattern,
+    const std::string &signal,
+    uint32_t audio_samples_per_sec,
+    uint32_t tone_samples_per_sec)
+    : name_{name},
+      output_size_{output_size},
+      fps_{fps},
+      bitrate_{bitrate},
+      pattern_{pattern},
+      signal_{signal},
+      audio_samples_per_sec_{audio_samples_per_sec},
+      tone_samples_per_sec_{tone_samples_per_sec} {
+}
+
+
+Benchmark::Preset::~Preset() {
+}
+}  // namespace ncstreamer
@@ -0,0 +1,86 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#ifndef NCSTREAMER_CEF_SRC_BENCHMARK_H_
+#define NCSTREAMER_CEF_SRC_BENCHMARK_H_
+
+
+#include <chrono>  // NOLINT
+#include <string>
+#include <vector>
+
+#include "boost/property_tree/ptree.hpp"
+
+#include "ncstreamer_cef/src/lib/dimension.h"
+
+
+namespace ncstreamer {
+// runs the capture-to-encode pipeline over the synthetic sources,
+// preset by preset, so that runs can be compared across changes.
+class Benchmark {
+ public:
+  class Preset;
+
+  static std::vector<Preset> ParsePresets(const std::string &json);
+  static std::vector<Preset> GetDefaultPresets();
+
+  Benchmark(
+      const std::vector<Preset> &presets,
+      const std::chrono::seconds &duration);
+  virtual ~Benchmark();
+
+  // blocks for about (warm-up + duration) per preset. a preset whose
+  // output never stops ends the run, with an error in the report.
+  boost::property_tree::ptree Run() const;
+
+ private:
+  boost::property_tree::ptree RunPreset(const Preset &preset) const;
+
+  // false if still benchmarking after a few seconds.
+  static bool WaitForStopped();
+
+  const std::vector<Preset> presets_;
+  const std::chrono::seconds duration_;
+};
+
+
+class Benchmark::Preset {
+ public:
+  Preset(
+      const std::string &name,
+      const Dimension<uint32_t> &output_size,
+      uint32_t fps,
+      uint32_t bitrate,
+      const std::string &pattern,
+      const std::string &signal,
+      uint32_t audio_samples_per_sec,
+      uint32_t tone_samples_per_sec);
+  virtual ~Preset();
+
+  const std::string &name() const { return name_; }
+  const Dimension<uint32_t> &output_size() const { return output_size_; }
+  uint32_t fps() const { return fps_; }
+  uint32_t bitrate() const { return bitrate_; }
+  const std::string &pattern() const { return pattern_; }
+  const std::string &signal() const { return signal_; }
+  // 0 for the audio format configured.
+  uint32_t audio_samples_per_sec() const { return audio_samples_per_sec_; }
+  // 0 for the rate of the audio pipeline; any other is resampled.
+  uint32_t tone_samples_per_sec() const { return tone_samples_per_sec_; }
+
+ private:
+  std::string name_;
+  Dimension<uint32_t> output_size_;
+  uint32_t fps_;
+  uint32_t bitrate_;
+  std::string pattern_;
+  std::string signal_;
+  uint32_t audio_samples_per_sec_;
+  uint32_t tone_samples_per_sec_;
+};
+}  // namespace ncstreamer
+
+
+#endif  // NCSTREAMER_CEF_SRC_BENCHMARK_H_
@@ -16,6 +16,7 @@
 #include "include/wrapper/cef_closure_task.h"
 #include "include/wrapper/cef_helpers.h"
 
+#include "ncstreamer_cef/src/encoder_capacity.h"
 #include "ncstreamer_cef/src/js_executor.h"
 #include "ncstreamer_cef/src/obs.h"
 #include "ncstreamer_cef/src/obs/obs_source_info.h"
@@ -127,9 +128,18 @@ void ClientLoadHandler::OnMainPageLoaded(
     CefRefPtr<CefBrowser> browser) {
   static std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
 
+  std::string video_quality = converter.to_bytes(video_quality_);
+  if (video_quality == "auto") {
+    // medium until the capacity of this machine is known.
+    video_quality = EncoderCapacity::Get()->GetRecommendedQuality();
+    if (video_quality.empty() == true) {
+      video_quality = "medium";
+    }
+  }
+
   boost::property_tree::ptree args;
   args.add("hidesSettings", hides_settings_);
-  args.add("videoQuality", converter.to_bytes(video_quality_));
+  args.add("videoQuality", video_quality);
 
   JsExecutor::Execute(browser, "setUp", args);
 
@@ -19,6 +19,7 @@
 #include "Shellapi.h"  // NOLINT
 #include "Shlwapi.h"  // NOLINT
 
+#include "ncstreamer_cef/src/encoder_capacity.h"
 #include "ncstreamer_cef/src/js_executor.h"
 #include "ncstreamer_cef/src/local_storage.h"
 #include "ncstreamer_cef/src/remote_server.h"
@@ -26,6 +27,40 @@
 #include "ncstreamer_cef/src/streaming_service.h"
 
 
+namespace {
+// for the user page and the privacy kept, as the ui selects them.
+void PrepareLiveVideo() {
+  const std::string &user_page =
+      ncstreamer::LocalStorage::Get()->GetUserPage();
+  const std::string &privacy = ncstreamer::LocalStorage::Get()->GetPrivacy();
+  if (user_page.empty() == true ||
+      privacy.empty() == true) {
+    return;
+  }
+
+  ncstreamer::StreamingService::Get()->PrepareLiveVideo(user_page, privacy);
+}
+
+
+boost::property_tree::ptree ToUserTree(
+    const std::string &user_name,
+    const std::string &user_link,
+    const std::vector<ncstreamer::StreamingServiceProvider::UserPage>
+        &user_pages) {
+  std::vector<boost::property_tree::ptree> tree_pages;
+  for (const auto &page : user_pages) {
+    tree_pages.emplace_back(page.ToTree());
+  }
+
+  boost::property_tree::ptree tree;
+  tree.add("userName", user_name);
+  tree.add("userLink", user_link);
+  tree.add_child("userPages", ncstreamer::JsExecutor::ToPtree(tree_pages));
+  return tree;
+}
+}  // unnamed namespace
+
+
 namespace ncstreamer {
 ClientRequestHandler::ClientRequestHandler(
     const std::wstring &locale)
@@ -258,19 +293,24 @@ void ClientRequestHandler::OnCommandServiceProviderLogIn(
       const std::string &user_name,
       const std::string &user_link,
       const std::vector<StreamingServiceProvider::UserPage> &user_pages) {
-    std::vector<boost::property_tree::ptree> tree_pages;
-    for (const auto &page : user_pages) {
-      tree_pages.emplace_back(page.ToTree());
-    }
-
-    boost::property_tree::ptree arg;
-    arg.add("userName", user_name);
-    arg.add("userLink", user_link);
-    arg.add_child("userPages", JsExecutor::ToPtree(tree_pages));
+    boost::property_tree::ptree arg{
+        ToUserTree(user_name, user_link, user_pages)};
     arg.add("userPage", LocalStorage::Get()->GetUserPage());
     arg.add("privacy", LocalStorage::Get()->GetPrivacy());
 
     JsExecutor::Execute(browser, "cef.onResponse", cmd, arg);
+
+    PrepareLiveVideo();
+  }, [browser](
+      const std::string &user_name,
+      const std::string &user_link,
+      const std::vector<StreamingServiceProvider::UserPage> &user_pages) {
+    // not a response; the ui is told as if it were.
+    JsExecutor::Execute(
+        browser,
+        "cef.onResponse",
+        "service_provider/user/update",
+        ToUserTree(user_name, user_link, user_pages));
   });
 }
 
@@ -387,6 +427,9 @@ void ClientRequestHandler::OnCommandStreamingStop(
         "cef.onResponse",
         cmd,
         std::make_pair("error", ""));
+
+    // the live video of this one is over; another for the next start.
+    PrepareLiveVideo();
   });
 }
 
@@ -444,11 +487,15 @@ void ClientRequestHandler::OnCommandSettingsVideoQualityUpdate(
   }
 
   Obs::Get()->UpdateVideoQuality({width, height}, fps, bitrate);
-  JsExecutor::Execute(
-      browser,
-      "cef.onResponse",
-      cmd,
-      std::make_pair("error", ""));
+
+  // applied anyway; the ui decides whether to warn.
+  boost::property_tree::ptree arg;
+  arg.put("error", "");
+  arg.put("overCapacity",
+          EncoderCapacity::Get()->IsOverCapacity({width, height}, fps));
+  arg.put("recommendedQuality",
+          EncoderCapacity::Get()->GetRecommendedQuality());
+  JsExecutor::Execute(browser, "cef.onResponse", cmd, arg);
 }
 
 
@@ -470,6 +517,7 @@ void ClientRequestHandler::OnCommandStorageUserPageUpdate(
   }
 
   LocalStorage::Get()->SetUserPage(user_page);
+  PrepareLiveVideo();
 }
 
 
@@ -491,6 +539,7 @@ void ClientRequestHandler::OnCommandStoragePrivacyUpdate(
   }
 
   LocalStorage::Get()->SetPrivacy(privacy);
+  PrepareLiveVideo();
 }
 
 
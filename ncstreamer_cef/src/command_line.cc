@@ -16,6 +16,7 @@
 namespace ncstreamer {
 CommandLine::CommandLine(const std::wstring &cmd_line)
     : is_renderer_{false},
+      is_headless_{false},
       hides_settings_{false},
       video_quality_{},
       shows_sources_all_{false},
@@ -24,7 +25,33 @@ CommandLine::CommandLine(const std::wstring &cmd_line)
       ui_uri_{},
       remote_port_{0},
       in_memory_local_storage_{false},
-      designated_user_{} {
+      designated_user_{},
+      renditions_{},
+      replay_hotkey_{},
+      replay_directory_{},
+      stream_profile_{},
+      measures_latency_{false},
+      is_benchmark_{false},
+      benchmark_presets_{},
+      benchmark_seconds_{0},
+      benchmark_report_{},
+      local_ingest_port_{0},
+      custom_rtmp_url_{},
+      idle_bitrate_{0},
+      guards_lag_{false},
+      lag_guard_restarts_{false},
+      audio_sample_rate_{0},
+      audio_channels_{},
+      audio_bitrate_{0},
+      reconnect_max_delay_{0},
+      facebook_api_uri_{},
+      prepares_live_video_{false},
+      mock_server_port_{0},
+      mock_server_script_{},
+      mock_server_cert_{},
+      mock_server_key_{},
+      is_http_self_test_{false},
+      http_self_test_report_{} {
   CefRefPtr<CefCommandLine> cef_cmd_line =
       CefCommandLine::CreateCommandLine();
   cef_cmd_line->InitFromString(cmd_line);
@@ -33,6 +60,8 @@ CommandLine::CommandLine(const std::wstring &cmd_line)
       cef_cmd_line->GetSwitchValue(L"type");
   is_renderer_ = (process_type == L"renderer");
 
+  is_headless_ = ReadBool(cef_cmd_line, L"headless", false);
+
   hides_settings_ = ReadBool(cef_cmd_line, L"hides-settings", false);
 
   const std::wstring &video_quality =
@@ -65,6 +94,117 @@ CommandLine::CommandLine(const std::wstring &cmd_line)
       ReadBool(cef_cmd_line, L"in-memory-local-storage", false);
 
   designated_user_ = cef_cmd_line->GetSwitchValue(L"designated-user");
+
+  renditions_ = cef_cmd_line->GetSwitchValue(L"renditions").ToString();
+
+  replay_hotkey_ = cef_cmd_line->GetSwitchValue(L"replay-hotkey").ToString();
+  replay_directory_ =
+      cef_cmd_line->GetSwitchValue(L"replay-directory").ToString();
+
+  const std::string &stream_profile =
+      cef_cmd_line->GetSwitchValue(L"stream-profile").ToString();
+  stream_profile_ = stream_profile.empty() ? "normal" : stream_profile;
+
+  measures_latency_ = ReadBool(cef_cmd_line, L"measure-latency", false);
+
+  is_benchmark_ = ReadBool(cef_cmd_line, L"benchmark", false);
+  benchmark_presets_ =
+      cef_cmd_line->GetSwitchValue(L"benchmark-presets").ToString();
+  const std::wstring &benchmark_seconds =
+      cef_cmd_line->GetSwitchValue(L"benchmark-seconds");
+  try {
+    benchmark_seconds_ = static_cast<uint32_t>(std::stoi(benchmark_seconds));
+  } catch (...) {
+    benchmark_seconds_ = 10;
+  }
+  benchmark_report_ = cef_cmd_line->GetSwitchValue(L"benchmark-report");
+
+  const std::wstring &local_ingest_port =
+      cef_cmd_line->GetSwitchValue(L"local-ingest-port");
+  try {
+    local_ingest_port_ = static_cast<uint16_t>(std::stoi(local_ingest_port));
+  } catch (...) {
+    local_ingest_port_ = 0;
+  }
+
+  custom_rtmp_url_ =
+      cef_cmd_line->GetSwitchValue(L"custom-rtmp-url").ToString();
+
+  const std::wstring &idle_bitrate =
+      cef_cmd_line->GetSwitchValue(L"idle-bitrate");
+  try {
+    idle_bitrate_ = static_cast<uint32_t>(std::stoi(idle_bitrate));
+  } catch (...) {
+    idle_bitrate_ = 0;
+  }
+
+  // off unless asked; a step is only reported without the restart.
+  guards_lag_ = ReadBool(cef_cmd_line, L"lag-guard", false);
+  // a step restarts the stream, which drops the viewers for a moment.
+  lag_guard_restarts_ = ReadBool(cef_cmd_line, L"lag-guard-restart", false);
+
+  // "auto" or none follows the default playback device.
+  const std::wstring &audio_sample_rate =
+      cef_cmd_line->GetSwitchValue(L"audio-sample-rate");
+  try {
+    audio_sample_rate_ = static_cast<uint32_t>(std::stoi(audio_sample_rate));
+  } catch (...) {
+    audio_sample_rate_ = 0;
+  }
+
+  // the streaming services mostly take stereo only.
+  const std::string &audio_channels =
+      cef_cmd_line->GetSwitchValue(L"audio-channels").ToString();
+  audio_channels_ = audio_channels.empty() ? "stereo" : audio_channels;
+
+  const std::wstring &audio_bitrate =
+      cef_cmd_line->GetSwitchValue(L"audio-bitrate");
+  try {
+    audio_bitrate_ = static_cast<uint32_t>(std::stoi(audio_bitrate));
+  } catch (...) {
+    audio_bitrate_ = 160;
+  }
+
+  // in seconds.
+  const std::wstring &reconnect_max_delay =
+      cef_cmd_line->GetSwitchValue(L"reconnect-max-delay");
+  try {
+    reconnect_max_delay_ =
+        static_cast<uint32_t>(std::stoi(reconnect_max_delay));
+  } catch (...) {
+    reconnect_max_delay_ = 30;
+  }
+
+  // a server in place of facebook, such as a local mock.
+  facebook_api_uri_ =
+      cef_cmd_line->GetSwitchValue(L"facebook-api-uri").ToString();
+
+  // a live video is posted ahead of the start, as the page and the
+  // privacy are selected.
+  prepares_live_video_ =
+      ReadBool(cef_cmd_line, L"prepare-live-video", false);
+
+#ifdef NCSTREAMER_HTTP_MOCK
+  // a local server answering the graph api, or the routes of the script
+  // file; the facebook api goes to it only if given as its uri. neither
+  // of it nor of the self test is in a release build.
+  const std::wstring &mock_server_port =
+      cef_cmd_line->GetSwitchValue(L"mock-server-port");
+  try {
+    mock_server_port_ = static_cast<uint16_t>(std::stoi(mock_server_port));
+  } catch (...) {
+    mock_server_port_ = 0;
+  }
+  mock_server_script_ = cef_cmd_line->GetSwitchValue(L"mock-server-script");
+  mock_server_cert_ =
+      cef_cmd_line->GetSwitchValue(L"mock-server-cert").ToString();
+  mock_server_key_ =
+      cef_cmd_line->GetSwitchValue(L"mock-server-key").ToString();
+
+  is_http_self_test_ = ReadBool(cef_cmd_line, L"http-self-test", false);
+  http_self_test_report_ =
+      cef_cmd_line->GetSwitchValue(L"http-self-test-report");
+#endif
 }
 
 
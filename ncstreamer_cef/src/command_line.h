@@ -20,6 +20,7 @@ class CommandLine {
   virtual ~CommandLine();
 
   bool is_renderer() const { return is_renderer_; }
+  bool is_headless() const { return is_headless_; }
   bool hides_settings() const { return hides_settings_; }
   const std::wstring &video_quality() const { return video_quality_; }
   bool shows_sources_all() const { return shows_sources_all_; }
@@ -29,6 +30,36 @@ class CommandLine {
   uint16_t remote_port() const { return remote_port_; }
   bool in_memory_local_storage() const { return in_memory_local_storage_; }
   const std::wstring &designated_user() const { return designated_user_; }
+  const std::string &renditions() const { return renditions_; }
+  const std::string &replay_hotkey() const { return replay_hotkey_; }
+  const std::string &replay_directory() const { return replay_directory_; }
+  const std::string &stream_profile() const { return stream_profile_; }
+  bool measures_latency() const { return measures_latency_; }
+  bool is_benchmark() const { return is_benchmark_; }
+  const std::string &benchmark_presets() const { return benchmark_presets_; }
+  uint32_t benchmark_seconds() const { return benchmark_seconds_; }
+  const std::wstring &benchmark_report() const { return benchmark_report_; }
+  uint16_t local_ingest_port() const { return local_ingest_port_; }
+  const std::string &custom_rtmp_url() const { return custom_rtmp_url_; }
+  uint32_t idle_bitrate() const { return idle_bitrate_; }
+  bool guards_lag() const { return guards_lag_; }
+  bool lag_guard_restarts() const { return lag_guard_restarts_; }
+  uint32_t audio_sample_rate() const { return audio_sample_rate_; }
+  const std::string &audio_channels() const { return audio_channels_; }
+  uint32_t audio_bitrate() const { return audio_bitrate_; }
+  uint32_t reconnect_max_delay() const { return reconnect_max_delay_; }
+  const std::string &facebook_api_uri() const { return facebook_api_uri_; }
+  bool prepares_live_video() const { return prepares_live_video_; }
+  uint16_t mock_server_port() const { return mock_server_port_; }
+  const std::wstring &mock_server_script() const {
+    return mock_server_script_;
+  }
+  const std::string &mock_server_cert() const { return mock_server_cert_; }
+  const std::string &mock_server_key() const { return mock_server_key_; }
+  bool is_http_self_test() const { return is_http_self_test_; }
+  const std::wstring &http_self_test_report() const {
+    return http_self_test_report_;
+  }
 
  private:
   static bool ReadBool(
@@ -40,6 +71,7 @@ class CommandLine {
       ParseSourcesArgument(const std::wstring &arg);
 
   bool is_renderer_;
+  bool is_headless_;
   bool hides_settings_;
   std::wstring video_quality_;
   bool shows_sources_all_;
@@ -49,6 +81,32 @@ class CommandLine {
   uint16_t remote_port_;
   bool in_memory_local_storage_;
   std::wstring designated_user_;
+  std::string renditions_;
+  std::string replay_hotkey_;
+  std::string replay_directory_;
+  std::string stream_profile_;
+  bool measures_latency_;
+  bool is_benchmark_;
+  std::string benchmark_presets_;
+  uint32_t benchmark_seconds_;
+  std::wstring benchmark_report_;
+  uint16_t local_ingest_port_;
+  std::string custom_rtmp_url_;
+  uint32_t idle_bitrate_;
+  bool guards_lag_;
+  bool lag_guard_restarts_;
+  uint32_t audio_sample_rate_;
+  std::string audio_channels_;
+  uint32_t audio_bitrate_;
+  uint32_t reconnect_max_delay_;
+  std::string facebook_api_uri_;
+  bool prepares_live_video_;
+  uint16_t mock_server_port_;
+  std::wstring mock_server_script_;
+  std::string mock_server_cert_;
+  std::string mock_server_key_;
+  bool is_http_self_test_;
+  std::wstring http_self_test_report_;
 };
 }  // namespace ncstreamer
 
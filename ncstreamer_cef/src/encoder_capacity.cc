@@ -0,0 +1,205 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#include "ncstreamer_cef/src/encoder_capacity.h"
+
+#include <intrin.h>
+
+#include <cassert>
+#include <cstring>
+#include <sstream>
+#include <unordered_set>
+
+#include "ncstreamer_cef/src/local_storage.h"
+#include "ncstreamer_cef/src/obs.h"
+#include "ncstreamer_cef/src/obs/obs_encoder_capacity_probe.h"
+
+
+namespace {
+const std::chrono::seconds kMeasureDuration{3};
+// of the candidates stored; another probes again.
+const int kStoredVersion{2};
+}  // unnamed namespace
+
+
+namespace ncstreamer {
+void EncoderCapacity::SetUp() {
+  assert(!static_instance);
+  static_instance = new EncoderCapacity{};
+}
+
+
+void EncoderCapacity::ShutDown() {
+  assert(static_instance);
+  delete static_instance;
+  static_instance = nullptr;
+}
+
+
+EncoderCapacity *EncoderCapacity::Get() {
+  assert(static_instance);
+  return static_instance;
+}
+
+
+std::string EncoderCapacity::GetRecommendedQuality() const {
+  std::lock_guard<std::mutex> lock{mutex_};
+  return recommended_quality_;
+}
+
+
+bool EncoderCapacity::IsOverCapacity(
+    const Dimension<uint32_t> &output_size,
+    uint32_t fps) const {
+  uint64_t pixel_rate = static_cast<uint64_t>(output_size.width()) *
+                        output_size.height() * fps;
+
+  std::lock_guard<std::mutex> lock{mutex_};
+  if (recommended_quality_.empty() == true) {
+    return false;
+  }
+  return pixel_rate > max_pixel_rate_;
+}
+
+
+boost::property_tree::ptree EncoderCapacity::ToTree() const {
+  std::lock_guard<std::mutex> lock{mutex_};
+
+  boost::property_tree::ptree tree;
+  tree.put("machine", machine_id_);
+  tree.put("probing", probing_);
+  tree.put("recommendedQuality", recommended_quality_);
+  tree.put("maxPixelRate", max_pixel_rate_);
+  tree.add_child("candidates", candidates_);
+  return std::move(tree);
+}
+
+
+EncoderCapacity::EncoderCapacity()
+    : machine_id_{GetMachineId()},
+      mutex_{},
+      probing_{false},
+      candidates_{},
+      recommended_quality_{},
+      max_pixel_rate_{0},
+      quit_{false},
+      probe_thread_{} {
+  const auto &stored = LocalStorage::Get()->GetEncoderCapacity();
+  if (stored.get("machine", "") == machine_id_ &&
+      stored.get("version", 0) == kStoredVersion &&
+      stored.get("recommendedQuality", "").empty() == false) {
+    candidates_ = stored.get_child("candidates", {});
+    recommended_quality_ = stored.get("recommendedQuality", "");
+    max_pixel_rate_ = stored.get("maxPixelRate", 0ull);
+    return;
+  }
+
+  probing_ = true;
+  Obs::Get()->SetOnCaptureStarting([this]() {
+    quit_ = true;
+  });
+  probe_thread_ = std::thread{&EncoderCapacity::Probe, this};
+}
+
+
+EncoderCapacity::~EncoderCapacity() {
+  Obs::Get()->SetOnCaptureStarting(nullptr);
+  quit_ = true;
+  if (probe_thread_.joinable() == true) {
+    probe_thread_.join();
+  }
+}
+
+
+std::string EncoderCapacity::GetMachineId() {
+  // the brand string is in the three extended leaves after 0x80000000.
+  int regs[4]{};
+  char brand[3 * sizeof(regs) + 1]{};
+  __cpuid(regs, 0x80000000);
+  if (static_cast<unsigned int>(regs[0]) >= 0x80000004) {
+    for (int i = 0; i < 3; ++i) {
+      __cpuid(regs, 0x80000002 + i);
+      std::memcpy(brand + i * sizeof(regs), regs, sizeof(regs));
+    }
+  }
+
+  std::stringstream id;
+  id << brand << " x" << std::thread::hardware_concurrency();
+  return id.str();
+}
+
+
+std::string EncoderCapacity::Recommend(
+    const boost::property_tree::ptree &candidates) {
+  std::unordered_set<std::string> sustained;
+  for (const auto &elem : candidates) {
+    const auto &candidate = elem.second;
+    if (candidate.get("sustainable", false) == true) {
+      sustained.emplace(candidate.get("name", ""));
+    }
+  }
+
+  // each quality is a candidate of its own, at its own bitrate and
+  // with the headroom it needs.
+  if (sustained.count("high") > 0) {
+    return "high";
+  }
+  if (sustained.count("medium") > 0) {
+    return "medium";
+  }
+  return "low";
+}
+
+
+void EncoderCapacity::Probe() {
+  boost::property_tree::ptree candidates;
+  uint64_t max_pixel_rate{0};
+  bool complete{true};
+  const auto &all = ObsEncoderCapacityProbe::GetDefaultCandidates();
+  for (const auto &candidate : all) {
+    // stopped by a capture, it is tried again at the next start.
+    if (quit_ == true) {
+      complete = false;
+      break;
+    }
+
+    const auto &result = ObsEncoderCapacityProbe::Measure(
+        candidate, kMeasureDuration, quit_);
+    candidates.push_back(std::make_pair("", result));
+    if (result.get("sustainable", false) == false) {
+      complete = (result.count("cancelled") == 0 &&
+                  result.count("error") == 0);
+      // the rest cost more.
+      break;
+    }
+    max_pixel_rate = candidate.GetPixelRate();
+  }
+
+  if (complete == false) {
+    std::lock_guard<std::mutex> lock{mutex_};
+    probing_ = false;
+    return;
+  }
+
+  const std::string &recommended_quality = Recommend(candidates);
+
+  boost::property_tree::ptree stored;
+  stored.put("machine", machine_id_);
+  stored.put("version", kStoredVersion);
+  stored.put("recommendedQuality", recommended_quality);
+  stored.put("maxPixelRate", max_pixel_rate);
+  stored.add_child("candidates", candidates);
+  LocalStorage::Get()->SetEncoderCapacity(stored);
+
+  std::lock_guard<std::mutex> lock{mutex_};
+  probing_ = false;
+  candidates_ = candidates;
+  recommended_quality_ = recommended_quality;
+  max_pixel_rate_ = max_pixel_rate;
+}
+
+
+EncoderCapacity *EncoderCapacity::static_instance{nullptr};
+}  // namespace ncstreamer
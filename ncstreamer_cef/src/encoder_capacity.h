@@ -0,0 +1,68 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#ifndef NCSTREAMER_CEF_SRC_ENCODER_CAPACITY_H_
+#define NCSTREAMER_CEF_SRC_ENCODER_CAPACITY_H_
+
+
+#include <atomic>
+#include <mutex>  // NOLINT
+#include <string>
+#include <thread>  // NOLINT
+
+#include "boost/property_tree/ptree.hpp"
+
+#include "ncstreamer_cef/src/lib/dimension.h"
+
+
+namespace ncstreamer {
+// how much x264 this machine sustains; probed once in the background
+// and kept in the local storage until the machine changes.
+class EncoderCapacity {
+ public:
+  // after the local storage and obs.
+  static void SetUp();
+  static void ShutDown();
+  static EncoderCapacity *Get();
+
+  // "low", "medium" or "high", the costliest of them sustained with its
+  // headroom; empty until known.
+  std::string GetRecommendedQuality() const;
+  // false while unknown.
+  bool IsOverCapacity(
+      const Dimension<uint32_t> &output_size,
+      uint32_t fps) const;
+
+  boost::property_tree::ptree ToTree() const;
+
+ private:
+  EncoderCapacity();
+  virtual ~EncoderCapacity();
+
+  static std::string GetMachineId();
+  static std::string Recommend(const boost::property_tree::ptree &candidates);
+
+  void Probe();
+
+  static EncoderCapacity *static_instance;
+
+  const std::string machine_id_;
+
+  mutable std::mutex mutex_;
+  bool probing_;
+  boost::property_tree::ptree candidates_;
+  std::string recommended_quality_;
+  // of the most expensive candidate sustained; 0 if none.
+  uint64_t max_pixel_rate_;
+
+  // set at the shut-down, or by obs as a capture starts; measured
+  // under a capture, the probe would tell little about the machine.
+  std::atomic<bool> quit_;
+  std::thread probe_thread_;
+};
+}  // namespace ncstreamer
+
+
+#endif  // NCSTREAMER_CEF_SRC_ENCODER_CAPACITY_H_
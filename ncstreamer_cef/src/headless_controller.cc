@@ -0,0 +1,232 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#include "ncstreamer_cef/src/headless_controller.h"
+
+#include <cassert>
+#include <memory>
+#include <tuple>
+#include <unordered_map>
+
+#include "ncstreamer_cef/src/encoder_capacity.h"
+#include "ncstreamer_cef/src/lib/dimension.h"
+#include "ncstreamer_cef/src/obs.h"
+#include "ncstreamer_cef/src/remote_server.h"
+
+
+namespace ncstreamer {
+void HeadlessController::SetUp(const std::string &video_quality) {
+  assert(!static_instance);
+  static_instance = new HeadlessController{video_quality};
+}
+
+
+void HeadlessController::ShutDown() {
+  assert(static_instance);
+  delete static_instance;
+  static_instance = nullptr;
+}
+
+
+HeadlessController *HeadlessController::Get() {
+  assert(static_instance);
+  return static_instance;
+}
+
+
+void HeadlessController::OnStreamingStatusRequest(int request_key) {
+  std::lock_guard<std::mutex> lock{mutex_};
+
+  RemoteServer::Get()->RespondStreamingStatus(
+      request_key,
+      ToString(status_),
+      source_title_,
+      /*user_name*/ "",
+      quality_);
+}
+
+
+void HeadlessController::OnStreamingStartRequest(
+    int request_key,
+    const std::string &source_title,
+    const std::string &service_provider,
+    const std::string &stream_url,
+    bool mic) {
+  // without a browser, nobody can log in to post a live video.
+  if (stream_url.empty() == true) {
+    RemoteServer::Get()->RespondStreamingStart(request_key, "no stream url");
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    if (status_ != Status::kStandby) {
+      const std::string &error = (source_title == source_title_) ?
+          "not standby: self" : "not standby: other";
+      RemoteServer::Get()->RespondStreamingStart(request_key, error);
+      return;
+    }
+    status_ = Status::kStarting;
+    source_title_ = source_title;
+  }
+
+  const std::string &source = Obs::Get()->FindSourceByTitle(source_title);
+  bool result{false};
+  if (source.empty() == false) {
+    result = Obs::Get()->StartStreaming(
+        source,
+        service_provider,
+        stream_url,
+        mic,
+        [this, request_key]() {
+      {
+        std::lock_guard<std::mutex> lock{mutex_};
+        status_ = Status::kOnAir;
+      }
+      RemoteServer::Get()->RespondStreamingStart(request_key, "");
+    });
+  }
+
+  if (result == false) {
+    {
+      std::lock_guard<std::mutex> lock{mutex_};
+      status_ = Status::kStandby;
+      source_title_.clear();
+    }
+    RemoteServer::Get()->RespondStreamingStart(
+        request_key, source.empty() ? "unknown title" : "obs internal");
+  }
+}
+
+
+void HeadlessController::OnStreamingStopRequest(
+    int request_key,
+    const std::string &source_title) {
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    if (status_ != Status::kOnAir) {
+      RemoteServer::Get()->RespondStreamingStop(request_key, "not onAir");
+      return;
+    }
+    if (source_title != source_title_) {
+      RemoteServer::Get()->RespondStreamingStop(request_key, "title mismatch");
+      return;
+    }
+    status_ = Status::kStopping;
+  }
+
+  Obs::Get()->StopStreaming([this, request_key]() {
+    {
+      std::lock_guard<std::mutex> lock{mutex_};
+      status_ = Status::kStandby;
+      source_title_.clear();
+    }
+    RemoteServer::Get()->RespondStreamingStop(request_key, "");
+  });
+}
+
+
+void HeadlessController::OnSettingsQualityUpdateRequest(
+    int request_key,
+    const std::string &quality) {
+  bool result = UpdateVideoQuality(quality);
+  RemoteServer::Get()->RespondSettingsQualityUpdate(
+      request_key,
+      result ? "" : "unknown quality");
+}
+
+
+void HeadlessController::Quit() {
+  ::PostThreadMessage(main_thread_id_, WM_QUIT, 0, 0);
+}
+
+
+void HeadlessController::Post(const std::function<void()> &task) {
+  auto posted = new std::function<void()>{task};
+  if (::PostThreadMessage(
+          main_thread_id_,
+          kTaskMessage,
+          0,
+          reinterpret_cast<LPARAM>(posted)) == FALSE) {
+    delete posted;
+  }
+}
+
+
+bool HeadlessController::RunTask(const MSG &msg) {
+  if (msg.message != kTaskMessage) {
+    return false;
+  }
+  std::unique_ptr<std::function<void()>> task{
+      reinterpret_cast<std::function<void()> *>(msg.lParam)};
+  (*task)();
+  return true;
+}
+
+
+HeadlessController::HeadlessController(const std::string &video_quality)
+    : main_thread_id_{::GetCurrentThreadId()},
+      mutex_{},
+      status_{Status::kStandby},
+      source_title_{},
+      quality_{} {
+  if (UpdateVideoQuality(video_quality) == false) {
+    UpdateVideoQuality("medium");
+  }
+}
+
+
+HeadlessController::~HeadlessController() {
+}
+
+
+const char *HeadlessController::ToString(Status status) {
+  switch (status) {
+    case Status::kStandby: return "standby";
+    case Status::kStarting: return "starting";
+    case Status::kOnAir: return "onAir";
+    case Status::kStopping: return "stopping";
+  }
+  return "";
+}
+
+
+bool HeadlessController::UpdateVideoQuality(const std::string &quality) {
+  if (quality == "auto") {
+    // medium until the capacity of this machine is known.
+    const std::string &recommended =
+        EncoderCapacity::Get()->GetRecommendedQuality();
+    return UpdateVideoQuality(recommended.empty() ? "medium" : recommended);
+  }
+
+  // the same presets as the ui offers.
+  static const std::unordered_map<
+      std::string,
+      std::tuple<Dimension<uint32_t> /*output_size*/,
+                 uint32_t /*fps*/,
+                 uint32_t /*bitrate*/>> kQualities{
+      {"high", std::make_tuple(Dimension<uint32_t>{1280, 720}, 30, 4000)},
+      {"medium", std::make_tuple(Dimension<uint32_t>{1280, 720}, 30, 3000)},
+      {"low", std::make_tuple(Dimension<uint32_t>{854, 480}, 30, 1000)}};
+
+  auto i = kQualities.find(quality);
+  if (i == kQualities.end()) {
+    return false;
+  }
+
+  Dimension<uint32_t> output_size{0, 0};
+  uint32_t fps{0};
+  uint32_t bitrate{0};
+  std::tie(output_size, fps, bitrate) = i->second;
+  Obs::Get()->UpdateVideoQuality(output_size, fps, bitrate);
+
+  std::lock_guard<std::mutex> lock{mutex_};
+  quality_ = quality;
+  return true;
+}
+
+
+HeadlessController *HeadlessController::static_instance{nullptr};
+}  // namespace ncstreamer
@@ -0,0 +1,76 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#ifndef NCSTREAMER_CEF_SRC_HEADLESS_CONTROLLER_H_
+#define NCSTREAMER_CEF_SRC_HEADLESS_CONTROLLER_H_
+
+
+#include <functional>
+#include <mutex>  // NOLINT
+#include <string>
+
+#include "windows.h"  // NOLINT
+
+
+namespace ncstreamer {
+// the streaming state model of the ui, in native code;
+// answers the remote requests which go to the browser otherwise.
+class HeadlessController {
+ public:
+  static void SetUp(const std::string &video_quality);
+  static void ShutDown();
+  static HeadlessController *Get();
+
+  void OnStreamingStatusRequest(int request_key);
+  void OnStreamingStartRequest(
+      int request_key,
+      const std::string &source_title,
+      const std::string &service_provider,
+      const std::string &stream_url,
+      bool mic);
+  void OnStreamingStopRequest(
+      int request_key,
+      const std::string &source_title);
+  void OnSettingsQualityUpdateRequest(
+      int request_key,
+      const std::string &quality);
+
+  // ends the message loop of the thread which called SetUp().
+  void Quit();
+  // runs the task on the thread which called SetUp(), which owns obs,
+  // as its message loop comes to it.
+  void Post(const std::function<void()> &task);
+  // for the message loop; false if the message is not of Post().
+  static bool RunTask(const MSG &msg);
+
+ private:
+  enum class Status {
+    kStandby,
+    kStarting,
+    kOnAir,
+    kStopping,
+  };
+
+  explicit HeadlessController(const std::string &video_quality);
+  virtual ~HeadlessController();
+
+  static const UINT kTaskMessage{WM_APP + 1};
+
+  static const char *ToString(Status status);
+  bool UpdateVideoQuality(const std::string &quality);
+
+  static HeadlessController *static_instance;
+
+  const DWORD main_thread_id_;
+
+  mutable std::mutex mutex_;
+  Status status_;
+  std::string source_title_;
+  std::string quality_;
+};
+}  // namespace ncstreamer
+
+
+#endif  // NCSTREAMER_CEF_SRC_HEADLESS_CONTROLLER_H_
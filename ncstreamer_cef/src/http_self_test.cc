@@ -0,0 +1,552 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#include "ncstreamer_cef/src/http_self_test.h"
+
+#include <chrono>  // NOLINT
+#include <condition_variable>  // NOLINT
+#include <memory>
+#include <mutex>  // NOLINT
+#include <sstream>
+#include <thread>  // NOLINT
+
+#include "boost/system/error_code.hpp"
+
+#include "ncstreamer_cef/src/lib/http_request_service.h"
+#include "ncstreamer_cef/src/lib/http_types.h"
+
+
+namespace {
+const std::size_t kParallelGets{300};
+const std::size_t kParallelGetsConcurrency{8};
+const std::size_t kParallelJson{100};
+const std::size_t kLenBodySize{1024};
+const std::size_t kFlakyFailures{2};
+const uint32_t kSlowLatencyMs{2000};
+
+// short deadlines, so that the stalls are given up on quickly.
+const std::chrono::milliseconds kConnectTimeout{1000};
+const std::chrono::milliseconds kFirstByteTimeout{300};
+const std::chrono::milliseconds kTotalTimeout{500};
+const std::chrono::milliseconds kBaseDelay{50};
+// for the deadlines not under check.
+const std::chrono::milliseconds kLongTimeout{10000};
+
+// long enough for any check on a loaded machine; only a hang takes it.
+const std::chrono::seconds kCheckTimeout{60};
+}  // unnamed namespace
+
+
+namespace ncstreamer {
+// the outcomes of the requests of a check, shared by their handlers.
+class HttpSelfTest::Tally {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  explicit Tally(std::size_t requests)
+      : requests_{requests},
+        mutex_{},
+        done_condition_{},
+        succeeded_{0},
+        failed_{0},
+        retries_{0},
+        last_error_{},
+        started_{Clock::now()},
+        elapsed_{} {
+  }
+
+  void OnSucceeded() {
+    std::lock_guard<std::mutex> lock{mutex_};
+    ++succeeded_;
+    OnDoneLocked();
+  }
+
+  void OnFailed(const boost::system::error_code &ec) {
+    std::lock_guard<std::mutex> lock{mutex_};
+    ++failed_;
+    last_error_ = ec;
+    OnDoneLocked();
+  }
+
+  void OnRetried() {
+    std::lock_guard<std::mutex> lock{mutex_};
+    ++retries_;
+  }
+
+  // false if the time runs out before every request is done.
+  bool Wait(const std::chrono::seconds &timeout) {
+    std::unique_lock<std::mutex> lock{mutex_};
+    return done_condition_.wait_for(lock, timeout, [this]() {
+      return succeeded_ + failed_ >= requests_;
+    });
+  }
+
+  std::size_t succeeded() const {
+    std::lock_guard<std::mutex> lock{mutex_};
+    return succeeded_;
+  }
+
+  std::size_t retries() const {
+    std::lock_guard<std::mutex> lock{mutex_};
+    return retries_;
+  }
+
+  boost::system::error_code last_error() const {
+    std::lock_guard<std::mutex> lock{mutex_};
+    return last_error_;
+  }
+
+  Clock::duration elapsed() const {
+    std::lock_guard<std::mutex> lock{mutex_};
+    return elapsed_;
+  }
+
+  boost::property_tree::ptree ToTree() const {
+    std::lock_guard<std::mutex> lock{mutex_};
+
+    boost::property_tree::ptree tree;
+    tree.put("requests", requests_);
+    tree.put("succeeded", succeeded_);
+    tree.put("failed", failed_);
+    tree.put("retries", retries_);
+    tree.put("durationMs", std::chrono::duration_cast<
+        std::chrono::milliseconds>(elapsed_).count());
+    tree.put("lastError", last_error_ ? last_error_.message() : "");
+    return std::move(tree);
+  }
+
+ private:
+  void OnDoneLocked() {
+    if (succeeded_ + failed_ < requests_) {
+      return;
+    }
+    elapsed_ = Clock::now() - started_;
+    done_condition_.notify_all();
+  }
+
+  const std::size_t requests_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable done_condition_;
+  std::size_t succeeded_;
+  std::size_t failed_;
+  std::size_t retries_;
+  boost::system::error_code last_error_;
+  const Clock::time_point started_;
+  Clock::duration elapsed_;
+};
+
+
+std::vector<HttpMockServer::Route> HttpSelfTest::GetRoutes() {
+  std::stringstream script;
+  script << R"({"routes": [
+      {"method": "GET", "path": "/self_test/len", "latencyMs": 10,
+       "bodySize": )" << kLenBodySize << R"(},
+      {"method": "GET", "path": "/self_test/me", "latencyMs": 5,
+       "chunkSize": 16, "body": {"id": "1000", "name": "Self Test"}},
+      {"method": "POST", "path": "/self_test/{page}/live_videos",
+       "latencyMs": 5,
+       "body": {"id": "3000",
+                "stream_url": "rtmp://127.0.0.1/live/self_test"}},
+      {"method": "GET", "path": "/self_test/stall", "failure": "stall"},
+      {"method": "GET", "path": "/self_test/stall_body", "bodySize": 1024,
+       "failure": "stall", "failAfterBytes": 16},
+      {"method": "GET", "path": "/self_test/flaky", "body": "ok",
+       "failure": "status", "failTimes": )" << kFlakyFailures << R"(},
+      {"method": "POST", "path": "/self_test/error",
+       "failure": "status", "failStatus": 500},
+      {"method": "POST", "path": "/self_test/dropped", "body": "ok",
+       "failure": "drop", "failTimes": 1},
+      {"method": "GET", "path": "/self_test/slow",
+       "latencyMs": )" << kSlowLatencyMs << R"(, "body": "slow"}]})";
+  return HttpMockServer::ParseScript(script.str());
+}
+
+
+HttpSelfTest::HttpSelfTest(const std::string &server_uri)
+    : server_uri_{server_uri} {
+}
+
+
+HttpSelfTest::~HttpSelfTest() {
+}
+
+
+boost::property_tree::ptree HttpSelfTest::Run() const {
+  using Check = boost::property_tree::ptree (HttpSelfTest::*)() const;
+  static const Check kChecks[]{
+      &HttpSelfTest::CheckParallelGets,
+      &HttpSelfTest::CheckParallelJson,
+      &HttpSelfTest::CheckFirstByteTimeout,
+      &HttpSelfTest::CheckRetriedTimeout,
+      &HttpSelfTest::CheckTotalTimeout,
+      &HttpSelfTest::CheckRetriedStatus,
+      &HttpSelfTest::CheckPostNotRetried,
+      &HttpSelfTest::CheckPostNotResent,
+      &HttpSelfTest::CheckCancelRunning,
+      &HttpSelfTest::CheckCancelPending};
+
+  boost::property_tree::ptree checks;
+  bool passed{true};
+  for (Check check : kChecks) {
+    const auto &result = (this->*check)();
+    passed &= result.get<bool>("passed", false);
+    checks.push_back({"", result});
+  }
+
+  boost::property_tree::ptree tree;
+  tree.put("serverUri", server_uri_);
+  tree.put("passed", passed);
+  tree.add_child("checks", checks);
+  return std::move(tree);
+}
+
+
+boost::property_tree::ptree HttpSelfTest::CheckParallelGets() const {
+  auto tally = std::make_shared<Tally>(kParallelGets);
+  bool done{false};
+  {
+    HttpRequestService service{kParallelGetsConcurrency};
+    for (std::size_t i = 0; i < kParallelGets; ++i) {
+      // apart by the query, so that the gets are not shared in flight.
+      std::stringstream uri;
+      uri << server_uri_ << "/self_test/len?n=" << i;
+      service.Get(
+          uri.str(),
+          [tally](const boost::system::error_code &ec) {
+        tally->OnFailed(ec);
+      }, [tally](const std::string &data) {
+        if (data.size() != kLenBodySize) {
+          tally->OnFailed(boost::system::errc::make_error_code(
+              boost::system::errc::bad_message));
+          return;
+        }
+        tally->OnSucceeded();
+      });
+    }
+    done = tally->Wait(kCheckTimeout);
+  }
+
+  boost::property_tree::ptree tree{tally->ToTree()};
+  tree.put("name", "parallelGets");
+  tree.put("concurrency", kParallelGetsConcurrency);
+  tree.put("passed", done && tally->succeeded() == kParallelGets);
+  return std::move(tree);
+}
+
+
+boost::property_tree::ptree HttpSelfTest::CheckParallelJson() const {
+  auto tally = std::make_shared<Tally>(kParallelJson * 2);
+  bool done{false};
+  {
+    HttpRequestService service;
+    auto on_failed = [tally](const boost::system::error_code &ec) {
+      tally->OnFailed(ec);
+    };
+    auto on_mismatched = [tally]() {
+      tally->OnFailed(boost::system::errc::make_error_code(
+          boost::system::errc::bad_message));
+    };
+
+    boost::property_tree::ptree post_content;
+    post_content.put("access_token", "self-test-token");
+    for (std::size_t i = 0; i < kParallelJson; ++i) {
+      std::stringstream me_uri;
+      me_uri << server_uri_ << "/self_test/me?n=" << i;
+      service.GetJson(
+          me_uri.str(),
+          {"id", "name"},
+          on_failed,
+          [tally, on_mismatched](const boost::property_tree::ptree &tree) {
+        if (tree.get<std::string>("id", "") != "1000") {
+          on_mismatched();
+          return;
+        }
+        tally->OnSucceeded();
+      });
+
+      std::stringstream live_videos_uri;
+      live_videos_uri << server_uri_ << "/self_test/" << i << "/live_videos";
+      service.PostJson(
+          live_videos_uri.str(),
+          post_content,
+          {"id", "stream_url"},
+          on_failed,
+          [tally, on_mismatched](const boost::property_tree::ptree &tree) {
+        if (tree.get<std::string>("stream_url", "").empty() == true) {
+          on_mismatched();
+          return;
+        }
+        tally->OnSucceeded();
+      });
+    }
+    done = tally->Wait(kCheckTimeout);
+  }
+
+  boost::property_tree::ptree tree{tally->ToTree()};
+  tree.put("name", "parallelJson");
+  tree.put("passed", done && tally->succeeded() == kParallelJson * 2);
+  return std::move(tree);
+}
+
+
+boost::property_tree::ptree HttpSelfTest::CheckFirstByteTimeout() const {
+  auto tally = std::make_shared<Tally>(1);
+  bool done{false};
+  {
+    HttpRequestService service;
+    Get(&service, "/self_test/stall", HttpRequestPolicy{
+        kConnectTimeout, kFirstByteTimeout, kLongTimeout, 0, kBaseDelay},
+        tally);
+    done = tally->Wait(kCheckTimeout);
+  }
+
+  return ToResult(
+      "firstByteTimeout",
+      *tally,
+      done,
+      HttpRequestError::Make(HttpRequestError::kFirstByteTimeout),
+      kFirstByteTimeout * 2);
+}
+
+
+boost::property_tree::ptree HttpSelfTest::CheckRetriedTimeout() const {
+  static const uint32_t kMaxRetries{2};
+
+  auto tally = std::make_shared<Tally>(1);
+  bool done{false};
+  {
+    HttpRequestService service;
+    Get(&service, "/self_test/stall", HttpRequestPolicy{
+        kConnectTimeout, kFirstByteTimeout, kLongTimeout, kMaxRetries,
+        kBaseDelay}, tally);
+    done = tally->Wait(kCheckTimeout);
+  }
+
+  // every try waits out the first byte, and the delays add up to less
+  // than one more.
+  auto tree = ToResult(
+      "retriedTimeout",
+      *tally,
+      done,
+      HttpRequestError::Make(HttpRequestError::kFirstByteTimeout),
+      kFirstByteTimeout * (kMaxRetries + 2));
+  tree.put("passed",
+      tree.get<bool>("passed") && tally->retries() == kMaxRetries);
+  return std::move(tree);
+}
+
+
+boost::property_tree::ptree HttpSelfTest::CheckTotalTimeout() const {
+  auto tally = std::make_shared<Tally>(1);
+  bool done{false};
+  {
+    HttpRequestService service;
+    Get(&service, "/self_test/stall_body", HttpRequestPolicy{
+        kConnectTimeout, kLongTimeout, kTotalTimeout, 0, kBaseDelay},
+        tally);
+    done = tally->Wait(kCheckTimeout);
+  }
+
+  return ToResult(
+      "totalTimeout",
+      *tally,
+      done,
+      HttpRequestError::Make(HttpRequestError::kTotalTimeout),
+      kTotalTimeout * 2);
+}
+
+
+boost::property_tree::ptree HttpSelfTest::CheckRetriedStatus() const {
+  auto tally = std::make_shared<Tally>(1);
+  bool done{false};
+  {
+    HttpRequestService service;
+    Get(&service, "/self_test/flaky", HttpRequestPolicy{
+        kConnectTimeout, kLongTimeout, kLongTimeout, kFlakyFailures + 1,
+        kBaseDelay}, tally);
+    done = tally->Wait(kCheckTimeout);
+  }
+
+  auto tree = ToResult(
+      "retriedStatus",
+      *tally,
+      done,
+      {},
+      kLongTimeout);
+  tree.put("passed",
+      tree.get<bool>("passed") && tally->retries() == kFlakyFailures);
+  return std::move(tree);
+}
+
+
+boost::property_tree::ptree HttpSelfTest::CheckPostNotRetried() const {
+  auto tally = std::make_shared<Tally>(1);
+  bool done{false};
+  {
+    HttpRequestService service;
+    Post(&service,
+         "/self_test/error",
+         HttpRequestPolicy{
+             kConnectTimeout, kLongTimeout, kLongTimeout, 2, kBaseDelay},
+         tally);
+    done = tally->Wait(kCheckTimeout);
+  }
+
+  auto tree = ToResult(
+      "postNotRetried",
+      *tally,
+      done,
+      urdl::http::make_error_code(urdl::http::errc::internal_server_error),
+      kLongTimeout);
+  tree.put("passed", tree.get<bool>("passed") && tally->retries() == 0);
+  return std::move(tree);
+}
+
+
+boost::property_tree::ptree HttpSelfTest::CheckPostNotResent() const {
+  auto kept_alive = std::make_shared<Tally>(1);
+  auto tally = std::make_shared<Tally>(1);
+  bool done{false};
+  {
+    // a single connection, left open by the get for the post.
+    HttpRequestService service{1};
+    Get(&service, "/self_test/len?n=kept_alive", HttpRequestPolicy{},
+        kept_alive);
+    kept_alive->Wait(kCheckTimeout);
+
+    // the server drops the first post only; the second would succeed.
+    Post(&service,
+         "/self_test/dropped",
+         HttpRequestPolicy{
+             kConnectTimeout, kLongTimeout, kLongTimeout, 2, kBaseDelay},
+         tally);
+    done = tally->Wait(kCheckTimeout);
+  }
+
+  // the drop is an end of file over http, but a truncated stream over
+  // https; either will do.
+  boost::property_tree::ptree tree{tally->ToTree()};
+  tree.put("name", "postNotResent");
+  tree.put("passed",
+      done == true &&
+      kept_alive->succeeded() == 1 &&
+      tally->succeeded() == 0 &&
+      tally->retries() == 0);
+  return std::move(tree);
+}
+
+
+boost::property_tree::ptree HttpSelfTest::CheckCancelRunning() const {
+  static const std::chrono::milliseconds kCancelAfter{100};
+
+  auto tally = std::make_shared<Tally>(1);
+  bool done{false};
+  {
+    HttpRequestService service;
+    auto handle = Get(&service, "/self_test/slow", HttpRequestPolicy{}, tally);
+    std::this_thread::sleep_for(kCancelAfter);
+    handle->Cancel();
+    done = tally->Wait(kCheckTimeout);
+  }
+
+  return ToResult(
+      "cancelRunning",
+      *tally,
+      done,
+      HttpRequestError::Make(HttpRequestError::kCancelled),
+      std::chrono::milliseconds{kSlowLatencyMs / 2});
+}
+
+
+boost::property_tree::ptree HttpSelfTest::CheckCancelPending() const {
+  auto running = std::make_shared<Tally>(1);
+  auto pending = std::make_shared<Tally>(1);
+  bool done{false};
+  {
+    HttpRequestService service{1};
+    auto running_handle = Get(
+        &service, "/self_test/slow?n=running", HttpRequestPolicy{}, running);
+    auto pending_handle = Get(
+        &service, "/self_test/slow?n=pending", HttpRequestPolicy{}, pending);
+    pending_handle->Cancel();
+    done = pending->Wait(kCheckTimeout);
+
+    running_handle->Cancel();
+    running->Wait(kCheckTimeout);
+  }
+
+  return ToResult(
+      "cancelPending",
+      *pending,
+      done,
+      HttpRequestError::Make(HttpRequestError::kCancelled),
+      std::chrono::milliseconds{kSlowLatencyMs / 2});
+}
+
+
+std::shared_ptr<HttpRequestHandle> HttpSelfTest::Get(
+    HttpRequestService *service,
+    const std::string &path,
+    const HttpRequestPolicy &policy,
+    const std::shared_ptr<Tally> &tally) const {
+  return service->Get(
+      server_uri_ + path,
+      policy,
+      [tally](const boost::system::error_code &ec) {
+    tally->OnFailed(ec);
+  }, [tally](const boost::system::error_code &/*ec*/,
+             uint32_t /*retry*/,
+             const std::chrono::milliseconds &/*delay*/) {
+    tally->OnRetried();
+  }, [](std::size_t /*file_size*/) {
+  }, [](std::size_t /*read_size*/) {
+  }, [tally](const std::string &/*data*/) {
+    tally->OnSucceeded();
+  });
+}
+
+
+std::shared_ptr<HttpRequestHandle> HttpSelfTest::Post(
+    HttpRequestService *service,
+    const std::string &path,
+    const HttpRequestPolicy &policy,
+    const std::shared_ptr<Tally> &tally) const {
+  return service->Post(
+      server_uri_ + path,
+      {},
+      policy,
+      [tally](const boost::system::error_code &ec) {
+    tally->OnFailed(ec);
+  }, [tally](const boost::system::error_code &/*ec*/,
+             uint32_t /*retry*/,
+             const std::chrono::milliseconds &/*delay*/) {
+    tally->OnRetried();
+  }, [](std::size_t /*file_size*/) {
+  }, [](std::size_t /*read_size*/) {
+  }, [tally](const std::string &/*data*/) {
+    tally->OnSucceeded();
+  });
+}
+
+
+boost::property_tree::ptree HttpSelfTest::ToResult(
+    const std::string &name,
+    const Tally &tally,
+    bool done,
+    const boost::system::error_code &expected_error,
+    const std::chrono::milliseconds &max_duration) {
+  boost::property_tree::ptree tree{tally.ToTree()};
+  tree.put("name", name);
+  tree.put("expectedError",
+      expected_error ? expected_error.message() : "");
+  tree.put("maxDurationMs", max_duration.count());
+  tree.put("passed",
+      done == true &&
+      tally.last_error() == expected_error &&
+      tally.elapsed() <= max_duration);
+  return std::move(tree);
+}
+}  // namespace ncstreamer
@@ -0,0 +1,86 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#ifndef NCSTREAMER_CEF_SRC_HTTP_SELF_TEST_H_
+#define NCSTREAMER_CEF_SRC_HTTP_SELF_TEST_H_
+
+
+#include <chrono>  // NOLINT
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "boost/property_tree/ptree.hpp"
+#include "boost/system/error_code.hpp"
+
+#include "ncstreamer_cef/src/lib/http_mock_server.h"
+#include "ncstreamer_cef/src/lib/http_request_handle.h"
+#include "ncstreamer_cef/src/lib/http_request_policy.h"
+
+
+namespace ncstreamer {
+class HttpRequestService;
+
+
+// drives the http request service against the mock server, over the
+// routes of its own, and reports check by check.
+class HttpSelfTest {
+ public:
+  static std::vector<HttpMockServer::Route> GetRoutes();
+
+  explicit HttpSelfTest(const std::string &server_uri);
+  virtual ~HttpSelfTest();
+
+  // blocks until every check is done.
+  boost::property_tree::ptree Run() const;
+
+ private:
+  class Tally;
+
+  // hundreds of gets at a time, more than the concurrency.
+  boost::property_tree::ptree CheckParallelGets() const;
+  // gets of json racing posts of json, as the login and the start do.
+  boost::property_tree::ptree CheckParallelJson() const;
+  // a server which never answers, with and without retries.
+  boost::property_tree::ptree CheckFirstByteTimeout() const;
+  boost::property_tree::ptree CheckRetriedTimeout() const;
+  // a server which stops in the middle of the body.
+  boost::property_tree::ptree CheckTotalTimeout() const;
+  // a server which fails twice before it answers.
+  boost::property_tree::ptree CheckRetriedStatus() const;
+  // a post is not idempotent, so is never retried.
+  boost::property_tree::ptree CheckPostNotRetried() const;
+  // nor sent again when its kept-alive connection is closed.
+  boost::property_tree::ptree CheckPostNotResent() const;
+  boost::property_tree::ptree CheckCancelRunning() const;
+  // a request waiting for its turn behind a slow one.
+  boost::property_tree::ptree CheckCancelPending() const;
+
+  // a get of the path; its outcome and its retries go to the tally.
+  std::shared_ptr<HttpRequestHandle> Get(
+      HttpRequestService *service,
+      const std::string &path,
+      const HttpRequestPolicy &policy,
+      const std::shared_ptr<Tally> &tally) const;
+  // a post of nothing to the path, as the get.
+  std::shared_ptr<HttpRequestHandle> Post(
+      HttpRequestService *service,
+      const std::string &path,
+      const HttpRequestPolicy &policy,
+      const std::shared_ptr<Tally> &tally) const;
+  // whether the request of the tally ended with the error, in time.
+  static boost::property_tree::ptree ToResult(
+      const std::string &name,
+      const Tally &tally,
+      bool done,
+      const boost::system::error_code &expected_error,
+      const std::chrono::milliseconds &max_duration);
+
+  const std::string server_uri_;
+};
+}  // namespace ncstreamer
+
+
+#endif  // NCSTREAMER_CEF_SRC_HTTP_SELF_TEST_H_
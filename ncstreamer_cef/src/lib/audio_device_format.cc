@@ -0,0 +1,77 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#include "ncstreamer_cef/src/lib/audio_device_format.h"
+
+#include "windows.h"  // NOLINT
+#include "audioclient.h"  // NOLINT
+#include "mmdeviceapi.h"  // NOLINT
+
+
+namespace ncstreamer {
+bool AudioDeviceFormat::GetDefault(Flow flow, AudioDeviceFormat *format) {
+  // the calling thread may have joined an apartment already.
+  HRESULT com_result = ::CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+  bool com_initialized = SUCCEEDED(com_result);
+
+  IMMDeviceEnumerator *enumerator{nullptr};
+  IMMDevice *device{nullptr};
+  IAudioClient *client{nullptr};
+  WAVEFORMATEX *mix_format{nullptr};
+
+  bool found{false};
+  if (SUCCEEDED(::CoCreateInstance(
+          __uuidof(MMDeviceEnumerator), nullptr, CLSCTX_ALL,
+          __uuidof(IMMDeviceEnumerator),
+          reinterpret_cast<void **>(&enumerator))) &&
+      SUCCEEDED(enumerator->GetDefaultAudioEndpoint(
+          (flow == Flow::kRender) ? eRender : eCapture,
+          eConsole,
+          &device)) &&
+      SUCCEEDED(device->Activate(
+          __uuidof(IAudioClient), CLSCTX_ALL, nullptr,
+          reinterpret_cast<void **>(&client))) &&
+      SUCCEEDED(client->GetMixFormat(&mix_format))) {
+    *format = {static_cast<uint32_t>(mix_format->nSamplesPerSec),
+               mix_format->nChannels};
+    found = true;
+  }
+
+  if (mix_format) {
+    ::CoTaskMemFree(mix_format);
+  }
+  if (client) {
+    client->Release();
+  }
+  if (device) {
+    device->Release();
+  }
+  if (enumerator) {
+    enumerator->Release();
+  }
+  if (com_initialized == true) {
+    ::CoUninitialize();
+  }
+  return found;
+}
+
+
+AudioDeviceFormat::AudioDeviceFormat()
+    : samples_per_sec_{0},
+      channels_{0} {
+}
+
+
+AudioDeviceFormat::AudioDeviceFormat(
+    uint32_t samples_per_sec,
+    uint32_t channels)
+    : samples_per_sec_{samples_per_sec},
+      channels_{channels} {
+}
+
+
+AudioDeviceFormat::~AudioDeviceFormat() {
+}
+}  // namespace ncstreamer
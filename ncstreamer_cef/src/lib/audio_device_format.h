@@ -0,0 +1,40 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#ifndef NCSTREAMER_CEF_SRC_LIB_AUDIO_DEVICE_FORMAT_H_
+#define NCSTREAMER_CEF_SRC_LIB_AUDIO_DEVICE_FORMAT_H_
+
+
+#include <cstdint>
+
+
+namespace ncstreamer {
+// the shared mode format of a default audio endpoint; whatever is mixed
+// at another rate gets resampled to this one, and back.
+class AudioDeviceFormat {
+ public:
+  enum class Flow {
+    kRender,
+    kCapture,
+  };
+
+  // false if there is no such device, as with no mic plugged in.
+  static bool GetDefault(Flow flow, AudioDeviceFormat *format);
+
+  AudioDeviceFormat();
+  AudioDeviceFormat(uint32_t samples_per_sec, uint32_t channels);
+  virtual ~AudioDeviceFormat();
+
+  uint32_t samples_per_sec() const { return samples_per_sec_; }
+  uint32_t channels() const { return channels_; }
+
+ private:
+  uint32_t samples_per_sec_;
+  uint32_t channels_;
+};
+}  // namespace ncstreamer
+
+
+#endif  // NCSTREAMER_CEF_SRC_LIB_AUDIO_DEVICE_FORMAT_H_
@@ -0,0 +1,110 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#include "ncstreamer_cef/src/lib/cpu_usage.h"
+
+#include "windows.h"  // NOLINT
+
+
+namespace ncstreamer {
+CpuUsage::CpuUsage()
+    : processors_size_{[]() {
+        SYSTEM_INFO info;
+        ::GetSystemInfo(&info);
+        return static_cast<unsigned int>(info.dwNumberOfProcessors);
+      }()},
+      mutex_{},
+      quit_condition_{},
+      quit_{false},
+      samples_{},
+      last_process_time_{GetProcessTime()},
+      last_sample_time_{Clock::now()},
+      sample_thread_{} {
+  sample_thread_ = std::thread{[this]() {
+    static const std::chrono::seconds kSampleInterval{1};
+
+    std::unique_lock<std::mutex> lock{mutex_};
+    while (quit_condition_.wait_for(
+        lock, kSampleInterval, [this]() { return quit_; }) == false) {
+      Sample();
+    }
+  }};
+}
+
+
+CpuUsage::~CpuUsage() {
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    quit_ = true;
+  }
+  quit_condition_.notify_all();
+  if (sample_thread_.joinable() == true) {
+    sample_thread_.join();
+  }
+}
+
+
+double CpuUsage::GetAverage(
+    const Clock::time_point &from,
+    const Clock::time_point &to) const {
+  double sum{0.0};
+  std::size_t count{0};
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    for (const auto &sample : samples_) {
+      if (sample.first >= from && sample.first < to) {
+        sum += sample.second;
+        ++count;
+      }
+    }
+  }
+  return (count == 0) ? -1.0 : sum / count;
+}
+
+
+double CpuUsage::GetRecentAverage(const Clock::duration &duration) const {
+  Clock::time_point now{Clock::now()};
+  return GetAverage(now - duration, now + std::chrono::seconds{1});
+}
+
+
+uint64_t CpuUsage::GetProcessTime() {
+  FILETIME creation_time;
+  FILETIME exit_time;
+  FILETIME kernel_time;
+  FILETIME user_time;
+  ::GetProcessTimes(::GetCurrentProcess(),
+      &creation_time, &exit_time, &kernel_time, &user_time);
+
+  auto to_100ns = [](const FILETIME &t) {
+    return (static_cast<uint64_t>(t.dwHighDateTime) << 32) | t.dwLowDateTime;
+  };
+  return to_100ns(kernel_time) + to_100ns(user_time);
+}
+
+
+void CpuUsage::Sample() {
+  static const std::chrono::minutes kKeepDuration{5};
+
+  uint64_t process_time = GetProcessTime();
+  Clock::time_point now = Clock::now();
+
+  auto elapsed_100ns = std::chrono::duration_cast<
+      std::chrono::duration<int64_t, std::ratio<1, 10000000>>>(
+          now - last_sample_time_).count();
+  if (elapsed_100ns > 0 && processors_size_ > 0) {
+    double percent = 100.0 * (process_time - last_process_time_) /
+        (static_cast<double>(elapsed_100ns) * processors_size_);
+    samples_.emplace_back(now, percent);
+  }
+  last_process_time_ = process_time;
+  last_sample_time_ = now;
+
+  while (samples_.empty() == false &&
+         samples_.front().first < now - kKeepDuration) {
+    samples_.pop_front();
+  }
+}
+}  // namespace ncstreamer
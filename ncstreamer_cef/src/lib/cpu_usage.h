@@ -0,0 +1,55 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#ifndef NCSTREAMER_CEF_SRC_LIB_CPU_USAGE_H_
+#define NCSTREAMER_CEF_SRC_LIB_CPU_USAGE_H_
+
+
+#include <chrono>  // NOLINT
+#include <condition_variable>  // NOLINT
+#include <cstdint>
+#include <deque>
+#include <mutex>  // NOLINT
+#include <thread>  // NOLINT
+#include <utility>
+
+
+namespace ncstreamer {
+// samples the cpu usage of this process once a second, in percent of
+// the whole machine, and keeps the last few minutes of samples.
+class CpuUsage {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  CpuUsage();
+  virtual ~CpuUsage();
+
+  // returns a negative value if no sample falls into [from, to).
+  double GetAverage(
+      const Clock::time_point &from,
+      const Clock::time_point &to) const;
+  double GetRecentAverage(const Clock::duration &duration) const;
+
+ private:
+  static uint64_t GetProcessTime();
+
+  void Sample();
+
+  const unsigned int processors_size_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable quit_condition_;
+  bool quit_;
+  std::deque<std::pair<Clock::time_point, double /*percent*/>> samples_;
+
+  uint64_t last_process_time_;
+  Clock::time_point last_sample_time_;
+
+  std::thread sample_thread_;
+};
+}  // namespace ncstreamer
+
+
+#endif  // NCSTREAMER_CEF_SRC_LIB_CPU_USAGE_H_
@@ -0,0 +1,286 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#include "ncstreamer_cef/src/lib/http_cache.h"
+
+#include <algorithm>
+#include <cassert>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+#include <utility>
+
+#include "boost/property_tree/json_parser.hpp"
+
+
+namespace ncstreamer {
+void HttpCache::SetUp(const std::wstring &file_path) {
+  assert(!static_instance);
+  static_instance = new HttpCache{file_path};
+}
+
+
+void HttpCache::ShutDown() {
+  assert(static_instance);
+  delete static_instance;
+  static_instance = nullptr;
+}
+
+
+HttpCache *HttpCache::Get() {
+  assert(static_instance);
+  return static_instance;
+}
+
+
+std::string HttpCache::ToKey(
+    const std::string &uri,
+    const std::vector<std::string> &paths,
+    const std::string &user_id) {
+  std::size_t question = uri.find('?');
+  std::stringstream key;
+  key << uri.substr(0, question);
+
+  if (question != std::string::npos) {
+    std::stringstream query{uri.substr(question + 1)};
+    std::string param;
+    char separator{'?'};
+    while (std::getline(query, param, '&')) {
+      const std::string &name = param.substr(0, param.find('='));
+      if (std::find(kTokenParameters.begin(),
+                    kTokenParameters.end(),
+                    name) != kTokenParameters.end()) {
+        continue;
+      }
+      key << separator << param;
+      separator = '&';
+    }
+  }
+
+  // the same uri with other paths picks other values.
+  char separator{'#'};
+  for (const auto &path : paths) {
+    key << separator << path;
+    separator = ',';
+  }
+
+  if (user_id.empty() == false) {
+    key << '@' << user_id;
+  }
+  return key.str();
+}
+
+
+bool HttpCache::Find(const std::string &key, Entry *entry) const {
+  std::lock_guard<std::mutex> lock{mutex_};
+  auto i = entries_.find(key);
+  if (i == entries_.end()) {
+    return false;
+  }
+  *entry = i->second;
+  return true;
+}
+
+
+void HttpCache::Put(const std::string &key, const Entry &entry) {
+  std::lock_guard<std::mutex> lock{mutex_};
+  if (entries_.size() >= kMaxEntrySize &&
+      entries_.find(key) == entries_.end()) {
+    auto oldest = std::min_element(
+        entries_.begin(),
+        entries_.end(),
+        [](const EntryMap::value_type &a, const EntryMap::value_type &b) {
+      return a.second.stored_at() < b.second.stored_at();
+    });
+    entries_.erase(oldest);
+  }
+  entries_[key] = entry;
+  SaveToFile(entries_, file_path_);
+}
+
+
+void HttpCache::Touch(const std::string &key) {
+  std::lock_guard<std::mutex> lock{mutex_};
+  auto i = entries_.find(key);
+  if (i == entries_.end()) {
+    return;
+  }
+  i->second.set_stored_at(Clock::now());
+  SaveToFile(entries_, file_path_);
+}
+
+
+void HttpCache::Clear() {
+  std::lock_guard<std::mutex> lock{mutex_};
+  entries_.clear();
+  SaveToFile(entries_, file_path_);
+}
+
+
+HttpCache::HttpCache(const std::wstring &file_path)
+    : file_path_{file_path},
+      mutex_{},
+      entries_{LoadFromFile(file_path)} {
+}
+
+
+HttpCache::~HttpCache() {
+}
+
+
+boost::property_tree::ptree HttpCache::StripTokens(
+    const boost::property_tree::ptree &tree,
+    bool *stripped) {
+  boost::property_tree::ptree out{tree.data()};
+  for (const auto &elem : tree) {
+    if (std::find(kTokenParameters.begin(),
+                  kTokenParameters.end(),
+                  elem.first) != kTokenParameters.end()) {
+      *stripped = true;
+      continue;
+    }
+    out.push_back(std::make_pair(
+        elem.first, StripTokens(elem.second, stripped)));
+  }
+  return std::move(out);
+}
+
+
+HttpCache::EntryMap HttpCache::LoadFromFile(const std::wstring &file_path) {
+  EntryMap entries;
+
+  if (file_path.empty()) {
+    return entries;
+  }
+
+  std::ifstream fs{file_path};
+  try {
+    boost::property_tree::ptree tree;
+    boost::property_tree::json_parser::read_json(fs, tree);
+    // the keys have dots in them; they are kept in an array.
+    for (const auto &elem : tree.get_child("entries")) {
+      const auto &entry = elem.second;
+      entries.emplace(
+          entry.get<std::string>("key"),
+          Entry{entry.get_child("tree"),
+                entry.get<std::string>("etag"),
+                entry.get<std::string>("lastModified"),
+                Clock::from_time_t(entry.get<std::time_t>("storedAt"))});
+    }
+  } catch (...) {
+    entries.clear();
+  }
+  return entries;
+}
+
+
+void HttpCache::SaveToFile(
+    const EntryMap &entries,
+    const std::wstring &file_path) {
+  if (file_path.empty()) {
+    return;
+  }
+
+  boost::property_tree::ptree arr;
+  for (const auto &elem : entries) {
+    const Entry &entry = elem.second;
+    bool stripped{false};
+    const auto &values = StripTokens(entry.tree(), &stripped);
+
+    // an entry without its tokens is revalidated in full, stale and
+    // with no validator, to get them back at the next launch.
+    boost::property_tree::ptree tree;
+    tree.put("key", elem.first);
+    tree.put("etag", stripped ? "" : entry.etag());
+    tree.put("lastModified", stripped ? "" : entry.last_modified());
+    tree.put("storedAt", stripped ?
+        std::time_t{0} : Clock::to_time_t(entry.stored_at()));
+    tree.put_child("tree", values);
+    arr.push_back(std::make_pair("", tree));
+  }
+
+  boost::property_tree::ptree tree;
+  tree.add_child("entries", arr);
+
+  std::ofstream fs{file_path};
+  boost::property_tree::write_json(fs, tree);
+}
+
+
+const std::vector<std::string> HttpCache::kTokenParameters{
+    "access_token",
+    "appsecret_proof"};
+
+
+const std::size_t HttpCache::kMaxEntrySize{64};
+
+
+HttpCache *HttpCache::static_instance{nullptr};
+
+
+HttpCache::Entry::Entry(
+    const boost::property_tree::ptree &tree,
+    const std::string &etag,
+    const std::string &last_modified,
+    const Clock::time_point &stored_at)
+    : tree_{tree},
+      etag_{etag},
+      last_modified_{last_modified},
+      stored_at_{stored_at} {
+}
+
+
+HttpCache::Entry::Entry()
+    : Entry{{}, "", "", Clock::time_point{}} {
+}
+
+
+HttpCache::Entry::~Entry() {
+}
+
+
+bool HttpCache::Entry::IsFresh(const std::chrono::seconds &ttl) const {
+  return Clock::now() - stored_at_ < ttl;
+}
+
+
+HttpHeaderMap HttpCache::Entry::ToValidators() const {
+  HttpHeaderMap validators;
+  if (etag_.empty() == false) {
+    validators.emplace("If-None-Match", etag_);
+  }
+  if (last_modified_.empty() == false) {
+    validators.emplace("If-Modified-Since", last_modified_);
+  }
+  return validators;
+}
+
+
+HttpCacheSink::HttpCacheSink(const std::vector<std::string> &paths)
+    : HttpJsonSink{paths},
+      status_{0},
+      etag_{},
+      last_modified_{} {
+}
+
+
+HttpCacheSink::~HttpCacheSink() {
+}
+
+
+void HttpCacheSink::Open(int status, const HttpHeaderMap &headers) {
+  status_ = status;
+
+  auto i = headers.find("etag");
+  etag_ = (i == headers.end()) ? "" : i->second;
+  auto j = headers.find("last-modified");
+  last_modified_ = (j == headers.end()) ? "" : j->second;
+}
+
+
+HttpCache::Entry HttpCacheSink::ToEntry() const {
+  return {tree(), etag_, last_modified_, HttpCache::Clock::now()};
+}
+}  // namespace ncstreamer
@@ -0,0 +1,132 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#ifndef NCSTREAMER_CEF_SRC_LIB_HTTP_CACHE_H_
+#define NCSTREAMER_CEF_SRC_LIB_HTTP_CACHE_H_
+
+
+#include <chrono>  // NOLINT
+#include <mutex>  // NOLINT
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "boost/property_tree/ptree.hpp"
+
+#include "ncstreamer_cef/src/lib/http_json_sink.h"
+#include "ncstreamer_cef/src/lib/http_types.h"
+
+
+namespace ncstreamer {
+// keeps the values picked out of the json responses, in memory and in a
+// file, so that they are at hand at the next launch as well.
+// the keys have the id of the user in place of the access token, which
+// is new at every login; the tokens in the values are kept in memory
+// only.
+class HttpCache {
+ public:
+  using Clock = std::chrono::system_clock;
+
+  class Entry;
+
+  // an empty path keeps the cache in memory only.
+  static void SetUp(const std::wstring &file_path);
+  static void ShutDown();
+  static HttpCache *Get();
+
+  // user_id is of the user the values are of; the token parameters of
+  // the uri are left out.
+  static std::string ToKey(
+      const std::string &uri,
+      const std::vector<std::string> &paths,
+      const std::string &user_id);
+
+  bool Find(const std::string &key, Entry *entry) const;
+  void Put(const std::string &key, const Entry &entry);
+  // the entry was revalidated; its age starts over.
+  void Touch(const std::string &key);
+  void Clear();
+
+ private:
+  using EntryMap = std::unordered_map<std::string /*key*/, Entry>;
+
+  explicit HttpCache(const std::wstring &file_path);
+  virtual ~HttpCache();
+
+  // returns the tree without the values named as the token parameters.
+  static boost::property_tree::ptree StripTokens(
+      const boost::property_tree::ptree &tree,
+      bool *stripped);
+
+  static EntryMap LoadFromFile(const std::wstring &file_path);
+  static void SaveToFile(
+      const EntryMap &entries,
+      const std::wstring &file_path);
+
+  static const std::vector<std::string> kTokenParameters;
+  static const std::size_t kMaxEntrySize;
+
+  static HttpCache *static_instance;
+
+  std::wstring file_path_;
+  // found on the caller threads and put on the io thread.
+  mutable std::mutex mutex_;
+  EntryMap entries_;
+};
+
+
+class HttpCache::Entry {
+ public:
+  Entry(
+      const boost::property_tree::ptree &tree,
+      const std::string &etag,
+      const std::string &last_modified,
+      const Clock::time_point &stored_at);
+  Entry();
+  virtual ~Entry();
+
+  const boost::property_tree::ptree &tree() const { return tree_; }
+  const std::string &etag() const { return etag_; }
+  const std::string &last_modified() const { return last_modified_; }
+  const Clock::time_point &stored_at() const { return stored_at_; }
+
+  bool IsFresh(const std::chrono::seconds &ttl) const;
+  // for a conditional request; empty if the server gave no validator.
+  HttpHeaderMap ToValidators() const;
+
+  void set_stored_at(const Clock::time_point &stored_at) {
+    stored_at_ = stored_at;
+  }
+
+ private:
+  boost::property_tree::ptree tree_;
+  std::string etag_;
+  std::string last_modified_;
+  Clock::time_point stored_at_;
+};
+
+
+// picks the values as HttpJsonSink does, along with the validators.
+class HttpCacheSink : public HttpJsonSink {
+ public:
+  explicit HttpCacheSink(const std::vector<std::string> &paths);
+  virtual ~HttpCacheSink();
+
+  void Open(int status, const HttpHeaderMap &headers) override;
+
+  bool not_modified() const { return status_ == 304; }
+
+  // stored now.
+  HttpCache::Entry ToEntry() const;
+
+ private:
+  int status_;
+  std::string etag_;
+  std::string last_modified_;
+};
+}  // namespace ncstreamer
+
+
+#endif  // NCSTREAMER_CEF_SRC_LIB_HTTP_CACHE_H_
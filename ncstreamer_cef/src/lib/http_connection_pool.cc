@@ -0,0 +1,330 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#include "ncstreamer_cef/src/lib/http_connection_pool.h"
+
+#include <algorithm>
+
+#include "boost/asio/connect.hpp"
+#include "boost/asio/read.hpp"
+#include "boost/asio/read_until.hpp"
+#include "boost/asio/write.hpp"
+
+
+namespace {
+// servers close the idle connections after a while; one older than
+// this is more likely closed than not.
+const std::chrono::seconds kMaxIdleTime{30};
+const std::size_t kMaxIdleSizePerHost{4};
+}  // unnamed namespace
+
+
+namespace ncstreamer {
+HttpConnectionPool::HttpConnectionPool(boost::asio::io_service *svc)
+    : io_service_{svc},
+      ssl_context_{boost::asio::ssl::context::sslv23_client},
+      idle_connections_{},
+      sessions_{} {
+  ssl_context_.set_options(
+      boost::asio::ssl::context::default_workarounds |
+      boost::asio::ssl::context::no_sslv2 |
+      boost::asio::ssl::context::no_sslv3);
+  ssl_context_.set_verify_mode(boost::asio::ssl::verify_peer);
+  boost::system::error_code ec;
+  ssl_context_.load_verify_file("cacert.pem", ec);
+  // the sessions are kept by the pool, per host.
+  ::SSL_CTX_set_session_cache_mode(
+      ssl_context_.native_handle(), SSL_SESS_CACHE_CLIENT);
+}
+
+
+HttpConnectionPool::~HttpConnectionPool() {
+}
+
+
+void HttpConnectionPool::Acquire(
+    const urdl::url &url,
+    bool fresh,
+    const AcquireHandler &handler) {
+  const std::string &key = ToKey(url);
+
+  auto i = idle_connections_.find(key);
+  if (fresh == false && i != idle_connections_.end()) {
+    auto *idles = &i->second;
+    const auto &now = Clock::now();
+    while (idles->empty() == false) {
+      IdleConnection idle{idles->back()};
+      idles->pop_back();
+      if (now - idle.second > kMaxIdleTime) {
+        idle.first->Close();
+        continue;
+      }
+      std::shared_ptr<Connection> connection{idle.first};
+      io_service_->post([handler, connection]() {
+        handler(boost::system::error_code{}, connection, true);
+      });
+      return;
+    }
+  }
+
+  Connect(url, handler);
+}
+
+
+void HttpConnectionPool::Release(
+    const std::shared_ptr<Connection> &connection) {
+  auto *idles = &idle_connections_[connection->key()];
+  if (idles->size() >= kMaxIdleSizePerHost) {
+    // the oldest is the first to be closed by the server.
+    idles->front().first->Close();
+    idles->erase(idles->begin());
+  }
+  idles->emplace_back(connection, Clock::now());
+}
+
+
+void HttpConnectionPool::PreConnect(const urdl::url &url) {
+  io_service_->post([this, url]() {
+    const std::string &key = ToKey(url);
+    auto i = idle_connections_.find(key);
+    if (i != idle_connections_.end() && i->second.empty() == false) {
+      return;
+    }
+    Connect(url, [this](
+        const boost::system::error_code &ec,
+        const std::shared_ptr<Connection> &connection,
+        bool /*reused*/) {
+      if (ec) {
+        return;
+      }
+      Release(connection);
+    });
+  });
+}
+
+
+std::string HttpConnectionPool::ToKey(const urdl::url &url) {
+  return url.protocol() + "://" + url.host() + ":" +
+         std::to_string(url.port());
+}
+
+
+void HttpConnectionPool::Connect(
+    const urdl::url &url,
+    const AcquireHandler &handler) {
+  const std::string &key = ToKey(url);
+  std::shared_ptr<Connection> connection{
+      new Connection{io_service_, &ssl_context_, key, url}};
+
+  auto i = sessions_.find(key);
+  SSL_SESSION *session = (i == sessions_.end()) ? nullptr : i->second.get();
+  connection->Connect(session, [this, connection, handler](
+      const boost::system::error_code &ec) {
+    if (ec) {
+      connection->Close();
+      handler(ec, nullptr, false);
+      return;
+    }
+    const auto &session = connection->GetSession();
+    if (session) {
+      sessions_[connection->key()] = session;
+    }
+    handler(ec, connection, false);
+  });
+}
+
+
+HttpConnectionPool::Connection::Connection(
+    boost::asio::io_service *svc,
+    boost::asio::ssl::context *ssl_context,
+    const std::string &key,
+    const urdl::url &url)
+    : key_{key},
+      host_{url.host()},
+      port_{std::to_string(url.port())},
+      secure_{url.protocol() == "https"},
+      resolver_{*svc},
+      stream_{*svc, *ssl_context},
+      write_data_{},
+      buffer_{},
+      phase_start_{},
+      resolve_duration_{Clock::duration::zero()},
+      connect_duration_{Clock::duration::zero()},
+      handshake_duration_{Clock::duration::zero()} {
+}
+
+
+HttpConnectionPool::Connection::~Connection() {
+}
+
+
+void HttpConnectionPool::Connection::Connect(
+    SSL_SESSION *session,
+    const Handler &handler) {
+  if (secure_ == true) {
+    // openssl holds a reference of its own to the session.
+    if (session) {
+      ::SSL_set_session(stream_.native_handle(), session);
+    }
+    ::SSL_set_tlsext_host_name(stream_.native_handle(), host_.c_str());
+    stream_.set_verify_callback(
+        boost::asio::ssl::rfc2818_verification{host_});
+  }
+
+  phase_start_ = Clock::now();
+
+  auto self{shared_from_this()};
+  resolver_.async_resolve(
+      boost::asio::ip::tcp::resolver::query{host_, port_},
+      [this, self, handler](
+          const boost::system::error_code &ec,
+          boost::asio::ip::tcp::resolver::iterator endpoints) {
+    OnResolved(ec, endpoints, handler);
+  });
+}
+
+
+std::shared_ptr<SSL_SESSION> HttpConnectionPool::Connection::GetSession() {
+  if (secure_ == false) {
+    return nullptr;
+  }
+  SSL_SESSION *session = ::SSL_get1_session(stream_.native_handle());
+  if (!session) {
+    return nullptr;
+  }
+  return std::shared_ptr<SSL_SESSION>{session, ::SSL_SESSION_free};
+}
+
+
+void HttpConnectionPool::Connection::Close() {
+  if (secure_ == true) {
+    // openssl makes the session of a connection closed without the
+    // close_notify unresumable; the other connections still share it.
+    ::SSL_set_shutdown(
+        stream_.native_handle(), SSL_SENT_SHUTDOWN | SSL_RECEIVED_SHUTDOWN);
+  }
+
+  boost::system::error_code ec;
+  resolver_.cancel();
+  stream_.lowest_layer().shutdown(
+      boost::asio::ip::tcp::socket::shutdown_both, ec);
+  stream_.lowest_layer().close(ec);
+}
+
+
+void HttpConnectionPool::Connection::Write(
+    const std::string &data,
+    const Handler &handler) {
+  write_data_ = data;
+
+  auto self{shared_from_this()};
+  auto on_written = [self, handler](
+      const boost::system::error_code &ec,
+      std::size_t /*length*/) {
+    handler(ec);
+  };
+  if (secure_ == true) {
+    boost::asio::async_write(
+        stream_, boost::asio::buffer(write_data_), on_written);
+  } else {
+    boost::asio::async_write(
+        stream_.next_layer(), boost::asio::buffer(write_data_), on_written);
+  }
+}
+
+
+void HttpConnectionPool::Connection::ReadUntil(
+    const std::string &delimiter,
+    const Handler &handler) {
+  auto self{shared_from_this()};
+  auto on_read = [self, handler](
+      const boost::system::error_code &ec,
+      std::size_t /*length*/) {
+    handler(ec);
+  };
+  if (secure_ == true) {
+    boost::asio::async_read_until(stream_, buffer_, delimiter, on_read);
+  } else {
+    boost::asio::async_read_until(
+        stream_.next_layer(), buffer_, delimiter, on_read);
+  }
+}
+
+
+void HttpConnectionPool::Connection::ReadAtLeast(
+    std::size_t size,
+    const Handler &handler) {
+  std::size_t lack = size - (std::min)(size, buffer_.size());
+
+  auto self{shared_from_this()};
+  auto on_read = [self, handler](
+      const boost::system::error_code &ec,
+      std::size_t /*length*/) {
+    handler(ec);
+  };
+  if (secure_ == true) {
+    boost::asio::async_read(
+        stream_, buffer_, boost::asio::transfer_at_least(lack), on_read);
+  } else {
+    boost::asio::async_read(
+        stream_.next_layer(), buffer_,
+        boost::asio::transfer_at_least(lack), on_read);
+  }
+}
+
+
+void HttpConnectionPool::Connection::OnResolved(
+    const boost::system::error_code &ec,
+    boost::asio::ip::tcp::resolver::iterator endpoints,
+    const Handler &handler) {
+  if (ec) {
+    handler(ec);
+    return;
+  }
+  const auto &now = Clock::now();
+  resolve_duration_ = now - phase_start_;
+  phase_start_ = now;
+
+  auto self{shared_from_this()};
+  boost::asio::async_connect(
+      stream_.lowest_layer(),
+      endpoints,
+      [this, self, handler](
+          const boost::system::error_code &ec,
+          boost::asio::ip::tcp::resolver::iterator /*endpoint*/) {
+    OnConnected(ec, handler);
+  });
+}
+
+
+void HttpConnectionPool::Connection::OnConnected(
+    const boost::system::error_code &ec,
+    const Handler &handler) {
+  if (ec) {
+    handler(ec);
+    return;
+  }
+  const auto &now = Clock::now();
+  connect_duration_ = now - phase_start_;
+  phase_start_ = now;
+
+  boost::system::error_code option_ec;
+  stream_.lowest_layer().set_option(
+      boost::asio::ip::tcp::no_delay{true}, option_ec);
+
+  if (secure_ == false) {
+    handler(ec);
+    return;
+  }
+
+  auto self{shared_from_this()};
+  stream_.async_handshake(
+      boost::asio::ssl::stream_base::client,
+      [this, self, handler](const boost::system::error_code &ec) {
+    handshake_duration_ = Clock::now() - phase_start_;
+    handler(ec);
+  });
+}
+}  // namespace ncstreamer
@@ -0,0 +1,151 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#ifndef NCSTREAMER_CEF_SRC_LIB_HTTP_CONNECTION_POOL_H_
+#define NCSTREAMER_CEF_SRC_LIB_HTTP_CONNECTION_POOL_H_
+
+
+#include <chrono>  // NOLINT
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "boost/asio/io_service.hpp"
+#include "boost/asio/ip/tcp.hpp"
+#include "boost/asio/ssl.hpp"
+#include "boost/asio/streambuf.hpp"
+
+#pragma warning(push)
+#pragma warning(disable: 4244)
+#include "urdl/istream.hpp"
+#pragma warning(pop)
+
+
+namespace ncstreamer {
+// keeps the connections to each host open after a response, so that
+// the next request to the host skips the dns, tcp and tls handshakes;
+// a new connection to a host resumes its last tls session.
+// all but PreConnect are called on the io thread.
+class HttpConnectionPool {
+ public:
+  class Connection;
+
+  using AcquireHandler = std::function<void(
+      const boost::system::error_code &ec,
+      const std::shared_ptr<Connection> &connection,
+      bool reused)>;
+
+  explicit HttpConnectionPool(boost::asio::io_service *svc);
+  virtual ~HttpConnectionPool();
+
+  // an idle connection to the host of the url, or a new one if fresh.
+  void Acquire(
+      const urdl::url &url,
+      bool fresh,
+      const AcquireHandler &handler);
+  // the response was read to the end; the connection may be reused.
+  void Release(const std::shared_ptr<Connection> &connection);
+
+  // may be called on any thread; leaves a connection idle for the
+  // next request to the host of the url.
+  void PreConnect(const urdl::url &url);
+
+ private:
+  using Clock = std::chrono::steady_clock;
+  using IdleConnection = std::pair<
+      std::shared_ptr<Connection>,
+      Clock::time_point /*released*/>;
+
+  static std::string ToKey(const urdl::url &url);
+
+  void Connect(const urdl::url &url, const AcquireHandler &handler);
+
+  boost::asio::io_service *io_service_;
+  // the certificates are loaded once for all the connections.
+  boost::asio::ssl::context ssl_context_;
+
+  std::unordered_map<
+      std::string /*key*/,
+      std::vector<IdleConnection>> idle_connections_;
+  std::unordered_map<
+      std::string /*key*/,
+      std::shared_ptr<SSL_SESSION>> sessions_;
+};
+
+
+class HttpConnectionPool::Connection
+    : public std::enable_shared_from_this<Connection> {
+ public:
+  using Handler = std::function<void(const boost::system::error_code &ec)>;
+  using Clock = std::chrono::steady_clock;
+
+  Connection(
+      boost::asio::io_service *svc,
+      boost::asio::ssl::context *ssl_context,
+      const std::string &key,
+      const urdl::url &url);
+  virtual ~Connection();
+
+  const std::string &key() const { return key_; }
+  bool secure() const { return secure_; }
+  // what was read but not consumed yet.
+  boost::asio::streambuf &buffer() { return buffer_; }
+
+  // of the connect; zero for the phases not gone through.
+  const Clock::duration &resolve_duration() const {
+    return resolve_duration_;
+  }
+  const Clock::duration &connect_duration() const {
+    return connect_duration_;
+  }
+  const Clock::duration &handshake_duration() const {
+    return handshake_duration_;
+  }
+
+  // the session is resumed if not null.
+  void Connect(SSL_SESSION *session, const Handler &handler);
+  // null if not secure.
+  std::shared_ptr<SSL_SESSION> GetSession();
+  void Close();
+
+  // the data is kept until the handler is called.
+  void Write(const std::string &data, const Handler &handler);
+  void ReadUntil(const std::string &delimiter, const Handler &handler);
+  // until the buffer has at least the given size.
+  void ReadAtLeast(std::size_t size, const Handler &handler);
+
+ private:
+  using Stream = boost::asio::ssl::stream<boost::asio::ip::tcp::socket>;
+
+  void OnResolved(
+      const boost::system::error_code &ec,
+      boost::asio::ip::tcp::resolver::iterator endpoints,
+      const Handler &handler);
+  void OnConnected(
+      const boost::system::error_code &ec,
+      const Handler &handler);
+
+  const std::string key_;
+  const std::string host_;
+  const std::string port_;
+  const bool secure_;
+
+  boost::asio::ip::tcp::resolver resolver_;
+  // the plain connections use only the next layer.
+  Stream stream_;
+  std::string write_data_;
+  boost::asio::streambuf buffer_;
+
+  Clock::time_point phase_start_;
+  Clock::duration resolve_duration_;
+  Clock::duration connect_duration_;
+  Clock::duration handshake_duration_;
+};
+}  // namespace ncstreamer
+
+
+#endif  // NCSTREAMER_CEF_SRC_LIB_HTTP_CONNECTION_POOL_H_
@@ -0,0 +1,778 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#include "ncstreamer_cef/src/lib/http_download.h"
+
+#include <algorithm>
+#include <cctype>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+#include "boost/asio/ssl/error.hpp"
+#include "boost/filesystem.hpp"
+#include "boost/property_tree/json_parser.hpp"
+#include "openssl/sha.h"
+
+#include "ncstreamer_cef/src/lib/http_request_service.h"
+
+
+namespace {
+// no segment is split smaller than this.
+const uint64_t kMinSegmentSize{1024 * 1024};
+// the end of a segment of the size not known.
+const uint64_t kOpenEnd{(std::numeric_limits<uint64_t>::max)()};
+// a segment which got nothing for this long after its response came is
+// resumed over another connection.
+const std::chrono::seconds kStallTimeout{20};
+// the rate is over these seconds.
+const std::size_t kRateSeconds{5};
+
+const ncstreamer::HttpRequest::RetryHandler kDefaultRetryHandler{
+    [](const boost::system::error_code &/*ec*/,
+       uint32_t /*retry*/,
+       const std::chrono::milliseconds &/*delay*/) {}};
+const ncstreamer::HttpRequest::OpenHandler kDefaultOpenHandler{
+    [](std::size_t /*file_size*/) {}};
+const ncstreamer::HttpRequest::ReadHandler kDefaultReadHandler{
+    [](std::size_t /*read_size*/) {}};
+
+
+std::string ToLower(const std::string &str) {
+  std::string lower{str};
+  std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+  return lower;
+}
+
+
+// the dropped connections and the deadlines cut into a body are to
+// resume from, unlike those of a single request.
+bool IsResumable(const boost::system::error_code &ec) {
+  return ncstreamer::HttpRequest::IsRetryable(ec) == true ||
+         ec == boost::asio::ssl::error::stream_truncated ||
+         ec == ncstreamer::HttpRequestError::Make(
+             ncstreamer::HttpRequestError::kTotalTimeout);
+}
+}  // unnamed namespace
+
+
+namespace ncstreamer {
+HttpDownloadOptions::HttpDownloadOptions(
+    uint32_t max_segments,
+    const std::string &sha256,
+    const HttpRequestPolicy &policy)
+    : max_segments_{(std::max)(max_segments, 1u)},
+      sha256_{sha256},
+      policy_{policy} {
+}
+
+
+HttpDownloadOptions::HttpDownloadOptions()
+    : HttpDownloadOptions{
+          4,
+          "",
+          HttpRequestPolicy{
+              std::chrono::milliseconds{10000},
+              std::chrono::milliseconds{15000},
+              std::chrono::milliseconds{3600000},
+              5,
+              std::chrono::milliseconds{1000}}} {
+}
+
+
+HttpDownloadOptions::~HttpDownloadOptions() {
+}
+
+
+HttpDownload::HttpDownload(
+    boost::asio::io_service *svc,
+    HttpRequestService *request_service,
+    const std::string &uri,
+    const std::string &file_name,
+    const HttpDownloadOptions &options,
+    const HttpRequest::ErrorHandler &err_handler,
+    const OpenHandler &open_handler,
+    const ReadHandler &read_handler,
+    const CompleteHandler &complete_handler)
+    : io_service_{svc},
+      request_service_{request_service},
+      uri_{uri},
+      file_name_{file_name},
+      state_file_name_{file_name + ".download"},
+      options_{options},
+      handle_{},
+      probe_handle_{},
+      random_{std::random_device{}()},
+      file_size_{0},
+      ranges_{false},
+      validator_{},
+      generation_{0},
+      done_{false},
+      file_{},
+      segments_{},
+      downloaded_{0},
+      state_dirty_{false},
+      tick_timer_{*svc},
+      samples_{},
+      bytes_per_second_{0.0},
+      err_handler_{err_handler},
+      open_handler_{open_handler},
+      read_handler_{read_handler},
+      complete_handler_{complete_handler} {
+}
+
+
+HttpDownload::~HttpDownload() {
+}
+
+
+void HttpDownload::Start(const std::shared_ptr<HttpRequestHandle> &handle) {
+  handle_ = handle;
+
+  // the handle may outlive the download.
+  std::weak_ptr<HttpDownload> weak_self{shared_from_this()};
+  boost::asio::io_service *svc{io_service_};
+  handle_->SetCanceller([weak_self, svc]() {
+    svc->post([weak_self]() {
+      std::shared_ptr<HttpDownload> self{weak_self.lock()};
+      if (!self) {
+        return;
+      }
+      self->Cancel();
+    });
+  });
+
+  auto self{shared_from_this()};
+  io_service_->post([this, self]() {
+    if (done_ == true) {
+      return;
+    }
+    std::shared_ptr<HttpHeaderSink> sink{new HttpHeaderSink{}};
+    probe_handle_ = request_service_->Head(
+        uri_,
+        options_.policy(),
+        sink,
+        [this, self](const boost::system::error_code &ec) {
+      if (done_ == true) {
+        return;
+      }
+      // a server may not take the head requests; the download goes on
+      // without the size, then.
+      if (ec.category() != urdl::http::error_category()) {
+        Fail(ec);
+        return;
+      }
+      OnProbed(0, HttpHeaderMap{});
+    }, [this, self, sink]() {
+      if (done_ == true) {
+        return;
+      }
+      OnProbed(sink->status(), sink->headers());
+    });
+  });
+}
+
+
+void HttpDownload::OnProbed(int status, const HttpHeaderMap &headers) {
+  probe_handle_.reset();
+
+  if (status / 100 == 2) {
+    auto i = headers.find("content-length");
+    if (i != headers.end()) {
+      try {
+        file_size_ = std::stoull(i->second);
+      } catch (const std::exception &/*e*/) {
+        file_size_ = 0;
+      }
+    }
+    auto j = headers.find("accept-ranges");
+    ranges_ = file_size_ > 0 &&
+              j != headers.end() &&
+              ToLower(j->second).find("bytes") != std::string::npos;
+
+    // a weak etag does not go into an if-range.
+    auto etag = headers.find("etag");
+    auto last_modified = headers.find("last-modified");
+    if (etag != headers.end() && etag->second.compare(0, 2, "W/") != 0) {
+      validator_ = etag->second;
+    } else if (last_modified != headers.end()) {
+      validator_ = last_modified->second;
+    }
+  }
+
+  if (LoadState() == true) {
+    if (OpenFile(false) == false) {
+      return;
+    }
+  } else {
+    Split();
+    if (OpenFile(true) == false) {
+      return;
+    }
+    SaveState();
+  }
+
+  downloaded_ = 0;
+  for (const auto &segment : segments_) {
+    downloaded_ += segment.next() - segment.begin();
+  }
+  open_handler_(file_size_);
+  Tick();
+
+  bool all_done{true};
+  for (std::size_t i = 0; i < segments_.size(); ++i) {
+    if (segments_[i].IsDone() == false) {
+      all_done = false;
+      StartSegment(i);
+    }
+  }
+  if (all_done == true) {
+    Finish();
+  }
+}
+
+
+bool HttpDownload::LoadState() {
+  if (ranges_ == false || validator_.empty() == true) {
+    return false;
+  }
+
+  boost::system::error_code ec;
+  if (boost::filesystem::file_size(file_name_, ec) != file_size_ || ec) {
+    return false;
+  }
+
+  boost::property_tree::ptree tree;
+  try {
+    std::ifstream in{state_file_name_.c_str(), std::ios_base::binary};
+    boost::property_tree::read_json(in, tree);
+  } catch (const std::exception &/*e*/) {
+    return false;
+  }
+  if (tree.get<std::string>("uri", "") != uri_ ||
+      tree.get<uint64_t>("fileSize", 0) != file_size_ ||
+      tree.get<std::string>("validator", "") != validator_) {
+    return false;
+  }
+
+  std::vector<Segment> segments;
+  try {
+    for (const auto &elem : tree.get_child("segments")) {
+      const auto &segment = elem.second;
+      uint64_t begin = segment.get<uint64_t>("begin");
+      uint64_t end = segment.get<uint64_t>("end");
+      uint64_t next = segment.get<uint64_t>("next");
+      if (begin > end || next < begin || next > end + 1 ||
+          end >= file_size_) {
+        return false;
+      }
+      segments.emplace_back(begin, end, next);
+    }
+  } catch (const std::exception &/*e*/) {
+    return false;
+  }
+  if (segments.empty() == true) {
+    return false;
+  }
+
+  segments_ = std::move(segments);
+  return true;
+}
+
+
+void HttpDownload::SaveState() {
+  state_dirty_ = false;
+  if (ranges_ == false || validator_.empty() == true) {
+    return;
+  }
+
+  // what the state tells is to be on the disk already.
+  file_.flush();
+
+  boost::property_tree::ptree segments;
+  for (const auto &segment : segments_) {
+    segments.push_back(std::make_pair("", segment.ToTree()));
+  }
+
+  boost::property_tree::ptree tree;
+  tree.put("uri", uri_);
+  tree.put("fileSize", file_size_);
+  tree.put("validator", validator_);
+  tree.add_child("segments", segments);
+
+  std::ofstream out{state_file_name_.c_str(), std::ios_base::binary};
+  boost::property_tree::write_json(out, tree, false);
+}
+
+
+void HttpDownload::Split() {
+  segments_.clear();
+  if (ranges_ == false) {
+    segments_.emplace_back(0, file_size_ > 0 ? file_size_ - 1 : kOpenEnd, 0);
+    return;
+  }
+
+  uint64_t count = (std::min)(
+      (std::max)(file_size_ / kMinSegmentSize, uint64_t{1}),
+      uint64_t{options_.max_segments()});
+  uint64_t size = file_size_ / count;
+  for (uint64_t i = 0; i < count; ++i) {
+    uint64_t begin = i * size;
+    uint64_t end = (i == count - 1) ? file_size_ - 1 : begin + size - 1;
+    segments_.emplace_back(begin, end, begin);
+  }
+}
+
+
+bool HttpDownload::OpenFile(bool preallocates) {
+  if (preallocates == true) {
+    {
+      std::ofstream out{
+          file_name_.c_str(),
+          std::ios_base::binary | std::ios_base::trunc};
+    }
+    // the segments are written in place, so the file is of its size
+    // from the start.
+    boost::system::error_code ec;
+    if (file_size_ > 0) {
+      boost::filesystem::resize_file(file_name_, file_size_, ec);
+    }
+    if (ec) {
+      Fail(ec);
+      return false;
+    }
+  }
+
+  file_.open(
+      file_name_.c_str(),
+      std::ios_base::in | std::ios_base::out | std::ios_base::binary);
+  if (file_.is_open() == false) {
+    Fail(boost::system::errc::make_error_code(
+        boost::system::errc::io_error));
+    return false;
+  }
+  return true;
+}
+
+
+void HttpDownload::StartSegment(std::size_t index) {
+  Segment &segment = segments_[index];
+
+  HttpHeaderMap headers;
+  if (ranges_ == true) {
+    headers.emplace("Range", segment.ToRange());
+    if (validator_.empty() == false) {
+      // the whole of a changed resource comes instead of the range.
+      headers.emplace("If-Range", validator_);
+    }
+  }
+
+  auto self{shared_from_this()};
+  uint32_t generation{generation_};
+  std::shared_ptr<SegmentSink> sink{
+      new SegmentSink{self, index, generation}};
+  segment.Run(request_service_->Get(
+      uri_,
+      headers,
+      options_.policy(),
+      sink,
+      [this, self, index, generation](const boost::system::error_code &ec) {
+    if (done_ == true || generation != generation_) {
+      return;
+    }
+    OnSegmentFailed(index, ec);
+  },
+      kDefaultRetryHandler,
+      kDefaultOpenHandler,
+      kDefaultReadHandler,
+      [this, self, index, generation]() {
+    if (done_ == true || generation != generation_) {
+      return;
+    }
+    OnSegmentCompleted(index);
+  }));
+}
+
+
+void HttpDownload::OnSegmentOpened(std::size_t index, int status) {
+  Segment &segment = segments_[index];
+  segment.set_opened();
+
+  if (ranges_ == true && status == 200 &&
+      (segments_.size() > 1 || segment.next() > 0)) {
+    // the range was not taken, or the resource has changed.
+    Restart();
+  }
+}
+
+
+void HttpDownload::OnSegmentWritten(
+    std::size_t index,
+    const char *data,
+    std::size_t size) {
+  Segment &segment = segments_[index];
+  if (segment.IsDone() == true) {
+    return;
+  }
+  if (segment.end() != kOpenEnd) {
+    // more than asked for is not of this segment.
+    size = static_cast<std::size_t>((std::min)(
+        uint64_t{size}, segment.end() - segment.next() + 1));
+  }
+
+  file_.seekp(segment.next());
+  file_.write(data, size);
+  if (!file_) {
+    Fail(boost::system::errc::make_error_code(
+        boost::system::errc::io_error));
+    return;
+  }
+
+  segment.Advance(size);
+  downloaded_ += size;
+  state_dirty_ = true;
+  read_handler_(downloaded_, file_size_, bytes_per_second_);
+}
+
+
+void HttpDownload::OnSegmentFailed(
+    std::size_t index,
+    const boost::system::error_code &ec) {
+  Segment &segment = segments_[index];
+  bool stalled{segment.stalled()};
+  segment.Stop();
+
+  if (stalled == false && IsResumable(ec) == false) {
+    Fail(ec);
+    return;
+  }
+  ResumeSegment(index, ec);
+}
+
+
+void HttpDownload::OnSegmentCompleted(std::size_t index) {
+  Segment &segment = segments_[index];
+  segment.Stop();
+
+  if (segment.IsDone() == false) {
+    if (segment.end() != kOpenEnd) {
+      // the body ended short of the range.
+      ResumeSegment(index, boost::asio::error::eof);
+      return;
+    }
+    // the body of no size told is over; it is the only segment.
+    file_size_ = segment.next();
+    Finish();
+    return;
+  }
+
+  SaveState();
+  for (const auto &segment : segments_) {
+    if (segment.IsDone() == false) {
+      return;
+    }
+  }
+  Finish();
+}
+
+
+void HttpDownload::ResumeSegment(
+    std::size_t index,
+    const boost::system::error_code &ec) {
+  Segment &segment = segments_[index];
+  if (ranges_ == false) {
+    downloaded_ -= segment.next() - segment.begin();
+    segment.Rewind();
+  }
+
+  segment.CountFailure();
+  if (segment.failures() > options_.policy().max_retries()) {
+    Fail(ec);
+    return;
+  }
+
+  const auto &delay =
+      options_.policy().GetRetryDelay(segment.failures() - 1, &random_);
+  std::shared_ptr<boost::asio::steady_timer> timer{
+      new boost::asio::steady_timer{*io_service_}};
+  timer->expires_from_now(delay);
+
+  auto self{shared_from_this()};
+  uint32_t generation{generation_};
+  timer->async_wait([this, self, timer, index, generation](
+      const boost::system::error_code &ec) {
+    if (ec || done_ == true || generation != generation_) {
+      return;
+    }
+    StartSegment(index);
+  });
+}
+
+
+void HttpDownload::Restart() {
+  ++generation_;
+  for (auto &segment : segments_) {
+    segment.Stop();
+  }
+
+  boost::system::error_code ec;
+  boost::filesystem::remove(state_file_name_, ec);
+
+  ranges_ = false;
+  validator_.clear();
+  Split();
+  downloaded_ = 0;
+  StartSegment(0);
+}
+
+
+void HttpDownload::Tick() {
+  const auto &now = Clock::now();
+  UpdateRate(now);
+
+  for (auto &segment : segments_) {
+    if (segment.CheckStall(now, kStallTimeout) == true) {
+      // comes back as cancelled, to be resumed.
+      segment.handle()->Cancel();
+    }
+  }
+
+  if (state_dirty_ == true) {
+    SaveState();
+  }
+
+  auto self{shared_from_this()};
+  tick_timer_.expires_from_now(std::chrono::seconds{1});
+  tick_timer_.async_wait([this, self](const boost::system::error_code &ec) {
+    if (ec || done_ == true) {
+      return;
+    }
+    Tick();
+  });
+}
+
+
+void HttpDownload::UpdateRate(const Clock::time_point &now) {
+  samples_.emplace_back(now, downloaded_);
+  while (samples_.size() > kRateSeconds + 1) {
+    samples_.pop_front();
+  }
+
+  const auto &elapsed = std::chrono::duration_cast<
+      std::chrono::duration<double>>(now - samples_.front().first);
+  // a restart takes the downloaded back.
+  if (elapsed.count() > 0 && downloaded_ >= samples_.front().second) {
+    bytes_per_second_ =
+        (downloaded_ - samples_.front().second) / elapsed.count();
+  }
+}
+
+
+void HttpDownload::Finish() {
+  file_.close();
+
+  boost::system::error_code remove_ec;
+  boost::filesystem::remove(state_file_name_, remove_ec);
+
+  if (options_.sha256().empty() == false && CheckHash() == false) {
+    // not to be resumed either.
+    boost::filesystem::remove(file_name_, remove_ec);
+    Done();
+    err_handler_(HttpRequestError::Make(HttpRequestError::kHashMismatch));
+    return;
+  }
+
+  Done();
+  UpdateRate(Clock::now());
+  read_handler_(downloaded_, file_size_, bytes_per_second_);
+  complete_handler_();
+}
+
+
+bool HttpDownload::CheckHash() {
+  std::ifstream in{file_name_.c_str(), std::ios_base::binary};
+  if (!in) {
+    return false;
+  }
+
+  SHA256_CTX context;
+  SHA256_Init(&context);
+  std::vector<char> buffer(64 * 1024);
+  while (in) {
+    in.read(buffer.data(), buffer.size());
+    SHA256_Update(&context, buffer.data(), static_cast<std::size_t>(
+        in.gcount()));
+  }
+  unsigned char digest[SHA256_DIGEST_LENGTH];
+  SHA256_Final(digest, &context);
+
+  std::stringstream hex;
+  for (unsigned char byte : digest) {
+    hex << std::hex << std::setw(2) << std::setfill('0')
+        << static_cast<int>(byte);
+  }
+  return hex.str() == ToLower(options_.sha256());
+}
+
+
+void HttpDownload::Fail(const boost::system::error_code &ec) {
+  if (done_ == true) {
+    return;
+  }
+  // what was written so far is for the next time.
+  SaveState();
+  file_.close();
+
+  Done();
+  err_handler_(ec);
+}
+
+
+void HttpDownload::Cancel() {
+  Fail(HttpRequestError::Make(HttpRequestError::kCancelled));
+}
+
+
+void HttpDownload::Done() {
+  done_ = true;
+  boost::system::error_code ec;
+  tick_timer_.cancel(ec);
+
+  if (probe_handle_) {
+    probe_handle_->Cancel();
+    probe_handle_.reset();
+  }
+  for (auto &segment : segments_) {
+    segment.Stop();
+  }
+  handle_->SetCanceller(nullptr);
+}
+
+
+HttpDownload::Segment::Segment(uint64_t begin, uint64_t end, uint64_t next)
+    : begin_{begin},
+      end_{end},
+      next_{next},
+      handle_{},
+      failures_{0},
+      furthest_{next},
+      progressed_at_{},
+      opened_{false},
+      stalled_{false} {
+}
+
+
+HttpDownload::Segment::~Segment() {
+}
+
+
+std::string HttpDownload::Segment::ToRange() const {
+  std::stringstream range;
+  range << "bytes=" << next_ << "-";
+  if (end_ != kOpenEnd) {
+    range << end_;
+  }
+  return range.str();
+}
+
+
+boost::property_tree::ptree HttpDownload::Segment::ToTree() const {
+  boost::property_tree::ptree tree;
+  tree.put("begin", begin_);
+  tree.put("end", end_);
+  tree.put("next", next_);
+  return tree;
+}
+
+
+void HttpDownload::Segment::Advance(uint64_t size) {
+  next_ += size;
+  progressed_at_ = Clock::now();
+  stalled_ = false;
+}
+
+
+void HttpDownload::Segment::Rewind() {
+  next_ = begin_;
+}
+
+
+void HttpDownload::Segment::Run(
+    const std::shared_ptr<HttpRequestHandle> &handle) {
+  handle_ = handle;
+  progressed_at_ = Clock::now();
+  opened_ = false;
+  stalled_ = false;
+}
+
+
+void HttpDownload::Segment::Stop() {
+  if (handle_) {
+    handle_->Cancel();
+    handle_.reset();
+  }
+}
+
+
+void HttpDownload::Segment::CountFailure() {
+  if (next_ > furthest_) {
+    furthest_ = next_;
+    failures_ = 0;
+  }
+  ++failures_;
+}
+
+
+bool HttpDownload::Segment::CheckStall(
+    const Clock::time_point &now,
+    const Clock::duration &timeout) {
+  if (!handle_ || opened_ == false || stalled_ == true) {
+    return false;
+  }
+  if (now - progressed_at_ < timeout) {
+    return false;
+  }
+  stalled_ = true;
+  return true;
+}
+
+
+HttpDownload::SegmentSink::SegmentSink(
+    const std::weak_ptr<HttpDownload> &download,
+    std::size_t index,
+    uint32_t generation)
+    : download_{download},
+      index_{index},
+      generation_{generation} {
+}
+
+
+HttpDownload::SegmentSink::~SegmentSink() {
+}
+
+
+void HttpDownload::SegmentSink::Open(
+    int status,
+    const HttpHeaderMap &/*headers*/) {
+  std::shared_ptr<HttpDownload> download{download_.lock()};
+  if (!download ||
+      download->done_ == true ||
+      download->generation_ != generation_) {
+    return;
+  }
+  download->OnSegmentOpened(index_, status);
+}
+
+
+void HttpDownload::SegmentSink::Write(const char *data, std::size_t size) {
+  std::shared_ptr<HttpDownload> download{download_.lock()};
+  if (!download ||
+      download->done_ == true ||
+      download->generation_ != generation_) {
+    return;
+  }
+  download->OnSegmentWritten(index_, data, size);
+}
+}  // namespace ncstreamer
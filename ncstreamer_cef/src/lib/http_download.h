@@ -0,0 +1,237 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#ifndef NCSTREAMER_CEF_SRC_LIB_HTTP_DOWNLOAD_H_
+#define NCSTREAMER_CEF_SRC_LIB_HTTP_DOWNLOAD_H_
+
+
+#include <chrono>  // NOLINT
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "boost/asio/io_service.hpp"
+#include "boost/asio/steady_timer.hpp"
+#include "boost/property_tree/ptree.hpp"
+
+#include "ncstreamer_cef/src/lib/http_request.h"
+#include "ncstreamer_cef/src/lib/http_request_handle.h"
+#include "ncstreamer_cef/src/lib/http_request_policy.h"
+#include "ncstreamer_cef/src/lib/http_response_sink.h"
+#include "ncstreamer_cef/src/lib/http_types.h"
+
+
+namespace ncstreamer {
+class HttpRequestService;
+
+
+// how a download is split and checked. the policy is for each request
+// of a segment; its retries count the resumes of a segment in a row
+// that got nothing further.
+class HttpDownloadOptions {
+ public:
+  HttpDownloadOptions(
+      uint32_t max_segments,
+      const std::string &sha256,
+      const HttpRequestPolicy &policy);
+  // 4 segments at most, as the service allows; no hash; an hour for
+  // each segment, and 5 resumes from a second.
+  HttpDownloadOptions();
+  virtual ~HttpDownloadOptions();
+
+  uint32_t max_segments() const { return max_segments_; }
+  // in hex; empty if not to be checked.
+  const std::string &sha256() const { return sha256_; }
+  const HttpRequestPolicy &policy() const { return policy_; }
+
+ private:
+  uint32_t max_segments_;
+  std::string sha256_;
+  HttpRequestPolicy policy_;
+};
+
+
+// a download to a file, preallocated to its size and written in byte
+// ranges by up to max_segments requests at a time. a segment dropped or
+// stalled goes on from where it got to. what was written is kept next
+// to the file, as "<file>.download", so a download given up on resumes
+// the next time, if the resource has not changed meanwhile.
+// a server without the ranges gets a single request, from the start.
+// lives on the io thread of the request service.
+class HttpDownload
+    : public std::enable_shared_from_this<HttpDownload> {
+ public:
+  using OpenHandler = std::function<void(uint64_t file_size)>;
+  // the bytes per second are over the last few seconds.
+  using ReadHandler = std::function<void(
+      uint64_t downloaded,
+      uint64_t file_size,
+      double bytes_per_second)>;
+  using CompleteHandler = std::function<void()>;
+
+  HttpDownload(
+      boost::asio::io_service *svc,
+      HttpRequestService *request_service,
+      const std::string &uri,
+      const std::string &file_name,
+      const HttpDownloadOptions &options,
+      const HttpRequest::ErrorHandler &err_handler,
+      const OpenHandler &open_handler,
+      const ReadHandler &read_handler,
+      const CompleteHandler &complete_handler);
+  virtual ~HttpDownload();
+
+  // the handle cancels the download as a whole.
+  void Start(const std::shared_ptr<HttpRequestHandle> &handle);
+
+ private:
+  class Segment;
+  class SegmentSink;
+
+  using Clock = std::chrono::steady_clock;
+
+  // the headers of the head request.
+  void OnProbed(int status, const HttpHeaderMap &headers);
+  // from the state kept next to the file, if it is of the same resource.
+  bool LoadState();
+  void SaveState();
+  void Split();
+  bool OpenFile(bool preallocates);
+
+  void StartSegment(std::size_t index);
+  void OnSegmentOpened(std::size_t index, int status);
+  void OnSegmentWritten(
+      std::size_t index,
+      const char *data,
+      std::size_t size);
+  void OnSegmentFailed(
+      std::size_t index,
+      const boost::system::error_code &ec);
+  void OnSegmentCompleted(std::size_t index);
+  void ResumeSegment(
+      std::size_t index,
+      const boost::system::error_code &ec);
+  // from the start, as a single segment without the ranges.
+  void Restart();
+
+  // every second; for the rate, the stalls and the state.
+  void Tick();
+  void UpdateRate(const Clock::time_point &now);
+  void Finish();
+  bool CheckHash();
+  void Fail(const boost::system::error_code &ec);
+  void Cancel();
+  void Done();
+
+  boost::asio::io_service *const io_service_;
+  HttpRequestService *const request_service_;
+  const std::string uri_;
+  const std::string file_name_;
+  const std::string state_file_name_;
+  const HttpDownloadOptions options_;
+  std::shared_ptr<HttpRequestHandle> handle_;
+  std::shared_ptr<HttpRequestHandle> probe_handle_;
+  std::mt19937 random_;
+
+  uint64_t file_size_;
+  bool ranges_;
+  // the strong etag or the last modified, for the if-range.
+  std::string validator_;
+  // the completions of the segments from before a restart are dropped.
+  uint32_t generation_;
+  bool done_;
+
+  std::fstream file_;
+  std::vector<Segment> segments_;
+  uint64_t downloaded_;
+  bool state_dirty_;
+
+  boost::asio::steady_timer tick_timer_;
+  std::deque<std::pair<Clock::time_point, uint64_t /*downloaded*/>> samples_;
+  double bytes_per_second_;
+
+  HttpRequest::ErrorHandler err_handler_;
+  OpenHandler open_handler_;
+  ReadHandler read_handler_;
+  CompleteHandler complete_handler_;
+};
+
+
+// the bytes from begin to end, both inclusive; the end of the last is
+// open if the size is not known.
+class HttpDownload::Segment {
+ public:
+  Segment(uint64_t begin, uint64_t end, uint64_t next);
+  virtual ~Segment();
+
+  bool IsDone() const { return next_ > end_; }
+  // the range from the next byte on.
+  std::string ToRange() const;
+
+  boost::property_tree::ptree ToTree() const;
+
+  uint64_t begin() const { return begin_; }
+  uint64_t end() const { return end_; }
+  uint64_t next() const { return next_; }
+  const std::shared_ptr<HttpRequestHandle> &handle() const { return handle_; }
+  uint32_t failures() const { return failures_; }
+  bool stalled() const { return stalled_; }
+
+  void set_end(uint64_t end) { end_ = end; }
+  // the response has come; a stall is told from then on.
+  void set_opened() { opened_ = true; }
+  // when the segment gets further, the failures and the stall are over.
+  void Advance(uint64_t size);
+  // from the begin again, as without the ranges.
+  void Rewind();
+  void Run(const std::shared_ptr<HttpRequestHandle> &handle);
+  void Stop();
+  // counted while nothing comes further than before.
+  void CountFailure();
+  // true at the stall, once.
+  bool CheckStall(const Clock::time_point &now,
+                  const Clock::duration &timeout);
+
+ private:
+  uint64_t begin_;
+  uint64_t end_;
+  uint64_t next_;
+  std::shared_ptr<HttpRequestHandle> handle_;
+  uint32_t failures_;
+  uint64_t furthest_;
+  Clock::time_point progressed_at_;
+  bool opened_;
+  bool stalled_;
+};
+
+
+// writes at the offsets of the segment; the download may be over by
+// the time the rest arrives, and then it is dropped.
+class HttpDownload::SegmentSink : public HttpResponseSink {
+ public:
+  SegmentSink(
+      const std::weak_ptr<HttpDownload> &download,
+      std::size_t index,
+      uint32_t generation);
+  virtual ~SegmentSink();
+
+  void Open(int status, const HttpHeaderMap &headers) override;
+  void Write(const char *data, std::size_t size) override;
+
+ private:
+  std::weak_ptr<HttpDownload> download_;
+  std::size_t index_;
+  uint32_t generation_;
+};
+}  // namespace ncstreamer
+
+
+#endif  // NCSTREAMER_CEF_SRC_LIB_HTTP_DOWNLOAD_H_
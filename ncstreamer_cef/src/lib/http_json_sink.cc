@@ -0,0 +1,378 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#include "ncstreamer_cef/src/lib/http_json_sink.h"
+
+#include <cctype>
+#include <utility>
+
+
+namespace ncstreamer {
+HttpJsonSink::HttpJsonSink(const std::vector<std::string> &paths)
+    : paths_{},
+      tree_{},
+      state_{State::kValue},
+      frames_{},
+      token_{},
+      in_key_{false},
+      unicode_{},
+      high_surrogate_{0} {
+  for (const auto &path : paths) {
+    paths_.emplace_back(Split(path));
+  }
+}
+
+
+HttpJsonSink::~HttpJsonSink() {
+}
+
+
+void HttpJsonSink::Write(const char *data, std::size_t size) {
+  for (std::size_t i = 0; i < size && state_ != State::kError; ++i) {
+    Feed(data[i]);
+  }
+}
+
+
+void HttpJsonSink::Close() {
+  // a number at the top level ends only with the body.
+  if (state_ == State::kLiteral && frames_.empty() == true) {
+    EndScalar(token_);
+  }
+  if (state_ != State::kDone) {
+    state_ = State::kError;
+  }
+}
+
+
+bool HttpJsonSink::ok() const {
+  return state_ == State::kDone;
+}
+
+
+std::vector<std::string> HttpJsonSink::Split(const std::string &path) {
+  std::vector<std::string> keys;
+  if (path.empty() == true) {
+    return keys;
+  }
+
+  std::size_t begin{0};
+  while (true) {
+    std::size_t end = path.find('.', begin);
+    keys.emplace_back(path.substr(begin, end - begin));
+    if (end == std::string::npos) {
+      break;
+    }
+    begin = end + 1;
+  }
+  return keys;
+}
+
+
+void HttpJsonSink::AppendUtf8(uint32_t code_point, std::string *out) {
+  if (code_point < 0x80) {
+    out->push_back(static_cast<char>(code_point));
+  } else if (code_point < 0x800) {
+    out->push_back(static_cast<char>(0xC0 | (code_point >> 6)));
+    out->push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+  } else if (code_point < 0x10000) {
+    out->push_back(static_cast<char>(0xE0 | (code_point >> 12)));
+    out->push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+    out->push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+  } else {
+    out->push_back(static_cast<char>(0xF0 | (code_point >> 18)));
+    out->push_back(static_cast<char>(0x80 | ((code_point >> 12) & 0x3F)));
+    out->push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+    out->push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+  }
+}
+
+
+void HttpJsonSink::Feed(char c) {
+  bool space = (c == ' ' || c == '\t' || c == '\r' || c == '\n');
+
+  switch (state_) {
+    case State::kValue: {
+      if (space == true) {
+        break;
+      }
+      if (c == '{') {
+        BeginContainer(true);
+        state_ = State::kKeyOrEnd;
+      } else if (c == '[') {
+        BeginContainer(false);
+        state_ = State::kValueOrEnd;
+      } else if (c == '"') {
+        token_.clear();
+        in_key_ = false;
+        state_ = State::kString;
+      } else if (c == '-' || std::isalnum(static_cast<unsigned char>(c))) {
+        token_.assign(1, c);
+        state_ = State::kLiteral;
+      } else {
+        state_ = State::kError;
+      }
+      break;
+    }
+    case State::kValueOrEnd: {
+      if (space == true) {
+        break;
+      }
+      if (c == ']') {
+        EndContainer();
+        break;
+      }
+      state_ = State::kValue;
+      Feed(c);
+      break;
+    }
+    case State::kKey:
+    case State::kKeyOrEnd: {
+      if (space == true) {
+        break;
+      }
+      if (c == '}' && state_ == State::kKeyOrEnd) {
+        EndContainer();
+      } else if (c == '"') {
+        token_.clear();
+        in_key_ = true;
+        state_ = State::kString;
+      } else {
+        state_ = State::kError;
+      }
+      break;
+    }
+    case State::kColon: {
+      if (space == true) {
+        break;
+      }
+      state_ = (c == ':') ? State::kValue : State::kError;
+      break;
+    }
+    case State::kCommaOrEnd: {
+      if (space == true) {
+        break;
+      }
+      bool object = frames_.back().object();
+      if (c == ',') {
+        state_ = object ? State::kKey : State::kValue;
+      } else if ((c == '}' && object == true) ||
+                 (c == ']' && object == false)) {
+        EndContainer();
+      } else {
+        state_ = State::kError;
+      }
+      break;
+    }
+    case State::kString: {
+      if (c == '\\') {
+        state_ = State::kEscape;
+      } else if (c != '"') {
+        token_.push_back(c);
+      } else if (in_key_ == true) {
+        frames_.back().set_key(token_);
+        state_ = State::kColon;
+      } else {
+        EndScalar(token_);
+      }
+      break;
+    }
+    case State::kEscape: {
+      FeedEscape(c);
+      break;
+    }
+    case State::kUnicode: {
+      FeedUnicode(c);
+      break;
+    }
+    case State::kLiteral: {
+      if (std::isalnum(static_cast<unsigned char>(c)) ||
+          c == '.' || c == '+' || c == '-') {
+        token_.push_back(c);
+        break;
+      }
+      if (std::isalpha(static_cast<unsigned char>(token_.front())) &&
+          token_ != "true" && token_ != "false" && token_ != "null") {
+        state_ = State::kError;
+        break;
+      }
+      EndScalar(token_);
+      Feed(c);
+      break;
+    }
+    case State::kDone: {
+      if (space == false) {
+        state_ = State::kError;
+      }
+      break;
+    }
+    default: {
+      break;
+    }
+  }
+}
+
+
+void HttpJsonSink::FeedEscape(char c) {
+  state_ = State::kString;
+  switch (c) {
+    case '"':
+    case '\\':
+    case '/': token_.push_back(c); break;
+    case 'b': token_.push_back('\b'); break;
+    case 'f': token_.push_back('\f'); break;
+    case 'n': token_.push_back('\n'); break;
+    case 'r': token_.push_back('\r'); break;
+    case 't': token_.push_back('\t'); break;
+    case 'u': {
+      unicode_.clear();
+      state_ = State::kUnicode;
+      break;
+    }
+    default: {
+      state_ = State::kError;
+      break;
+    }
+  }
+}
+
+
+void HttpJsonSink::FeedUnicode(char c) {
+  if (std::isxdigit(static_cast<unsigned char>(c)) == 0) {
+    state_ = State::kError;
+    return;
+  }
+  unicode_.push_back(c);
+  if (unicode_.size() < 4) {
+    return;
+  }
+  state_ = State::kString;
+
+  uint32_t code = std::stoul(unicode_, nullptr, 16);
+  if (code >= 0xD800 && code <= 0xDBFF) {
+    // the low half follows as another escape.
+    high_surrogate_ = code;
+    return;
+  }
+  if (code >= 0xDC00 && code <= 0xDFFF && high_surrogate_ != 0) {
+    code = 0x10000 + ((high_surrogate_ - 0xD800) << 10) + (code - 0xDC00);
+  }
+  high_surrogate_ = 0;
+  AppendUtf8(code, &token_);
+}
+
+
+void HttpJsonSink::Match(
+    bool *whole,
+    std::vector<std::size_t> *alive) const {
+  *whole = false;
+  if (frames_.empty() == true) {
+    for (std::size_t i = 0; i < paths_.size(); ++i) {
+      if (paths_[i].empty() == true) {
+        *whole = true;
+      } else {
+        alive->emplace_back(i);
+      }
+    }
+    return;
+  }
+
+  const Frame &parent = frames_.back();
+  if (parent.whole() == true) {
+    *whole = true;
+    return;
+  }
+
+  std::size_t depth = frames_.size() - 1;
+  const std::string &name = parent.object() ?
+      parent.key() : std::to_string(parent.index());
+  for (const auto &i : parent.alive()) {
+    const auto &path = paths_[i];
+    if (path[depth] != name && path[depth] != "*") {
+      continue;
+    }
+    if (path.size() == depth + 1) {
+      *whole = true;
+    } else {
+      alive->emplace_back(i);
+    }
+  }
+}
+
+
+boost::property_tree::ptree *HttpJsonSink::AddChild(
+    const std::string &value) {
+  const Frame &parent = frames_.back();
+  const std::string &key = parent.object() ? parent.key() : "";
+  parent.out()->push_back(
+      std::make_pair(key, boost::property_tree::ptree{value}));
+  return &parent.out()->back().second;
+}
+
+
+void HttpJsonSink::BeginContainer(bool object) {
+  bool whole{false};
+  std::vector<std::size_t> alive;
+  Match(&whole, &alive);
+
+  boost::property_tree::ptree *out{nullptr};
+  if (whole == true || alive.empty() == false) {
+    out = frames_.empty() ? &tree_ : AddChild("");
+  }
+  frames_.emplace_back(object, whole, alive, out);
+}
+
+
+void HttpJsonSink::EndContainer() {
+  frames_.pop_back();
+  EndValue();
+}
+
+
+void HttpJsonSink::EndScalar(const std::string &value) {
+  bool whole{false};
+  std::vector<std::size_t> alive;
+  Match(&whole, &alive);
+
+  if (whole == true) {
+    if (frames_.empty() == true) {
+      tree_.data() = value;
+    } else {
+      AddChild(value);
+    }
+  }
+  EndValue();
+}
+
+
+void HttpJsonSink::EndValue() {
+  if (frames_.empty() == true) {
+    state_ = State::kDone;
+    return;
+  }
+  if (frames_.back().object() == false) {
+    frames_.back().Next();
+  }
+  state_ = State::kCommaOrEnd;
+}
+
+
+HttpJsonSink::Frame::Frame(
+    bool object,
+    bool whole,
+    const std::vector<std::size_t> &alive,
+    boost::property_tree::ptree *out)
+    : object_{object},
+      whole_{whole},
+      alive_{alive},
+      out_{out},
+      key_{},
+      index_{0} {
+}
+
+
+HttpJsonSink::Frame::~Frame() {
+}
+}  // namespace ncstreamer
@@ -0,0 +1,117 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#ifndef NCSTREAMER_CEF_SRC_LIB_HTTP_JSON_SINK_H_
+#define NCSTREAMER_CEF_SRC_LIB_HTTP_JSON_SINK_H_
+
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "boost/property_tree/ptree.hpp"
+
+#include "ncstreamer_cef/src/lib/http_response_sink.h"
+
+
+namespace ncstreamer {
+// picks the values at the given paths out of a json body as it arrives,
+// and lets the rest go by; nothing but the picked values is kept.
+// a path is dotted, as "accounts.data.*.id", where "*" stands for any
+// key or array index. a path to an object or an array picks it whole.
+class HttpJsonSink : public HttpResponseSink {
+ public:
+  explicit HttpJsonSink(const std::vector<std::string> &paths);
+  virtual ~HttpJsonSink();
+
+  void Write(const char *data, std::size_t size) override;
+  void Close() override;
+
+  // after the close; false unless the body was one whole json value.
+  bool ok() const;
+  // the picked values, laid out as read_json would have.
+  const boost::property_tree::ptree &tree() const { return tree_; }
+
+ private:
+  enum class State {
+    kValue,
+    kValueOrEnd,
+    kKey,
+    kKeyOrEnd,
+    kColon,
+    kCommaOrEnd,
+    kString,
+    kEscape,
+    kUnicode,
+    kLiteral,
+    kDone,
+    kError,
+  };
+
+  class Frame;
+
+  static std::vector<std::string> Split(const std::string &path);
+  static void AppendUtf8(uint32_t code_point, std::string *out);
+
+  void Feed(char c);
+  void FeedEscape(char c);
+  void FeedUnicode(char c);
+
+  // of the value about to be read: whether it is picked whole, or else
+  // which of the paths go on below it.
+  void Match(bool *whole, std::vector<std::size_t> *alive) const;
+  boost::property_tree::ptree *AddChild(const std::string &value);
+
+  void BeginContainer(bool object);
+  void EndContainer();
+  void EndScalar(const std::string &value);
+  void EndValue();
+
+  std::vector<std::vector<std::string>> paths_;
+  boost::property_tree::ptree tree_;
+
+  State state_;
+  std::vector<Frame> frames_;
+  std::string token_;
+  bool in_key_;
+  std::string unicode_;
+  uint32_t high_surrogate_;
+};
+
+
+class HttpJsonSink::Frame {
+ public:
+  Frame(
+      bool object,
+      bool whole,
+      const std::vector<std::size_t> &alive,
+      boost::property_tree::ptree *out);
+  virtual ~Frame();
+
+  bool object() const { return object_; }
+  bool whole() const { return whole_; }
+  const std::vector<std::size_t> &alive() const { return alive_; }
+  boost::property_tree::ptree *out() const { return out_; }
+  const std::string &key() const { return key_; }
+  std::size_t index() const { return index_; }
+
+  void set_key(const std::string &key) { key_ = key; }
+  void Next() { ++index_; }
+
+ private:
+  bool object_;
+  bool whole_;
+  std::vector<std::size_t> alive_;
+  // null if nothing below is picked.
+  boost::property_tree::ptree *out_;
+
+  // of the value being read.
+  std::string key_;
+  std::size_t index_;
+};
+}  // namespace ncstreamer
+
+
+#endif  // NCSTREAMER_CEF_SRC_LIB_HTTP_JSON_SINK_H_
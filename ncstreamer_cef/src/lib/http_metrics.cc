@@ -0,0 +1,248 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#include "ncstreamer_cef/src/lib/http_metrics.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iomanip>
+#include <sstream>
+#include <utility>
+
+
+namespace {
+double ToMs(const ncstreamer::HttpRequestTiming::Clock::duration &duration) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+      duration).count() / 1000.0;
+}
+}  // unnamed namespace
+
+
+namespace ncstreamer {
+void HttpMetrics::SetUp() {
+  assert(!static_instance);
+  static_instance = new HttpMetrics{};
+}
+
+
+void HttpMetrics::ShutDown() {
+  assert(static_instance);
+  delete static_instance;
+  static_instance = nullptr;
+}
+
+
+HttpMetrics *HttpMetrics::Get() {
+  assert(static_instance);
+  return static_instance;
+}
+
+
+void HttpMetrics::Record(const HttpRequestTiming &timing) {
+  std::lock_guard<std::mutex> lock{mutex_};
+  endpoints_[timing.method() + " " + timing.endpoint()].Add(timing);
+}
+
+
+void HttpMetrics::CountGet(bool coalesced) {
+  std::lock_guard<std::mutex> lock{mutex_};
+  ++get_count_;
+  if (coalesced == true) {
+    ++coalesced_count_;
+  }
+}
+
+
+boost::property_tree::ptree HttpMetrics::ToTree() const {
+  std::lock_guard<std::mutex> lock{mutex_};
+
+  boost::property_tree::ptree endpoints;
+  for (const auto &elem : endpoints_) {
+    boost::property_tree::ptree endpoint{elem.second.ToTree()};
+    endpoint.put("endpoint", elem.first);
+    endpoints.push_back(std::make_pair("", endpoint));
+  }
+
+  boost::property_tree::ptree tree;
+  tree.add_child("endpoints", endpoints);
+  tree.put("gets", get_count_);
+  tree.put("coalescedGets", coalesced_count_);
+  return tree;
+}
+
+
+std::string HttpMetrics::ToString() const {
+  std::lock_guard<std::mutex> lock{mutex_};
+
+  std::stringstream ss;
+  ss << "http: " << get_count_ << " gets, "
+     << coalesced_count_ << " coalesced.";
+  for (const auto &elem : endpoints_) {
+    ss << "\r\n" << elem.first << ": " << elem.second.ToString();
+  }
+  return ss.str();
+}
+
+
+HttpMetrics::HttpMetrics()
+    : mutex_{},
+      endpoints_{},
+      get_count_{0},
+      coalesced_count_{0} {
+}
+
+
+HttpMetrics::~HttpMetrics() {
+}
+
+
+HttpMetrics *HttpMetrics::static_instance{nullptr};
+
+
+HttpMetrics::Histogram::Histogram()
+    : count_{0},
+      sum_ms_{0.0},
+      max_ms_{0.0},
+      buckets_(kBoundsMs.size() + 1, 0) {
+}
+
+
+HttpMetrics::Histogram::~Histogram() {
+}
+
+
+void HttpMetrics::Histogram::Add(double ms) {
+  ++count_;
+  sum_ms_ += ms;
+  max_ms_ = (std::max)(max_ms_, ms);
+
+  auto i = std::lower_bound(kBoundsMs.begin(), kBoundsMs.end(), ms);
+  ++buckets_[i - kBoundsMs.begin()];
+}
+
+
+double HttpMetrics::Histogram::GetQuantile(double quantile) const {
+  if (count_ == 0) {
+    return 0.0;
+  }
+
+  uint64_t rank = static_cast<uint64_t>(quantile * (count_ - 1)) + 1;
+  uint64_t seen{0};
+  for (std::size_t i = 0; i < kBoundsMs.size(); ++i) {
+    seen += buckets_[i];
+    if (seen >= rank) {
+      return (std::min)(kBoundsMs[i], max_ms_);
+    }
+  }
+  return max_ms_;
+}
+
+
+boost::property_tree::ptree HttpMetrics::Histogram::ToTree() const {
+  boost::property_tree::ptree tree;
+  tree.put("count", count_);
+  tree.put("averageMs", count_ == 0 ? 0.0 : sum_ms_ / count_);
+  tree.put("p50Ms", GetQuantile(0.5));
+  tree.put("p90Ms", GetQuantile(0.9));
+  tree.put("maxMs", max_ms_);
+
+  boost::property_tree::ptree buckets;
+  for (std::size_t i = 0; i < buckets_.size(); ++i) {
+    boost::property_tree::ptree bucket;
+    // the last bucket has no bound.
+    bucket.put("upToMs", i < kBoundsMs.size() ? kBoundsMs[i] : -1.0);
+    bucket.put("count", buckets_[i]);
+    buckets.push_back(std::make_pair("", bucket));
+  }
+  tree.add_child("buckets", buckets);
+  return tree;
+}
+
+
+const std::vector<double> HttpMetrics::Histogram::kBoundsMs{
+    1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000, 5000, 10000, 30000};
+
+
+HttpMetrics::Endpoint::Endpoint()
+    : count_{0},
+      failures_{0},
+      reused_{0},
+      retries_{0},
+      bytes_{0},
+      dns_{},
+      connect_{},
+      tls_{},
+      first_byte_{},
+      transfer_{},
+      total_{} {
+}
+
+
+HttpMetrics::Endpoint::~Endpoint() {
+}
+
+
+void HttpMetrics::Endpoint::Add(const HttpRequestTiming &timing) {
+  ++count_;
+  retries_ += timing.retries();
+  total_.Add(ToMs(timing.total()));
+  if (timing.succeeded() == false) {
+    ++failures_;
+    return;
+  }
+
+  bytes_ += timing.bytes();
+  // a kept-alive connection would only bring the zeros in.
+  if (timing.reused() == true) {
+    ++reused_;
+  } else {
+    dns_.Add(ToMs(timing.dns()));
+    connect_.Add(ToMs(timing.connect()));
+    tls_.Add(ToMs(timing.tls()));
+  }
+  first_byte_.Add(ToMs(timing.first_byte()));
+  transfer_.Add(ToMs(timing.transfer()));
+}
+
+
+boost::property_tree::ptree HttpMetrics::Endpoint::ToTree() const {
+  boost::property_tree::ptree tree;
+  tree.put("count", count_);
+  tree.put("failures", failures_);
+  tree.put("reused", reused_);
+  tree.put("retries", retries_);
+  tree.put("bytes", bytes_);
+  tree.add_child("dns", dns_.ToTree());
+  tree.add_child("connect", connect_.ToTree());
+  tree.add_child("tls", tls_.ToTree());
+  tree.add_child("firstByte", first_byte_.ToTree());
+  tree.add_child("transfer", transfer_.ToTree());
+  tree.add_child("total", total_.ToTree());
+  return tree;
+}
+
+
+std::string HttpMetrics::Endpoint::ToString() const {
+  static const auto ToQuantiles = [](const Histogram &histogram) {
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(1)
+       << histogram.GetQuantile(0.5) << "/"
+       << histogram.GetQuantile(0.9) << "ms";
+    return ss.str();
+  };
+
+  std::stringstream ss;
+  ss << count_ << " requests (" << failures_ << " failed, "
+     << reused_ << " reused, " << retries_ << " retries, "
+     << bytes_ << " bytes); p50/p90"
+     << " dns " << ToQuantiles(dns_)
+     << ", connect " << ToQuantiles(connect_)
+     << ", tls " << ToQuantiles(tls_)
+     << ", first byte " << ToQuantiles(first_byte_)
+     << ", transfer " << ToQuantiles(transfer_)
+     << ", total " << ToQuantiles(total_) << ".";
+  return ss.str();
+}
+}  // namespace ncstreamer
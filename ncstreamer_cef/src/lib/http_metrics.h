@@ -0,0 +1,104 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#ifndef NCSTREAMER_CEF_SRC_LIB_HTTP_METRICS_H_
+#define NCSTREAMER_CEF_SRC_LIB_HTTP_METRICS_H_
+
+
+#include <cstdint>
+#include <map>
+#include <mutex>  // NOLINT
+#include <string>
+#include <vector>
+
+#include "boost/property_tree/ptree.hpp"
+
+#include "ncstreamer_cef/src/lib/http_request_timing.h"
+
+
+namespace ncstreamer {
+// the timings of the requests, in histograms per endpoint, and the
+// counts of the gets coalesced; for the whole process.
+class HttpMetrics {
+ public:
+  static void SetUp();
+  static void ShutDown();
+  static HttpMetrics *Get();
+
+  void Record(const HttpRequestTiming &timing);
+  void CountGet(bool coalesced);
+
+  boost::property_tree::ptree ToTree() const;
+  // a line per endpoint, for the log.
+  std::string ToString() const;
+
+ private:
+  class Histogram;
+  class Endpoint;
+
+  HttpMetrics();
+  virtual ~HttpMetrics();
+
+  static HttpMetrics *static_instance;
+
+  // the timings come from the io threads of the request services.
+  mutable std::mutex mutex_;
+  std::map<std::string /*method and endpoint*/, Endpoint> endpoints_;
+  uint64_t get_count_;
+  uint64_t coalesced_count_;
+};
+
+
+// of the durations in milliseconds, in buckets of fixed bounds.
+class HttpMetrics::Histogram {
+ public:
+  Histogram();
+  virtual ~Histogram();
+
+  void Add(double ms);
+  // the upper bound of the bucket where the quantile falls.
+  double GetQuantile(double quantile) const;
+
+  boost::property_tree::ptree ToTree() const;
+
+ private:
+  static const std::vector<double> kBoundsMs;
+
+  uint64_t count_;
+  double sum_ms_;
+  double max_ms_;
+  // the last is over the last bound.
+  std::vector<uint64_t> buckets_;
+};
+
+
+class HttpMetrics::Endpoint {
+ public:
+  Endpoint();
+  virtual ~Endpoint();
+
+  void Add(const HttpRequestTiming &timing);
+
+  boost::property_tree::ptree ToTree() const;
+  std::string ToString() const;
+
+ private:
+  uint64_t count_;
+  uint64_t failures_;
+  uint64_t reused_;
+  uint64_t retries_;
+  uint64_t bytes_;
+
+  Histogram dns_;
+  Histogram connect_;
+  Histogram tls_;
+  Histogram first_byte_;
+  Histogram transfer_;
+  Histogram total_;
+};
+}  // namespace ncstreamer
+
+
+#endif  // NCSTREAMER_CEF_SRC_LIB_HTTP_METRICS_H_
@@ -0,0 +1,808 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#include "ncstreamer_cef/src/lib/http_mock_server.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>  // NOLINT
+#include <functional>
+#include <istream>
+#include <sstream>
+
+#include "boost/asio/ip/address.hpp"
+#include "boost/asio/read.hpp"
+#include "boost/asio/read_until.hpp"
+#include "boost/asio/steady_timer.hpp"
+#include "boost/asio/streambuf.hpp"
+#include "boost/asio/write.hpp"
+#include "boost/property_tree/json_parser.hpp"
+
+
+namespace {
+std::string ToLower(const std::string &str) {
+  std::string lower{str};
+  std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+  return lower;
+}
+
+
+std::string Trim(const std::string &str) {
+  static const char *kSpaces{" \t\r\n"};
+  std::size_t first = str.find_first_not_of(kSpaces);
+  if (first == std::string::npos) {
+    return "";
+  }
+  std::size_t last = str.find_last_not_of(kSpaces);
+  return str.substr(first, last - first + 1);
+}
+
+
+std::vector<std::string> SplitPath(const std::string &path) {
+  std::vector<std::string> segments;
+  std::stringstream ss{path};
+  std::string segment;
+  while (std::getline(ss, segment, '/')) {
+    if (segment.empty() == false) {
+      segments.emplace_back(segment);
+    }
+  }
+  return segments;
+}
+
+
+const char *ToReason(int status) {
+  switch (status) {
+    case 200: return "OK";
+    case 204: return "No Content";
+    case 302: return "Found";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 408: return "Request Timeout";
+    case 429: return "Too Many Requests";
+    case 500: return "Internal Server Error";
+    case 502: return "Bad Gateway";
+    case 503: return "Service Unavailable";
+    default: return "Unknown";
+  }
+}
+
+
+std::string ToChunked(const std::string &body, std::size_t chunk_size) {
+  std::stringstream chunked;
+  for (std::size_t pos = 0; pos < body.size(); pos += chunk_size) {
+    std::size_t size = (std::min)(chunk_size, body.size() - pos);
+    chunked << std::hex << size << "\r\n"
+            << body.substr(pos, size) << "\r\n";
+  }
+  chunked << "0\r\n\r\n";
+  return chunked.str();
+}
+
+
+// a body of children is json; any other is the text as it is.
+std::string ToBody(const boost::property_tree::ptree &tree) {
+  if (tree.empty() == true) {
+    return tree.data();
+  }
+  std::stringstream body;
+  boost::property_tree::write_json(body, tree, false);
+  return Trim(body.str());
+}
+
+
+const char *kFailureBody{"{\"error\":{\"message\":\"mock failure\"}}"};
+const char *kUnmatchedBody{"{\"error\":{\"message\":\"no route\"}}"};
+}  // unnamed namespace
+
+
+namespace ncstreamer {
+class HttpMockServer::Session
+    : public std::enable_shared_from_this<Session> {
+ public:
+  Session(
+      HttpMockServer *server,
+      boost::asio::io_service *io_service,
+      boost::asio::ssl::context *ssl_context,
+      bool secure)
+      : server_{server},
+        secure_{secure},
+        stream_{*io_service, *ssl_context},
+        timer_{*io_service},
+        buffer_{},
+        write_data_{},
+        written_{0},
+        closed_{false} {
+  }
+
+  virtual ~Session() {
+  }
+
+  boost::asio::ip::tcp::socket &socket() { return stream_.next_layer(); }
+
+  void Start() {
+    server_->OnConnected();
+    if (secure_ == false) {
+      ReadRequest();
+      return;
+    }
+
+    auto self = shared_from_this();
+    stream_.async_handshake(
+        boost::asio::ssl::stream_base::server,
+        [self](const boost::system::error_code &ec) {
+      if (ec) {
+        self->Close();
+        return;
+      }
+      self->ReadRequest();
+    });
+  }
+
+  void Close() {
+    if (closed_ == true) {
+      return;
+    }
+    closed_ = true;
+    boost::system::error_code ec;
+    timer_.cancel(ec);
+    stream_.lowest_layer().close(ec);
+  }
+
+ private:
+  using Handler = std::function<void()>;
+
+  void ReadRequest() {
+    auto self = shared_from_this();
+    auto on_read = [self](
+        const boost::system::error_code &ec, std::size_t /*size*/) {
+      if (ec) {
+        self->Close();
+        return;
+      }
+      self->OnRequestHeader();
+    };
+    if (secure_ == true) {
+      boost::asio::async_read_until(stream_, buffer_, "\r\n\r\n", on_read);
+    } else {
+      boost::asio::async_read_until(
+          stream_.next_layer(), buffer_, "\r\n\r\n", on_read);
+    }
+  }
+
+  void OnRequestHeader() {
+    std::istream in{&buffer_};
+    std::string line;
+    std::getline(in, line);
+
+    std::string method;
+    std::string target;
+    std::string version;
+    std::stringstream{line} >> method >> target >> version;
+
+    std::size_t content_length{0};
+    bool close{Trim(version) == "HTTP/1.0"};
+    while (std::getline(in, line) && Trim(line).empty() == false) {
+      std::size_t colon = line.find(':');
+      if (colon == std::string::npos) {
+        continue;
+      }
+      const std::string &name = ToLower(Trim(line.substr(0, colon)));
+      const std::string &value = Trim(line.substr(colon + 1));
+      if (name == "content-length") {
+        try {
+          content_length = std::stoul(value);
+        } catch (const std::exception &/*e*/) {
+          Close();
+          return;
+        }
+      } else if (name == "connection") {
+        close = (ToLower(value) == "close");
+      }
+    }
+
+    const std::string &path = target.substr(0, target.find_first_of("?#"));
+    ReadContent(content_length, [this, method, path, close]() {
+      Respond(method, path, close);
+    });
+  }
+
+  // the content is not of interest; it is read only to keep the
+  // connection in step.
+  void ReadContent(std::size_t size, const Handler &on_read) {
+    if (buffer_.size() >= size) {
+      buffer_.consume(size);
+      on_read();
+      return;
+    }
+
+    std::size_t lack = size - buffer_.size();
+    auto self = shared_from_this();
+    auto on_content = [self, size, on_read](
+        const boost::system::error_code &ec, std::size_t /*size*/) {
+      if (ec) {
+        self->Close();
+        return;
+      }
+      self->buffer_.consume(size);
+      on_read();
+    };
+    if (secure_ == true) {
+      boost::asio::async_read(
+          stream_, buffer_, boost::asio::transfer_exactly(lack), on_content);
+    } else {
+      boost::asio::async_read(
+          stream_.next_layer(), buffer_,
+          boost::asio::transfer_exactly(lack), on_content);
+    }
+  }
+
+  void Respond(
+      const std::string &method,
+      const std::string &path,
+      bool close) {
+    std::size_t count{0};
+    const Route *route = server_->Match(method, path, &count);
+    if (!route) {
+      static const Route kUnmatched{
+          "", "", 404, {}, kUnmatchedBody, Delivery{}, Failure{}};
+      route = &kUnmatched;
+    }
+
+    auto self = shared_from_this();
+    timer_.expires_from_now(
+        std::chrono::milliseconds{route->delivery().latency_ms()});
+    timer_.async_wait([self, route, count, close](
+        const boost::system::error_code &ec) {
+      if (ec) {
+        self->Close();
+        return;
+      }
+      self->Reply(*route, route->failure().FailsAt(count), close);
+    });
+  }
+
+  void Reply(const Route &route, bool fails, bool close) {
+    const Failure &failure = route.failure();
+    Failure::Kind kind =
+        (fails == true) ? failure.kind() : Failure::Kind::kNone;
+    bool breaks = (kind == Failure::Kind::kDrop ||
+                   kind == Failure::Kind::kStall);
+    if (breaks == true && failure.after_bytes() < 0) {
+      Break(kind);
+      return;
+    }
+
+    int status = route.status();
+    std::string body = route.body();
+    if (kind == Failure::Kind::kStatus) {
+      status = failure.status();
+      body = kFailureBody;
+    }
+
+    const Delivery &delivery = route.delivery();
+    std::stringstream header;
+    header << "HTTP/1.1 " << status << " " << ToReason(status) << "\r\n";
+    bool has_content_type{false};
+    for (const auto &elem : route.headers()) {
+      header << elem.first << ": " << elem.second << "\r\n";
+      has_content_type |= (ToLower(elem.first) == "content-type");
+    }
+    if (has_content_type == false) {
+      header << "Content-Type: "
+             << ((body.empty() == false &&
+                  (body.front() == '{' || body.front() == '[')) ?
+                 "application/json" : "text/plain") << "\r\n";
+    }
+    if (delivery.chunk_size() > 0) {
+      header << "Transfer-Encoding: chunked\r\n";
+      body = ToChunked(body, delivery.chunk_size());
+    } else {
+      header << "Content-Length: " << body.size() << "\r\n";
+    }
+    close |= breaks;
+    header << "Connection: " << ((close == true) ? "close" : "keep-alive")
+           << "\r\n\r\n";
+
+    if (breaks == true) {
+      body.resize((std::min)(
+          body.size(), static_cast<std::size_t>(failure.after_bytes())));
+    }
+    write_data_ = header.str() + body;
+    written_ = 0;
+    Send(delivery.bytes_per_sec(), [this, kind, breaks, close]() {
+      if (breaks == true) {
+        Break(kind);
+      } else if (close == true) {
+        Close();
+      } else {
+        ReadRequest();
+      }
+    });
+  }
+
+  // a tenth of the rate every 100ms if throttled; all at once if not.
+  void Send(uint32_t bytes_per_sec, const Handler &on_sent) {
+    std::size_t piece = write_data_.size() - written_;
+    if (bytes_per_sec > 0) {
+      piece = (std::min)(
+          piece, (std::max)(static_cast<std::size_t>(bytes_per_sec / 10),
+                            static_cast<std::size_t>(1)));
+    }
+
+    auto self = shared_from_this();
+    auto on_written = [self, bytes_per_sec, on_sent](
+        const boost::system::error_code &ec, std::size_t size) {
+      if (ec) {
+        self->Close();
+        return;
+      }
+      self->written_ += size;
+      if (self->written_ >= self->write_data_.size()) {
+        on_sent();
+        return;
+      }
+      if (bytes_per_sec == 0) {
+        self->Send(bytes_per_sec, on_sent);
+        return;
+      }
+      self->timer_.expires_from_now(std::chrono::milliseconds{100});
+      self->timer_.async_wait([self, bytes_per_sec, on_sent](
+          const boost::system::error_code &ec) {
+        if (ec) {
+          self->Close();
+          return;
+        }
+        self->Send(bytes_per_sec, on_sent);
+      });
+    };
+    const auto &data = boost::asio::buffer(&write_data_[written_], piece);
+    if (secure_ == true) {
+      boost::asio::async_write(stream_, data, on_written);
+    } else {
+      boost::asio::async_write(stream_.next_layer(), data, on_written);
+    }
+  }
+
+  void Break(Failure::Kind kind) {
+    if (kind == Failure::Kind::kDrop) {
+      Close();
+      return;
+    }
+
+    // stalls by reading whatever comes until the client goes away.
+    auto self = shared_from_this();
+    auto on_read = [self](
+        const boost::system::error_code &ec, std::size_t /*size*/) {
+      if (ec) {
+        self->Close();
+        return;
+      }
+      self->buffer_.consume(self->buffer_.size());
+      self->Break(Failure::Kind::kStall);
+    };
+    if (secure_ == true) {
+      boost::asio::async_read(
+          stream_, buffer_, boost::asio::transfer_at_least(1), on_read);
+    } else {
+      boost::asio::async_read(
+          stream_.next_layer(), buffer_,
+          boost::asio::transfer_at_least(1), on_read);
+    }
+  }
+
+  HttpMockServer *const server_;
+  const bool secure_;
+  boost::asio::ssl::stream<boost::asio::ip::tcp::socket> stream_;
+  boost::asio::steady_timer timer_;
+  boost::asio::streambuf buffer_;
+  std::string write_data_;
+  std::size_t written_;
+  bool closed_;
+};
+
+
+void HttpMockServer::SetUp(
+    uint16_t port,
+    const std::vector<Route> &routes,
+    const std::string &certificate_file,
+    const std::string &private_key_file) {
+  assert(!static_instance);
+  static_instance = new HttpMockServer{
+      port, routes, certificate_file, private_key_file};
+}
+
+
+void HttpMockServer::ShutDown() {
+  assert(static_instance);
+  delete static_instance;
+  static_instance = nullptr;
+}
+
+
+HttpMockServer *HttpMockServer::Get() {
+  assert(static_instance);
+  return static_instance;
+}
+
+
+std::vector<HttpMockServer::Route> HttpMockServer::ParseScript(
+    const std::string &json) {
+  std::vector<Route> routes;
+  if (json.empty() == true) {
+    return routes;
+  }
+
+  // get_child() hands back its default, so the default has to outlive
+  // the reference.
+  static const boost::property_tree::ptree kEmpty{};
+
+  boost::property_tree::ptree root;
+  std::stringstream root_ss{json};
+  try {
+    boost::property_tree::read_json(root_ss, root);
+    const auto &arr = root.get_child("routes", kEmpty);
+    for (const auto &elem : arr) {
+      const boost::property_tree::ptree &obj = elem.second;
+
+      std::vector<std::pair<std::string, std::string>> headers;
+      for (const auto &header : obj.get_child("headers", kEmpty)) {
+        headers.emplace_back(header.first, header.second.data());
+      }
+
+      // a body of the size is the body repeated, for the bulk routes.
+      std::string body{ToBody(obj.get_child("body", kEmpty))};
+      std::size_t body_size = obj.get<std::size_t>("bodySize", 0);
+      if (body_size > 0) {
+        std::string pattern{body.empty() ? std::string{"."} : body};
+        body.clear();
+        while (body.size() < body_size) {
+          body += pattern;
+        }
+        body.resize(body_size);
+      }
+
+      routes.emplace_back(
+          obj.get<std::string>("method", "GET"),
+          obj.get<std::string>("path"),
+          obj.get<int>("status", 200),
+          headers,
+          body,
+          Delivery{
+              obj.get<uint32_t>("latencyMs", 0),
+              obj.get<uint32_t>("bytesPerSec", 0),
+              obj.get<std::size_t>("chunkSize", 0)},
+          Failure{
+              Failure::ToKind(obj.get<std::string>("failure", "none")),
+              obj.get<std::size_t>("failTimes", 0),
+              obj.get<int64_t>("failAfterBytes", -1),
+              obj.get<int>("failStatus", 503)});
+    }
+  } catch (const std::exception &/*e*/) {
+    routes.clear();
+  }
+  return routes;
+}
+
+
+std::vector<HttpMockServer::Route> HttpMockServer::GetDefaultRoutes(
+    const std::string &stream_url) {
+  // the ids are those the app sends back, so any of them will do.
+  std::stringstream script;
+  script << R"({"routes": [
+      {"method": "GET", "path": "/v2.8/dialog/oauth", "status": 302,
+       "headers": {"Location": "/connect/login_success.html#)"
+         << R"(access_token=mock-user-token&expires_in=5183999"}},
+      {"method": "GET", "path": "/connect/login_success.html",
+       "headers": {"Content-Type": "text/html"},
+       "body": "<html><body>logged in</body></html>"},
+      {"method": "GET", "path": "/v2.8/me",
+       "body": {"id": "1000", "name": "Mock User",
+                "link": "https://www.facebook.com/1000",
+                "accounts": {"data": [
+                    {"id": "2000", "name": "Mock Page",
+                     "link": "https://www.facebook.com/2000",
+                     "access_token": "mock-page-token"}]}}},
+      {"method": "POST", "path": "/{id}/live_videos",
+       "body": {"id": "3000", "stream_url": ")" << stream_url << R"("}},
+      {"method": "POST", "path": "/{id}",
+       "body": {"id": "3000", "success": "true"}}]})";
+  return ParseScript(script.str());
+}
+
+
+bool HttpMockServer::IsListening() const {
+  return listening_;
+}
+
+
+std::string HttpMockServer::GetUri() const {
+  if (listening_ == false) {
+    return "";
+  }
+
+  // by name, as the certificates of a local server are issued for.
+  std::stringstream uri;
+  uri << ((secure_ == true) ? "https" : "http") << "://localhost:" << port_;
+  return uri.str();
+}
+
+
+boost::property_tree::ptree HttpMockServer::ToTree() const {
+  std::lock_guard<std::mutex> lock{mutex_};
+
+  boost::property_tree::ptree routes;
+  for (std::size_t i = 0; i < routes_.size(); ++i) {
+    boost::property_tree::ptree route{routes_[i].ToTree()};
+    route.put("requests", route_requests_[i]);
+    routes.push_back({"", route});
+  }
+
+  boost::property_tree::ptree tree;
+  tree.put("listening", listening_);
+  tree.put("uri", GetUri());
+  tree.put("connections", connections_);
+  tree.put("requests", requests_);
+  tree.put("unmatched", unmatched_);
+  tree.add_child("routes", routes);
+  return std::move(tree);
+}
+
+
+HttpMockServer::HttpMockServer(
+    uint16_t port,
+    const std::vector<Route> &routes,
+    const std::string &certificate_file,
+    const std::string &private_key_file)
+    : port_{port},
+      routes_{routes},
+      secure_{false},
+      listening_{false},
+      io_service_{},
+      io_service_work_{io_service_},
+      ssl_context_{boost::asio::ssl::context::sslv23_server},
+      acceptor_{io_service_},
+      mutex_{},
+      route_requests_(routes.size(), 0),
+      connections_{0},
+      requests_{0},
+      unmatched_{0},
+      io_thread_{} {
+  if (port_ == 0) {
+    return;
+  }
+
+  boost::system::error_code ec;
+  if (certificate_file.empty() == false &&
+      private_key_file.empty() == false) {
+    ssl_context_.set_options(
+        boost::asio::ssl::context::default_workarounds |
+        boost::asio::ssl::context::no_sslv2 |
+        boost::asio::ssl::context::no_sslv3);
+    ssl_context_.use_certificate_chain_file(certificate_file, ec);
+    if (!ec) {
+      ssl_context_.use_private_key_file(
+          private_key_file, boost::asio::ssl::context::pem, ec);
+    }
+    if (ec) {
+      return;
+    }
+    secure_ = true;
+  }
+
+  // loopback only; this is not meant to be reachable from outside.
+  boost::asio::ip::tcp::endpoint endpoint{
+      boost::asio::ip::address_v4::loopback(), port_};
+  acceptor_.open(endpoint.protocol(), ec);
+  if (!ec) {
+    acceptor_.set_option(
+        boost::asio::ip::tcp::acceptor::reuse_address{true}, ec);
+  }
+  if (!ec) {
+    acceptor_.bind(endpoint, ec);
+  }
+  if (!ec) {
+    acceptor_.listen(boost::asio::socket_base::max_connections, ec);
+  }
+  if (ec) {
+    acceptor_.close(ec);
+    return;
+  }
+
+  listening_ = true;
+  Accept();
+  io_thread_ = std::thread{[this]() {
+    io_service_.run();
+  }};
+}
+
+
+HttpMockServer::~HttpMockServer() {
+  io_service_.stop();
+  if (io_thread_.joinable() == true) {
+    io_thread_.join();
+  }
+}
+
+
+void HttpMockServer::Accept() {
+  auto session = std::make_shared<Session>(
+      this, &io_service_, &ssl_context_, secure_);
+  acceptor_.async_accept(
+      session->socket(),
+      [this, session](const boost::system::error_code &ec) {
+    if (ec) {
+      return;
+    }
+    boost::system::error_code option_ec;
+    session->socket().set_option(
+        boost::asio::ip::tcp::no_delay{true}, option_ec);
+    session->Start();
+    Accept();
+  });
+}
+
+
+const HttpMockServer::Route *HttpMockServer::Match(
+    const std::string &method,
+    const std::string &path,
+    std::size_t *count) {
+  std::lock_guard<std::mutex> lock{mutex_};
+  ++requests_;
+  for (std::size_t i = 0; i < routes_.size(); ++i) {
+    if (routes_[i].Matches(method, path) == true) {
+      *count = ++route_requests_[i];
+      return &routes_[i];
+    }
+  }
+  ++unmatched_;
+  *count = 0;
+  return nullptr;
+}
+
+
+void HttpMockServer::OnConnected() {
+  std::lock_guard<std::mutex> lock{mutex_};
+  ++connections_;
+}
+
+
+HttpMockServer::Delivery::Delivery(
+    uint32_t latency_ms,
+    uint32_t bytes_per_sec,
+    std::size_t chunk_size)
+    : latency_ms_{latency_ms},
+      bytes_per_sec_{bytes_per_sec},
+      chunk_size_{chunk_size} {
+}
+
+
+HttpMockServer::Delivery::Delivery()
+    : Delivery{0, 0, 0} {
+}
+
+
+HttpMockServer::Delivery::~Delivery() {
+}
+
+
+HttpMockServer::Failure::Failure(
+    Kind kind,
+    std::size_t times,
+    int64_t after_bytes,
+    int status)
+    : kind_{kind},
+      times_{times},
+      after_bytes_{after_bytes},
+      status_{status} {
+}
+
+
+HttpMockServer::Failure::Failure()
+    : Failure{Kind::kNone, 0, -1, 503} {
+}
+
+
+HttpMockServer::Failure::~Failure() {
+}
+
+
+HttpMockServer::Failure::Kind HttpMockServer::Failure::ToKind(
+    const std::string &name) {
+  if (name == "status") {
+    return Kind::kStatus;
+  }
+  if (name == "drop") {
+    return Kind::kDrop;
+  }
+  if (name == "stall") {
+    return Kind::kStall;
+  }
+  return Kind::kNone;
+}
+
+
+std::string HttpMockServer::Failure::ToName(Kind kind) {
+  switch (kind) {
+    case Kind::kStatus: return "status";
+    case Kind::kDrop: return "drop";
+    case Kind::kStall: return "stall";
+    default: return "none";
+  }
+}
+
+
+bool HttpMockServer::Failure::FailsAt(std::size_t count) const {
+  if (kind_ == Kind::kNone || count == 0) {
+    return false;
+  }
+  if (times_ == 0) {
+    return true;
+  }
+  return (count - 1) % (times_ + 1) < times_;
+}
+
+
+HttpMockServer::Route::Route(
+    const std::string &method,
+    const std::string &path,
+    int status,
+    const std::vector<std::pair<std::string, std::string>> &headers,
+    const std::string &body,
+    const Delivery &delivery,
+    const Failure &failure)
+    : method_{method},
+      path_{path},
+      status_{status},
+      headers_{headers},
+      body_{body},
+      delivery_{delivery},
+      failure_{failure} {
+}
+
+
+HttpMockServer::Route::~Route() {
+}
+
+
+bool HttpMockServer::Route::Matches(
+    const std::string &method,
+    const std::string &path) const {
+  if (method_ != "*" && method_ != method) {
+    return false;
+  }
+
+  const std::vector<std::string> &patterns = SplitPath(path_);
+  const std::vector<std::string> &segments = SplitPath(path);
+  for (std::size_t i = 0; i < patterns.size(); ++i) {
+    const std::string &pattern = patterns[i];
+    if (pattern == "*" && i + 1 == patterns.size()) {
+      return true;
+    }
+    if (i >= segments.size()) {
+      return false;
+    }
+    bool any = (pattern.size() >= 2 &&
+                pattern.front() == '{' && pattern.back() == '}');
+    if (any == false && pattern != segments[i]) {
+      return false;
+    }
+  }
+  return patterns.size() == segments.size();
+}
+
+
+boost::property_tree::ptree HttpMockServer::Route::ToTree() const {
+  boost::property_tree::ptree tree;
+  tree.put("method", method_);
+  tree.put("path", path_);
+  tree.put("status", status_);
+  tree.put("failure", Failure::ToName(failure_.kind()));
+  return std::move(tree);
+}
+
+
+HttpMockServer *HttpMockServer::static_instance{nullptr};
+}  // namespace ncstreamer
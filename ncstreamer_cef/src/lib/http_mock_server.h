@@ -0,0 +1,204 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#ifndef NCSTREAMER_CEF_SRC_LIB_HTTP_MOCK_SERVER_H_
+#define NCSTREAMER_CEF_SRC_LIB_HTTP_MOCK_SERVER_H_
+
+
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "boost/asio/io_service.hpp"
+#include "boost/asio/ip/tcp.hpp"
+#include "boost/asio/ssl.hpp"
+#include "boost/property_tree/ptree.hpp"
+
+
+namespace ncstreamer {
+// a local stand-in for the servers the app talks to; answers scripted
+// routes, slowly or wrongly if asked, so that the http stack can be
+// driven without the network.
+class HttpMockServer {
+ public:
+  class Route;
+  class Delivery;
+  class Failure;
+
+  // port 0 sets up a server which never listens. it serves https if
+  // both of the certificate and its private key are given.
+  static void SetUp(
+      uint16_t port,
+      const std::vector<Route> &routes,
+      const std::string &certificate_file,
+      const std::string &private_key_file);
+  static void ShutDown();
+  static HttpMockServer *Get();
+
+  // reads {"routes": [...]}; empty if malformed.
+  static std::vector<Route> ParseScript(const std::string &json);
+  // the graph api calls of the app, answered for a mock user whose new
+  // live videos stream to stream_url.
+  static std::vector<Route> GetDefaultRoutes(const std::string &stream_url);
+
+  bool IsListening() const;
+  // empty if not listening.
+  std::string GetUri() const;
+
+  boost::property_tree::ptree ToTree() const;
+
+ private:
+  class Session;
+
+  HttpMockServer(
+      uint16_t port,
+      const std::vector<Route> &routes,
+      const std::string &certificate_file,
+      const std::string &private_key_file);
+  virtual ~HttpMockServer();
+
+  void Accept();
+
+  // the first route matching, or nullptr; *count is the number of the
+  // requests of the route so far, this one included.
+  const Route *Match(
+      const std::string &method,
+      const std::string &path,
+      std::size_t *count);
+  void OnConnected();
+
+  static HttpMockServer *static_instance;
+
+  const uint16_t port_;
+  const std::vector<Route> routes_;
+  bool secure_;
+  bool listening_;
+
+  boost::asio::io_service io_service_;
+  boost::asio::io_service::work io_service_work_;
+  boost::asio::ssl::context ssl_context_;
+  boost::asio::ip::tcp::acceptor acceptor_;
+
+  mutable std::mutex mutex_;
+  std::vector<std::size_t> route_requests_;
+  std::size_t connections_;
+  std::size_t requests_;
+  std::size_t unmatched_;
+
+  std::thread io_thread_;
+};
+
+
+// how the bytes of a response go out.
+class HttpMockServer::Delivery {
+ public:
+  Delivery(
+      uint32_t latency_ms,
+      uint32_t bytes_per_sec,
+      std::size_t chunk_size);
+  Delivery();
+  virtual ~Delivery();
+
+  // before the first byte.
+  uint32_t latency_ms() const { return latency_ms_; }
+  // 0 for as fast as the socket takes.
+  uint32_t bytes_per_sec() const { return bytes_per_sec_; }
+  // 0 for a content length; any other is chunked by the size.
+  std::size_t chunk_size() const { return chunk_size_; }
+
+ private:
+  uint32_t latency_ms_;
+  uint32_t bytes_per_sec_;
+  std::size_t chunk_size_;
+};
+
+
+// how a response goes wrong.
+class HttpMockServer::Failure {
+ public:
+  enum class Kind {
+    kNone,
+    // answers with the status of the failure.
+    kStatus,
+    // closes the connection.
+    kDrop,
+    // holds the connection until the client gives up.
+    kStall,
+  };
+
+  Failure(
+      Kind kind,
+      std::size_t times,
+      int64_t after_bytes,
+      int status);
+  Failure();
+  virtual ~Failure();
+
+  static Kind ToKind(const std::string &name);
+  static std::string ToName(Kind kind);
+
+  // whether the count-th request of a route, from 1, fails.
+  bool FailsAt(std::size_t count) const;
+
+  Kind kind() const { return kind_; }
+  // so many fail in a row, then one succeeds; 0 for every one failing.
+  std::size_t times() const { return times_; }
+  // the body bytes on the wire before a drop or a stall; negative for
+  // before the headers.
+  int64_t after_bytes() const { return after_bytes_; }
+  int status() const { return status_; }
+
+ private:
+  Kind kind_;
+  std::size_t times_;
+  int64_t after_bytes_;
+  int status_;
+};
+
+
+class HttpMockServer::Route {
+ public:
+  // {name} in a path matches a segment, and a trailing * the rest.
+  Route(
+      const std::string &method,
+      const std::string &path,
+      int status,
+      const std::vector<std::pair<std::string, std::string>> &headers,
+      const std::string &body,
+      const Delivery &delivery,
+      const Failure &failure);
+  virtual ~Route();
+
+  // the path is without the query.
+  bool Matches(const std::string &method, const std::string &path) const;
+
+  boost::property_tree::ptree ToTree() const;
+
+  const std::string &method() const { return method_; }
+  const std::string &path() const { return path_; }
+  int status() const { return status_; }
+  const std::vector<std::pair<std::string, std::string>> &headers() const {
+    return headers_;
+  }
+  const std::string &body() const { return body_; }
+  const Delivery &delivery() const { return delivery_; }
+  const Failure &failure() const { return failure_; }
+
+ private:
+  std::string method_;
+  std::string path_;
+  int status_;
+  std::vector<std::pair<std::string, std::string>> headers_;
+  std::string body_;
+  Delivery delivery_;
+  Failure failure_;
+};
+}  // namespace ncstreamer
+
+
+#endif  // NCSTREAMER_CEF_SRC_LIB_HTTP_MOCK_SERVER_H_
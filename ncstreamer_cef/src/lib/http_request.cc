@@ -5,108 +5,174 @@
 
 #include "ncstreamer_cef/src/lib/http_request.h"
 
+#include <algorithm>
+#include <cctype>
+#include <istream>
+#include <sstream>
+
 #include "ncstreamer_cef/src/lib/http_types.h"
 
 
-namespace ncstreamer {
-HttpRequest::HttpRequest(boost::asio::io_service *svc)
-    : rstream_{*svc},
-      out_{},
-      buffer_{},
-      err_handler_{},
-      open_handler_{},
-      read_handler_{},
-      complete_handler_{},
-      ostream_close_handler_{} {
-  rstream_.set_option(urdl::ssl::ca_cert{"cacert.pem"});
+namespace {
+const int kMaxRedirects{5};
+
+
+std::string ToLower(const std::string &str) {
+  std::string lower{str};
+  std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+  return lower;
 }
 
 
-void HttpRequest::Download(
-    const urdl::url &url,
-    const std::string &file_name,
-    const ErrorHandler &err_handler,
-    const OpenHandler &open_handler,
-    const ReadHandler &read_handler,
-    const DownloadCompleteHandler &complete_handler) {
-  if (rstream_.is_open()) {
-    // borrowed error code from boost::asio::error temporarily.
-    // TODO(khpark): replace this error code with in-house one.
-    err_handler(boost::asio::error::already_started);
-    return;
+std::string Trim(const std::string &str) {
+  static const char *kSpaces{" \t\r\n"};
+  std::size_t first = str.find_first_not_of(kSpaces);
+  if (first == std::string::npos) {
+    return "";
   }
+  std::size_t last = str.find_last_not_of(kSpaces);
+  return str.substr(first, last - first + 1);
+}
 
-  rstream_.set_option(HttpRequestMethod::kGet);
-
-  std::fstream *ofstream{new std::fstream{
-      file_name.c_str(), std::ios_base::out | std::ios_base::binary}};
-  out_.reset(ofstream);
 
-  err_handler_ = err_handler;
-  open_handler_ = open_handler;
-  read_handler_ = read_handler;
-  complete_handler_ = [complete_handler]() {
-    complete_handler();
-  };
+bool IsDefaultPort(const urdl::url &url) {
+  return (url.protocol() == "https" && url.port() == 443) ||
+         (url.protocol() == "http" && url.port() == 80);
+}
+}  // unnamed namespace
 
-  ostream_close_handler_ = [ofstream]() {
-    ofstream->close();
-  };
 
-  Request(url);
+namespace ncstreamer {
+HttpRequest::HttpRequest(
+    boost::asio::io_service *svc,
+    HttpConnectionPool *connection_pool)
+    : io_service_{svc},
+      connection_pool_{connection_pool},
+      request_id_{0},
+      exchange_id_{0},
+      policy_{},
+      handle_{},
+      retry_count_{0},
+      random_{std::random_device{}()},
+      phase_timer_{*svc},
+      total_timer_{*svc},
+      connection_{},
+      url_{},
+      method_{},
+      headers_{},
+      content_{},
+      redirect_count_{0},
+      reused_{false},
+      responded_{false},
+      body_read_{false},
+      keep_alive_{false},
+      body_type_{BodyType::kNone},
+      body_remaining_{0},
+      sink_{},
+      timing_{},
+      started_at_{},
+      written_at_{},
+      first_byte_at_{},
+      err_handler_{},
+      open_handler_{},
+      read_handler_{},
+      retry_handler_{},
+      complete_handler_{} {
 }
 
 
 void HttpRequest::Request(
     const urdl::url &url,
     const urdl::http::request_method &method,
+    const HttpHeaderMap &headers,
     const boost::property_tree::ptree &post_content,
+    const HttpRequestPolicy &policy,
+    const std::shared_ptr<HttpRequestHandle> &handle,
+    const std::shared_ptr<HttpResponseSink> &sink,
     const ErrorHandler &err_handler,
+    const RetryHandler &retry_handler,
     const OpenHandler &open_handler,
     const ReadHandler &read_handler,
-    const ResponseCompleteHandler &complete_handler) {
-  if (rstream_.is_open()) {
+    const SinkCompleteHandler &complete_handler) {
+  if (handle_) {
     // borrowed error code from boost::asio::error temporarily.
     // TODO(khpark): replace this error code with in-house one.
     err_handler(boost::asio::error::already_started);
     return;
   }
+  timing_ = HttpRequestTiming{method.value(), HttpRequestTiming::ToEndpoint(
+      url.path())};
+  started_at_ = HttpRequestTiming::Clock::now();
 
-  rstream_.set_option(method);
-  if (post_content.empty() == false) {
-    HttpRequestContent::SetJson(post_content, &rstream_);
+  if (handle->IsCancelled() == true) {
+    err_handler(HttpRequestError::Make(HttpRequestError::kCancelled));
+    return;
   }
 
-  std::stringstream *stringstream{new std::stringstream{}};
-  out_.reset(stringstream);
+  url_ = url;
+  method_ = method.value();
+  headers_ = headers;
+  content_ = post_content.empty() ?
+      "" : HttpRequestContent::ToJson(post_content);
+  redirect_count_ = 0;
+  policy_ = policy;
+  handle_ = handle;
+  retry_count_ = 0;
+
+  sink_ = sink;
 
   err_handler_ = err_handler;
   open_handler_ = open_handler;
   read_handler_ = read_handler;
-  complete_handler_ = [complete_handler, stringstream]() {
-    complete_handler(stringstream->str());
-  };
+  retry_handler_ = retry_handler;
+  complete_handler_ = complete_handler;
 
-  static const OstreamCloseHandler kDefaultOstreamCloseHandler{[]() {}};
-  ostream_close_handler_ = kDefaultOstreamCloseHandler;
+  ++request_id_;
+  uint64_t request_id{request_id_};
+  // the handle may outlive the request object.
+  std::weak_ptr<HttpRequest> weak_self{shared_from_this()};
+  handle_->SetCanceller([weak_self, request_id]() {
+    std::shared_ptr<HttpRequest> self{weak_self.lock()};
+    if (!self) {
+      return;
+    }
+    self->io_service_->post([self, request_id]() {
+      if (request_id != self->request_id_) {
+        return;
+      }
+      self->Abort(HttpRequestError::Make(HttpRequestError::kCancelled));
+    });
+  });
 
-  Request(url);
+  StartDeadline(
+      &total_timer_, policy_.total_timeout(), HttpRequestError::kTotalTimeout);
+  Exchange(false);
 }
 
 
 void HttpRequest::Get(
     const urdl::url &url,
+    const HttpHeaderMap &headers,
+    const HttpRequestPolicy &policy,
+    const std::shared_ptr<HttpRequestHandle> &handle,
+    const std::shared_ptr<HttpResponseSink> &sink,
     const ErrorHandler &err_handler,
+    const RetryHandler &retry_handler,
     const OpenHandler &open_handler,
     const ReadHandler &read_handler,
-    const ResponseCompleteHandler &complete_handler) {
+    const SinkCompleteHandler &complete_handler) {
   static const boost::property_tree::ptree kEmptyPostContent;
 
   Request(
       url,
       HttpRequestMethod::kGet,
+      headers,
       kEmptyPostContent,
+      policy,
+      handle,
+      sink,
       err_handler,
+      retry_handler,
       open_handler,
       read_handler,
       complete_handler);
@@ -116,61 +182,539 @@ void HttpRequest::Get(
 void HttpRequest::Post(
     const urdl::url &url,
     const boost::property_tree::ptree &post_content,
+    const HttpRequestPolicy &policy,
+    const std::shared_ptr<HttpRequestHandle> &handle,
+    const std::shared_ptr<HttpResponseSink> &sink,
     const ErrorHandler &err_handler,
+    const RetryHandler &retry_handler,
     const OpenHandler &open_handler,
     const ReadHandler &read_handler,
-    const ResponseCompleteHandler &complete_handler) {
+    const SinkCompleteHandler &complete_handler) {
   Request(
       url,
       HttpRequestMethod::kPost,
+      HttpHeaderMap{},
       post_content,
+      policy,
+      handle,
+      sink,
       err_handler,
+      retry_handler,
       open_handler,
       read_handler,
       complete_handler);
 }
 
 
-void HttpRequest::Request(const urdl::url &url) {
+bool HttpRequest::IsIdempotent(const std::string &method) {
+  return method == HttpRequestMethod::kGet.value() ||
+         method == HttpRequestMethod::kHead.value() ||
+         method == HttpRequestMethod::kPut.value() ||
+         method == HttpRequestMethod::kDelete.value();
+}
+
+
+bool HttpRequest::IsRetryable(const boost::system::error_code &ec) {
+  if (ec.category() == HttpRequestError::category()) {
+    // the total deadline is over the retries as well.
+    return ec.value() == HttpRequestError::kConnectTimeout ||
+           ec.value() == HttpRequestError::kFirstByteTimeout;
+  }
+  if (ec.category() == urdl::http::error_category()) {
+    // the server may get over it; a bad request would stay bad.
+    return ec.value() >= 500 || ec.value() == 408 || ec.value() == 429;
+  }
+  // nor would a certificate change.
+  return ec.category() != boost::asio::error::get_ssl_category();
+}
+
+
+void HttpRequest::Exchange(bool fresh) {
+  ++exchange_id_;
+  reused_ = false;
+  responded_ = false;
+  body_read_ = false;
+  keep_alive_ = false;
+  body_type_ = BodyType::kNone;
+  body_remaining_ = 0;
+  timing_.ResetExchange();
+
+  StartDeadline(
+      &phase_timer_,
+      policy_.connect_timeout(),
+      HttpRequestError::kConnectTimeout);
+
+  auto self{shared_from_this()};
+  uint64_t exchange_id{exchange_id_};
+  connection_pool_->Acquire(url_, fresh, [this, self, exchange_id](
+      const boost::system::error_code &ec,
+      const std::shared_ptr<HttpConnectionPool::Connection> &connection,
+      bool reused) {
+    if (exchange_id != exchange_id_) {
+      // given up on meanwhile; the connection is still of use to others.
+      if (!ec) {
+        connection_pool_->Release(connection);
+      }
+      return;
+    }
+    OnAcquired(ec, connection, reused);
+  });
+}
+
+
+HttpConnectionPool::Connection::Handler HttpRequest::Continue(
+    Continuation next) {
   auto self{shared_from_this()};
-  rstream_.async_open(
-      url, [this, self](const boost::system::error_code &ec) {
-    if (ec) {
-      rstream_.close();
-      ostream_close_handler_();
-      err_handler_(ec);
+  uint64_t exchange_id{exchange_id_};
+  return [this, self, exchange_id, next](
+      const boost::system::error_code &ec) {
+    if (exchange_id != exchange_id_) {
       return;
     }
-    open_handler_(rstream_.content_length());
+    (this->*next)(ec);
+  };
+}
+
 
-    rstream_.async_read_some(boost::asio::buffer(buffer_),
-                             std::bind(&HttpRequest::OnRead,
-                                       self,
-                                       std::placeholders::_1,
-                                       std::placeholders::_2));
+void HttpRequest::StartDeadline(
+    boost::asio::steady_timer *timer,
+    const std::chrono::milliseconds &timeout,
+    HttpRequestError::Code code) {
+  auto self{shared_from_this()};
+  uint64_t request_id{request_id_};
+  uint64_t exchange_id{exchange_id_};
+  timer->expires_from_now(timeout);
+  timer->async_wait([this, self, timer, request_id, exchange_id, code](
+      const boost::system::error_code &ec) {
+    // a deadline may be moved or stopped after it went off.
+    if (ec || timer->expires_at() >
+              boost::asio::steady_timer::clock_type::now()) {
+      return;
+    }
+    if (request_id != request_id_ ||
+        (timer == &phase_timer_ && exchange_id != exchange_id_)) {
+      return;
+    }
+    Abort(HttpRequestError::Make(code));
   });
 }
 
 
-void HttpRequest::OnRead(const boost::system::error_code &ec,
-                            std::size_t length) {
+void HttpRequest::StopDeadline(boost::asio::steady_timer *timer) {
+  timer->expires_at(boost::asio::steady_timer::time_point::max());
+}
+
+
+std::string HttpRequest::BuildRequest() const {
+  std::string target{url_.to_string(
+      urdl::url::path_component | urdl::url::query_component)};
+  if (target.empty() == true || target.front() != '/') {
+    target = "/" + target;
+  }
+
+  std::stringstream request;
+  request << method_ << " " << target << " HTTP/1.1\r\n";
+  request << "Host: " << url_.host();
+  if (IsDefaultPort(url_) == false) {
+    request << ":" << url_.port();
+  }
+  request << "\r\n";
+  request << "Accept: */*\r\n";
+  request << "Connection: keep-alive\r\n";
+  for (const auto &header : headers_) {
+    request << header.first << ": " << header.second << "\r\n";
+  }
+  if (content_.empty() == false) {
+    request << "Content-Type: "
+            << HttpRequestContentType::kApplicationJson.value() << "\r\n";
+  }
+  if (content_.empty() == false || method_ == "POST" || method_ == "PUT") {
+    request << "Content-Length: " << content_.size() << "\r\n";
+  }
+  request << "\r\n";
+  request << content_;
+  return request.str();
+}
+
+
+void HttpRequest::OnAcquired(
+    const boost::system::error_code &ec,
+    const std::shared_ptr<HttpConnectionPool::Connection> &connection,
+    bool reused) {
+  if (ec) {
+    Fail(ec);
+    return;
+  }
+  connection_ = connection;
+  reused_ = reused;
+
+  timing_.set_reused(reused);
+  if (reused == false) {
+    timing_.set_dns(connection_->resolve_duration());
+    timing_.set_connect(connection_->connect_duration());
+    timing_.set_tls(connection_->handshake_duration());
+  }
+  written_at_ = HttpRequestTiming::Clock::now();
+
+  StartDeadline(
+      &phase_timer_,
+      policy_.first_byte_timeout(),
+      HttpRequestError::kFirstByteTimeout);
+  connection_->Write(BuildRequest(), Continue(&HttpRequest::OnWritten));
+}
+
+
+void HttpRequest::OnWritten(const boost::system::error_code &ec) {
+  if (ec) {
+    Fail(ec);
+    return;
+  }
+
+  connection_->ReadUntil("\r\n\r\n", Continue(&HttpRequest::OnHeaderRead));
+}
+
+
+void HttpRequest::OnHeaderRead(const boost::system::error_code &ec) {
+  if (ec) {
+    Fail(ec);
+    return;
+  }
+  responded_ = true;
+  StopDeadline(&phase_timer_);
+  if (timing_.first_byte() == HttpRequestTiming::Clock::duration::zero()) {
+    first_byte_at_ = HttpRequestTiming::Clock::now();
+    timing_.set_first_byte(first_byte_at_ - written_at_);
+  }
+
+  int status{0};
+  HttpHeaderMap headers;
+  if (ParseHeader(&status, &headers, &keep_alive_) == false) {
+    Fail(urdl::http::make_error_code(
+        urdl::http::errc::malformed_response_headers));
+    return;
+  }
+
+  if (status / 100 == 1) {
+    connection_->ReadUntil("\r\n\r\n", Continue(&HttpRequest::OnHeaderRead));
+    return;
+  }
+
+  const std::string &location = headers["location"];
+  if ((status == 301 || status == 302 || status == 303 ||
+       status == 307 || status == 308) &&
+      location.empty() == false &&
+      redirect_count_ < kMaxRedirects) {
+    // the body of a redirect is not worth reading to keep the connection.
+    connection_->Close();
+    connection_.reset();
+
+    boost::system::error_code url_ec;
+    urdl::url location_url = (location.front() == '/') ?
+        urdl::url::from_string(
+            url_.to_string(urdl::url::protocol_component |
+                           urdl::url::host_component |
+                           urdl::url::port_component) + location, url_ec) :
+        urdl::url::from_string(location, url_ec);
+    if (url_ec) {
+      Fail(url_ec);
+      return;
+    }
+    ++redirect_count_;
+    url_ = location_url;
+    if (status == 303) {
+      method_ = HttpRequestMethod::kGet.value();
+      content_.clear();
+    }
+    Exchange(false);
+    return;
+  }
+
+  // a not modified is up to the caller of a conditional request.
+  if (status / 100 != 2 && status != 304) {
+    connection_->Close();
+    connection_.reset();
+    Fail(urdl::http::make_error_code(
+        static_cast<urdl::http::errc::errc_t>(status)));
+    return;
+  }
+
+  const std::string &content_length = headers["content-length"];
+  std::size_t file_size{0};
+  if (method_ == HttpRequestMethod::kHead.value() ||
+      status == 204 || status == 304) {
+    body_type_ = BodyType::kNone;
+  } else if (ToLower(headers["transfer-encoding"]).find("chunked") !=
+             std::string::npos) {
+    body_type_ = BodyType::kChunked;
+  } else if (content_length.empty() == false) {
+    try {
+      file_size = std::stoul(content_length);
+    } catch (const std::exception &/*e*/) {
+      Fail(urdl::http::make_error_code(
+          urdl::http::errc::malformed_response_headers));
+      return;
+    }
+    body_type_ = BodyType::kLength;
+    body_remaining_ = file_size;
+  } else {
+    body_type_ = BodyType::kUntilClose;
+    keep_alive_ = false;
+  }
+
+  sink_->Open(status, headers);
+  open_handler_(file_size);
+  ReadBody();
+}
+
+
+bool HttpRequest::ParseHeader(
+    int *status,
+    HttpHeaderMap *headers,
+    bool *keep_alive) {
+  std::istream in{&connection_->buffer()};
+
+  std::string version;
+  std::string reason;
+  in >> version >> *status;
+  std::getline(in, reason);
+  if (!in || version.compare(0, 5, "HTTP/") != 0) {
+    return false;
+  }
+
+  std::string line;
+  while (std::getline(in, line) && line != "\r" && line.empty() == false) {
+    std::size_t colon = line.find(':');
+    if (colon == std::string::npos) {
+      continue;
+    }
+    (*headers)[ToLower(Trim(line.substr(0, colon)))] =
+        Trim(line.substr(colon + 1));
+  }
+
+  const std::string &connection = ToLower((*headers)["connection"]);
+  if (connection == "close") {
+    *keep_alive = false;
+  } else if (connection == "keep-alive") {
+    *keep_alive = true;
+  } else {
+    *keep_alive = (version != "HTTP/1.0");
+  }
+  return true;
+}
+
+
+void HttpRequest::ReadBody() {
+  switch (body_type_) {
+    case BodyType::kNone: {
+      Finish();
+      break;
+    }
+    case BodyType::kLength: {
+      std::size_t size =
+          (std::min)(body_remaining_, connection_->buffer().size());
+      Consume(size);
+      body_remaining_ -= size;
+      if (body_remaining_ == 0) {
+        Finish();
+        break;
+      }
+      connection_->ReadAtLeast(1, Continue(&HttpRequest::OnBodyRead));
+      break;
+    }
+    case BodyType::kChunked: {
+      connection_->ReadUntil(
+          "\r\n", Continue(&HttpRequest::OnChunkSizeRead));
+      break;
+    }
+    case BodyType::kUntilClose: {
+      Consume(connection_->buffer().size());
+      connection_->ReadAtLeast(1, Continue(&HttpRequest::OnBodyRead));
+      break;
+    }
+    default: {
+      break;
+    }
+  }
+}
+
+
+void HttpRequest::OnBodyRead(const boost::system::error_code &ec) {
+  if (ec) {
+    // servers may close without the tls close_notify.
+    if (body_type_ == BodyType::kUntilClose &&
+        (ec == boost::asio::error::eof ||
+         ec == boost::asio::ssl::error::stream_truncated)) {
+      Consume(connection_->buffer().size());
+      Finish();
+      return;
+    }
+    Fail(ec);
+    return;
+  }
+  ReadBody();
+}
+
+
+void HttpRequest::OnChunkSizeRead(const boost::system::error_code &ec) {
+  if (ec) {
+    Fail(ec);
+    return;
+  }
+
+  std::istream in{&connection_->buffer()};
+  std::string line;
+  std::getline(in, line);
+  std::size_t chunk_size{0};
+  try {
+    chunk_size = std::stoul(line, nullptr, 16);
+  } catch (const std::exception &/*e*/) {
+    Fail(urdl::http::make_error_code(
+        urdl::http::errc::malformed_response_headers));
+    return;
+  }
+
+  if (chunk_size == 0) {
+    connection_->ReadUntil("\r\n", Continue(&HttpRequest::OnTrailerRead));
+    return;
+  }
+
+  body_remaining_ = chunk_size;
+  connection_->ReadAtLeast(
+      chunk_size + 2, Continue(&HttpRequest::OnChunkRead));
+}
+
+
+void HttpRequest::OnChunkRead(const boost::system::error_code &ec) {
   if (ec) {
-    rstream_.close();
-    ostream_close_handler_();
-    if (ec == boost::asio::error::eof) {
-      complete_handler_();
-    } else {
-      err_handler_(ec);
+    Fail(ec);
+    return;
+  }
+
+  Consume(body_remaining_);
+  body_remaining_ = 0;
+  // the crlf after the chunk.
+  connection_->buffer().consume(2);
+
+  ReadBody();
+}
+
+
+void HttpRequest::OnTrailerRead(const boost::system::error_code &ec) {
+  if (ec) {
+    Fail(ec);
+    return;
+  }
+
+  std::istream in{&connection_->buffer()};
+  std::string line;
+  std::getline(in, line);
+  if (line.empty() == true || line == "\r") {
+    Finish();
+    return;
+  }
+
+  connection_->ReadUntil("\r\n", Continue(&HttpRequest::OnTrailerRead));
+}
+
+
+void HttpRequest::Consume(std::size_t size) {
+  if (size == 0) {
+    return;
+  }
+  body_read_ = true;
+  timing_.set_bytes(timing_.bytes() + size);
+  read_handler_(size);
+
+  auto *buffer = &connection_->buffer();
+  sink_->Write(
+      boost::asio::buffer_cast<const char *>(buffer->data()), size);
+  buffer->consume(size);
+}
+
+
+void HttpRequest::Finish() {
+  std::shared_ptr<HttpConnectionPool::Connection> connection{connection_};
+  connection_.reset();
+  if (keep_alive_ == true && connection->buffer().size() == 0) {
+    connection_pool_->Release(connection);
+  } else {
+    connection->Close();
+  }
+
+  timing_.set_transfer(HttpRequestTiming::Clock::now() - first_byte_at_);
+  timing_.set_succeeded(true);
+  Done();
+  sink_->Close();
+  complete_handler_();
+}
+
+
+void HttpRequest::Fail(const boost::system::error_code &ec) {
+  // the completions still due from this exchange are dropped.
+  ++exchange_id_;
+  StopDeadline(&phase_timer_);
+
+  if (connection_) {
+    connection_->Close();
+    connection_.reset();
+
+    // most likely closed by the server while idle; tried once more on
+    // a fresh connection, as the browsers do. a post may have got to
+    // the server, so is not sent twice.
+    if (reused_ == true && responded_ == false &&
+        IsIdempotent(method_) == true) {
+      Exchange(true);
+      return;
     }
+  }
+
+  if (retry_count_ < policy_.max_retries() &&
+      body_read_ == false &&
+      IsIdempotent(method_) == true &&
+      IsRetryable(ec) == true) {
+    const auto &delay = policy_.GetRetryDelay(retry_count_, &random_);
+    ++retry_count_;
+    retry_handler_(ec, retry_count_, delay);
+
+    auto self{shared_from_this()};
+    uint64_t exchange_id{exchange_id_};
+    phase_timer_.expires_from_now(delay);
+    phase_timer_.async_wait([this, self, exchange_id](
+        const boost::system::error_code &ec) {
+      if (ec || exchange_id != exchange_id_) {
+        return;
+      }
+      Exchange(false);
+    });
     return;
   }
-  read_handler_(length);
 
-  out_->write(buffer_, length);
-  rstream_.async_read_some(boost::asio::buffer(buffer_),
-                           std::bind(&HttpRequest::OnRead,
-                                     shared_from_this(),
-                                     std::placeholders::_1,
-                                     std::placeholders::_2));
+  timing_.set_succeeded(false);
+  Done();
+  sink_->Close();
+  err_handler_(ec);
+}
+
+
+void HttpRequest::Abort(const boost::system::error_code &ec) {
+  ++exchange_id_;
+  if (connection_) {
+    connection_->Close();
+    connection_.reset();
+  }
+  Fail(ec);
+}
+
+
+void HttpRequest::Done() {
+  timing_.set_retries(retry_count_);
+  timing_.set_total(HttpRequestTiming::Clock::now() - started_at_);
+
+  ++request_id_;
+  ++exchange_id_;
+  StopDeadline(&phase_timer_);
+  StopDeadline(&total_timer_);
+  handle_->SetCanceller(nullptr);
+  handle_.reset();
 }
 }  // namespace ncstreamer
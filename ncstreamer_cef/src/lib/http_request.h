@@ -7,14 +7,23 @@
 #define NCSTREAMER_CEF_SRC_LIB_HTTP_REQUEST_H_
 
 
+#include <chrono>  // NOLINT
 #include <functional>
 #include <memory>
-#include <ostream>
+#include <random>
 #include <string>
 
 #include "boost/asio/io_service.hpp"
+#include "boost/asio/steady_timer.hpp"
 #include "boost/property_tree/ptree.hpp"
 
+#include "ncstreamer_cef/src/lib/http_connection_pool.h"
+#include "ncstreamer_cef/src/lib/http_request_handle.h"
+#include "ncstreamer_cef/src/lib/http_request_policy.h"
+#include "ncstreamer_cef/src/lib/http_request_timing.h"
+#include "ncstreamer_cef/src/lib/http_response_sink.h"
+#include "ncstreamer_cef/src/lib/http_types.h"
+
 #pragma warning(push)
 #pragma warning(disable: 4244)
 #include "urdl/istream.hpp"
@@ -28,62 +37,150 @@ class HttpRequest
   using ErrorHandler = std::function<void(const boost::system::error_code &ec)>;
   using OpenHandler = std::function<void(std::size_t file_size)>;
   using ReadHandler = std::function<void(std::size_t read_size)>;
-  using DownloadCompleteHandler = std::function<void()>;
   using ResponseCompleteHandler = std::function<void(const std::string &data)>;
-
-  explicit HttpRequest(boost::asio::io_service *svc);
-
-  void Download(
-      const urdl::url &url,
-      const std::string &file_name,
-      const ErrorHandler &err_handler,
-      const OpenHandler &open_handler,
-      const ReadHandler &read_handler,
-      const DownloadCompleteHandler &complete_handler);
-
+  using SinkCompleteHandler = std::function<void()>;
+  // before each retry; the error is the one of the try given up on.
+  using RetryHandler = std::function<void(
+      const boost::system::error_code &ec,
+      uint32_t retry,
+      const std::chrono::milliseconds &delay)>;
+
+  // the requests go over the connections of the pool.
+  HttpRequest(
+      boost::asio::io_service *svc,
+      HttpConnectionPool *connection_pool);
+
+  // the headers are sent along with those of our own.
   void Request(
       const urdl::url &url,
       const urdl::http::request_method &method,
+      const HttpHeaderMap &headers,
       const boost::property_tree::ptree &post_content,
+      const HttpRequestPolicy &policy,
+      const std::shared_ptr<HttpRequestHandle> &handle,
+      const std::shared_ptr<HttpResponseSink> &sink,
       const ErrorHandler &err_handler,
+      const RetryHandler &retry_handler,
       const OpenHandler &open_handler,
       const ReadHandler &read_handler,
-      const ResponseCompleteHandler &complete_handler);
+      const SinkCompleteHandler &complete_handler);
 
   void Get(
       const urdl::url &url,
+      const HttpHeaderMap &headers,
+      const HttpRequestPolicy &policy,
+      const std::shared_ptr<HttpRequestHandle> &handle,
+      const std::shared_ptr<HttpResponseSink> &sink,
       const ErrorHandler &err_handler,
+      const RetryHandler &retry_handler,
       const OpenHandler &open_handler,
       const ReadHandler &read_handler,
-      const ResponseCompleteHandler &complete_handler);
+      const SinkCompleteHandler &complete_handler);
 
   void Post(
       const urdl::url &url,
       const boost::property_tree::ptree &post_content,
+      const HttpRequestPolicy &policy,
+      const std::shared_ptr<HttpRequestHandle> &handle,
+      const std::shared_ptr<HttpResponseSink> &sink,
       const ErrorHandler &err_handler,
+      const RetryHandler &retry_handler,
       const OpenHandler &open_handler,
       const ReadHandler &read_handler,
-      const ResponseCompleteHandler &complete_handler);
+      const SinkCompleteHandler &complete_handler);
 
- private:
-  using CompleteHandler = std::function<void()>;
-  using OstreamCloseHandler = std::function<void()>;
+  // a network error, a deadline before the response or a server error
+  // that another try may get over.
+  static bool IsRetryable(const boost::system::error_code &ec);
 
-  void Request(const urdl::url &url);
+  // of the last request; complete once its handlers are called.
+  const HttpRequestTiming &timing() const { return timing_; }
 
-  void OnRead(const boost::system::error_code &ec,
-              std::size_t length);
+ private:
+  using CompleteHandler = std::function<void()>;
 
-  urdl::read_stream rstream_;
-  std::unique_ptr<std::ostream> out_;
-  char buffer_[1024];
+  enum class BodyType {
+    kNone,
+    kLength,
+    kChunked,
+    kUntilClose,
+  };
+
+  using Continuation =
+      void (HttpRequest::*)(const boost::system::error_code &ec);
+
+  static bool IsIdempotent(const std::string &method);
+
+  // an http/1.1 exchange over a pooled connection; a retry is another.
+  void Exchange(bool fresh);
+  // dropped if the exchange was given up on meanwhile.
+  HttpConnectionPool::Connection::Handler Continue(Continuation next);
+  void StartDeadline(
+      boost::asio::steady_timer *timer,
+      const std::chrono::milliseconds &timeout,
+      HttpRequestError::Code code);
+  void StopDeadline(boost::asio::steady_timer *timer);
+  std::string BuildRequest() const;
+  void OnAcquired(
+      const boost::system::error_code &ec,
+      const std::shared_ptr<HttpConnectionPool::Connection> &connection,
+      bool reused);
+  void OnWritten(const boost::system::error_code &ec);
+  void OnHeaderRead(const boost::system::error_code &ec);
+  bool ParseHeader(int *status, HttpHeaderMap *headers, bool *keep_alive);
+  void ReadBody();
+  void OnBodyRead(const boost::system::error_code &ec);
+  void OnChunkSizeRead(const boost::system::error_code &ec);
+  void OnChunkRead(const boost::system::error_code &ec);
+  void OnTrailerRead(const boost::system::error_code &ec);
+  // moves the given size of the read data to the output.
+  void Consume(std::size_t size);
+  void Finish();
+  void Fail(const boost::system::error_code &ec);
+  // gives up on the exchange under way.
+  void Abort(const boost::system::error_code &ec);
+  void Done();
+
+  boost::asio::io_service *const io_service_;
+  HttpConnectionPool *const connection_pool_;
+  // tell the completions of a request or an exchange given up on.
+  uint64_t request_id_;
+  uint64_t exchange_id_;
+  HttpRequestPolicy policy_;
+  std::shared_ptr<HttpRequestHandle> handle_;
+  uint32_t retry_count_;
+  std::mt19937 random_;
+  // for the connect, the first byte and the delay before a retry.
+  boost::asio::steady_timer phase_timer_;
+  boost::asio::steady_timer total_timer_;
+
+  std::shared_ptr<HttpConnectionPool::Connection> connection_;
+  urdl::url url_;
+  std::string method_;
+  HttpHeaderMap headers_;
+  std::string content_;
+  int redirect_count_;
+  // a reused connection may have been closed by the server meanwhile.
+  bool reused_;
+  bool responded_;
+  // a retry could not take back what was handed over already.
+  bool body_read_;
+  bool keep_alive_;
+  BodyType body_type_;
+  std::size_t body_remaining_;
+
+  std::shared_ptr<HttpResponseSink> sink_;
+
+  HttpRequestTiming timing_;
+  HttpRequestTiming::Clock::time_point started_at_;
+  HttpRequestTiming::Clock::time_point written_at_;
+  HttpRequestTiming::Clock::time_point first_byte_at_;
 
   ErrorHandler err_handler_;
   OpenHandler open_handler_;
   ReadHandler read_handler_;
+  RetryHandler retry_handler_;
   CompleteHandler complete_handler_;
-
-  OstreamCloseHandler ostream_close_handler_;
 };
 }  // namespace ncstreamer
 
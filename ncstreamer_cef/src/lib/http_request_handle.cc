@@ -0,0 +1,55 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#include "ncstreamer_cef/src/lib/http_request_handle.h"
+
+
+namespace ncstreamer {
+HttpRequestHandle::HttpRequestHandle()
+    : mutex_{},
+      cancelled_{false},
+      canceller_{} {
+}
+
+
+HttpRequestHandle::~HttpRequestHandle() {
+}
+
+
+void HttpRequestHandle::Cancel() {
+  Canceller canceller;
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    if (cancelled_ == true) {
+      return;
+    }
+    cancelled_ = true;
+    canceller = canceller_;
+  }
+  if (canceller) {
+    canceller();
+  }
+}
+
+
+bool HttpRequestHandle::IsCancelled() const {
+  std::lock_guard<std::mutex> lock{mutex_};
+  return cancelled_;
+}
+
+
+void HttpRequestHandle::SetCanceller(const Canceller &canceller) {
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    canceller_ = canceller;
+    if (cancelled_ == false) {
+      return;
+    }
+  }
+  if (canceller) {
+    canceller();
+  }
+}
+}  // namespace ncstreamer
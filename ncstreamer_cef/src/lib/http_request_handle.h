@@ -0,0 +1,42 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#ifndef NCSTREAMER_CEF_SRC_LIB_HTTP_REQUEST_HANDLE_H_
+#define NCSTREAMER_CEF_SRC_LIB_HTTP_REQUEST_HANDLE_H_
+
+
+#include <functional>
+#include <mutex>  // NOLINT
+
+
+namespace ncstreamer {
+// given out for each request, to cancel it wherever it is: waiting for
+// its turn, connecting, reading or waiting to retry. the error handler
+// of the request is called with HttpRequestError::kCancelled, unless
+// the request is done already.
+class HttpRequestHandle {
+ public:
+  using Canceller = std::function<void()>;
+
+  HttpRequestHandle();
+  virtual ~HttpRequestHandle();
+
+  // may be called on any thread.
+  void Cancel();
+  bool IsCancelled() const;
+
+  // by whoever holds the request for the moment; called at once if
+  // cancelled already.
+  void SetCanceller(const Canceller &canceller);
+
+ private:
+  mutable std::mutex mutex_;
+  bool cancelled_;
+  Canceller canceller_;
+};
+}  // namespace ncstreamer
+
+
+#endif  // NCSTREAMER_CEF_SRC_LIB_HTTP_REQUEST_HANDLE_H_
@@ -0,0 +1,52 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#include "ncstreamer_cef/src/lib/http_request_policy.h"
+
+#include <algorithm>
+
+
+namespace ncstreamer {
+HttpRequestPolicy::HttpRequestPolicy(
+    const std::chrono::milliseconds &connect_timeout,
+    const std::chrono::milliseconds &first_byte_timeout,
+    const std::chrono::milliseconds &total_timeout,
+    uint32_t max_retries,
+    const std::chrono::milliseconds &base_delay)
+    : connect_timeout_{connect_timeout},
+      first_byte_timeout_{first_byte_timeout},
+      total_timeout_{total_timeout},
+      max_retries_{max_retries},
+      base_delay_{base_delay} {
+}
+
+
+HttpRequestPolicy::HttpRequestPolicy()
+    : HttpRequestPolicy{
+          std::chrono::milliseconds{10000},
+          std::chrono::milliseconds{15000},
+          std::chrono::milliseconds{30000},
+          2,
+          std::chrono::milliseconds{500}} {
+}
+
+
+HttpRequestPolicy::~HttpRequestPolicy() {
+}
+
+
+std::chrono::milliseconds HttpRequestPolicy::GetRetryDelay(
+    uint32_t retry,
+    std::mt19937 *random) const {
+  // past this, the total deadline would be long gone anyway.
+  static const uint32_t kMaxShift{10};
+
+  uint32_t shift = (std::min)(retry, kMaxShift);
+  std::chrono::milliseconds delay{base_delay_.count() << shift};
+
+  std::uniform_int_distribution<int64_t> jitter{0, delay.count() / 2};
+  return delay - std::chrono::milliseconds{jitter(*random)};
+}
+}  // namespace ncstreamer
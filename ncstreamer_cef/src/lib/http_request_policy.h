@@ -0,0 +1,60 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#ifndef NCSTREAMER_CEF_SRC_LIB_HTTP_REQUEST_POLICY_H_
+#define NCSTREAMER_CEF_SRC_LIB_HTTP_REQUEST_POLICY_H_
+
+
+#include <chrono>  // NOLINT
+#include <cstdint>
+#include <random>
+
+
+namespace ncstreamer {
+// how long a request may take, and how it is tried again. the connect
+// and the first byte of the response each have a deadline of their own
+// for every try; the total one covers the retries as well. only the
+// idempotent methods are retried, after a delay doubled each time and
+// jittered into its upper half.
+class HttpRequestPolicy {
+ public:
+  HttpRequestPolicy(
+      const std::chrono::milliseconds &connect_timeout,
+      const std::chrono::milliseconds &first_byte_timeout,
+      const std::chrono::milliseconds &total_timeout,
+      uint32_t max_retries,
+      const std::chrono::milliseconds &base_delay);
+  // 10 seconds to connect, 15 to the first byte and 30 in all;
+  // 2 retries from half a second.
+  HttpRequestPolicy();
+  virtual ~HttpRequestPolicy();
+
+  // before the retry-th retry, counted from 0.
+  std::chrono::milliseconds GetRetryDelay(
+      uint32_t retry,
+      std::mt19937 *random) const;
+
+  const std::chrono::milliseconds &connect_timeout() const {
+    return connect_timeout_;
+  }
+  const std::chrono::milliseconds &first_byte_timeout() const {
+    return first_byte_timeout_;
+  }
+  const std::chrono::milliseconds &total_timeout() const {
+    return total_timeout_;
+  }
+  uint32_t max_retries() const { return max_retries_; }
+
+ private:
+  std::chrono::milliseconds connect_timeout_;
+  std::chrono::milliseconds first_byte_timeout_;
+  std::chrono::milliseconds total_timeout_;
+  uint32_t max_retries_;
+  std::chrono::milliseconds base_delay_;
+};
+}  // namespace ncstreamer
+
+
+#endif  // NCSTREAMER_CEF_SRC_LIB_HTTP_REQUEST_POLICY_H_
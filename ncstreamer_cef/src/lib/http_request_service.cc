@@ -5,15 +5,54 @@
 
 #include "ncstreamer_cef/src/lib/http_request_service.h"
 
+#include <algorithm>
+#include <cctype>
+#include <map>
+#include <sstream>
+
+#include "ncstreamer_cef/src/lib/http_metrics.h"
+#include "ncstreamer_cef/src/lib/uri.h"
+
+
+namespace {
+const ncstreamer::HttpRequest::RetryHandler kDefaultRetryHandler{
+    [](const boost::system::error_code &/*ec*/,
+       uint32_t /*retry*/,
+       const std::chrono::milliseconds &/*delay*/) {}};
+const ncstreamer::HttpRequest::OpenHandler kDefaultOpenHandler{
+    [](std::size_t /*file_size*/) {}};
+const ncstreamer::HttpRequest::ReadHandler kDefaultReadHandler{
+    [](std::size_t /*read_size*/) {}};
+
+
+std::string ToLower(const std::string &str) {
+  std::string lower{str};
+  std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+  return lower;
+}
+}  // unnamed namespace
+
 
 namespace ncstreamer {
-HttpRequestService::HttpRequestService()
-    : io_service_{},
+HttpRequestService::HttpRequestService(std::size_t max_concurrency)
+    : max_concurrency_{max_concurrency},
+      io_service_{},
       io_service_work_{io_service_},
+      connection_pool_{&io_service_},
       io_thread_{[this]() {
         io_service_.run();
       }},
-      http_request_{new HttpRequest{&io_service_}} {
+      mutex_{},
+      active_size_{0},
+      idle_requests_{},
+      pending_jobs_{},
+      flight_mutex_{},
+      flights_{} {
+}
+
+
+HttpRequestService::HttpRequestService()
+    : HttpRequestService{4} {
 }
 
 
@@ -25,72 +64,607 @@ HttpRequestService::~HttpRequestService() {
 }
 
 
-void HttpRequestService::Get(
+std::shared_ptr<HttpRequestHandle> HttpRequestService::Get(
     const std::string &uri,
+    const HttpRequestPolicy &policy,
+    const std::shared_ptr<HttpResponseSink> &sink,
     const HttpRequest::ErrorHandler &err_handler,
+    const HttpRequest::RetryHandler &retry_handler,
     const HttpRequest::OpenHandler &open_handler,
     const HttpRequest::ReadHandler &read_handler,
-    const HttpRequest::ResponseCompleteHandler &complete_handler) {
-  http_request_->Get(
+    const HttpRequest::SinkCompleteHandler &complete_handler) {
+  return Get(
       uri,
+      HttpHeaderMap{},
+      policy,
+      sink,
       err_handler,
+      retry_handler,
       open_handler,
       read_handler,
       complete_handler);
 }
 
 
-void HttpRequestService::Get(
+std::shared_ptr<HttpRequestHandle> HttpRequestService::Get(
+    const std::string &uri,
+    const HttpHeaderMap &headers,
+    const HttpRequestPolicy &policy,
+    const std::shared_ptr<HttpResponseSink> &sink,
+    const HttpRequest::ErrorHandler &err_handler,
+    const HttpRequest::RetryHandler &retry_handler,
+    const HttpRequest::OpenHandler &open_handler,
+    const HttpRequest::ReadHandler &read_handler,
+    const HttpRequest::SinkCompleteHandler &complete_handler) {
+  std::shared_ptr<HttpRequestHandle> handle{new HttpRequestHandle{}};
+  Enqueue(handle, [=](const std::shared_ptr<HttpRequest> &request) {
+    request->Get(
+        uri,
+        headers,
+        policy,
+        handle,
+        sink,
+        WithRelease(request, err_handler),
+        retry_handler,
+        open_handler,
+        read_handler,
+        WithRelease(request, complete_handler));
+  }, err_handler);
+  return handle;
+}
+
+
+std::shared_ptr<HttpRequestHandle> HttpRequestService::Get(
     const std::string &uri,
+    const HttpRequestPolicy &policy,
     const HttpRequest::ErrorHandler &err_handler,
+    const HttpRequest::RetryHandler &retry_handler,
+    const HttpRequest::OpenHandler &open_handler,
+    const HttpRequest::ReadHandler &read_handler,
     const HttpRequest::ResponseCompleteHandler &complete_handler) {
-  static const HttpRequest::OpenHandler kDefaultOpenHandler{
-        [](std::size_t /*file_size*/) {}};
-  static const HttpRequest::ReadHandler kDefaultReadHandler{
-        [](std::size_t /*read_size*/) {}};
+  std::shared_ptr<HttpStringSink> sink{new HttpStringSink{}};
+  return Get(
+      uri,
+      policy,
+      sink,
+      err_handler,
+      retry_handler,
+      open_handler,
+      read_handler,
+      ToStringHandler(sink, complete_handler));
+}
+
 
-  Get(
+std::shared_ptr<HttpRequestHandle> HttpRequestService::Get(
+    const std::string &uri,
+    const HttpRequest::ErrorHandler &err_handler,
+    const HttpRequest::ResponseCompleteHandler &complete_handler) {
+  std::shared_ptr<HttpStringSink> sink{new HttpStringSink{}};
+  return GetOnce(
+      ToFlightKey("string", uri, {}, {}),
       uri,
+      {},
+      sink,
       err_handler,
-      kDefaultOpenHandler,
-      kDefaultReadHandler,
-      complete_handler);
+      [complete_handler](const std::shared_ptr<HttpResponseSink> &sink) {
+    ToStringHandler(
+        std::static_pointer_cast<HttpStringSink>(sink),
+        complete_handler)();
+  });
 }
 
 
-void HttpRequestService::Post(
+std::shared_ptr<HttpRequestHandle> HttpRequestService::GetJson(
+    const std::string &uri,
+    const std::vector<std::string> &paths,
+    const HttpRequest::ErrorHandler &err_handler,
+    const JsonCompleteHandler &complete_handler) {
+  std::shared_ptr<HttpJsonSink> sink{new HttpJsonSink{paths}};
+  return GetOnce(
+      ToFlightKey("json", uri, paths, {}),
+      uri,
+      {},
+      sink,
+      err_handler,
+      [err_handler, complete_handler](
+          const std::shared_ptr<HttpResponseSink> &sink) {
+    ToJsonHandler(
+        std::static_pointer_cast<HttpJsonSink>(sink),
+        err_handler,
+        complete_handler)();
+  });
+}
+
+
+std::shared_ptr<HttpRequestHandle> HttpRequestService::GetCachedJson(
+    const std::string &uri,
+    const std::vector<std::string> &paths,
+    const std::string &user_id,
+    const std::chrono::seconds &ttl,
+    const HttpRequest::ErrorHandler &err_handler,
+    const JsonCompleteHandler &complete_handler,
+    const JsonCompleteHandler &refresh_handler) {
+  HttpCache *cache{HttpCache::Get()};
+  const std::string &key = HttpCache::ToKey(uri, paths, user_id);
+
+  HttpCache::Entry entry;
+  bool cached = cache->Find(key, &entry);
+  if (cached == true) {
+    const auto &tree = entry.tree();
+    io_service_.post([complete_handler, tree]() {
+      complete_handler(tree);
+    });
+    if (entry.IsFresh(ttl) == true) {
+      return std::shared_ptr<HttpRequestHandle>{new HttpRequestHandle{}};
+    }
+  }
+
+  static const HttpRequest::ErrorHandler kDefaultErrorHandler{
+      [](const boost::system::error_code &/*ec*/) {}};
+  const HttpRequest::ErrorHandler &request_err_handler =
+      (cached == true) ? kDefaultErrorHandler : err_handler;
+
+  const HttpHeaderMap &validators = entry.ToValidators();
+  std::shared_ptr<HttpCacheSink> sink{new HttpCacheSink{paths}};
+  return GetOnce(
+      ToFlightKey("cache", uri, paths, validators),
+      uri,
+      validators,
+      sink,
+      request_err_handler,
+      [=](const std::shared_ptr<HttpResponseSink> &flight_sink) {
+    const auto &sink = std::static_pointer_cast<HttpCacheSink>(flight_sink);
+    if (cached == true && sink->not_modified() == true) {
+      cache->Touch(key);
+      return;
+    }
+    if (sink->ok() == false) {
+      request_err_handler(
+          HttpRequestError::Make(HttpRequestError::kMalformedJson));
+      return;
+    }
+    cache->Put(key, sink->ToEntry());
+    if (cached == false) {
+      complete_handler(sink->tree());
+    } else if (sink->tree() != entry.tree()) {
+      refresh_handler(sink->tree());
+    }
+  });
+}
+
+
+std::shared_ptr<HttpRequestHandle> HttpRequestService::Post(
+    const std::string &uri,
+    const boost::property_tree::ptree &post_content,
+    const HttpRequestPolicy &policy,
+    const std::shared_ptr<HttpResponseSink> &sink,
+    const HttpRequest::ErrorHandler &err_handler,
+    const HttpRequest::RetryHandler &retry_handler,
+    const HttpRequest::OpenHandler &open_handler,
+    const HttpRequest::ReadHandler &read_handler,
+    const HttpRequest::SinkCompleteHandler &complete_handler) {
+  std::shared_ptr<HttpRequestHandle> handle{new HttpRequestHandle{}};
+  Enqueue(handle, [=](const std::shared_ptr<HttpRequest> &request) {
+    request->Post(
+        uri,
+        post_content,
+        policy,
+        handle,
+        sink,
+        WithRelease(request, err_handler),
+        retry_handler,
+        open_handler,
+        read_handler,
+        WithRelease(request, complete_handler));
+  }, err_handler);
+  return handle;
+}
+
+
+std::shared_ptr<HttpRequestHandle> HttpRequestService::Post(
     const std::string &uri,
     const boost::property_tree::ptree &post_content,
+    const HttpRequestPolicy &policy,
     const HttpRequest::ErrorHandler &err_handler,
+    const HttpRequest::RetryHandler &retry_handler,
     const HttpRequest::OpenHandler &open_handler,
     const HttpRequest::ReadHandler &read_handler,
     const HttpRequest::ResponseCompleteHandler &complete_handler) {
-  http_request_->Post(
+  std::shared_ptr<HttpStringSink> sink{new HttpStringSink{}};
+  return Post(
       uri,
       post_content,
+      policy,
+      sink,
       err_handler,
+      retry_handler,
       open_handler,
       read_handler,
-      complete_handler);
+      ToStringHandler(sink, complete_handler));
 }
 
 
-void HttpRequestService::Post(
+std::shared_ptr<HttpRequestHandle> HttpRequestService::Post(
     const std::string &uri,
     const boost::property_tree::ptree &post_content,
     const HttpRequest::ErrorHandler &err_handler,
     const HttpRequest::ResponseCompleteHandler &complete_handler) {
-  static const HttpRequest::OpenHandler kDefaultOpenHandler{
-        [](std::size_t /*file_size*/) {}};
-  static const HttpRequest::ReadHandler kDefaultReadHandler{
-        [](std::size_t /*read_size*/) {}};
-
-  Post(
+  return Post(
       uri,
       post_content,
+      HttpRequestPolicy{},
       err_handler,
+      kDefaultRetryHandler,
       kDefaultOpenHandler,
       kDefaultReadHandler,
       complete_handler);
 }
+
+
+std::shared_ptr<HttpRequestHandle> HttpRequestService::PostJson(
+    const std::string &uri,
+    const boost::property_tree::ptree &post_content,
+    const std::vector<std::string> &paths,
+    const HttpRequest::ErrorHandler &err_handler,
+    const JsonCompleteHandler &complete_handler) {
+  std::shared_ptr<HttpJsonSink> sink{new HttpJsonSink{paths}};
+  return Post(
+      uri,
+      post_content,
+      HttpRequestPolicy{},
+      sink,
+      err_handler,
+      kDefaultRetryHandler,
+      kDefaultOpenHandler,
+      kDefaultReadHandler,
+      ToJsonHandler(sink, err_handler, complete_handler));
+}
+
+
+std::shared_ptr<HttpRequestHandle> HttpRequestService::Head(
+    const std::string &uri,
+    const HttpRequestPolicy &policy,
+    const std::shared_ptr<HttpResponseSink> &sink,
+    const HttpRequest::ErrorHandler &err_handler,
+    const HttpRequest::SinkCompleteHandler &complete_handler) {
+  static const boost::property_tree::ptree kEmptyPostContent;
+
+  std::shared_ptr<HttpRequestHandle> handle{new HttpRequestHandle{}};
+  Enqueue(handle, [=](const std::shared_ptr<HttpRequest> &request) {
+    request->Request(
+        uri,
+        HttpRequestMethod::kHead,
+        HttpHeaderMap{},
+        kEmptyPostContent,
+        policy,
+        handle,
+        sink,
+        WithRelease(request, err_handler),
+        kDefaultRetryHandler,
+        kDefaultOpenHandler,
+        kDefaultReadHandler,
+        WithRelease(request, complete_handler));
+  }, err_handler);
+  return handle;
+}
+
+
+std::shared_ptr<HttpRequestHandle> HttpRequestService::Download(
+    const std::string &uri,
+    const std::string &file_name,
+    const HttpDownloadOptions &options,
+    const HttpRequest::ErrorHandler &err_handler,
+    const HttpDownload::OpenHandler &open_handler,
+    const HttpDownload::ReadHandler &read_handler,
+    const HttpDownload::CompleteHandler &complete_handler) {
+  const uint32_t max_segments = static_cast<uint32_t>((std::min)(
+      std::size_t{options.max_segments()},
+      (std::max)(max_concurrency_, std::size_t{2}) - 1));
+
+  std::shared_ptr<HttpRequestHandle> handle{new HttpRequestHandle{}};
+  std::shared_ptr<HttpDownload> download{new HttpDownload{
+      &io_service_,
+      this,
+      uri,
+      file_name,
+      HttpDownloadOptions{max_segments, options.sha256(), options.policy()},
+      err_handler,
+      open_handler,
+      read_handler,
+      complete_handler}};
+  download->Start(handle);
+  return handle;
+}
+
+
+void HttpRequestService::PreConnect(const std::string &uri) {
+  connection_pool_.PreConnect(uri);
+}
+
+
+std::string HttpRequestService::ToFlightKey(
+    const std::string &sink_kind,
+    const std::string &uri,
+    const std::vector<std::string> &paths,
+    const HttpHeaderMap &headers) {
+  // the scheme and the host are case insensitive; the fragment is not
+  // sent at all.
+  Uri parsed{uri};
+  std::stringstream key;
+  key << sink_kind << " "
+      << ToLower(parsed.scheme()) << "://" << ToLower(parsed.authority())
+      << (parsed.path().empty() ? "/" : parsed.path());
+  if (parsed.query().query_string().empty() == false) {
+    key << "?" << parsed.query().query_string();
+  }
+  for (const auto &path : paths) {
+    key << " " << path;
+  }
+  const std::map<std::string, std::string> sorted_headers{
+      headers.begin(), headers.end()};
+  for (const auto &header : sorted_headers) {
+    key << " " << ToLower(header.first) << ":" << header.second;
+  }
+  return key.str();
+}
+
+
+HttpRequest::SinkCompleteHandler HttpRequestService::ToStringHandler(
+    const std::shared_ptr<HttpStringSink> &sink,
+    const HttpRequest::ResponseCompleteHandler &complete_handler) {
+  return [sink, complete_handler]() {
+    complete_handler(sink->data());
+  };
+}
+
+
+HttpRequest::SinkCompleteHandler HttpRequestService::ToJsonHandler(
+    const std::shared_ptr<HttpJsonSink> &sink,
+    const HttpRequest::ErrorHandler &err_handler,
+    const JsonCompleteHandler &complete_handler) {
+  return [sink, err_handler, complete_handler]() {
+    if (sink->ok() == false) {
+      err_handler(HttpRequestError::Make(HttpRequestError::kMalformedJson));
+      return;
+    }
+    complete_handler(sink->tree());
+  };
+}
+
+
+void HttpRequestService::Enqueue(
+    const std::shared_ptr<HttpRequestHandle> &handle,
+    const Job &job,
+    const HttpRequest::ErrorHandler &err_handler) {
+  std::shared_ptr<HttpRequest> request;
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    if (active_size_ >= max_concurrency_) {
+      const HttpRequestHandle *key{handle.get()};
+      pending_jobs_.emplace_back(key, job);
+      // taken out of the line at once; the request sets its own later.
+      handle->SetCanceller([this, key, err_handler]() {
+        io_service_.post([this, key, err_handler]() {
+          {
+            std::lock_guard<std::mutex> lock{mutex_};
+            auto i = std::find_if(
+                pending_jobs_.begin(),
+                pending_jobs_.end(),
+                [key](const std::pair<const HttpRequestHandle *, Job> &job) {
+              return job.first == key;
+            });
+            if (i == pending_jobs_.end()) {
+              return;
+            }
+            pending_jobs_.erase(i);
+          }
+          err_handler(HttpRequestError::Make(HttpRequestError::kCancelled));
+        });
+      });
+      return;
+    }
+    ++active_size_;
+    if (idle_requests_.empty() == true) {
+      request.reset(new HttpRequest{&io_service_, &connection_pool_});
+    } else {
+      request = idle_requests_.back();
+      idle_requests_.pop_back();
+    }
+  }
+
+  io_service_.post([job, request]() {
+    job(request);
+  });
+}
+
+
+void HttpRequestService::Release(const std::shared_ptr<HttpRequest> &request) {
+  Job job;
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    if (pending_jobs_.empty() == true) {
+      --active_size_;
+      idle_requests_.emplace_back(request);
+      return;
+    }
+    job = pending_jobs_.front().second;
+    pending_jobs_.pop_front();
+  }
+  job(request);
+}
+
+
+std::shared_ptr<HttpRequestHandle> HttpRequestService::GetOnce(
+    const std::string &key,
+    const std::string &uri,
+    const HttpHeaderMap &headers,
+    const std::shared_ptr<HttpResponseSink> &sink,
+    const HttpRequest::ErrorHandler &err_handler,
+    const FlightCompleteHandler &complete_handler) {
+  std::shared_ptr<HttpRequestHandle> handle{new HttpRequestHandle{}};
+  std::shared_ptr<Flight> flight;
+  bool joined{false};
+  {
+    std::lock_guard<std::mutex> lock{flight_mutex_};
+    auto i = flights_.find(key);
+    if (i != flights_.end()) {
+      flight = i->second;
+      joined = true;
+    } else {
+      flight.reset(new Flight{
+          std::shared_ptr<HttpRequestHandle>{new HttpRequestHandle{}}, sink});
+      flights_.emplace(key, flight);
+    }
+    flight->Join(handle.get(), err_handler, complete_handler);
+  }
+  HttpMetrics::Get()->CountGet(joined);
+
+  const HttpRequestHandle *waiter{handle.get()};
+  handle->SetCanceller([this, key, waiter]() {
+    LeaveFlight(key, waiter);
+  });
+  if (joined == true) {
+    return handle;
+  }
+
+  const auto &land_err_handler = [this, key, flight](
+      const boost::system::error_code &ec) {
+    const auto &landed = Land(key, flight);
+    for (const auto &waiter : landed->waiters()) {
+      std::get<1>(waiter)(ec);
+    }
+  };
+  Enqueue(flight->handle(), [=](const std::shared_ptr<HttpRequest> &request) {
+    request->Get(
+        uri,
+        headers,
+        HttpRequestPolicy{},
+        flight->handle(),
+        flight->sink(),
+        WithRelease(request, land_err_handler),
+        kDefaultRetryHandler,
+        kDefaultOpenHandler,
+        kDefaultReadHandler,
+        WithRelease(request, [this, key, flight]() {
+      const auto &landed = Land(key, flight);
+      for (const auto &waiter : landed->waiters()) {
+        std::get<2>(waiter)(landed->sink());
+      }
+    }));
+  }, land_err_handler);
+  return handle;
+}
+
+
+void HttpRequestService::LeaveFlight(
+    const std::string &key,
+    const HttpRequestHandle *waiter) {
+  std::shared_ptr<Flight> flight;
+  HttpRequest::ErrorHandler err_handler;
+  {
+    std::lock_guard<std::mutex> lock{flight_mutex_};
+    auto i = flights_.find(key);
+    if (i == flights_.end() ||
+        i->second->Leave(waiter, &err_handler) == false) {
+      return;
+    }
+    if (i->second->waiters().empty() == true) {
+      // a new get of the key starts a flight of its own.
+      flight = i->second;
+      flights_.erase(i);
+    }
+  }
+
+  if (flight) {
+    flight->handle()->Cancel();
+  }
+  io_service_.post([err_handler]() {
+    err_handler(HttpRequestError::Make(HttpRequestError::kCancelled));
+  });
+}
+
+
+std::shared_ptr<HttpRequestService::Flight> HttpRequestService::Land(
+    const std::string &key,
+    const std::shared_ptr<Flight> &flight) {
+  std::lock_guard<std::mutex> lock{flight_mutex_};
+  auto i = flights_.find(key);
+  if (i != flights_.end() && i->second == flight) {
+    flights_.erase(i);
+  }
+  // no one joins it any more; the waiters are as they are.
+  return flight;
+}
+
+
+HttpRequest::ErrorHandler HttpRequestService::WithRelease(
+    const std::shared_ptr<HttpRequest> &request,
+    const HttpRequest::ErrorHandler &err_handler) {
+  // the request keeps its handlers; a strong reference would keep it.
+  std::weak_ptr<HttpRequest> weak_request{request};
+  return [this, weak_request, err_handler](
+      const boost::system::error_code &ec) {
+    // posted, since the request is still inside this handler.
+    std::shared_ptr<HttpRequest> request{weak_request.lock()};
+    HttpMetrics::Get()->Record(request->timing());
+    io_service_.post([this, request]() {
+      Release(request);
+    });
+    err_handler(ec);
+  };
+}
+
+
+HttpRequest::SinkCompleteHandler HttpRequestService::WithRelease(
+    const std::shared_ptr<HttpRequest> &request,
+    const HttpRequest::SinkCompleteHandler &complete_handler) {
+  std::weak_ptr<HttpRequest> weak_request{request};
+  return [this, weak_request, complete_handler]() {
+    std::shared_ptr<HttpRequest> request{weak_request.lock()};
+    HttpMetrics::Get()->Record(request->timing());
+    io_service_.post([this, request]() {
+      Release(request);
+    });
+    complete_handler();
+  };
+}
+
+
+HttpRequestService::Flight::Flight(
+    const std::shared_ptr<HttpRequestHandle> &handle,
+    const std::shared_ptr<HttpResponseSink> &sink)
+    : handle_{handle},
+      sink_{sink},
+      waiters_{} {
+}
+
+
+HttpRequestService::Flight::~Flight() {
+}
+
+
+void HttpRequestService::Flight::Join(
+    const HttpRequestHandle *waiter,
+    const HttpRequest::ErrorHandler &err_handler,
+    const FlightCompleteHandler &complete_handler) {
+  waiters_.emplace_back(waiter, err_handler, complete_handler);
+}
+
+
+bool HttpRequestService::Flight::Leave(
+    const HttpRequestHandle *waiter,
+    HttpRequest::ErrorHandler *err_handler) {
+  auto i = std::find_if(
+      waiters_.begin(),
+      waiters_.end(),
+      [waiter](const Waiter &elem) {
+    return std::get<0>(elem) == waiter;
+  });
+  if (i == waiters_.end()) {
+    return false;
+  }
+  *err_handler = std::get<1>(*i);
+  waiters_.erase(i);
+  return true;
+}
 }  // namespace ncstreamer
@@ -7,54 +7,270 @@
 #define NCSTREAMER_CEF_SRC_LIB_HTTP_REQUEST_SERVICE_H_
 
 
+#include <chrono>  // NOLINT
+#include <deque>
+#include <functional>
 #include <memory>
+#include <mutex>  // NOLINT
 #include <string>
 #include <thread>  // NOLINT
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "boost/asio/io_service.hpp"
 #include "boost/property_tree/ptree.hpp"
 
+#include "ncstreamer_cef/src/lib/http_cache.h"
+#include "ncstreamer_cef/src/lib/http_connection_pool.h"
+#include "ncstreamer_cef/src/lib/http_download.h"
+#include "ncstreamer_cef/src/lib/http_json_sink.h"
 #include "ncstreamer_cef/src/lib/http_request.h"
+#include "ncstreamer_cef/src/lib/http_request_handle.h"
+#include "ncstreamer_cef/src/lib/http_request_policy.h"
+#include "ncstreamer_cef/src/lib/http_response_sink.h"
 
 
 namespace ncstreamer {
+// runs at most max_concurrency requests at a time, each on a request
+// object of its own; the others wait in the order they came.
+// the requests share the kept-alive connections to each host.
+// the same gets in flight at a time, but those with handlers for the
+// progress, go over the network once; the callers share the response.
+// the handles given out are not to outlive the service.
 class HttpRequestService {
  public:
+  using JsonCompleteHandler =
+      std::function<void(const boost::property_tree::ptree &tree)>;
+
+  explicit HttpRequestService(std::size_t max_concurrency);
   HttpRequestService();
   virtual ~HttpRequestService();
 
-  void Get(
+  // the body goes to the sink as it arrives.
+  std::shared_ptr<HttpRequestHandle> Get(
+      const std::string &uri,
+      const HttpRequestPolicy &policy,
+      const std::shared_ptr<HttpResponseSink> &sink,
+      const HttpRequest::ErrorHandler &err_handler,
+      const HttpRequest::RetryHandler &retry_handler,
+      const HttpRequest::OpenHandler &open_handler,
+      const HttpRequest::ReadHandler &read_handler,
+      const HttpRequest::SinkCompleteHandler &complete_handler);
+
+  // with the headers sent along.
+  std::shared_ptr<HttpRequestHandle> Get(
       const std::string &uri,
+      const HttpHeaderMap &headers,
+      const HttpRequestPolicy &policy,
+      const std::shared_ptr<HttpResponseSink> &sink,
       const HttpRequest::ErrorHandler &err_handler,
+      const HttpRequest::RetryHandler &retry_handler,
+      const HttpRequest::OpenHandler &open_handler,
+      const HttpRequest::ReadHandler &read_handler,
+      const HttpRequest::SinkCompleteHandler &complete_handler);
+
+  std::shared_ptr<HttpRequestHandle> Get(
+      const std::string &uri,
+      const HttpRequestPolicy &policy,
+      const HttpRequest::ErrorHandler &err_handler,
+      const HttpRequest::RetryHandler &retry_handler,
       const HttpRequest::OpenHandler &open_handler,
       const HttpRequest::ReadHandler &read_handler,
       const HttpRequest::ResponseCompleteHandler &complete_handler);
 
-  void Get(
+  // with the default policy.
+  std::shared_ptr<HttpRequestHandle> Get(
       const std::string &uri,
       const HttpRequest::ErrorHandler &err_handler,
       const HttpRequest::ResponseCompleteHandler &complete_handler);
 
-  void Post(
+  // with only the values at the given paths of the json body kept.
+  std::shared_ptr<HttpRequestHandle> GetJson(
+      const std::string &uri,
+      const std::vector<std::string> &paths,
+      const HttpRequest::ErrorHandler &err_handler,
+      const JsonCompleteHandler &complete_handler);
+
+  // served from the http cache at once, if there; an entry older than
+  // the ttl is revalidated meanwhile, and the refresh handler is given
+  // the values if they have changed. a failed revalidation is not told.
+  // the entry is of the user of user_id, as the key of HttpCache.
+  std::shared_ptr<HttpRequestHandle> GetCachedJson(
+      const std::string &uri,
+      const std::vector<std::string> &paths,
+      const std::string &user_id,
+      const std::chrono::seconds &ttl,
+      const HttpRequest::ErrorHandler &err_handler,
+      const JsonCompleteHandler &complete_handler,
+      const JsonCompleteHandler &refresh_handler);
+
+  std::shared_ptr<HttpRequestHandle> Post(
+      const std::string &uri,
+      const boost::property_tree::ptree &post_content,
+      const HttpRequestPolicy &policy,
+      const std::shared_ptr<HttpResponseSink> &sink,
+      const HttpRequest::ErrorHandler &err_handler,
+      const HttpRequest::RetryHandler &retry_handler,
+      const HttpRequest::OpenHandler &open_handler,
+      const HttpRequest::ReadHandler &read_handler,
+      const HttpRequest::SinkCompleteHandler &complete_handler);
+
+  std::shared_ptr<HttpRequestHandle> Post(
       const std::string &uri,
       const boost::property_tree::ptree &post_content,
+      const HttpRequestPolicy &policy,
       const HttpRequest::ErrorHandler &err_handler,
+      const HttpRequest::RetryHandler &retry_handler,
       const HttpRequest::OpenHandler &open_handler,
       const HttpRequest::ReadHandler &read_handler,
       const HttpRequest::ResponseCompleteHandler &complete_handler);
 
-  void Post(
+  // with the default policy.
+  std::shared_ptr<HttpRequestHandle> Post(
       const std::string &uri,
       const boost::property_tree::ptree &post_content,
       const HttpRequest::ErrorHandler &err_handler,
       const HttpRequest::ResponseCompleteHandler &complete_handler);
 
+  std::shared_ptr<HttpRequestHandle> PostJson(
+      const std::string &uri,
+      const boost::property_tree::ptree &post_content,
+      const std::vector<std::string> &paths,
+      const HttpRequest::ErrorHandler &err_handler,
+      const JsonCompleteHandler &complete_handler);
+
+  // the status and the headers of the response go to the sink.
+  std::shared_ptr<HttpRequestHandle> Head(
+      const std::string &uri,
+      const HttpRequestPolicy &policy,
+      const std::shared_ptr<HttpResponseSink> &sink,
+      const HttpRequest::ErrorHandler &err_handler,
+      const HttpRequest::SinkCompleteHandler &complete_handler);
+
+  // to the file, in ranges over up to options.max_segments() requests
+  // at a time; see HttpDownload. the segments are kept fewer than
+  // max_concurrency, so the other requests do not wait on a download.
+  std::shared_ptr<HttpRequestHandle> Download(
+      const std::string &uri,
+      const std::string &file_name,
+      const HttpDownloadOptions &options,
+      const HttpRequest::ErrorHandler &err_handler,
+      const HttpDownload::OpenHandler &open_handler,
+      const HttpDownload::ReadHandler &read_handler,
+      const HttpDownload::CompleteHandler &complete_handler);
+
+  // connects to the host of the uri ahead of the requests to it.
+  void PreConnect(const std::string &uri);
+
  private:
+  using Job = std::function<void(const std::shared_ptr<HttpRequest> &)>;
+  using FlightCompleteHandler = std::function<void(
+      const std::shared_ptr<HttpResponseSink> &sink)>;
+
+  class Flight;
+
+  // the gets of the same key share a response; so the key tells the
+  // sinks as well.
+  static std::string ToFlightKey(
+      const std::string &sink_kind,
+      const std::string &uri,
+      const std::vector<std::string> &paths,
+      const HttpHeaderMap &headers);
+
+  static HttpRequest::SinkCompleteHandler ToStringHandler(
+      const std::shared_ptr<HttpStringSink> &sink,
+      const HttpRequest::ResponseCompleteHandler &complete_handler);
+  static HttpRequest::SinkCompleteHandler ToJsonHandler(
+      const std::shared_ptr<HttpJsonSink> &sink,
+      const HttpRequest::ErrorHandler &err_handler,
+      const JsonCompleteHandler &complete_handler);
+
+  // the error handler is for a cancel while the job waits.
+  void Enqueue(
+      const std::shared_ptr<HttpRequestHandle> &handle,
+      const Job &job,
+      const HttpRequest::ErrorHandler &err_handler);
+  // on the io thread; hands the request to the next job waiting, if any.
+  void Release(const std::shared_ptr<HttpRequest> &request);
+
+  // joins the flight of the key, or starts one with the given sink;
+  // the complete handler is given the sink of the flight.
+  std::shared_ptr<HttpRequestHandle> GetOnce(
+      const std::string &key,
+      const std::string &uri,
+      const HttpHeaderMap &headers,
+      const std::shared_ptr<HttpResponseSink> &sink,
+      const HttpRequest::ErrorHandler &err_handler,
+      const FlightCompleteHandler &complete_handler);
+  // the request of a flight is cancelled when no one waits for it.
+  void LeaveFlight(
+      const std::string &key,
+      const HttpRequestHandle *waiter);
+  std::shared_ptr<Flight> Land(
+      const std::string &key,
+      const std::shared_ptr<Flight> &flight);
+
+  // the request goes back to the pool before the handler is called.
+  HttpRequest::ErrorHandler WithRelease(
+      const std::shared_ptr<HttpRequest> &request,
+      const HttpRequest::ErrorHandler &err_handler);
+  HttpRequest::SinkCompleteHandler WithRelease(
+      const std::shared_ptr<HttpRequest> &request,
+      const HttpRequest::SinkCompleteHandler &complete_handler);
+
+  const std::size_t max_concurrency_;
+
   boost::asio::io_service io_service_;
   boost::asio::io_service::work io_service_work_;
+  HttpConnectionPool connection_pool_;
   std::thread io_thread_;
 
-  std::shared_ptr<HttpRequest> http_request_;
+  std::mutex mutex_;
+  std::size_t active_size_;
+  std::vector<std::shared_ptr<HttpRequest>> idle_requests_;
+  std::deque<std::pair<const HttpRequestHandle *, Job>> pending_jobs_;
+
+  std::mutex flight_mutex_;
+  std::unordered_map<
+      std::string /*key*/,
+      std::shared_ptr<Flight>> flights_;
+};
+
+
+class HttpRequestService::Flight {
+ public:
+  using Waiter = std::tuple<
+      const HttpRequestHandle *,
+      HttpRequest::ErrorHandler,
+      FlightCompleteHandler>;
+
+  Flight(
+      const std::shared_ptr<HttpRequestHandle> &handle,
+      const std::shared_ptr<HttpResponseSink> &sink);
+  virtual ~Flight();
+
+  const std::shared_ptr<HttpRequestHandle> &handle() const {
+    return handle_;
+  }
+  const std::shared_ptr<HttpResponseSink> &sink() const { return sink_; }
+  const std::vector<Waiter> &waiters() const { return waiters_; }
+
+  void Join(
+      const HttpRequestHandle *waiter,
+      const HttpRequest::ErrorHandler &err_handler,
+      const FlightCompleteHandler &complete_handler);
+  // false if the waiter is not there.
+  bool Leave(
+      const HttpRequestHandle *waiter,
+      HttpRequest::ErrorHandler *err_handler);
+
+ private:
+  // of the request; apart from those of the waiters.
+  const std::shared_ptr<HttpRequestHandle> handle_;
+  const std::shared_ptr<HttpResponseSink> sink_;
+  std::vector<Waiter> waiters_;
 };
 }  // namespace ncstreamer
 
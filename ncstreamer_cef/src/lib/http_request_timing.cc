@@ -0,0 +1,90 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#include "ncstreamer_cef/src/lib/http_request_timing.h"
+
+#include <algorithm>
+#include <cctype>
+
+
+namespace {
+double ToMs(const ncstreamer::HttpRequestTiming::Clock::duration &duration) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+      duration).count() / 1000.0;
+}
+}  // unnamed namespace
+
+
+namespace ncstreamer {
+HttpRequestTiming::HttpRequestTiming(
+    const std::string &method,
+    const std::string &endpoint)
+    : method_{method},
+      endpoint_{endpoint},
+      succeeded_{false},
+      reused_{false},
+      retries_{0},
+      dns_{Clock::duration::zero()},
+      connect_{Clock::duration::zero()},
+      tls_{Clock::duration::zero()},
+      first_byte_{Clock::duration::zero()},
+      transfer_{Clock::duration::zero()},
+      total_{Clock::duration::zero()},
+      bytes_{0} {
+}
+
+
+HttpRequestTiming::HttpRequestTiming()
+    : HttpRequestTiming{"", ""} {
+}
+
+
+HttpRequestTiming::~HttpRequestTiming() {
+}
+
+
+std::string HttpRequestTiming::ToEndpoint(const std::string &path) {
+  std::string trimmed{path.substr(0, path.find_first_of("?#"))};
+  while (trimmed.empty() == false && trimmed.back() == '/') {
+    trimmed.pop_back();
+  }
+
+  const std::string &segment = trimmed.substr(trimmed.rfind('/') + 1);
+  if (segment.empty() == false &&
+      std::all_of(segment.begin(), segment.end(), ::isdigit) == true) {
+    return "/{id}";
+  }
+  return "/" + segment;
+}
+
+
+void HttpRequestTiming::ResetExchange() {
+  reused_ = false;
+  dns_ = Clock::duration::zero();
+  connect_ = Clock::duration::zero();
+  tls_ = Clock::duration::zero();
+  first_byte_ = Clock::duration::zero();
+  transfer_ = Clock::duration::zero();
+  bytes_ = 0;
+}
+
+
+boost::property_tree::ptree HttpRequestTiming::ToTree() const {
+  boost::property_tree::ptree tree;
+  tree.put("method", method_);
+  tree.put("endpoint", endpoint_);
+  tree.put("succeeded", succeeded_);
+  tree.put("reused", reused_);
+  tree.put("retries", retries_);
+  tree.put("dnsMs", ToMs(dns_));
+  tree.put("connectMs", ToMs(connect_));
+  tree.put("tlsMs", ToMs(tls_));
+  tree.put("firstByteMs", ToMs(first_byte_));
+  tree.put("transferMs", ToMs(transfer_));
+  tree.put("totalMs", ToMs(total_));
+  tree.put("bytes", bytes_);
+  return tree;
+}
+}  // namespace ncstreamer
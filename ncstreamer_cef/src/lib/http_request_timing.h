@@ -0,0 +1,87 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#ifndef NCSTREAMER_CEF_SRC_LIB_HTTP_REQUEST_TIMING_H_
+#define NCSTREAMER_CEF_SRC_LIB_HTTP_REQUEST_TIMING_H_
+
+
+#include <chrono>  // NOLINT
+#include <cstdint>
+#include <string>
+
+#include "boost/property_tree/ptree.hpp"
+
+
+namespace ncstreamer {
+// where the time of a request went; the phases are of its last exchange,
+// the total is over the redirects and the retries as well.
+// the dns, connect and tls are zero over a kept-alive connection.
+class HttpRequestTiming {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  HttpRequestTiming(
+      const std::string &method,
+      const std::string &endpoint);
+  HttpRequestTiming();
+  virtual ~HttpRequestTiming();
+
+  // the last segment of the path, as "/me" or "/live_videos"; a number
+  // stands for an id, as in "/{id}".
+  static std::string ToEndpoint(const std::string &path);
+
+  const std::string &method() const { return method_; }
+  const std::string &endpoint() const { return endpoint_; }
+  bool succeeded() const { return succeeded_; }
+  bool reused() const { return reused_; }
+  uint32_t retries() const { return retries_; }
+  const Clock::duration &dns() const { return dns_; }
+  const Clock::duration &connect() const { return connect_; }
+  const Clock::duration &tls() const { return tls_; }
+  const Clock::duration &first_byte() const { return first_byte_; }
+  const Clock::duration &transfer() const { return transfer_; }
+  const Clock::duration &total() const { return total_; }
+  uint64_t bytes() const { return bytes_; }
+
+  void set_succeeded(bool succeeded) { succeeded_ = succeeded; }
+  void set_reused(bool reused) { reused_ = reused; }
+  void set_retries(uint32_t retries) { retries_ = retries; }
+  void set_dns(const Clock::duration &dns) { dns_ = dns; }
+  void set_connect(const Clock::duration &connect) { connect_ = connect; }
+  void set_tls(const Clock::duration &tls) { tls_ = tls; }
+  void set_first_byte(const Clock::duration &first_byte) {
+    first_byte_ = first_byte;
+  }
+  void set_transfer(const Clock::duration &transfer) {
+    transfer_ = transfer;
+  }
+  void set_total(const Clock::duration &total) { total_ = total; }
+  void set_bytes(uint64_t bytes) { bytes_ = bytes; }
+
+  // before a new exchange of the request.
+  void ResetExchange();
+
+  boost::property_tree::ptree ToTree() const;
+
+ private:
+  std::string method_;
+  std::string endpoint_;
+  bool succeeded_;
+  bool reused_;
+  uint32_t retries_;
+
+  Clock::duration dns_;
+  Clock::duration connect_;
+  Clock::duration tls_;
+  // from the request written on the connection.
+  Clock::duration first_byte_;
+  Clock::duration transfer_;
+  Clock::duration total_;
+  uint64_t bytes_;
+};
+}  // namespace ncstreamer
+
+
+#endif  // NCSTREAMER_CEF_SRC_LIB_HTTP_REQUEST_TIMING_H_
@@ -0,0 +1,60 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#include "ncstreamer_cef/src/lib/http_response_sink.h"
+
+
+namespace ncstreamer {
+HttpResponseSink::HttpResponseSink() {
+}
+
+
+HttpResponseSink::~HttpResponseSink() {
+}
+
+
+void HttpResponseSink::Open(
+    int /*status*/,
+    const HttpHeaderMap &/*headers*/) {
+}
+
+
+void HttpResponseSink::Close() {
+}
+
+
+HttpStringSink::HttpStringSink()
+    : data_{} {
+}
+
+
+HttpStringSink::~HttpStringSink() {
+}
+
+
+void HttpStringSink::Write(const char *data, std::size_t size) {
+  data_.append(data, size);
+}
+
+
+HttpHeaderSink::HttpHeaderSink()
+    : status_{0},
+      headers_{} {
+}
+
+
+HttpHeaderSink::~HttpHeaderSink() {
+}
+
+
+void HttpHeaderSink::Open(int status, const HttpHeaderMap &headers) {
+  status_ = status;
+  headers_ = headers;
+}
+
+
+void HttpHeaderSink::Write(const char * /*data*/, std::size_t /*size*/) {
+}
+}  // namespace ncstreamer
@@ -0,0 +1,65 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#ifndef NCSTREAMER_CEF_SRC_LIB_HTTP_RESPONSE_SINK_H_
+#define NCSTREAMER_CEF_SRC_LIB_HTTP_RESPONSE_SINK_H_
+
+
+#include <string>
+
+#include "ncstreamer_cef/src/lib/http_types.h"
+
+
+namespace ncstreamer {
+// where the body of a response goes, chunk by chunk as it arrives.
+class HttpResponseSink {
+ public:
+  HttpResponseSink();
+  virtual ~HttpResponseSink();
+
+  // before the body of the response followed to the end, which is
+  // either a success or a not modified.
+  virtual void Open(int status, const HttpHeaderMap &headers);
+  virtual void Write(const char *data, std::size_t size) = 0;
+  // at the end of the body, or when the request fails.
+  virtual void Close();
+};
+
+
+// keeps the whole body.
+class HttpStringSink : public HttpResponseSink {
+ public:
+  HttpStringSink();
+  virtual ~HttpStringSink();
+
+  void Write(const char *data, std::size_t size) override;
+
+  const std::string &data() const { return data_; }
+
+ private:
+  std::string data_;
+};
+
+
+// keeps the status and the headers; for a head request.
+class HttpHeaderSink : public HttpResponseSink {
+ public:
+  HttpHeaderSink();
+  virtual ~HttpHeaderSink();
+
+  void Open(int status, const HttpHeaderMap &headers) override;
+  void Write(const char *data, std::size_t size) override;
+
+  int status() const { return status_; }
+  const HttpHeaderMap &headers() const { return headers_; }
+
+ private:
+  int status_;
+  HttpHeaderMap headers_;
+};
+}  // namespace ncstreamer
+
+
+#endif  // NCSTREAMER_CEF_SRC_LIB_HTTP_RESPONSE_SINK_H_
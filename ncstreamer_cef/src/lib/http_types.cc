@@ -10,6 +10,36 @@
 #include "boost/property_tree/json_parser.hpp"
 
 
+namespace {
+class HttpRequestErrorCategory : public boost::system::error_category {
+ public:
+  const char *name() const BOOST_SYSTEM_NOEXCEPT override {
+    return "ncstreamer.http_request";
+  }
+
+  std::string message(int value) const override {
+    using ncstreamer::HttpRequestError;
+    switch (value) {
+      case HttpRequestError::kConnectTimeout:
+        return "connect timed out";
+      case HttpRequestError::kFirstByteTimeout:
+        return "response timed out";
+      case HttpRequestError::kTotalTimeout:
+        return "request timed out";
+      case HttpRequestError::kCancelled:
+        return "request cancelled";
+      case HttpRequestError::kMalformedJson:
+        return "malformed json";
+      case HttpRequestError::kHashMismatch:
+        return "hash mismatch";
+      default:
+        return "unknown error";
+    }
+  }
+};
+}  // unnamed namespace
+
+
 namespace ncstreamer {
 const urdl::http::request_method HttpRequestMethod::kGet{"GET"};
 const urdl::http::request_method HttpRequestMethod::kHead{"HEAD"};
@@ -22,13 +52,21 @@ const urdl::http::request_content_type
     HttpRequestContentType::kApplicationJson{"application/json"};
 
 
-void HttpRequestContent::SetJson(
-    const boost::property_tree::ptree &content,
-    urdl::read_stream *out) {
+std::string HttpRequestContent::ToJson(
+    const boost::property_tree::ptree &content) {
   std::stringstream json;
   boost::property_tree::write_json(json, content, false);
+  return json.str();
+}
+
+
+const boost::system::error_category &HttpRequestError::category() {
+  static const HttpRequestErrorCategory kCategory;
+  return kCategory;
+}
+
 
-  out->set_option(HttpRequestContentType::kApplicationJson);
-  out->set_option(urdl::http::request_content{json.str()});
+boost::system::error_code HttpRequestError::Make(Code code) {
+  return {code, category()};
 }
 }  // namespace ncstreamer
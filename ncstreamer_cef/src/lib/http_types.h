@@ -7,7 +7,11 @@
 #define NCSTREAMER_CEF_SRC_LIB_HTTP_TYPES_H_
 
 
+#include <string>
+#include <unordered_map>
+
 #include "boost/property_tree/ptree.hpp"
+#include "boost/system/error_code.hpp"
 
 #pragma warning(push)
 #pragma warning(disable: 4244)
@@ -16,6 +20,11 @@
 
 
 namespace ncstreamer {
+// the names of the response headers are in lowercase.
+using HttpHeaderMap = std::unordered_map<
+    std::string /*name*/, std::string /*value*/>;
+
+
 class HttpRequestMethod {
  public:
   static const urdl::http::request_method kGet;
@@ -34,9 +43,25 @@ class HttpRequestContentType {
 
 class HttpRequestContent {
  public:
-  static void SetJson(
-      const boost::property_tree::ptree &content,
-      urdl::read_stream *out);
+  static std::string ToJson(const boost::property_tree::ptree &content);
+};
+
+
+// the errors of our own, as distinct from those of the network and
+// of the server.
+class HttpRequestError {
+ public:
+  enum Code {
+    kConnectTimeout = 1,
+    kFirstByteTimeout,
+    kTotalTimeout,
+    kCancelled,
+    kMalformedJson,
+    kHashMismatch,
+  };
+
+  static const boost::system::error_category &category();
+  static boost::system::error_code Make(Code code);
 };
 }  // namespace ncstreamer
 
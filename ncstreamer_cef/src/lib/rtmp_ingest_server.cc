@@ -0,0 +1,784 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#include "ncstreamer_cef/src/lib/rtmp_ingest_server.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+
+#include "boost/asio/ip/address.hpp"
+#include "boost/asio/read.hpp"
+#include "boost/asio/write.hpp"
+
+
+namespace {
+// rtmp message type ids.
+const uint8_t kSetChunkSize{1};
+const uint8_t kWindowAckSize{5};
+const uint8_t kSetPeerBandwidth{6};
+const uint8_t kAudio{8};
+const uint8_t kVideo{9};
+const uint8_t kCommandAmf0{20};
+
+// amf0 markers.
+const uint8_t kAmfNumber{0x00};
+const uint8_t kAmfString{0x02};
+const uint8_t kAmfObject{0x03};
+const uint8_t kAmfNull{0x05};
+const uint8_t kAmfObjectEnd{0x09};
+
+const std::size_t kHandshakeSize{1536};
+
+// a chunk of 0 would never end; none is of use past the longest message.
+const std::size_t kMinChunkSize{1};
+const std::size_t kMaxChunkSize{0xffffff};
+
+
+uint32_t ReadUint24(const uint8_t *bytes) {
+  return (bytes[0] << 16) | (bytes[1] << 8) | bytes[2];
+}
+
+
+uint32_t ReadUint32(const uint8_t *bytes) {
+  return (bytes[0] << 24) | (bytes[1] << 16) | (bytes[2] << 8) | bytes[3];
+}
+
+
+void AppendUint24(uint32_t value, std::vector<uint8_t> *out) {
+  out->emplace_back(static_cast<uint8_t>(value >> 16));
+  out->emplace_back(static_cast<uint8_t>(value >> 8));
+  out->emplace_back(static_cast<uint8_t>(value));
+}
+
+
+void AppendUint32(uint32_t value, std::vector<uint8_t> *out) {
+  out->emplace_back(static_cast<uint8_t>(value >> 24));
+  AppendUint24(value, out);
+}
+
+
+bool ReadAmfString(
+    const std::vector<uint8_t> &in, std::size_t *pos, std::string *value) {
+  if (*pos + 3 > in.size() || in[*pos] != kAmfString) {
+    return false;
+  }
+  std::size_t size = (in[*pos + 1] << 8) | in[*pos + 2];
+  if (*pos + 3 + size > in.size()) {
+    return false;
+  }
+  value->assign(in.begin() + *pos + 3, in.begin() + *pos + 3 + size);
+  *pos += 3 + size;
+  return true;
+}
+
+
+bool ReadAmfNumber(
+    const std::vector<uint8_t> &in, std::size_t *pos, double *value) {
+  if (*pos + 9 > in.size() || in[*pos] != kAmfNumber) {
+    return false;
+  }
+  uint64_t bits{0};
+  for (std::size_t i = 1; i <= 8; ++i) {
+    bits = (bits << 8) | in[*pos + i];
+  }
+  std::memcpy(value, &bits, sizeof(*value));
+  *pos += 9;
+  return true;
+}
+
+
+void AppendAmfString(const std::string &value, std::vector<uint8_t> *out) {
+  out->emplace_back(kAmfString);
+  out->emplace_back(static_cast<uint8_t>(value.size() >> 8));
+  out->emplace_back(static_cast<uint8_t>(value.size()));
+  out->insert(out->end(), value.begin(), value.end());
+}
+
+
+void AppendAmfNumber(double value, std::vector<uint8_t> *out) {
+  uint64_t bits{0};
+  std::memcpy(&bits, &value, sizeof(value));
+  out->emplace_back(kAmfNumber);
+  for (int shift = 56; shift >= 0; shift -= 8) {
+    out->emplace_back(static_cast<uint8_t>(bits >> shift));
+  }
+}
+
+
+void AppendAmfNull(std::vector<uint8_t> *out) {
+  out->emplace_back(kAmfNull);
+}
+
+
+// an object of string properties only, which is all the replies need.
+void AppendAmfObject(
+    const std::vector<std::pair<std::string, std::string>> &properties,
+    std::vector<uint8_t> *out) {
+  out->emplace_back(kAmfObject);
+  for (const auto &property : properties) {
+    out->emplace_back(static_cast<uint8_t>(property.first.size() >> 8));
+    out->emplace_back(static_cast<uint8_t>(property.first.size()));
+    out->insert(out->end(), property.first.begin(), property.first.end());
+    AppendAmfString(property.second, out);
+  }
+  out->insert(out->end(), {0x00, 0x00, kAmfObjectEnd});
+}
+
+
+int64_t ToMilliseconds(const std::chrono::steady_clock::duration &duration) {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+      duration).count();
+}
+}  // unnamed namespace
+
+
+namespace ncstreamer {
+class RtmpIngestServer::Session
+    : public std::enable_shared_from_this<Session> {
+ public:
+  Session(boost::asio::io_service *io_service, Stats *stats)
+      : socket_{*io_service},
+        stats_{stats},
+        buffer_{},
+        write_queue_{},
+        chunk_streams_{},
+        in_chunk_size_{128},
+        out_chunk_size_{128},
+        closed_{false} {
+  }
+
+  virtual ~Session() {
+  }
+
+  boost::asio::ip::tcp::socket &socket() { return socket_; }
+
+  void Start() {
+    stats_->OnConnected();
+    ReadHandshake();
+  }
+
+  void Close() {
+    if (closed_ == true) {
+      return;
+    }
+    closed_ = true;
+    boost::system::error_code ec;
+    socket_.close(ec);
+    stats_->OnDisconnected();
+  }
+
+ private:
+  class ChunkStream {
+   public:
+    ChunkStream()
+        : timestamp_ms{0},
+          timestamp_delta_ms{0},
+          extended_timestamp{false},
+          length{0},
+          type_id{0},
+          stream_id{0},
+          payload{} {
+    }
+
+    uint32_t timestamp_ms;
+    uint32_t timestamp_delta_ms;
+    bool extended_timestamp;
+    uint32_t length;
+    uint8_t type_id;
+    uint32_t stream_id;
+    std::vector<uint8_t> payload;
+  };
+
+  using OnRead = std::function<void()>;
+
+  void Read(std::size_t size, const OnRead &on_read) {
+    buffer_.resize(size);
+    auto self = shared_from_this();
+    boost::asio::async_read(
+        socket_,
+        boost::asio::buffer(buffer_),
+        [self, on_read](
+            const boost::system::error_code &ec, std::size_t /*size*/) {
+      if (ec) {
+        self->Close();
+        return;
+      }
+      on_read();
+    });
+  }
+
+  void Write(std::vector<uint8_t> &&data) {
+    write_queue_.emplace_back(std::move(data));
+    if (write_queue_.size() == 1) {
+      WriteFront();
+    }
+  }
+
+  void WriteFront() {
+    auto self = shared_from_this();
+    boost::asio::async_write(
+        socket_,
+        boost::asio::buffer(write_queue_.front()),
+        [self](const boost::system::error_code &ec, std::size_t /*size*/) {
+      if (ec) {
+        self->Close();
+        return;
+      }
+      self->write_queue_.pop_front();
+      if (self->write_queue_.empty() == false) {
+        self->WriteFront();
+      }
+    });
+  }
+
+  // the plain handshake; s2 echoes c1, and a zero version in s1 tells
+  // the client not to expect the digest scheme.
+  void ReadHandshake() {
+    Read(1 + kHandshakeSize, [this]() {
+      std::vector<uint8_t> reply(1 + kHandshakeSize * 2, 0);
+      reply[0] = 0x03;
+      std::copy(buffer_.begin() + 1, buffer_.end(),
+                reply.begin() + 1 + kHandshakeSize);
+      Write(std::move(reply));
+
+      Read(kHandshakeSize, [this]() {
+        ReadChunkBasicHeader();
+      });
+    });
+  }
+
+  void ReadChunkBasicHeader() {
+    Read(1, [this]() {
+      uint8_t fmt = buffer_[0] >> 6;
+      uint32_t csid = buffer_[0] & 0x3f;
+      if (csid == 0) {
+        Read(1, [this, fmt]() {
+          ReadChunkMessageHeader(fmt, 64 + buffer_[0]);
+        });
+      } else if (csid == 1) {
+        Read(2, [this, fmt]() {
+          ReadChunkMessageHeader(fmt, 64 + buffer_[0] + buffer_[1] * 256);
+        });
+      } else {
+        ReadChunkMessageHeader(fmt, csid);
+      }
+    });
+  }
+
+  void ReadChunkMessageHeader(uint8_t fmt, uint32_t csid) {
+    static const std::size_t kHeaderSizes[]{11, 7, 3, 0};
+
+    ChunkStream *stream = &chunk_streams_[csid];
+    if (fmt == 3) {
+      ReadExtendedTimestamp(fmt, stream, 0);
+      return;
+    }
+
+    Read(kHeaderSizes[fmt], [this, fmt, stream]() {
+      uint32_t timestamp = ReadUint24(&buffer_[0]);
+      if (fmt <= 1) {
+        stream->length = ReadUint24(&buffer_[3]);
+        stream->type_id = buffer_[6];
+        stream->payload.clear();
+      }
+      if (fmt == 0) {
+        // the only little-endian field of rtmp.
+        stream->stream_id = buffer_[7] | (buffer_[8] << 8) |
+                            (buffer_[9] << 16) | (buffer_[10] << 24);
+      }
+      stream->extended_timestamp = (timestamp == 0xffffff);
+      ReadExtendedTimestamp(fmt, stream, timestamp);
+    });
+  }
+
+  void ReadExtendedTimestamp(
+      uint8_t fmt, ChunkStream *stream, uint32_t timestamp) {
+    if (stream->extended_timestamp == false) {
+      OnChunkHeader(fmt, stream, timestamp);
+      return;
+    }
+    Read(4, [this, fmt, stream]() {
+      OnChunkHeader(fmt, stream, ReadUint32(&buffer_[0]));
+    });
+  }
+
+  void OnChunkHeader(uint8_t fmt, ChunkStream *stream, uint32_t timestamp) {
+    if (fmt == 0) {
+      stream->timestamp_ms = timestamp;
+      stream->timestamp_delta_ms = 0;
+    } else if (fmt <= 2) {
+      stream->timestamp_delta_ms = timestamp;
+      stream->timestamp_ms += timestamp;
+    } else if (stream->payload.empty() == true) {
+      // type 3 opening a new message repeats the last delta.
+      stream->timestamp_ms += stream->timestamp_delta_ms;
+    }
+    ReadChunkPayload(stream);
+  }
+
+  void ReadChunkPayload(ChunkStream *stream) {
+    std::size_t remaining = stream->length - stream->payload.size();
+    Read((std::min)(remaining, in_chunk_size_), [this, stream]() {
+      stream->payload.insert(
+          stream->payload.end(), buffer_.begin(), buffer_.end());
+      if (stream->payload.size() >= stream->length) {
+        OnMessage(*stream);
+        stream->payload.clear();
+      }
+      ReadChunkBasicHeader();
+    });
+  }
+
+  void OnMessage(const ChunkStream &stream) {
+    const std::vector<uint8_t> &payload = stream.payload;
+    switch (stream.type_id) {
+      case kSetChunkSize: {
+        if (payload.size() >= 4) {
+          std::size_t chunk_size = ReadUint32(&payload[0]) & 0x7fffffff;
+          in_chunk_size_ = (std::min)(
+              (std::max)(chunk_size, kMinChunkSize), kMaxChunkSize);
+        }
+        break;
+      }
+      case kCommandAmf0: {
+        OnCommand(payload);
+        break;
+      }
+      case kAudio: {
+        stats_->OnBytes(payload.size());
+        stats_->OnAudioTag(stream.timestamp_ms);
+        break;
+      }
+      case kVideo: {
+        stats_->OnBytes(payload.size());
+        // avc sequence headers carry no picture.
+        if (payload.size() < 2 || payload[1] != 0x01) {
+          break;
+        }
+        bool keyframe = (payload[0] >> 4) == 1;
+        stats_->OnVideoTag(stream.timestamp_ms, keyframe);
+        break;
+      }
+      default: {
+        break;
+      }
+    }
+  }
+
+  void OnCommand(const std::vector<uint8_t> &payload) {
+    std::size_t pos{0};
+    std::string name;
+    double transaction_id{0};
+    if (ReadAmfString(payload, &pos, &name) == false ||
+        ReadAmfNumber(payload, &pos, &transaction_id) == false) {
+      return;
+    }
+
+    if (name == "connect") {
+      std::vector<uint8_t> window;
+      AppendUint32(2500000, &window);
+      SendMessage(2, kWindowAckSize, 0, window);
+
+      std::vector<uint8_t> bandwidth{window};
+      bandwidth.emplace_back(2);  // dynamic
+      SendMessage(2, kSetPeerBandwidth, 0, bandwidth);
+
+      std::vector<uint8_t> chunk_size;
+      AppendUint32(4096, &chunk_size);
+      SendMessage(2, kSetChunkSize, 0, chunk_size);
+      out_chunk_size_ = 4096;
+
+      std::vector<uint8_t> result;
+      AppendAmfString("_result", &result);
+      AppendAmfNumber(transaction_id, &result);
+      AppendAmfObject({{"fmsVer", "FMS/3,0,1,123"}}, &result);
+      AppendAmfObject({
+          {"level", "status"},
+          {"code", "NetConnection.Connect.Success"},
+          {"description", "Connection succeeded."}}, &result);
+      SendMessage(3, kCommandAmf0, 0, result);
+    } else if (name == "createStream") {
+      std::vector<uint8_t> result;
+      AppendAmfString("_result", &result);
+      AppendAmfNumber(transaction_id, &result);
+      AppendAmfNull(&result);
+      AppendAmfNumber(kStreamId, &result);
+      SendMessage(3, kCommandAmf0, 0, result);
+    } else if (name == "publish") {
+      // skips the null command object.
+      std::string stream_name;
+      ++pos;
+      ReadAmfString(payload, &pos, &stream_name);
+      stats_->OnPublished(stream_name);
+
+      std::vector<uint8_t> status;
+      AppendAmfString("onStatus", &status);
+      AppendAmfNumber(0, &status);
+      AppendAmfNull(&status);
+      AppendAmfObject({
+          {"level", "status"},
+          {"code", "NetStream.Publish.Start"},
+          {"description", "Publishing."}}, &status);
+      SendMessage(5, kCommandAmf0, kStreamId, status);
+    }
+    // nothing waits for the replies to the others.
+  }
+
+  void SendMessage(
+      uint8_t csid,
+      uint8_t type_id,
+      uint32_t stream_id,
+      const std::vector<uint8_t> &payload) {
+    std::vector<uint8_t> message;
+    message.emplace_back(csid);  // fmt 0
+    AppendUint24(0, &message);
+    AppendUint24(static_cast<uint32_t>(payload.size()), &message);
+    message.emplace_back(type_id);
+    for (int shift = 0; shift < 32; shift += 8) {
+      message.emplace_back(static_cast<uint8_t>(stream_id >> shift));
+    }
+
+    for (std::size_t offset = 0; offset < payload.size();
+         offset += out_chunk_size_) {
+      if (offset > 0) {
+        message.emplace_back(0xc0 | csid);  // fmt 3
+      }
+      std::size_t size = (std::min)(out_chunk_size_, payload.size() - offset);
+      message.insert(message.end(),
+                     payload.begin() + offset,
+                     payload.begin() + offset + size);
+    }
+    Write(std::move(message));
+  }
+
+  static const uint32_t kStreamId{1};
+
+  boost::asio::ip::tcp::socket socket_;
+  Stats *const stats_;
+
+  std::vector<uint8_t> buffer_;
+  std::deque<std::vector<uint8_t>> write_queue_;
+  std::unordered_map<uint32_t /*csid*/, ChunkStream> chunk_streams_;
+  std::size_t in_chunk_size_;
+  std::size_t out_chunk_size_;
+  bool closed_;
+};
+
+
+void RtmpIngestServer::SetUp(uint16_t port) {
+  assert(!static_instance);
+  static_instance = new RtmpIngestServer{port};
+}
+
+
+void RtmpIngestServer::ShutDown() {
+  assert(static_instance);
+  delete static_instance;
+  static_instance = nullptr;
+}
+
+
+RtmpIngestServer *RtmpIngestServer::Get() {
+  assert(static_instance);
+  return static_instance;
+}
+
+
+bool RtmpIngestServer::IsListening() const {
+  return listening_;
+}
+
+
+std::string RtmpIngestServer::GetStreamUrl() const {
+  if (listening_ == false) {
+    return "";
+  }
+
+  std::stringstream url;
+  url << "rtmp://127.0.0.1:" << port_ << "/live/ingest";
+  return url.str();
+}
+
+
+boost::property_tree::ptree RtmpIngestServer::ToTree() const {
+  boost::property_tree::ptree tree{stats_->ToTree()};
+  tree.put("listening", listening_);
+  tree.put("streamUrl", GetStreamUrl());
+  return std::move(tree);
+}
+
+
+RtmpIngestServer::RtmpIngestServer(uint16_t port)
+    : port_{port},
+      listening_{false},
+      io_service_{},
+      io_service_work_{io_service_},
+      acceptor_{io_service_},
+      session_{},
+      stats_{new Stats{}},
+      io_thread_{} {
+  if (port_ == 0) {
+    return;
+  }
+
+  // loopback only; this is not meant to be reachable from outside.
+  boost::asio::ip::tcp::endpoint endpoint{
+      boost::asio::ip::address_v4::loopback(), port_};
+  boost::system::error_code ec;
+  acceptor_.open(endpoint.protocol(), ec);
+  if (!ec) {
+    acceptor_.set_option(
+        boost::asio::ip::tcp::acceptor::reuse_address{true}, ec);
+  }
+  if (!ec) {
+    acceptor_.bind(endpoint, ec);
+  }
+  if (!ec) {
+    acceptor_.listen(boost::asio::socket_base::max_connections, ec);
+  }
+  if (ec) {
+    acceptor_.close(ec);
+    return;
+  }
+
+  listening_ = true;
+  Accept();
+  io_thread_ = std::thread{[this]() {
+    io_service_.run();
+  }};
+}
+
+
+RtmpIngestServer::~RtmpIngestServer() {
+  io_service_.stop();
+  if (io_thread_.joinable() == true) {
+    io_thread_.join();
+  }
+}
+
+
+void RtmpIngestServer::Accept() {
+  auto session = std::make_shared<Session>(&io_service_, stats_.get());
+  acceptor_.async_accept(
+      session->socket(),
+      [this, session](const boost::system::error_code &ec) {
+    if (ec) {
+      return;
+    }
+    // a new publisher replaces the old one, as a real ingest would.
+    if (session_) {
+      session_->Close();
+    }
+    session_ = session;
+    session_->Start();
+    Accept();
+  });
+}
+
+
+RtmpIngestServer::Stats::Stats()
+    : mutex_{},
+      connected_{false},
+      publishing_{false},
+      stream_name_{},
+      connected_time_{},
+      total_bytes_{0},
+      recent_bytes_{},
+      video_tags_{0},
+      audio_tags_{0},
+      keyframes_{0},
+      last_keyframe_timestamp_ms_{-1},
+      max_keyframe_interval_ms_{0},
+      keyframe_intervals_ms_{},
+      last_arrival_{},
+      last_timestamp_ms_{0},
+      jitter_ms_{0.0},
+      max_arrival_gap_ms_{0},
+      transits_ms_{},
+      min_transit_ms_{0} {
+}
+
+
+RtmpIngestServer::Stats::~Stats() {
+}
+
+
+void RtmpIngestServer::Stats::OnConnected() {
+  std::lock_guard<std::mutex> lock{mutex_};
+  ClearLocked();
+  connected_ = true;
+  connected_time_ = Clock::now();
+}
+
+
+void RtmpIngestServer::Stats::OnPublished(const std::string &stream_name) {
+  std::lock_guard<std::mutex> lock{mutex_};
+  publishing_ = true;
+  stream_name_ = stream_name;
+}
+
+
+void RtmpIngestServer::Stats::OnDisconnected() {
+  // the numbers stay until the next publisher, for a look afterward.
+  std::lock_guard<std::mutex> lock{mutex_};
+  connected_ = false;
+  publishing_ = false;
+}
+
+
+void RtmpIngestServer::Stats::OnBytes(std::size_t size) {
+  static const std::chrono::seconds kBitrateWindow{5};
+
+  Clock::time_point now{Clock::now()};
+
+  std::lock_guard<std::mutex> lock{mutex_};
+  total_bytes_ += size;
+  recent_bytes_.emplace_back(now, size);
+  while (now - recent_bytes_.front().first > kBitrateWindow) {
+    recent_bytes_.pop_front();
+  }
+}
+
+
+void RtmpIngestServer::Stats::OnVideoTag(
+    uint32_t timestamp_ms, bool keyframe) {
+  Clock::time_point now{Clock::now()};
+
+  std::lock_guard<std::mutex> lock{mutex_};
+  ++video_tags_;
+
+  // interarrival jitter, the way rtp estimates it.
+  if (video_tags_ > 1) {
+    int64_t arrival_delta_ms = ToMilliseconds(now - last_arrival_);
+    int64_t timestamp_delta_ms =
+        static_cast<int64_t>(timestamp_ms) - last_timestamp_ms_;
+    double d = static_cast<double>(
+        std::abs(arrival_delta_ms - timestamp_delta_ms));
+    jitter_ms_ += (d - jitter_ms_) / 16.0;
+    max_arrival_gap_ms_ = (std::max)(max_arrival_gap_ms_, arrival_delta_ms);
+  }
+  last_arrival_ = now;
+  last_timestamp_ms_ = timestamp_ms;
+
+  int64_t transit_ms = ToMilliseconds(now - connected_time_) - timestamp_ms;
+  min_transit_ms_ = (video_tags_ == 1) ?
+      transit_ms : (std::min)(min_transit_ms_, transit_ms);
+  transits_ms_.emplace_back(transit_ms);
+  if (transits_ms_.size() > kMaxSamples) {
+    transits_ms_.pop_front();
+  }
+
+  if (keyframe == false) {
+    return;
+  }
+  ++keyframes_;
+  if (last_keyframe_timestamp_ms_ >= 0) {
+    int64_t interval_ms = timestamp_ms - last_keyframe_timestamp_ms_;
+    max_keyframe_interval_ms_ =
+        (std::max)(max_keyframe_interval_ms_, interval_ms);
+    keyframe_intervals_ms_.emplace_back(interval_ms);
+    if (keyframe_intervals_ms_.size() > kMaxSamples) {
+      keyframe_intervals_ms_.pop_front();
+    }
+  }
+  last_keyframe_timestamp_ms_ = timestamp_ms;
+}
+
+
+void RtmpIngestServer::Stats::OnAudioTag(uint32_t /*timestamp_ms*/) {
+  std::lock_guard<std::mutex> lock{mutex_};
+  ++audio_tags_;
+}
+
+
+boost::property_tree::ptree RtmpIngestServer::Stats::ToTree() const {
+  std::lock_guard<std::mutex> lock{mutex_};
+
+  double kbps{0.0};
+  if (recent_bytes_.size() >= 2) {
+    double seconds = std::chrono::duration<double>(
+        recent_bytes_.back().first - recent_bytes_.front().first).count();
+    std::size_t bytes{0};
+    for (const auto &elem : recent_bytes_) {
+      bytes += elem.second;
+    }
+    kbps = (seconds > 0) ? bytes * 8 / 1000.0 / seconds : 0.0;
+  }
+
+  int64_t interval_sum{0};
+  for (const auto &interval : keyframe_intervals_ms_) {
+    interval_sum += interval;
+  }
+  boost::property_tree::ptree keyframe_interval;
+  keyframe_interval.put("averageMs", keyframe_intervals_ms_.empty() ?
+      -1.0 : static_cast<double>(interval_sum) / keyframe_intervals_ms_.size());
+  keyframe_interval.put("maxMs", max_keyframe_interval_ms_);
+
+  // the transit above the fastest one; the queueing on the way. the
+  // clocks of the publisher and of this server are never compared as
+  // such, so it is an approximation, of the delay added since the
+  // fastest frame and not of the latency from the capture.
+  int64_t delay_sum{0};
+  int64_t delay_max{0};
+  for (const auto &transit : transits_ms_) {
+    delay_sum += transit - min_transit_ms_;
+    delay_max = (std::max)(delay_max, transit - min_transit_ms_);
+  }
+  boost::property_tree::ptree delay;
+  delay.put("averageMs", transits_ms_.empty() ?
+      -1.0 : static_cast<double>(delay_sum) / transits_ms_.size());
+  delay.put("maxMs", delay_max);
+
+  boost::property_tree::ptree video;
+  video.put("tags", video_tags_);
+  video.put("keyframes", keyframes_);
+  video.add_child("keyframeInterval", keyframe_interval);
+  video.put("jitterMs", jitter_ms_);
+  video.put("maxArrivalGapMs", max_arrival_gap_ms_);
+  video.add_child("delay", delay);
+
+  boost::property_tree::ptree audio;
+  audio.put("tags", audio_tags_);
+
+  boost::property_tree::ptree tree;
+  tree.put("connected", connected_);
+  tree.put("publishing", publishing_);
+  tree.put("streamName", stream_name_);
+  tree.put("bytes", total_bytes_);
+  tree.put("kbps", kbps);
+  tree.add_child("video", video);
+  tree.add_child("audio", audio);
+  return std::move(tree);
+}
+
+
+void RtmpIngestServer::Stats::ClearLocked() {
+  connected_ = false;
+  publishing_ = false;
+  stream_name_.clear();
+  total_bytes_ = 0;
+  recent_bytes_.clear();
+  video_tags_ = 0;
+  audio_tags_ = 0;
+  keyframes_ = 0;
+  last_keyframe_timestamp_ms_ = -1;
+  max_keyframe_interval_ms_ = 0;
+  keyframe_intervals_ms_.clear();
+  last_timestamp_ms_ = 0;
+  jitter_ms_ = 0.0;
+  max_arrival_gap_ms_ = 0;
+  transits_ms_.clear();
+  min_transit_ms_ = 0;
+}
+
+
+RtmpIngestServer *RtmpIngestServer::static_instance{nullptr};
+}  // namespace ncstreamer
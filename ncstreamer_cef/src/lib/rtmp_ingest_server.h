@@ -0,0 +1,113 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#ifndef NCSTREAMER_CEF_SRC_LIB_RTMP_INGEST_SERVER_H_
+#define NCSTREAMER_CEF_SRC_LIB_RTMP_INGEST_SERVER_H_
+
+
+#include <chrono>  // NOLINT
+#include <deque>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
+
+#include "boost/asio/io_service.hpp"
+#include "boost/asio/ip/tcp.hpp"
+#include "boost/property_tree/ptree.hpp"
+
+
+namespace ncstreamer {
+// a local stand-in for the ingest of a streaming service; accepts one
+// publisher at a time, throws the media away and keeps arrival statistics.
+class RtmpIngestServer {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  // port 0 sets up a server which never listens.
+  static void SetUp(uint16_t port);
+  static void ShutDown();
+  static RtmpIngestServer *Get();
+
+  bool IsListening() const;
+  // empty if not listening.
+  std::string GetStreamUrl() const;
+
+  boost::property_tree::ptree ToTree() const;
+
+ private:
+  class Session;
+  class Stats;
+
+  explicit RtmpIngestServer(uint16_t port);
+  virtual ~RtmpIngestServer();
+
+  void Accept();
+
+  static RtmpIngestServer *static_instance;
+
+  const uint16_t port_;
+  bool listening_;
+
+  boost::asio::io_service io_service_;
+  boost::asio::io_service::work io_service_work_;
+  boost::asio::ip::tcp::acceptor acceptor_;
+  std::shared_ptr<Session> session_;
+  std::unique_ptr<Stats> stats_;
+  std::thread io_thread_;
+};
+
+
+class RtmpIngestServer::Stats {
+ public:
+  Stats();
+  virtual ~Stats();
+
+  void OnConnected();
+  void OnPublished(const std::string &stream_name);
+  void OnDisconnected();
+  void OnBytes(std::size_t size);
+  // timestamp_ms is the flv timestamp; the clock of the publisher.
+  void OnVideoTag(uint32_t timestamp_ms, bool keyframe);
+  void OnAudioTag(uint32_t timestamp_ms);
+
+  boost::property_tree::ptree ToTree() const;
+
+ private:
+  static const std::size_t kMaxSamples{300};
+
+  void ClearLocked();
+
+  mutable std::mutex mutex_;
+  bool connected_;
+  bool publishing_;
+  std::string stream_name_;
+  Clock::time_point connected_time_;
+
+  uint64_t total_bytes_;
+  std::deque<std::pair<Clock::time_point, std::size_t>> recent_bytes_;
+
+  uint64_t video_tags_;
+  uint64_t audio_tags_;
+  uint64_t keyframes_;
+  int64_t last_keyframe_timestamp_ms_;
+  int64_t max_keyframe_interval_ms_;
+  std::deque<int64_t> keyframe_intervals_ms_;
+
+  Clock::time_point last_arrival_;
+  int64_t last_timestamp_ms_;
+  double jitter_ms_;
+  int64_t max_arrival_gap_ms_;
+
+  // arrival minus timestamp, by two clocks of different origins; only
+  // its rise above its minimum, the fastest transit seen, tells.
+  std::deque<int64_t> transits_ms_;
+  int64_t min_transit_ms_;
+};
+}  // namespace ncstreamer
+
+
+#endif  // NCSTREAMER_CEF_SRC_LIB_RTMP_INGEST_SERVER_H_
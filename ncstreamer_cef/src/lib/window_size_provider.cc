@@ -0,0 +1,50 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#include "ncstreamer_cef/src/lib/window_size_provider.h"
+
+#include <codecvt>
+#include <locale>
+
+#include "windows.h"  // NOLINT
+
+
+namespace ncstreamer {
+DesktopWindowSizeProvider::DesktopWindowSizeProvider() {
+}
+
+
+DesktopWindowSizeProvider::~DesktopWindowSizeProvider() {
+}
+
+
+bool DesktopWindowSizeProvider::GetClientSize(
+    const std::string &title,
+    const std::string &clazz,
+    Dimension<uint32_t> *size) const {
+  std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
+  std::wstring w_class_name = converter.from_bytes(clazz);
+  std::wstring w_title = converter.from_bytes(title);
+
+  HWND handle = ::FindWindowExW(
+      nullptr, nullptr, w_class_name.c_str(), w_title.c_str());
+  if (handle == NULL) {
+    return false;
+  }
+
+  RECT rect;
+  if (::GetClientRect(handle, &rect) == FALSE) {
+    return false;
+  }
+  uint32_t width = rect.right - rect.left;
+  uint32_t height = rect.bottom - rect.top;
+  if (width == 0 || height == 0) {
+    return false;
+  }
+
+  *size = {width, height};
+  return true;
+}
+}  // namespace ncstreamer
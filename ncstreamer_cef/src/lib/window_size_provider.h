@@ -0,0 +1,44 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#ifndef NCSTREAMER_CEF_SRC_LIB_WINDOW_SIZE_PROVIDER_H_
+#define NCSTREAMER_CEF_SRC_LIB_WINDOW_SIZE_PROVIDER_H_
+
+
+#include <string>
+
+#include "ncstreamer_cef/src/lib/dimension.h"
+
+
+namespace ncstreamer {
+// tells the client size of a top level window; an interface, so that a
+// fake window can stand in for the desktop.
+class WindowSizeProvider {
+ public:
+  virtual ~WindowSizeProvider() {}
+
+  // false if there is no such window, or it has no client area,
+  // as while minimized.
+  virtual bool GetClientSize(
+      const std::string &title,
+      const std::string &clazz,
+      Dimension<uint32_t> *size) const = 0;
+};
+
+
+class DesktopWindowSizeProvider : public WindowSizeProvider {
+ public:
+  DesktopWindowSizeProvider();
+  virtual ~DesktopWindowSizeProvider();
+
+  bool GetClientSize(
+      const std::string &title,
+      const std::string &clazz,
+      Dimension<uint32_t> *size) const override;
+};
+}  // namespace ncstreamer
+
+
+#endif  // NCSTREAMER_CEF_SRC_LIB_WINDOW_SIZE_PROVIDER_H_
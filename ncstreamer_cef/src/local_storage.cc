@@ -32,20 +32,35 @@ LocalStorage *LocalStorage::Get() {
 
 
 std::string LocalStorage::GetUserPage() const {
+  std::lock_guard<std::mutex> lock{mutex_};
   return storage_.get(kUserPage, "");
 }
 
 
 std::string LocalStorage::GetPrivacy() const {
+  std::lock_guard<std::mutex> lock{mutex_};
   return storage_.get(kPrivacy, "");
 }
 
 
 std::string LocalStorage::GetDesignatedUser() const {
+  std::lock_guard<std::mutex> lock{mutex_};
   return storage_.get(kDesignatedUser, "");
 }
 
 
+boost::property_tree::ptree LocalStorage::GetEncoderCapacity() const {
+  std::lock_guard<std::mutex> lock{mutex_};
+  return storage_.get_child(kEncoderCapacity, {});
+}
+
+
+boost::property_tree::ptree LocalStorage::GetBandwidthTest() const {
+  std::lock_guard<std::mutex> lock{mutex_};
+  return storage_.get_child(kBandwidthTest, {});
+}
+
+
 void LocalStorage::SetUserPage(const std::string &user_page) {
   SetValue(kUserPage, user_page);
 }
@@ -61,8 +76,25 @@ void LocalStorage::SetDesignatedUser(const std::string &designated_user) {
 }
 
 
+void LocalStorage::SetEncoderCapacity(
+    const boost::property_tree::ptree &capacity) {
+  std::lock_guard<std::mutex> lock{mutex_};
+  storage_.put_child(kEncoderCapacity, capacity);
+  SaveToFile(storage_, storage_path_);
+}
+
+
+void LocalStorage::SetBandwidthTest(
+    const boost::property_tree::ptree &bandwidth_test) {
+  std::lock_guard<std::mutex> lock{mutex_};
+  storage_.put_child(kBandwidthTest, bandwidth_test);
+  SaveToFile(storage_, storage_path_);
+}
+
+
 LocalStorage::LocalStorage(const std::wstring &storage_path)
     : storage_path_{storage_path},
+      mutex_{},
       storage_{LoadFromFile(storage_path)} {
 }
 
@@ -102,6 +134,7 @@ void LocalStorage::SaveToFile(
 
 template<typename T>
     void LocalStorage::SetValue(const std::string &key, const T &value) {
+  std::lock_guard<std::mutex> lock{mutex_};
   storage_.put(key, value);
   SaveToFile(storage_, storage_path_);
 }
@@ -121,6 +154,8 @@ void LocalStorage::SetValue<bool>(
 const char *LocalStorage::kUserPage{"userPage"};
 const char *LocalStorage::kPrivacy{"privacy"};
 const char *LocalStorage::kDesignatedUser{"designatedUser"};
+const char *LocalStorage::kEncoderCapacity{"encoderCapacity"};
+const char *LocalStorage::kBandwidthTest{"bandwidthTest"};
 
 
 LocalStorage *LocalStorage::static_instance{nullptr};
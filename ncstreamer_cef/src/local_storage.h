@@ -7,6 +7,7 @@
 #define NCSTREAMER_CEF_SRC_LOCAL_STORAGE_H_
 
 
+#include <mutex>  // NOLINT
 #include <string>
 
 #include "boost/property_tree/ptree.hpp"
@@ -22,10 +23,16 @@ class LocalStorage {
   std::string GetUserPage() const;
   std::string GetPrivacy() const;
   std::string GetDesignatedUser() const;
+  // empty if never probed.
+  boost::property_tree::ptree GetEncoderCapacity() const;
+  // empty if never tested.
+  boost::property_tree::ptree GetBandwidthTest() const;
 
   void SetUserPage(const std::string &user_page);
   void SetPrivacy(const std::string &privacy);
   void SetDesignatedUser(const std::string &designated_user);
+  void SetEncoderCapacity(const boost::property_tree::ptree &capacity);
+  void SetBandwidthTest(const boost::property_tree::ptree &bandwidth_test);
 
  private:
   explicit LocalStorage(const std::wstring &storage_path);
@@ -44,10 +51,15 @@ class LocalStorage {
   static const char *kUserPage;
   static const char *kPrivacy;
   static const char *kDesignatedUser;
+  static const char *kEncoderCapacity;
+  static const char *kBandwidthTest;
 
   static LocalStorage *static_instance;
 
   std::wstring storage_path_;
+  // the encoder capacity and the bandwidth test are written from
+  // threads of their own.
+  mutable std::mutex mutex_;
   boost::property_tree::ptree storage_;
 };
 }  // namespace ncstreamer
@@ -4,14 +4,27 @@
 
 
 #include <cassert>
+#include <codecvt>
+#include <fstream>
+#include <iterator>
+#include <locale>
 #include <memory>
+#include <string>
 
 #include "boost/filesystem.hpp"
+#include "boost/property_tree/json_parser.hpp"
 #include "windows.h"  // NOLINT
 
+#include "ncstreamer_cef/src/bandwidth_test.h"
+#include "ncstreamer_cef/src/benchmark.h"
 #include "ncstreamer_cef/src/browser_app.h"
 #include "ncstreamer_cef/src/command_line.h"
 #include "ncstreamer_cef/src/designated_user.h"
+#include "ncstreamer_cef/src/encoder_capacity.h"
+#include "ncstreamer_cef/src/headless_controller.h"
+#include "ncstreamer_cef/src/lib/http_cache.h"
+#include "ncstreamer_cef/src/lib/http_metrics.h"
+#include "ncstreamer_cef/src/lib/rtmp_ingest_server.h"
 #include "ncstreamer_cef/src/lib/window_frame_remover.h"
 #include "ncstreamer_cef/src/lib/windows_types.h"
 #include "ncstreamer_cef/src/local_storage.h"
@@ -20,6 +33,12 @@
 #include "ncstreamer_cef/src/remote_server.h"
 #include "ncstreamer_cef/src/render_app.h"
 #include "ncstreamer_cef/src/streaming_service.h"
+#include "ncstreamer_cef/src/streaming_service/facebook_api.h"
+
+#ifdef NCSTREAMER_HTTP_MOCK
+#include "ncstreamer_cef/src/http_self_test.h"
+#include "ncstreamer_cef/src/lib/http_mock_server.h"
+#endif
 
 
 namespace {
@@ -41,6 +60,183 @@ boost::filesystem::path CreateUserLocalAppDirectory() {
   boost::filesystem::create_directories(app_data_path);
   return app_data_path;
 }
+
+
+void SetUpObs(const ncstreamer::CommandLine &cmd_line) {
+  ncstreamer::Obs::SetUp();
+  ncstreamer::Obs::Get()->UpdateRenditions(
+      ncstreamer::ObsRendition::ParseSpecs(cmd_line.renditions()));
+  ncstreamer::Obs::Get()->UpdateStreamProfile(
+      cmd_line.stream_profile(), cmd_line.measures_latency());
+  ncstreamer::Obs::Get()->UpdateIdleVideoBitrate(cmd_line.idle_bitrate());
+  ncstreamer::Obs::Get()->UpdateLagGuard(
+      cmd_line.guards_lag(), cmd_line.lag_guard_restarts());
+  ncstreamer::Obs::Get()->UpdateAudioFormat(
+      cmd_line.audio_sample_rate(),
+      cmd_line.audio_channels(),
+      cmd_line.audio_bitrate());
+  ncstreamer::Obs::Get()->UpdateReconnectMaxDelay(
+      std::chrono::seconds{cmd_line.reconnect_max_delay()});
+  if (cmd_line.replay_hotkey().empty() == false) {
+    ncstreamer::Obs::Get()->BindReplayBufferHotkey(
+        cmd_line.replay_hotkey(), cmd_line.replay_directory());
+  }
+}
+
+
+#ifdef NCSTREAMER_HTTP_MOCK
+// the routes of the script file go ahead of those of the graph api, so
+// that a script can override any of them.
+void SetUpHttpMockServer(const ncstreamer::CommandLine &cmd_line) {
+  std::string script;
+  if (cmd_line.mock_server_script().empty() == false) {
+    std::ifstream ifs{cmd_line.mock_server_script()};
+    script.assign(
+        std::istreambuf_iterator<char>{ifs}, std::istreambuf_iterator<char>{});
+  }
+  auto routes = ncstreamer::HttpMockServer::ParseScript(script);
+
+  // new live videos stream to the local ingest, if listening.
+  std::string stream_url{
+      ncstreamer::RtmpIngestServer::Get()->GetStreamUrl()};
+  if (stream_url.empty() == true) {
+    stream_url = "rtmp://127.0.0.1:1935/live/mock";
+  }
+  const auto &defaults =
+      ncstreamer::HttpMockServer::GetDefaultRoutes(stream_url);
+  routes.insert(routes.end(), defaults.begin(), defaults.end());
+
+  ncstreamer::HttpMockServer::SetUp(
+      cmd_line.mock_server_port(),
+      routes,
+      cmd_line.mock_server_cert(),
+      cmd_line.mock_server_key());
+}
+#endif
+
+
+// no cef, no browser and no login; only the obs pipeline,
+// the local storage and the remote server.
+int RunHeadless(
+    const ncstreamer::CommandLine &cmd_line,
+    const boost::filesystem::path &app_data_path) {
+  boost::filesystem::path storage_path{};
+  if (cmd_line.in_memory_local_storage() == false) {
+    storage_path = app_data_path / L"local_storage.json";
+  }
+
+  std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
+
+  ncstreamer::LocalStorage::SetUp(storage_path.c_str());
+  ncstreamer::HttpMetrics::SetUp();
+  SetUpObs(cmd_line);
+  ncstreamer::EncoderCapacity::SetUp();
+  ncstreamer::HeadlessController::SetUp(
+      converter.to_bytes(cmd_line.video_quality()));
+  ncstreamer::RtmpIngestServer::SetUp(cmd_line.local_ingest_port());
+  ncstreamer::BandwidthTest::SetUp();
+  ncstreamer::RemoteServer::SetUp(
+      nullptr,
+      cmd_line.remote_port());
+
+  MSG msg;
+  while (::GetMessage(&msg, NULL, 0, 0) > 0) {
+    if (ncstreamer::HeadlessController::RunTask(msg) == true) {
+      continue;
+    }
+    ::TranslateMessage(&msg);
+    ::DispatchMessage(&msg);
+  }
+
+  ncstreamer::RemoteServer::ShutDown();
+  ncstreamer::BandwidthTest::ShutDown();
+  ncstreamer::RtmpIngestServer::ShutDown();
+  ncstreamer::HeadlessController::ShutDown();
+  ncstreamer::EncoderCapacity::ShutDown();
+  ncstreamer::Obs::ShutDown();
+  ncstreamer::HttpMetrics::ShutDown();
+  ncstreamer::LocalStorage::ShutDown();
+
+  return 0;
+}
+
+
+// synthetic sources through the real encoders; writes the report and exits
+// with 0 unless the run has failed.
+int RunBenchmark(
+    const ncstreamer::CommandLine &cmd_line,
+    const boost::filesystem::path &app_data_path) {
+  auto presets = ncstreamer::Benchmark::ParsePresets(
+      cmd_line.benchmark_presets());
+  if (presets.empty() == true) {
+    presets = ncstreamer::Benchmark::GetDefaultPresets();
+  }
+
+  boost::filesystem::path report_path{cmd_line.benchmark_report()};
+  if (report_path.empty() == true) {
+    report_path = app_data_path / L"benchmark.json";
+  }
+
+  SetUpObs(cmd_line);
+  const auto &report = ncstreamer::Benchmark{
+      presets,
+      std::chrono::seconds{cmd_line.benchmark_seconds()}}.Run();
+  ncstreamer::Obs::ShutDown();
+
+  std::ofstream ofs{report_path.c_str()};
+  if (!ofs) {
+    return -1;
+  }
+  boost::property_tree::write_json(ofs, report);
+  return (report.get("error", "").empty() == true) ? 0 : 1;
+}
+
+
+#ifdef NCSTREAMER_HTTP_MOCK
+// the http stack against the mock server; writes the report and exits
+// with 0 only if every check has passed.
+int RunHttpSelfTest(
+    const ncstreamer::CommandLine &cmd_line,
+    const boost::filesystem::path &app_data_path) {
+  static const uint16_t kDefaultPort{18080};
+
+  boost::filesystem::path report_path{cmd_line.http_self_test_report()};
+  if (report_path.empty() == true) {
+    report_path = app_data_path / L"http_self_test.json";
+  }
+
+  ncstreamer::HttpCache::SetUp(L"");
+  ncstreamer::HttpMetrics::SetUp();
+  ncstreamer::HttpMockServer::SetUp(
+      (cmd_line.mock_server_port() == 0) ?
+          kDefaultPort : cmd_line.mock_server_port(),
+      ncstreamer::HttpSelfTest::GetRoutes(),
+      cmd_line.mock_server_cert(),
+      cmd_line.mock_server_key());
+
+  boost::property_tree::ptree report;
+  if (ncstreamer::HttpMockServer::Get()->IsListening() == true) {
+    report = ncstreamer::HttpSelfTest{
+        ncstreamer::HttpMockServer::Get()->GetUri()}.Run();
+  } else {
+    report.put("passed", false);
+    report.put("error", "mock server not listening");
+  }
+  report.add_child("server", ncstreamer::HttpMockServer::Get()->ToTree());
+  report.add_child("metrics", ncstreamer::HttpMetrics::Get()->ToTree());
+
+  ncstreamer::HttpMockServer::ShutDown();
+  ncstreamer::HttpMetrics::ShutDown();
+  ncstreamer::HttpCache::ShutDown();
+
+  std::ofstream ofs{report_path.c_str()};
+  if (!ofs) {
+    return -1;
+  }
+  boost::property_tree::write_json(ofs, report);
+  return (report.get<bool>("passed", false) == true) ? 0 : 1;
+}
+#endif
 }  // unnamed namespace
 
 
@@ -62,6 +258,20 @@ int APIENTRY wWinMain(HINSTANCE instance,
 
   auto app_data_path = CreateUserLocalAppDirectory();
 
+  if (cmd_line.is_headless()) {
+    return RunHeadless(cmd_line, app_data_path);
+  }
+
+  if (cmd_line.is_benchmark()) {
+    return RunBenchmark(cmd_line, app_data_path);
+  }
+
+#ifdef NCSTREAMER_HTTP_MOCK
+  if (cmd_line.is_http_self_test()) {
+    return RunHttpSelfTest(cmd_line, app_data_path);
+  }
+#endif
+
   CefRefPtr<ncstreamer::BrowserApp> browser_app{new ncstreamer::BrowserApp{
       instance,
       cmd_line.hides_settings(),
@@ -79,15 +289,34 @@ int APIENTRY wWinMain(HINSTANCE instance,
 
   ::CefInitialize(CefMainArgs{instance}, settings, browser_app, nullptr);
 
+  if (cmd_line.facebook_api_uri().empty() == false) {
+    ncstreamer::FacebookApi::SetUpServer(
+        ncstreamer::Uri{cmd_line.facebook_api_uri()});
+  }
+
   boost::filesystem::path storage_path{};
+  boost::filesystem::path http_cache_path{};
   if (cmd_line.in_memory_local_storage() == false) {
     storage_path = app_data_path / L"local_storage.json";
+    http_cache_path = app_data_path / L"http_cache.json";
   }
 
   ncstreamer::LocalStorage::SetUp(storage_path.c_str());
+  ncstreamer::HttpCache::SetUp(http_cache_path.c_str());
+  ncstreamer::HttpMetrics::SetUp();
   ncstreamer::WindowFrameRemover::SetUp();
-  ncstreamer::Obs::SetUp();
-  ncstreamer::StreamingService::SetUp();
+  SetUpObs(cmd_line);
+  ncstreamer::EncoderCapacity::SetUp();
+  ncstreamer::RtmpIngestServer::SetUp(cmd_line.local_ingest_port());
+#ifdef NCSTREAMER_HTTP_MOCK
+  SetUpHttpMockServer(cmd_line);
+#endif
+  ncstreamer::BandwidthTest::SetUp();
+  ncstreamer::StreamingService::SetUp(
+      cmd_line.custom_rtmp_url().empty() ?
+          ncstreamer::RtmpIngestServer::Get()->GetStreamUrl() :
+          cmd_line.custom_rtmp_url(),
+      cmd_line.prepares_live_video());
   ncstreamer::RemoteServer::SetUp(
       browser_app,
       cmd_line.remote_port());
@@ -98,8 +327,16 @@ int APIENTRY wWinMain(HINSTANCE instance,
 
   ncstreamer::RemoteServer::ShutDown();
   ncstreamer::StreamingService::ShutDown();
+  ncstreamer::BandwidthTest::ShutDown();
+#ifdef NCSTREAMER_HTTP_MOCK
+  ncstreamer::HttpMockServer::ShutDown();
+#endif
+  ncstreamer::RtmpIngestServer::ShutDown();
+  ncstreamer::EncoderCapacity::ShutDown();
   ncstreamer::Obs::ShutDown();
   ncstreamer::WindowFrameRemover::ShutDown();
+  ncstreamer::HttpMetrics::ShutDown();
+  ncstreamer::HttpCache::ShutDown();
   ncstreamer::LocalStorage::ShutDown();
   ::CefShutdown();
 
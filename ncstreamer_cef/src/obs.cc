@@ -6,13 +6,60 @@
 #include "ncstreamer_cef/src/obs.h"
 
 #include <cassert>
-#include <codecvt>
-
-#include "windows.h"  //NOLINT
+#include <chrono>  // NOLINT
 
+#include "ncstreamer_cef/src/obs/obs_encoder_capacity_probe.h"
+#include "ncstreamer_cef/src/obs/obs_source_info.h"
+#include "ncstreamer_cef/src/obs/obs_synthetic_source.h"
 #include "ncstreamer_cef/src_imported/from_obs_studio_ui/obs-app.hpp"
 
 
+namespace {
+const struct {
+  const char *name;
+  speaker_layout speakers;
+  uint32_t channels;
+} kChannelLayouts[]{
+    {"mono", SPEAKERS_MONO, 1},
+    {"stereo", SPEAKERS_STEREO, 2},
+    {"2.1", SPEAKERS_2POINT1, 3},
+    {"4.0", SPEAKERS_QUAD, 4},
+    {"4.1", SPEAKERS_4POINT1, 5},
+    {"5.1", SPEAKERS_5POINT1, 6},
+    {"7.1", SPEAKERS_7POINT1, 8}};
+
+
+speaker_layout ToSpeakers(const std::string &channels) {
+  for (const auto &layout : kChannelLayouts) {
+    if (channels == layout.name) {
+      return layout.speakers;
+    }
+  }
+  return SPEAKERS_UNKNOWN;
+}
+
+
+speaker_layout ToSpeakers(uint32_t channels) {
+  for (const auto &layout : kChannelLayouts) {
+    if (channels == layout.channels) {
+      return layout.speakers;
+    }
+  }
+  return SPEAKERS_UNKNOWN;
+}
+
+
+std::string ToChannels(speaker_layout speakers) {
+  for (const auto &layout : kChannelLayouts) {
+    if (speakers == layout.speakers) {
+      return layout.name;
+    }
+  }
+  return "";
+}
+}  // unnamed namespace
+
+
 namespace ncstreamer {
 void Obs::SetUp() {
   assert(!static_instance);
@@ -55,20 +102,28 @@ std::vector<std::string> Obs::FindAllWindowsOnDesktop() {
 }
 
 
+std::string Obs::FindSourceByTitle(const std::string &title) {
+  for (const auto &source : FindAllWindowsOnDesktop()) {
+    if (ObsSourceInfo{source}.title() == title) {
+      return source;
+    }
+  }
+  return "";
+}
+
+
 bool Obs::StartStreaming(
     const std::string &source_info,
     const std::string &service_provider,
     const std::string &stream_url,
     const bool &mic,
     const ObsOutput::OnStarted &on_streaming_started) {
-  UpdateBaseResolution(source_info);
-
-  ResetAudio();
-  ResetVideo();
-  obs_encoder_set_audio(audio_encoder_, obs_get_audio());
-  obs_encoder_set_video(video_encoder_, obs_get_video());
-
-  UpdateCurrentSource(source_info, mic);
+  if (IsCapturing() == false) {
+    SetUpCapture(source_info, mic);
+  } else if (source_info != current_source_info_) {
+    // the running recording owns the capture; it can not be switched.
+    return false;
+  }
 
   std::string stream_server;
   std::string stream_key;
@@ -76,17 +131,665 @@ bool Obs::StartStreaming(
   UpdateCurrentService(service_provider, stream_server, stream_key);
   UpdateCurrentServiceEncoders(audio_bitrate_, video_bitrate_);
 
-  return stream_output_->Start(
+  obs_data_t *output_settings = obs_data_create();
+  stream_profile_->ApplyToOutput(output_settings);
+  stream_output_->Update(output_settings);
+  obs_data_release(output_settings);
+
+  bool result = stream_output_->Start(
       audio_encoder_, video_encoder_, current_service_, on_streaming_started);
+  if (result == true) {
+    StartStreamMonitors();
+  }
+  if (result == true && guards_lag_ == true) {
+    {
+      std::lock_guard<std::mutex> lock{step_mutex_};
+      step_cancelled_ = false;
+    }
+    obs_video_info ovi;
+    obs_get_video_info(&ovi);
+    lag_guard_->Start(
+        {ovi.output_width, ovi.output_height},
+        ovi.fps_num / ovi.fps_den,
+        [this](const ObsLagGuard::Step &step, const std::string &reason) {
+      return StepVideoQuality(step, reason);
+    });
+  }
+  return result;
 }
 
 
 void Obs::StopStreaming(
     const ObsOutput::OnStopped &on_streaming_stopped) {
+  // a step in progress gives up its waits, so the guard stops at once.
+  {
+    std::lock_guard<std::mutex> lock{step_mutex_};
+    step_cancelled_ = true;
+  }
+  step_condition_.notify_all();
+  lag_guard_->Stop();
+  StopStreamMonitors(nullptr);
   stream_output_->Stop(on_streaming_stopped);
 }
 
 
+bool Obs::UpdateStreamProfile(
+    const std::string &profile,
+    bool measures_latency) {
+  const ObsStreamProfile *stream_profile = ObsStreamProfile::Find(profile);
+  if (!stream_profile) {
+    return false;
+  }
+  // tune and keyint can not be changed under a running encoder.
+  if (IsCapturing() == true) {
+    return false;
+  }
+
+  stream_profile_ = stream_profile;
+  measures_latency_ = measures_latency;
+  return true;
+}
+
+
+boost::property_tree::ptree Obs::GetLatencyStatus() const {
+  boost::property_tree::ptree tree;
+  tree.put("profile", stream_profile_->name());
+  tree.put("measuring", latency_probe_->IsActive());
+  tree.add_child("encoder", latency_probe_->ToTree());
+
+  // rtmp_output reports its congestion as the duration of the queued
+  // packets over the drop threshold.
+  float congestion = stream_output_->GetCongestion();
+  boost::property_tree::ptree network;
+  network.put("congestion", congestion);
+  network.put("queueMs", congestion * stream_profile_->drop_threshold_ms());
+  network.put("framesDropped", stream_output_->GetFramesDropped());
+  tree.add_child("network", network);
+  return std::move(tree);
+}
+
+
+void Obs::UpdateIdleVideoBitrate(uint32_t idle_bitrate) {
+  idle_video_bitrate_ = idle_bitrate;
+}
+
+
+boost::property_tree::ptree Obs::GetIdleStatus() const {
+  boost::property_tree::ptree tree{frame_change_detector_->ToTree()};
+  tree.put("bitrate", video_bitrate_);
+  tree.put("idleBitrate", idle_video_bitrate_);
+
+  // cbr fills the bits it does not need, so the difference is all saved.
+  double idle_sec = tree.get("idleSec", 0.0);
+  double saved_kbits = (idle_video_bitrate_ == 0) ?
+      0.0 : (video_bitrate_ - static_cast<int>(idle_video_bitrate_)) * idle_sec;
+  tree.put("savedKbits", saved_kbits);
+  return std::move(tree);
+}
+
+
+void Obs::UpdateLagGuard(bool enabled, bool restarts) {
+  guards_lag_ = enabled;
+  lag_guard_restarts_ = restarts;
+}
+
+
+void Obs::SetOnVideoQualityStepped(const OnVideoQualityStepped &on_stepped) {
+  std::lock_guard<std::mutex> lock{on_video_quality_stepped_mutex_};
+  on_video_quality_stepped_ = on_stepped;
+}
+
+
+boost::property_tree::ptree Obs::GetLagGuardStatus() const {
+  boost::property_tree::ptree tree{lag_guard_->ToTree()};
+  tree.put("enabled", guards_lag_);
+  tree.put("restarts", lag_guard_restarts_);
+  return std::move(tree);
+}
+
+
+void Obs::UpdateReconnectMaxDelay(const std::chrono::seconds &max_delay) {
+  const ObsReconnectPolicy reconnect_policy{max_delay};
+  stream_output_->SetReconnectPolicy(reconnect_policy);
+
+  std::lock_guard<std::mutex> lock{simulcast_mutex_};
+  simulcast_reconnect_policy_ = reconnect_policy;
+}
+
+
+void Obs::SetOnStreamingReconnect(
+    const ObsOutput::OnReconnect &on_reconnect) {
+  stream_output_->SetOnReconnect(on_reconnect);
+}
+
+
+boost::property_tree::ptree Obs::GetReconnectStatus() const {
+  return stream_output_->GetReconnectStatus();
+}
+
+
+ObsReconnectPolicy Obs::GetReconnectPolicy() const {
+  std::lock_guard<std::mutex> lock{simulcast_mutex_};
+  return simulcast_reconnect_policy_;
+}
+
+
+bool Obs::UpdateAudioFormat(
+    uint32_t samples_per_sec,
+    const std::string &channels,
+    uint32_t bitrate) {
+  if (samples_per_sec != 0 &&
+      IsSupportedSamplesPerSec(samples_per_sec) == false) {
+    return false;
+  }
+  if (channels != "auto" && ToSpeakers(channels) == SPEAKERS_UNKNOWN) {
+    return false;
+  }
+
+  audio_samples_per_sec_setting_ = samples_per_sec;
+  audio_channels_setting_ = channels;
+  if (bitrate != 0) {
+    audio_bitrate_ = bitrate;
+  }
+  return true;
+}
+
+
+boost::property_tree::ptree Obs::GetAudioStatus() const {
+  static const struct {
+    const char *name;
+    AudioDeviceFormat::Flow flow;
+  } kDevices[]{
+      {"desktop", AudioDeviceFormat::Flow::kRender},
+      {"mic", AudioDeviceFormat::Flow::kCapture}};
+
+  boost::property_tree::ptree devices;
+  for (const auto &device : kDevices) {
+    AudioDeviceFormat format;
+    if (AudioDeviceFormat::GetDefault(device.flow, &format) == false) {
+      continue;
+    }
+    boost::property_tree::ptree tree;
+    tree.put("sampleRate", format.samples_per_sec());
+    tree.put("channels", format.channels());
+    // libobs resamples whatever comes in at another rate.
+    tree.put("resampled", format.samples_per_sec() != audio_samples_per_sec_);
+    devices.add_child(device.name, tree);
+  }
+
+  boost::property_tree::ptree configured;
+  if (audio_samples_per_sec_setting_ == 0) {
+    configured.put("sampleRate", "auto");
+  } else {
+    configured.put("sampleRate", audio_samples_per_sec_setting_);
+  }
+  configured.put("channels", audio_channels_setting_);
+
+  boost::property_tree::ptree tree;
+  tree.put("sampleRate", audio_samples_per_sec_);
+  tree.put("channels", ToChannels(audio_speakers_));
+  tree.put("bitrate", audio_bitrate_);
+  tree.add_child("configured", configured);
+  tree.add_child("devices", devices);
+  return std::move(tree);
+}
+
+
+bool Obs::StartRecording(
+    const std::string &source_info,
+    const bool &mic,
+    const std::string &path,
+    const bool &dedicated_encoder,
+    const ObsRecordingOutput::OnStarted &on_recording_started) {
+  if (recording_output_->IsActive() == true) {
+    return false;
+  }
+
+  // a recording alone captures its own source, and lets it go if it
+  // fails to start.
+  const bool captures = (IsCapturing() == false);
+  if (captures == true) {
+    if (source_info.empty() == true) {
+      return false;
+    }
+    SetUpCapture(source_info, mic);
+    UpdateCurrentServiceEncoders(audio_bitrate_, video_bitrate_);
+  }
+
+  obs_encoder_t *video_encoder{video_encoder_};
+  if (dedicated_encoder == true) {
+    if (!recording_video_encoder_) {
+      recording_video_encoder_ = CreateRecordingVideoEncoder();
+    }
+    if (obs_encoder_active(recording_video_encoder_) == false) {
+      obs_encoder_set_video(recording_video_encoder_, obs_get_video());
+    }
+    video_encoder = recording_video_encoder_;
+  }
+
+  bool result = recording_output_->Start(
+      audio_encoder_, video_encoder, path, on_recording_started);
+  if (result == false && captures == true) {
+    ClearSceneData();
+    current_source_info_.clear();
+  }
+  return result;
+}
+
+
+void Obs::StopRecording(
+    const ObsRecordingOutput::OnStopped &on_recording_stopped) {
+  recording_output_->Stop(on_recording_stopped);
+}
+
+
+bool Obs::StartSimulcast(
+    const std::string &destination,
+    const std::string &source_info,
+    const bool &mic,
+    const std::string &service_provider,
+    const std::string &stream_url,
+    const std::string &rendition,
+    const ObsReconnectPolicy &reconnect_policy,
+    const ObsOutput::OnStarted &on_simulcast_started) {
+  bool capturing = IsCapturing();
+
+  std::lock_guard<std::mutex> lock{simulcast_mutex_};
+
+  auto i = simulcast_destinations_.find(destination);
+  if (i != simulcast_destinations_.end() && i->second->IsActive() == true) {
+    return false;
+  }
+
+  ObsRendition *obs_rendition{nullptr};
+  if (rendition.empty() == false) {
+    auto rendition_i = renditions_.find(rendition);
+    if (rendition_i == renditions_.end()) {
+      return false;
+    }
+    obs_rendition = rendition_i->second.get();
+  }
+
+  if (capturing == false) {
+    if (source_info.empty() == true) {
+      return false;
+    }
+    SetUpCapture(source_info, mic);
+    UpdateCurrentServiceEncoders(audio_bitrate_, video_bitrate_);
+  }
+
+  std::string stream_server;
+  std::string stream_key;
+  std::tie(stream_server, stream_key) = SplitStreamUrl(stream_url);
+
+  // the shared encoders keep the settings of the main service;
+  // a destination never reconfigures them under the other outputs.
+  obs_service_t *service = CreateService(
+      "simulcast_service_" + destination,
+      service_provider,
+      stream_server,
+      stream_key);
+
+  obs_encoder_t *video_encoder{video_encoder_};
+  if (obs_rendition) {
+    obs_rendition->Prepare();
+    if (obs_encoder_active(obs_rendition->video_encoder()) == false) {
+      // the cost is measured on the cpu of the whole process, so two
+      // renditions starting in the window of each other spoil both.
+      bool overlapped{false};
+      for (const auto &elem : renditions_) {
+        if (elem.second.get() != obs_rendition &&
+            elem.second->IsMeasuring() == true) {
+          elem.second->MarkOverlapped();
+          overlapped = true;
+        }
+      }
+      obs_rendition->MarkStarted(cpu_usage_);
+      if (overlapped == true) {
+        obs_rendition->MarkOverlapped();
+      }
+    }
+    video_encoder = obs_rendition->video_encoder();
+  }
+
+  std::unique_ptr<ObsStreamDestination> stream_destination{
+      new ObsStreamDestination{
+          destination,
+          service_provider,
+          rendition,
+          service,
+          reconnect_policy,
+          [this](const boost::property_tree::ptree &event) {
+        NotifySimulcastEvent(event);
+      }}};
+  bool result = stream_destination->Start(
+      audio_encoder_, video_encoder, on_simulcast_started);
+  simulcast_destinations_[destination] = std::move(stream_destination);
+  return result;
+}
+
+
+bool Obs::StopSimulcast(
+    const std::string &destination,
+    const ObsOutput::OnStopped &on_simulcast_stopped) {
+  std::lock_guard<std::mutex> lock{simulcast_mutex_};
+
+  auto i = simulcast_destinations_.find(destination);
+  if (i == simulcast_destinations_.end() || i->second->IsActive() == false) {
+    return false;
+  }
+  i->second->Stop(on_simulcast_stopped);
+  return true;
+}
+
+
+std::vector<boost::property_tree::ptree> Obs::GetSimulcastStatus() const {
+  std::vector<boost::property_tree::ptree> status;
+
+  std::lock_guard<std::mutex> lock{simulcast_mutex_};
+  for (const auto &elem : simulcast_destinations_) {
+    status.emplace_back(elem.second->ToTree());
+  }
+  return status;
+}
+
+
+void Obs::SetOnSimulcastEvent(
+    const ObsStreamDestination::OnEvent &on_event) {
+  std::lock_guard<std::mutex> lock{on_simulcast_event_mutex_};
+  on_simulcast_event_ = on_event;
+}
+
+
+bool Obs::UpdateRenditions(const std::vector<ObsRendition::Spec> &specs) {
+  std::lock_guard<std::mutex> lock{simulcast_mutex_};
+
+  for (const auto &elem : renditions_) {
+    if (obs_encoder_active(elem.second->video_encoder()) == true) {
+      return false;
+    }
+  }
+
+  renditions_.clear();
+  for (const auto &spec : specs) {
+    renditions_.emplace(
+        spec.name(), std::unique_ptr<ObsRendition>{new ObsRendition{spec}});
+  }
+  return true;
+}
+
+
+std::vector<boost::property_tree::ptree> Obs::GetRenditionStatus() const {
+  std::vector<boost::property_tree::ptree> status;
+
+  std::lock_guard<std::mutex> lock{simulcast_mutex_};
+  for (const auto &elem : renditions_) {
+    status.emplace_back(elem.second->ToTree(cpu_usage_));
+  }
+  return status;
+}
+
+
+double Obs::GetCpuUsage() const {
+  static const std::chrono::seconds kRecentDuration{3};
+
+  return cpu_usage_.GetRecentAverage(kRecentDuration);
+}
+
+
+bool Obs::StartBenchmark(
+    const std::string &pattern,
+    const std::string &signal,
+    uint32_t audio_samples_per_sec,
+    uint32_t tone_samples_per_sec) {
+  if (IsCapturing() == true) {
+    return false;
+  }
+  if (audio_samples_per_sec != 0 &&
+      IsSupportedSamplesPerSec(audio_samples_per_sec) == false) {
+    return false;
+  }
+  ClearSceneData();
+
+  // no scaling; the encoder gets the synthetic frames as they are.
+  base_size_ = output_size_;
+  // the next capture resets the audio to the format configured.
+  uint32_t audio_samples_per_sec_setting = audio_samples_per_sec_setting_;
+  if (audio_samples_per_sec != 0) {
+    audio_samples_per_sec_setting_ = audio_samples_per_sec;
+  }
+  ResetCapture();
+  audio_samples_per_sec_setting_ = audio_samples_per_sec_setting;
+  UpdateCurrentServiceEncoders(audio_bitrate_, video_bitrate_);
+  current_source_info_.clear();
+
+  obs_source_t *video_source =
+      ObsSyntheticSource::CreateVideoSource(output_size_, fps_, pattern);
+  obs_set_output_source(0, video_source);
+  obs_source_release(video_source);
+
+  obs_source_t *audio_source =
+      ObsSyntheticSource::CreateAudioSource(signal, tone_samples_per_sec);
+  obs_set_output_source(1, audio_source);
+  obs_source_release(audio_source);
+
+  if (latency_probe_->Start(audio_encoder_, video_encoder_) == false) {
+    ClearSceneData();
+    return false;
+  }
+  return true;
+}
+
+
+void Obs::StopBenchmark() {
+  latency_probe_->Stop(nullptr);
+  ClearSceneData();
+}
+
+
+bool Obs::IsBenchmarking() const {
+  return latency_probe_->IsActive() && !stream_output_->IsActive();
+}
+
+
+boost::property_tree::ptree Obs::GetBenchmarkStatus() const {
+  video_t *video = obs_get_video();
+
+  boost::property_tree::ptree frames;
+  frames.put("total", video_output_get_total_frames(video));
+  frames.put("skipped", video_output_get_skipped_frames(video));
+  frames.put("lagged", obs_get_lagged_frames());
+
+  boost::property_tree::ptree tree;
+  tree.add_child("encoder", latency_probe_->ToTree());
+  tree.add_child("frames", frames);
+  tree.put("cpu", GetCpuUsage());
+  return std::move(tree);
+}
+
+
+bool Obs::StartBandwidthTest(
+    const std::string &service_provider,
+    const std::string &stream_url,
+    uint32_t bitrate) {
+  if (IsCapturing() == true) {
+    return false;
+  }
+  ClearSceneData();
+
+  base_size_ = output_size_;
+  ResetCapture();
+  current_source_info_.clear();
+
+  // noise leaves cbr nothing to save, so the bitrate is all sent.
+  obs_source_t *video_source =
+      ObsSyntheticSource::CreateVideoSource(output_size_, fps_, "noise");
+  obs_set_output_source(0, video_source);
+  obs_source_release(video_source);
+
+  obs_source_t *audio_source = ObsSyntheticSource::CreateAudioSource("tone", 0);
+  obs_set_output_source(1, audio_source);
+  obs_source_release(audio_source);
+
+  // the test takes the place of the current service until it stops.
+  service_saved_ = true;
+  saved_service_ = current_service_;
+  current_service_ = nullptr;
+
+  std::string stream_server;
+  std::string stream_key;
+  std::tie(stream_server, stream_key) = SplitStreamUrl(stream_url);
+  UpdateCurrentService(service_provider, stream_server, stream_key);
+  UpdateCurrentServiceEncoders(audio_bitrate_, bitrate);
+
+  bool result = bandwidth_test_output_->Start(
+      audio_encoder_, video_encoder_, current_service_, []() {});
+  if (result == false) {
+    ClearSceneData();
+    RestoreCurrentService();
+    UpdateCurrentServiceEncoders(audio_bitrate_, video_bitrate_);
+  }
+  return result;
+}
+
+
+void Obs::UpdateBandwidthTestBitrate(uint32_t bitrate) {
+  UpdateCurrentServiceEncoders(audio_bitrate_, bitrate);
+}
+
+
+void Obs::StopBandwidthTest(const ObsOutput::OnStopped &on_stopped) {
+  // the next capture resets the video, which fails under an active
+  // output; so the scene is cleared once the output has stopped.
+  const ObsOutput::OnStopped on_output_stopped = [this, on_stopped]() {
+    ClearSceneData();
+    RestoreCurrentService();
+    UpdateCurrentServiceEncoders(audio_bitrate_, video_bitrate_);
+    if (on_stopped) {
+      on_stopped();
+    }
+  };
+
+  // a test which failed to connect has no stop to signal.
+  if (bandwidth_test_output_->IsActive() == false) {
+    on_output_stopped();
+    return;
+  }
+  bandwidth_test_output_->Stop(on_output_stopped);
+}
+
+
+bool Obs::IsBandwidthTesting() const {
+  return bandwidth_test_output_->IsActive();
+}
+
+
+boost::property_tree::ptree Obs::GetBandwidthTestStatus() const {
+  boost::property_tree::ptree tree;
+  tree.put("active", bandwidth_test_output_->IsActive());
+  tree.put("totalBytes", bandwidth_test_output_->GetTotalBytes());
+  tree.put("totalFrames", bandwidth_test_output_->GetTotalFrames());
+  tree.put("framesDropped", bandwidth_test_output_->GetFramesDropped());
+  tree.put("congestion", bandwidth_test_output_->GetCongestion());
+  tree.put("lastStopCode", bandwidth_test_output_->last_stop_code());
+  tree.put("audioBitrate", audio_bitrate_);
+  return std::move(tree);
+}
+
+
+bool Obs::StartReplayBuffer(
+    const std::string &source_info,
+    const bool &mic,
+    int64_t max_duration_usec,
+    std::size_t max_bytes) {
+  if (replay_buffer_->IsActive() == true) {
+    return false;
+  }
+
+  if (IsCapturing() == false) {
+    if (source_info.empty() == true) {
+      return false;
+    }
+    SetUpCapture(source_info, mic);
+    UpdateCurrentServiceEncoders(audio_bitrate_, video_bitrate_);
+  }
+
+  // no encoder of its own; it keeps what the stream already encoded.
+  return replay_buffer_->Start(
+      audio_encoder_, video_encoder_, max_duration_usec, max_bytes);
+}
+
+
+void Obs::StopReplayBuffer() {
+  replay_buffer_->Stop();
+}
+
+
+bool Obs::SaveReplayBuffer(
+    const std::string &path,
+    const ObsReplayBuffer::OnSaved &on_replay_saved) {
+  return replay_buffer_->Save(path, on_replay_saved);
+}
+
+
+void Obs::BindReplayBufferHotkey(
+    const std::string &keys,
+    const std::string &directory) {
+  replay_buffer_->BindSaveHotkey(keys, directory);
+}
+
+
+bool Obs::IsReplayBuffering() const {
+  return replay_buffer_->IsActive();
+}
+
+
+boost::property_tree::ptree Obs::GetReplayBufferStatus() const {
+  return replay_buffer_->ToTree();
+}
+
+
+// an rtmp output is not active to libobs until it has connected, but
+// it holds the capture from its start.
+bool Obs::IsCapturing() const {
+  if (stream_output_->IsActive() ||
+      stream_output_->IsStarting() ||
+      bandwidth_test_output_->IsActive() ||
+      bandwidth_test_output_->IsStarting() ||
+      recording_output_->IsActive() ||
+      replay_buffer_->IsActive() ||
+      latency_probe_->IsActive()) {
+    return true;
+  }
+
+  std::lock_guard<std::mutex> lock{simulcast_mutex_};
+  for (const auto &elem : simulcast_destinations_) {
+    if (elem.second->IsActive() == true ||
+        elem.second->IsStarting() == true) {
+      return true;
+    }
+  }
+  return false;
+}
+
+
+void Obs::SetOnCaptureStarting(
+    const OnCaptureStarting &on_capture_starting) {
+  std::lock_guard<std::mutex> lock{on_capture_starting_mutex_};
+  on_capture_starting_ = on_capture_starting;
+}
+
+
+bool Obs::IsRecording() const {
+  return recording_output_->IsActive();
+}
+
+
+std::string Obs::GetRecordingPath() const {
+  return recording_output_->path();
+}
+
+
 void Obs::TurnOnMic() {
   obs_source_t *video_source = obs_get_output_source(0);
   if (!video_source)
@@ -94,6 +797,7 @@ void Obs::TurnOnMic() {
 
   obs_data_t *settings = obs_data_create();
   obs_data_set_string(settings, "device_id", "default");
+  stream_profile_->ApplyToAudioSource(settings);
 
   obs_source_t *source = obs_source_create(
       "wasapi_input_capture", "Mic/Aux", settings, nullptr);
@@ -125,13 +829,16 @@ void Obs::UpdateCurrentServiceEncoders(
   obs_data_t *video_settings = obs_data_create();
   obs_data_set_string(video_settings, "rate_control", "CBR");
   obs_data_set_int(video_settings, "bitrate", video_bitrate);
+  stream_profile_->ApplyToVideoEncoder(video_settings);
 
   obs_data_t *audio_settings = obs_data_create();
   obs_data_set_string(audio_settings, "rate_control", "CBR");
   obs_data_set_int(audio_settings, "bitrate", audio_bitrate);
 
-  obs_service_apply_encoder_settings(
-      current_service_, video_settings, audio_settings);
+  if (current_service_) {
+    obs_service_apply_encoder_settings(
+        current_service_, video_settings, audio_settings);
+  }
 
   video_t *video = obs_get_video();
   enum video_format format = video_output_get_format(video);
@@ -153,8 +860,47 @@ Obs::Obs()
       audio_encoder_{nullptr},
       video_encoder_{nullptr},
       stream_output_{},
+      bandwidth_test_output_{},
+      stream_profile_{&ObsStreamProfile::GetDefault()},
+      measures_latency_{false},
+      latency_probe_{},
+      frame_change_detector_{new ObsFrameChangeDetector{}},
+      idle_video_bitrate_{0},
+      lag_guard_{new ObsLagGuard{}},
+      guards_lag_{false},
+      lag_guard_restarts_{false},
+      step_mutex_{},
+      step_condition_{},
+      step_generation_{0},
+      step_stops_pending_{0},
+      step_started_{false},
+      step_cancelled_{false},
+      on_video_quality_stepped_mutex_{},
+      on_video_quality_stepped_{},
+      on_capture_starting_mutex_{},
+      on_capture_starting_{},
+      recording_video_encoder_{nullptr},
+      recording_output_{},
+      replay_buffer_{},
+      current_source_info_{},
+      window_size_provider_{new DesktopWindowSizeProvider{}},
+      capture_scene_{nullptr},
+      capture_item_{nullptr},
+      simulcast_mutex_{},
+      simulcast_destinations_{},
+      simulcast_reconnect_policy_{},
+      on_simulcast_event_mutex_{},
+      on_simulcast_event_{},
+      renditions_{},
+      cpu_usage_{},
       current_service_{nullptr},
+      service_saved_{false},
+      saved_service_{nullptr},
       audio_bitrate_{160},
+      audio_samples_per_sec_setting_{0},
+      audio_channels_setting_{"stereo"},
+      audio_samples_per_sec_{44100},
+      audio_speakers_{SPEAKERS_STEREO},
       video_bitrate_{2500},
       base_size_{1920, 1080},
       output_size_{1280, 720},
@@ -162,23 +908,52 @@ Obs::Obs()
   SetUpLog();
   obs_startup("en-US", nullptr, nullptr);
   obs_load_all_modules();
+  ObsReplayBuffer::RegisterOutputType();
+  ObsLatencyProbe::RegisterOutputType();
+  ObsEncoderCapacityProbe::RegisterOutputType();
+  ObsSyntheticSource::RegisterSourceTypes();
   obs_log_loaded_modules();
 
   audio_encoder_ = CreateAudioEncoder();
   video_encoder_ = CreateVideoEncoder();
 
   stream_output_.reset(new ObsOutput{});
+  // a failed test is a result; it does not try again.
+  bandwidth_test_output_.reset(new ObsOutput{
+      "bandwidth_test",
+      ObsReconnectPolicy{
+          std::chrono::milliseconds::zero(),
+          std::chrono::milliseconds::zero(),
+          std::chrono::milliseconds::zero(),
+          0}});
+  recording_output_.reset(new ObsRecordingOutput{});
+  replay_buffer_.reset(new ObsReplayBuffer{});
+  latency_probe_.reset(new ObsLatencyProbe{});
 
   ResetAudio();
-  ResetVideo();
+  ResetVideo(output_size_, fps_);
 }
 
 
 Obs::~Obs() {
+  lag_guard_.reset();
   ReleaseCurrentService();
+  if (saved_service_) {
+    obs_service_release(saved_service_);
+  }
   ClearSceneData();
 
+  simulcast_destinations_.clear();
+  renditions_.clear();
+  replay_buffer_.reset();
+  recording_output_.reset();
+  frame_change_detector_.reset();
+  latency_probe_.reset();
+  bandwidth_test_output_.reset();
   stream_output_.reset();
+  if (recording_video_encoder_) {
+    obs_encoder_release(recording_video_encoder_);
+  }
   obs_encoder_release(video_encoder_);
   obs_encoder_release(audio_encoder_);
 
@@ -194,6 +969,12 @@ std::tuple<std::string /*server*/, std::string /*key*/>
 }
 
 
+bool Obs::IsSupportedSamplesPerSec(uint32_t samples_per_sec) {
+  // what the aac encoder and the streaming services take.
+  return samples_per_sec == 44100 || samples_per_sec == 48000;
+}
+
+
 bool Obs::SetUpLog() {
   bool dir_created = obs_app::MakeUserDirs();
   if (dir_created == false) {
@@ -206,23 +987,49 @@ bool Obs::SetUpLog() {
 
 
 void Obs::ResetAudio() {
+  static const uint32_t kDefaultSamplesPerSec{44100};
+
+  AudioDeviceFormat device;
+  bool detected = AudioDeviceFormat::GetDefault(
+      AudioDeviceFormat::Flow::kRender, &device);
+
+  uint32_t samples_per_sec = audio_samples_per_sec_setting_;
+  if (samples_per_sec == 0) {
+    samples_per_sec = (detected == true &&
+        IsSupportedSamplesPerSec(device.samples_per_sec()) == true) ?
+            device.samples_per_sec() : kDefaultSamplesPerSec;
+  }
+
+  speaker_layout speakers = ToSpeakers(audio_channels_setting_);
+  if (speakers == SPEAKERS_UNKNOWN && detected == true) {
+    speakers = ToSpeakers(device.channels());
+  }
+  if (speakers == SPEAKERS_UNKNOWN) {
+    speakers = SPEAKERS_STEREO;
+  }
+
   struct obs_audio_info ai;
-  ai.samples_per_sec = 44100;
-  ai.speakers = SPEAKERS_STEREO;
+  ai.samples_per_sec = samples_per_sec;
+  ai.speakers = speakers;
 
   obs_reset_audio(&ai);
+  audio_samples_per_sec_ = samples_per_sec;
+  audio_speakers_ = speakers;
+  blog(LOG_INFO, "audio: %u Hz, %s; the desktop device at %u Hz.",
+      samples_per_sec, ToChannels(speakers).c_str(),
+      device.samples_per_sec());
 }
 
 
-void Obs::ResetVideo() {
+void Obs::ResetVideo(const Dimension<uint32_t> &output_size, uint32_t fps) {
   struct obs_video_info ovi;
-  ovi.fps_num = fps_;
+  ovi.fps_num = fps;
   ovi.fps_den = 1;
   ovi.graphics_module = "libobs-d3d11.dll";
   ovi.base_width = base_size_.width();
   ovi.base_height = base_size_.height();
-  ovi.output_width = output_size_.width();
-  ovi.output_height = output_size_.height();
+  ovi.output_width = output_size.width();
+  ovi.output_height = output_size.height();
   ovi.output_format = VIDEO_FORMAT_NV12;
   ovi.colorspace = VIDEO_CS_601;
   ovi.range = VIDEO_RANGE_PARTIAL;
@@ -246,10 +1053,61 @@ obs_encoder_t *Obs::CreateVideoEncoder() {
 }
 
 
+obs_encoder_t *Obs::CreateRecordingVideoEncoder() {
+  obs_data_t *settings = obs_data_create();
+  obs_data_set_string(settings, "rate_control", "CRF");
+  obs_data_set_int(settings, "crf", 18);
+  obs_data_set_string(settings, "preset", "veryfast");
+
+  obs_encoder_t *encoder = obs_video_encoder_create(
+      "obs_x264", "simple_h264_recording", settings, nullptr);
+  obs_data_release(settings);
+  return encoder;
+}
+
+
 void Obs::ClearSceneData() {
   obs_set_output_source(3, nullptr);
   obs_set_output_source(1, nullptr);
   obs_set_output_source(0, nullptr);
+
+  if (capture_scene_) {
+    obs_scene_release(capture_scene_);
+    capture_scene_ = nullptr;
+    capture_item_ = nullptr;
+  }
+}
+
+
+void Obs::SetUpCapture(const std::string &source_info,
+                       const bool &mic) {
+  UpdateBaseResolution(source_info);
+  ResetCapture();
+
+  UpdateCurrentSource(source_info, mic);
+  current_source_info_ = source_info;
+}
+
+
+void Obs::ResetCapture() {
+  OnCaptureStarting on_capture_starting;
+  {
+    std::lock_guard<std::mutex> lock{on_capture_starting_mutex_};
+    on_capture_starting = on_capture_starting_;
+  }
+  if (on_capture_starting) {
+    on_capture_starting();
+  }
+
+  ResetCapture(output_size_, fps_);
+}
+
+
+void Obs::ResetCapture(const Dimension<uint32_t> &output_size, uint32_t fps) {
+  ResetAudio();
+  ResetVideo(output_size, fps);
+  obs_encoder_set_audio(audio_encoder_, obs_get_audio());
+  obs_encoder_set_video(video_encoder_, obs_get_video());
 }
 
 
@@ -264,14 +1122,28 @@ void Obs::UpdateCurrentSource(const std::string &source_info,
         "window_capture", "Window Capture", settings, nullptr);
     obs_data_release(settings);
 
-    obs_set_output_source(0, source);
+    obs_scene_t *scene = obs_scene_create_private("Capture");
+    obs_sceneitem_t *item = obs_scene_add(scene, source);
     obs_source_release(source);
+
+    obs_scene_t *released = capture_scene_;
+    capture_scene_ = scene;
+    capture_item_ = item;
+    // before the scene is rendered, so that the item is never set
+    // under the graphics thread.
+    FitCaptureItem();
+
+    obs_set_output_source(0, obs_scene_get_source(scene));
+    if (released) {
+      obs_scene_release(released);
+    }
   }
 
   // audio
   {
     obs_data_t *settings = obs_data_create();
     obs_data_set_string(settings, "device_id", "default");
+    stream_profile_->ApplyToAudioSource(settings);
 
     obs_source_t *source = obs_source_create(
         "wasapi_output_capture", "Desktop Audio", settings, nullptr);
@@ -288,21 +1160,35 @@ void Obs::UpdateCurrentSource(const std::string &source_info,
 }
 
 
-void Obs::UpdateCurrentService(
+obs_service_t *Obs::CreateService(
+    const std::string &service_name,
     const std::string &service_provider,
     const std::string &stream_server,
     const std::string &stream_key) {
-  ReleaseCurrentService();
-
   obs_data_t *settings = obs_data_create();
   obs_data_set_string(settings, "service", service_provider.c_str());
   obs_data_set_string(settings, "server", stream_server.c_str());
   obs_data_set_string(settings, "key", stream_key.c_str());
   obs_data_set_bool(settings, "show_all", false);
 
-  current_service_ = obs_service_create(
-      "rtmp_common", "default_service", settings, nullptr);
+  // rtmp_common only knows the services of its own list.
+  const char *service_id = (service_provider == "Custom RTMP") ?
+      "rtmp_custom" : "rtmp_common";
+  obs_service_t *service = obs_service_create(
+      service_id, service_name.c_str(), settings, nullptr);
   obs_data_release(settings);
+  return service;
+}
+
+
+void Obs::UpdateCurrentService(
+    const std::string &service_provider,
+    const std::string &stream_server,
+    const std::string &stream_key) {
+  ReleaseCurrentService();
+
+  current_service_ = CreateService(
+      "default_service", service_provider, stream_server, stream_key);
 }
 
 
@@ -315,6 +1201,17 @@ void Obs::ReleaseCurrentService() {
 }
 
 
+void Obs::RestoreCurrentService() {
+  if (service_saved_ == false) {
+    return;
+  }
+  ReleaseCurrentService();
+  current_service_ = saved_service_;
+  service_saved_ = false;
+  saved_service_ = nullptr;
+}
+
+
 void Obs::UpdateBaseResolution(const std::string &source_info) {
   std::string title_class = source_info.substr(
     0, source_info.find_last_of(":"));
@@ -322,17 +1219,223 @@ void Obs::UpdateBaseResolution(const std::string &source_info) {
     title_class.find_last_of(":") + 1, title_class.length());
   std::string title = title_class.substr(0, title_class.find_last_of(":"));
 
-  std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
-  std::wstring w_class_name = converter.from_bytes(class_name);
-  std::wstring w_title = converter.from_bytes(title);
-
-  HWND handle = ::FindWindowExW(
-    nullptr, nullptr, w_class_name.c_str(), w_title.c_str());
-  RECT rect;
-  GetClientRect(handle, &rect);
-  uint32_t width = rect.right - rect.left;
-  uint32_t height = rect.bottom - rect.top;
-  base_size_ = {width, height};
+  // the last size stays if the window has none to tell.
+  window_size_provider_->GetClientSize(title, class_name, &base_size_);
+}
+
+
+void Obs::FitCaptureItem() {
+  if (!capture_item_) {
+    return;
+  }
+
+  // the canvas keeps its size under the outputs; the window is scaled
+  // into it, keeping its aspect, and centered.
+  obs_video_info ovi;
+  if (obs_get_video_info(&ovi) == false) {
+    return;
+  }
+  vec2 bounds;
+  vec2_set(&bounds,
+           static_cast<float>(ovi.base_width),
+           static_cast<float>(ovi.base_height));
+  obs_sceneitem_set_bounds_type(capture_item_, OBS_BOUNDS_SCALE_INNER);
+  obs_sceneitem_set_bounds_alignment(capture_item_, OBS_ALIGN_CENTER);
+  obs_sceneitem_set_bounds(capture_item_, &bounds);
+
+  blog(LOG_INFO, "capture: %ux%u into the canvas of %ux%u.",
+       base_size_.width(), base_size_.height(),
+       ovi.base_width, ovi.base_height);
+}
+
+
+void Obs::ApplyIdleVideoBitrate(bool idle) {
+  // obs_x264 reconfigures the bitrate on the fly; the keyframe interval
+  // and everything else stay as they are.
+  obs_data_t *settings = obs_data_create();
+  obs_data_set_int(settings, "bitrate",
+      idle ? idle_video_bitrate_ : video_bitrate_);
+  obs_encoder_update(video_encoder_, settings);
+  obs_data_release(settings);
+}
+
+
+void Obs::StartStreamMonitors() {
+  if (measures_latency_ == true) {
+    latency_probe_->Start(audio_encoder_, video_encoder_);
+  }
+  if (idle_video_bitrate_ != 0 &&
+      idle_video_bitrate_ < static_cast<uint32_t>(video_bitrate_)) {
+    obs_video_info ovi;
+    obs_get_video_info(&ovi);
+    frame_change_detector_->Start(
+        {ovi.output_width, ovi.output_height},
+        ovi.fps_num / ovi.fps_den,
+        &cpu_usage_,
+        [this](bool idle) {
+      ApplyIdleVideoBitrate(idle);
+    });
+  }
+}
+
+
+void Obs::StopStreamMonitors(const ObsLatencyProbe::OnStopped &on_stopped) {
+  frame_change_detector_->Stop();
+  latency_probe_->Stop(on_stopped);
+}
+
+
+bool Obs::StepVideoQuality(
+    const ObsLagGuard::Step &step,
+    const std::string &reason) {
+  static const std::chrono::seconds kStopTimeout{5};
+  // rtmp takes its time to connect.
+  static const std::chrono::seconds kRestartTimeout{20};
+
+  if (lag_guard_restarts_ == false) {
+    NotifyVideoQualityStepped(step, reason, false, "");
+    return false;
+  }
+
+  // libobs resets the video only with no output on it, so the stream
+  // restarts; the other outputs would stop along with it.
+  if (stream_output_->IsActive() == false ||
+      recording_output_->IsActive() == true ||
+      replay_buffer_->IsActive() == true) {
+    return false;
+  }
+  {
+    std::lock_guard<std::mutex> lock{simulcast_mutex_};
+    for (const auto &elem : simulcast_destinations_) {
+      if (elem.second->IsActive() == true) {
+        return false;
+      }
+    }
+  }
+
+  uint32_t generation{0};
+  {
+    std::lock_guard<std::mutex> lock{step_mutex_};
+    if (step_cancelled_ == true) {
+      return false;
+    }
+    generation = ++step_generation_;
+    step_stops_pending_ = 2;  // the stream and the latency probe.
+    step_started_ = false;
+  }
+
+  blog(LOG_INFO, "lag guard: stepping to %s (%s).",
+       step.name().c_str(), reason.c_str());
+
+  // a callback of an earlier step counts nothing.
+  auto on_stopped = [this, generation]() {
+    {
+      std::lock_guard<std::mutex> lock{step_mutex_};
+      if (generation != step_generation_ || step_stops_pending_ == 0) {
+        return;
+      }
+      --step_stops_pending_;
+    }
+    step_condition_.notify_all();
+  };
+  StopStreamMonitors(on_stopped);
+  stream_output_->Stop(on_stopped);
+  {
+    std::unique_lock<std::mutex> lock{step_mutex_};
+    bool stopped = step_condition_.wait_for(lock, kStopTimeout, [this]() {
+      return step_cancelled_ || step_stops_pending_ == 0;
+    });
+    if (step_cancelled_ == true) {
+      return false;
+    }
+    if (stopped == false) {
+      lock.unlock();
+      blog(LOG_WARNING, "lag guard: the stream did not stop.");
+      stream_output_->GiveUp("lagGuard");
+      NotifyVideoQualityStepped(step, reason, false, "stop");
+      return false;
+    }
+  }
+
+  // the quality of the user stays for the next streaming.
+  ResetCapture(step.output_size(), step.fps());
+  UpdateCurrentServiceEncoders(audio_bitrate_, video_bitrate_);
+
+  {
+    std::lock_guard<std::mutex> lock{step_mutex_};
+    if (step_cancelled_ == true) {
+      return false;
+    }
+  }
+  bool restarted = stream_output_->Start(
+      audio_encoder_, video_encoder_, current_service_,
+      [this, generation]() {
+    {
+      std::lock_guard<std::mutex> lock{step_mutex_};
+      if (generation != step_generation_) {
+        return;
+      }
+      step_started_ = true;
+    }
+    step_condition_.notify_all();
+  });
+  if (restarted == true) {
+    std::unique_lock<std::mutex> lock{step_mutex_};
+    restarted = step_condition_.wait_for(lock, kRestartTimeout, [this]() {
+      return step_cancelled_ || step_started_;
+    });
+    if (step_cancelled_ == true) {
+      return false;
+    }
+  }
+  if (restarted == false) {
+    blog(LOG_WARNING, "lag guard: the stream did not restart.");
+    stream_output_->Stop(nullptr);
+    stream_output_->GiveUp("lagGuard");
+    NotifyVideoQualityStepped(step, reason, true, "restart");
+    return false;
+  }
+
+  StartStreamMonitors();
+  NotifyVideoQualityStepped(step, reason, true, "");
+  return true;
+}
+
+
+// the destination may be stopping under the simulcast mutex, so the
+// callback is kept apart from it.
+void Obs::NotifySimulcastEvent(const boost::property_tree::ptree &event) {
+  ObsStreamDestination::OnEvent on_event;
+  {
+    std::lock_guard<std::mutex> lock{on_simulcast_event_mutex_};
+    on_event = on_simulcast_event_;
+  }
+  if (on_event) {
+    on_event(event);
+  }
+}
+
+
+void Obs::NotifyVideoQualityStepped(
+    const ObsLagGuard::Step &step,
+    const std::string &reason,
+    bool applied,
+    const std::string &error) {
+  boost::property_tree::ptree event;
+  event.add_child("step", step.ToTree());
+  event.put("reason", reason);
+  // not applied, the step is left to the user for the next streaming.
+  event.put("applied", applied);
+  event.put("error", error);
+
+  OnVideoQualityStepped on_stepped;
+  {
+    std::lock_guard<std::mutex> lock{on_video_quality_stepped_mutex_};
+    on_stepped = on_video_quality_stepped_;
+  }
+  if (on_stepped) {
+    on_stepped(event);
+  }
 }
 
 
@@ -7,26 +7,53 @@
 #define NCSTREAMER_CEF_SRC_OBS_H_
 
 
+#include <chrono>  // NOLINT
+#include <condition_variable>  // NOLINT
 #include <fstream>
+#include <functional>
 #include <memory>
+#include <mutex>  // NOLINT
 #include <string>
 #include <tuple>
+#include <unordered_map>
 #include <vector>
 
+#include "boost/property_tree/ptree.hpp"
+
 #include "obs-studio/libobs/obs.h"
 
+#include "ncstreamer_cef/src/lib/audio_device_format.h"
+#include "ncstreamer_cef/src/lib/cpu_usage.h"
 #include "ncstreamer_cef/src/lib/dimension.h"
+#include "ncstreamer_cef/src/lib/window_size_provider.h"
+#include "ncstreamer_cef/src/obs/obs_frame_change_detector.h"
+#include "ncstreamer_cef/src/obs/obs_lag_guard.h"
+#include "ncstreamer_cef/src/obs/obs_latency_probe.h"
 #include "ncstreamer_cef/src/obs/obs_output.h"
+#include "ncstreamer_cef/src/obs/obs_reconnect_policy.h"
+#include "ncstreamer_cef/src/obs/obs_recording_output.h"
+#include "ncstreamer_cef/src/obs/obs_rendition.h"
+#include "ncstreamer_cef/src/obs/obs_replay_buffer.h"
+#include "ncstreamer_cef/src/obs/obs_stream_destination.h"
+#include "ncstreamer_cef/src/obs/obs_stream_profile.h"
 
 
 namespace ncstreamer {
 class Obs {
  public:
+  // called on the lag guard thread after each step of the video.
+  using OnVideoQualityStepped =
+      std::function<void(const boost::property_tree::ptree &step)>;
+  // called on the thread which owns obs, before a capture, a benchmark
+  // or a bandwidth test resets the video.
+  using OnCaptureStarting = std::function<void()>;
+
   static void SetUp();
   static void ShutDown();
   static Obs *Get();
 
   std::vector<std::string> FindAllWindowsOnDesktop();
+  std::string FindSourceByTitle(const std::string &title);
 
   bool StartStreaming(
       const std::string &source_info,
@@ -37,6 +64,118 @@ class Obs {
   void StopStreaming(
       const ObsOutput::OnStopped &on_streaming_stopped);
 
+  bool UpdateStreamProfile(
+      const std::string &profile,
+      bool measures_latency);
+  boost::property_tree::ptree GetLatencyStatus() const;
+
+  // while the picture stays still, the stream drops to idle_bitrate;
+  // 0 turns it off. takes effect from the next streaming.
+  void UpdateIdleVideoBitrate(uint32_t idle_bitrate);
+  boost::property_tree::ptree GetIdleStatus() const;
+
+  // while frames lag, the video steps down; it is only reported unless
+  // restarts is set, as a step restarts the stream. takes effect from
+  // the next streaming.
+  void UpdateLagGuard(bool enabled, bool restarts);
+  void SetOnVideoQualityStepped(const OnVideoQualityStepped &on_stepped);
+  boost::property_tree::ptree GetLagGuardStatus() const;
+
+  // a rate of 0 and channels of "auto" follow the default playback
+  // device, which then goes unresampled; a bitrate of 0 keeps the current.
+  // returns false, changing nothing, on a rate or channels not supported.
+  // takes effect from the next capture.
+  bool UpdateAudioFormat(
+      uint32_t samples_per_sec,
+      const std::string &channels,
+      uint32_t bitrate);
+  boost::property_tree::ptree GetAudioStatus() const;
+
+  // the longest wait between two attempts to reconnect the stream, and
+  // the simulcast destinations started after without a policy of their
+  // own.
+  void UpdateReconnectMaxDelay(const std::chrono::seconds &max_delay);
+  void SetOnStreamingReconnect(const ObsOutput::OnReconnect &on_reconnect);
+  boost::property_tree::ptree GetReconnectStatus() const;
+  // that of the stream, for a destination not given one.
+  ObsReconnectPolicy GetReconnectPolicy() const;
+
+  bool StartRecording(
+      const std::string &source_info,
+      const bool &mic,
+      const std::string &path,
+      const bool &dedicated_encoder,
+      const ObsRecordingOutput::OnStarted &on_recording_started);
+  void StopRecording(
+      const ObsRecordingOutput::OnStopped &on_recording_stopped);
+
+  bool StartSimulcast(
+      const std::string &destination,
+      const std::string &source_info,
+      const bool &mic,
+      const std::string &service_provider,
+      const std::string &stream_url,
+      const std::string &rendition,
+      const ObsReconnectPolicy &reconnect_policy,
+      const ObsOutput::OnStarted &on_simulcast_started);
+  bool StopSimulcast(
+      const std::string &destination,
+      const ObsOutput::OnStopped &on_simulcast_stopped);
+  std::vector<boost::property_tree::ptree> GetSimulcastStatus() const;
+  void SetOnSimulcastEvent(const ObsStreamDestination::OnEvent &on_event);
+
+  bool UpdateRenditions(const std::vector<ObsRendition::Spec> &specs);
+  std::vector<boost::property_tree::ptree> GetRenditionStatus() const;
+  double GetCpuUsage() const;
+
+  // encodes a synthetic scene of the output size with the current
+  // encoders, and throws the packets away after measuring them.
+  // audio_samples_per_sec overrides the audio format for this run and
+  // tone_samples_per_sec is the rate of the synthetic audio; 0 for
+  // either follows the audio format.
+  bool StartBenchmark(
+      const std::string &pattern,
+      const std::string &signal,
+      uint32_t audio_samples_per_sec,
+      uint32_t tone_samples_per_sec);
+  void StopBenchmark();
+  bool IsBenchmarking() const;
+  boost::property_tree::ptree GetBenchmarkStatus() const;
+
+  // streams synthetic noise of the output size to the stream url on an
+  // output of its own, at a bitrate the caller steps while measuring.
+  bool StartBandwidthTest(
+      const std::string &service_provider,
+      const std::string &stream_url,
+      uint32_t bitrate);
+  void UpdateBandwidthTestBitrate(uint32_t bitrate);
+  // returns at once; on_stopped is called once the output has stopped,
+  // on a thread of obs, or at once if the test never connected. the
+  // scene of the test is gone by then.
+  void StopBandwidthTest(const ObsOutput::OnStopped &on_stopped);
+  bool IsBandwidthTesting() const;
+  boost::property_tree::ptree GetBandwidthTestStatus() const;
+
+  bool StartReplayBuffer(
+      const std::string &source_info,
+      const bool &mic,
+      int64_t max_duration_usec,
+      std::size_t max_bytes);
+  void StopReplayBuffer();
+  bool SaveReplayBuffer(
+      const std::string &path,
+      const ObsReplayBuffer::OnSaved &on_replay_saved);
+  void BindReplayBufferHotkey(
+      const std::string &keys,
+      const std::string &directory);
+  bool IsReplayBuffering() const;
+  boost::property_tree::ptree GetReplayBufferStatus() const;
+
+  bool IsCapturing() const;
+  void SetOnCaptureStarting(const OnCaptureStarting &on_capture_starting);
+  bool IsRecording() const;
+  std::string GetRecordingPath() const;
+
   void TurnOnMic();
   void TurnOffMic();
   void UpdateVideoQuality(
@@ -55,22 +194,51 @@ class Obs {
   static std::tuple<std::string /*server*/, std::string /*key*/>
       Obs::SplitStreamUrl(const std::string &stream_url);
 
+  static bool IsSupportedSamplesPerSec(uint32_t samples_per_sec);
+
   bool SetUpLog();
   void ResetAudio();
-  void ResetVideo();
+  void ResetVideo(const Dimension<uint32_t> &output_size, uint32_t fps);
   obs_encoder_t *CreateAudioEncoder();
   obs_encoder_t *CreateVideoEncoder();
+  obs_encoder_t *CreateRecordingVideoEncoder();
   void ClearSceneData();
 
+  void SetUpCapture(const std::string &source_info,
+                    const bool &mic);
+  void ResetCapture();
+  void ResetCapture(const Dimension<uint32_t> &output_size, uint32_t fps);
+
   void UpdateCurrentSource(const std::string &source_info,
                            const bool &mic);
 
+  static obs_service_t *CreateService(
+      const std::string &service_name,
+      const std::string &service_provider,
+      const std::string &stream_server,
+      const std::string &stream_key);
+
   void UpdateCurrentService(
       const std::string &service_provider,
       const std::string &stream_server,
       const std::string &stream_key);
   void ReleaseCurrentService();
+  // puts back the service which the bandwidth test took the place of.
+  void RestoreCurrentService();
   void UpdateBaseResolution(const std::string &source_info);
+  void FitCaptureItem();
+  void ApplyIdleVideoBitrate(bool idle);
+  void StartStreamMonitors();
+  void StopStreamMonitors(const ObsLatencyProbe::OnStopped &on_stopped);
+  bool StepVideoQuality(
+      const ObsLagGuard::Step &step,
+      const std::string &reason);
+  void NotifySimulcastEvent(const boost::property_tree::ptree &event);
+  void NotifyVideoQualityStepped(
+      const ObsLagGuard::Step &step,
+      const std::string &reason,
+      bool applied,
+      const std::string &error);
 
   static Obs *static_instance;
 
@@ -78,11 +246,65 @@ class Obs {
   obs_encoder_t *audio_encoder_;
   obs_encoder_t *video_encoder_;
   std::unique_ptr<ObsOutput> stream_output_;
+  std::unique_ptr<ObsOutput> bandwidth_test_output_;
+  const ObsStreamProfile *stream_profile_;
+  bool measures_latency_;
+  std::unique_ptr<ObsLatencyProbe> latency_probe_;
+  std::unique_ptr<ObsFrameChangeDetector> frame_change_detector_;
+  uint32_t idle_video_bitrate_;
+  std::unique_ptr<ObsLagGuard> lag_guard_;
+  bool guards_lag_;
+  bool lag_guard_restarts_;
+  // a step waits for the outputs; stopping the streaming cancels it.
+  std::mutex step_mutex_;
+  std::condition_variable step_condition_;
+  uint32_t step_generation_;
+  uint32_t step_stops_pending_;
+  bool step_started_;
+  bool step_cancelled_;
+  mutable std::mutex on_video_quality_stepped_mutex_;
+  OnVideoQualityStepped on_video_quality_stepped_;
+  mutable std::mutex on_capture_starting_mutex_;
+  OnCaptureStarting on_capture_starting_;
+  obs_encoder_t *recording_video_encoder_;
+  std::unique_ptr<ObsRecordingOutput> recording_output_;
+  std::unique_ptr<ObsReplayBuffer> replay_buffer_;
+  std::string current_source_info_;
+  std::unique_ptr<WindowSizeProvider> window_size_provider_;
+  // the window capture goes through a scene, which scales it to fit
+  // the canvas when the window is resized; libobs refits the bounds of
+  // the item to the size of the window every frame.
+  obs_scene_t *capture_scene_;
+  obs_sceneitem_t *capture_item_;
+
+  mutable std::mutex simulcast_mutex_;
+  std::unordered_map<
+      std::string /*destination*/,
+      std::unique_ptr<ObsStreamDestination>> simulcast_destinations_;
+  // of the stream, for the destinations not given one as well.
+  ObsReconnectPolicy simulcast_reconnect_policy_;
+  mutable std::mutex on_simulcast_event_mutex_;
+  ObsStreamDestination::OnEvent on_simulcast_event_;
+  std::unordered_map<
+      std::string /*name*/,
+      std::unique_ptr<ObsRendition>> renditions_;
+  CpuUsage cpu_usage_;
 
   obs_service_t *current_service_;
+  // the service of the streaming while the bandwidth test has its own.
+  bool service_saved_;
+  obs_service_t *saved_service_;
   int audio_bitrate_;
+  // as configured; 0 and "auto" follow the device.
+  uint32_t audio_samples_per_sec_setting_;
+  std::string audio_channels_setting_;
+  // as of the last reset of the audio.
+  uint32_t audio_samples_per_sec_;
+  speaker_layout audio_speakers_;
   int video_bitrate_;
   Dimension<uint32_t> base_size_;
+  // of the user, set on the ui thread only; a step of the lag guard
+  // resets the video to its own quality.
   Dimension<uint32_t> output_size_;
   uint32_t fps_;
 };
@@ -0,0 +1,312 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#include "ncstreamer_cef/src/obs/obs_encoder_capacity_probe.h"
+
+#include <cstring>
+#include <mutex>  // NOLINT
+#include <thread>  // NOLINT
+
+#include "ncstreamer_cef/src/obs/obs_synthetic_source.h"
+
+
+namespace {
+const char *kOutputId{"ncstreamer_capacity_probe"};
+
+const uint32_t kWarmUpSeconds{1};
+const std::size_t kVideoCacheSize{6};
+const std::size_t kPatternFrames{8};
+
+// more skipped frames than this is over the capacity.
+const double kMaxSkippedRatio{0.01};
+}  // unnamed namespace
+
+
+namespace ncstreamer {
+class ObsEncoderCapacityProbe::OutputData {
+ public:
+  explicit OutputData(obs_output_t *output)
+      : output_{output},
+        mutex_{},
+        packets_{0} {
+  }
+
+  obs_output_t *output() const { return output_; }
+
+  void Clear() {
+    std::lock_guard<std::mutex> lock{mutex_};
+    packets_ = 0;
+  }
+
+  void Add(const encoder_packet & /*packet*/) {
+    std::lock_guard<std::mutex> lock{mutex_};
+    ++packets_;
+  }
+
+  uint64_t packets() const {
+    std::lock_guard<std::mutex> lock{mutex_};
+    return packets_;
+  }
+
+ private:
+  obs_output_t *const output_;
+
+  mutable std::mutex mutex_;
+  uint64_t packets_;
+};
+
+
+void ObsEncoderCapacityProbe::RegisterOutputType() {
+  static obs_output_info info{};
+  info.id = kOutputId;
+  info.flags = OBS_OUTPUT_VIDEO | OBS_OUTPUT_ENCODED;
+  info.get_name = GetOutputName;
+  info.create = CreateOutput;
+  info.destroy = DestroyOutput;
+  info.start = StartOutput;
+  info.stop = StopOutput;
+  info.encoded_packet = OnEncodedPacket;
+
+  obs_register_output(&info);
+}
+
+
+std::vector<ObsEncoderCapacityProbe::Candidate>
+    ObsEncoderCapacityProbe::GetDefaultCandidates() {
+  // a candidate is fed faster than its own frame rate, so that a
+  // machine which only just keeps up does not pass; the game takes its
+  // share of the cpu while streaming. "high" is "medium" at more bits,
+  // which are worth the cpu only with room to spare.
+  return {
+      {"low", {854, 480}, 30, 1000, "veryfast", 150},
+      {"medium", {1280, 720}, 30, 3000, "veryfast", 150},
+      {"high", {1280, 720}, 30, 4000, "veryfast", 200},
+      {"720p60", {1280, 720}, 60, 0, "veryfast", 150},
+      {"1080p30", {1920, 1080}, 30, 0, "veryfast", 150}};
+}
+
+
+boost::property_tree::ptree ObsEncoderCapacityProbe::Measure(
+    const Candidate &candidate,
+    const std::chrono::seconds &duration,
+    const std::atomic<bool> &quit) {
+  using Clock = std::chrono::steady_clock;
+
+  uint32_t width = candidate.output_size().width();
+  uint32_t height = candidate.output_size().height();
+  // of the candidate, or in proportion to the pixels; x264 works harder
+  // with more.
+  uint32_t bitrate = (candidate.bitrate() != 0) ?
+      candidate.bitrate() :
+      static_cast<uint32_t>(candidate.GetPixelRate() / 20000);
+  uint32_t probe_fps = candidate.fps() * candidate.headroom_percent() / 100;
+
+  boost::property_tree::ptree tree;
+  tree.put("name", candidate.name());
+  tree.put("width", width);
+  tree.put("height", height);
+  tree.put("fps", candidate.fps());
+  tree.put("bitrate", bitrate);
+  tree.put("preset", candidate.preset());
+  tree.put("probeFps", probe_fps);
+
+  video_output_info info{};
+  info.name = "capacity_probe_video";
+  info.format = VIDEO_FORMAT_NV12;
+  info.fps_num = probe_fps;
+  info.fps_den = 1;
+  info.width = width;
+  info.height = height;
+  info.cache_size = kVideoCacheSize;
+  info.colorspace = VIDEO_CS_DEFAULT;
+  info.range = VIDEO_RANGE_DEFAULT;
+
+  video_t *video{nullptr};
+  if (video_output_open(&video, &info) != VIDEO_OUTPUT_SUCCESS) {
+    tree.put("error", "video output");
+    return std::move(tree);
+  }
+
+  obs_data_t *settings = obs_data_create();
+  obs_data_set_string(settings, "rate_control", "CBR");
+  obs_data_set_int(settings, "bitrate", bitrate);
+  obs_data_set_string(settings, "preset", candidate.preset().c_str());
+  obs_data_set_int(settings, "keyint_sec", 2);
+  obs_encoder_t *encoder = obs_video_encoder_create(
+      "obs_x264", "capacity_probe_h264", settings, nullptr);
+  obs_data_release(settings);
+
+  obs_output_t *output = obs_output_create(
+      kOutputId, "capacity_probe_output", nullptr, nullptr);
+  calldata_t params = {0};
+  proc_handler_call(
+      obs_output_get_proc_handler(output), "get_output_data", &params);
+  auto output_data = static_cast<OutputData *>(calldata_ptr(&params, "data"));
+  calldata_free(&params);
+
+  obs_encoder_set_video(encoder, video);
+  obs_output_set_video_encoder(output, encoder);
+
+  if (obs_output_start(output) == false) {
+    tree.put("error", "output start");
+  } else {
+    std::vector<std::vector<uint8_t>> lumas;
+    for (std::size_t i = 0; i < kPatternFrames; ++i) {
+      lumas.emplace_back(width * height);
+      ObsSyntheticSource::RenderLuma(
+          "scroll", i, width, height, lumas.back().data(), width);
+    }
+
+    const uint64_t warm_up_frames = probe_fps * kWarmUpSeconds;
+    const uint64_t total_frames =
+        warm_up_frames + probe_fps * duration.count();
+    const auto interval = std::chrono::nanoseconds{1000000000 / probe_fps};
+
+    uint32_t skipped_base{0};
+    uint64_t packets_base{0};
+    Clock::time_point measure_start{};
+    const auto start = Clock::now();
+    uint64_t index{0};
+    for (; index < total_frames && quit == false; ++index) {
+      std::this_thread::sleep_until(start + interval * index);
+      if (index == warm_up_frames) {
+        skipped_base = video_output_get_skipped_frames(video);
+        packets_base = output_data->packets();
+        measure_start = Clock::now();
+      }
+
+      video_frame frame;
+      if (video_output_lock_frame(video, &frame, 1, os_gettime_ns()) ==
+          false) {
+        // counted as skipped by the video output.
+        continue;
+      }
+      const auto &luma = lumas[index % lumas.size()];
+      for (uint32_t y = 0; y < height; ++y) {
+        std::memcpy(frame.data[0] + y * frame.linesize[0],
+                    luma.data() + y * width,
+                    width);
+      }
+      for (uint32_t y = 0; y < height / 2; ++y) {
+        std::memset(frame.data[1] + y * frame.linesize[1], 128, width);
+      }
+      video_output_unlock_frame(video);
+    }
+
+    if (index < total_frames) {
+      tree.put("cancelled", true);
+    } else {
+      double elapsed_sec = std::chrono::duration<double>(
+          Clock::now() - measure_start).count();
+      uint64_t frames = total_frames - warm_up_frames;
+      uint32_t skipped = video_output_get_skipped_frames(video) - skipped_base;
+      uint64_t packets = output_data->packets() - packets_base;
+      double skipped_ratio = static_cast<double>(skipped) / frames;
+
+      tree.put("frames", frames);
+      tree.put("skipped", skipped);
+      tree.put("encodedFps", packets / elapsed_sec);
+      tree.put("sustainable", skipped_ratio <= kMaxSkippedRatio);
+    }
+  }
+
+  // the encoder must be off the video output before it closes.
+  obs_output_stop(output);
+  for (int i = 0; i < 100 && obs_output_active(output) == true; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds{10});
+  }
+  if (obs_output_active(output) == true) {
+    obs_output_force_stop(output);
+  }
+  obs_output_release(output);
+  obs_encoder_release(encoder);
+  video_output_close(video);
+
+  return std::move(tree);
+}
+
+
+const char *ObsEncoderCapacityProbe::GetOutputName(void * /*type_data*/) {
+  return "NCStreamer Encoder Capacity Probe";
+}
+
+
+void *ObsEncoderCapacityProbe::CreateOutput(
+    obs_data_t * /*settings*/, obs_output_t *output) {
+  OutputData *output_data = new OutputData{output};
+  proc_handler_add(
+      obs_output_get_proc_handler(output),
+      "void get_output_data(out ptr data)",
+      GetOutputDataProc,
+      output_data);
+  return output_data;
+}
+
+
+void ObsEncoderCapacityProbe::DestroyOutput(void *data) {
+  delete static_cast<OutputData *>(data);
+}
+
+
+bool ObsEncoderCapacityProbe::StartOutput(void *data) {
+  auto output_data = static_cast<OutputData *>(data);
+  obs_output_t *output = output_data->output();
+
+  if (obs_output_can_begin_data_capture(output, 0) == false) {
+    return false;
+  }
+  if (obs_output_initialize_encoders(output, 0) == false) {
+    return false;
+  }
+
+  output_data->Clear();
+  return obs_output_begin_data_capture(output, 0);
+}
+
+
+void ObsEncoderCapacityProbe::StopOutput(void *data, uint64_t /*ts*/) {
+  auto output_data = static_cast<OutputData *>(data);
+  obs_output_end_data_capture(output_data->output());
+}
+
+
+void ObsEncoderCapacityProbe::OnEncodedPacket(
+    void *data, encoder_packet *packet) {
+  auto output_data = static_cast<OutputData *>(data);
+  output_data->Add(*packet);
+}
+
+
+void ObsEncoderCapacityProbe::GetOutputDataProc(
+    void *data, calldata_t *params) {
+  calldata_set_ptr(params, "data", data);
+}
+
+
+ObsEncoderCapacityProbe::Candidate::Candidate(
+    const std::string &name,
+    const Dimension<uint32_t> &output_size,
+    uint32_t fps,
+    uint32_t bitrate,
+    const std::string &preset,
+    uint32_t headroom_percent)
+    : name_{name},
+      output_size_{output_size},
+      fps_{fps},
+      bitrate_{bitrate},
+      preset_{preset},
+      headroom_percent_{headroom_percent} {
+}
+
+
+ObsEncoderCapacityProbe::Candidate::~Candidate() {
+}
+
+
+uint64_t ObsEncoderCapacityProbe::Candidate::GetPixelRate() const {
+  return static_cast<uint64_t>(output_size_.width()) *
+         output_size_.height() * fps_;
+}
+}  // namespace ncstreamer
@@ -0,0 +1,88 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#ifndef NCSTREAMER_CEF_SRC_OBS_OBS_ENCODER_CAPACITY_PROBE_H_
+#define NCSTREAMER_CEF_SRC_OBS_OBS_ENCODER_CAPACITY_PROBE_H_
+
+
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <string>
+#include <vector>
+
+#include "boost/property_tree/ptree.hpp"
+#include "obs-studio/libobs/obs.h"
+
+#include "ncstreamer_cef/src/lib/dimension.h"
+
+
+namespace ncstreamer {
+// feeds synthetic frames to an x264 encoder of its own, apart from the
+// canvas, and tells whether the encoder keeps up with them.
+class ObsEncoderCapacityProbe {
+ public:
+  class Candidate;
+
+  // registers the output type; call once after obs_startup().
+  static void RegisterOutputType();
+
+  // from the cheapest to the most expensive: the video qualities of the
+  // ui, "low", "medium" and "high", then heavier ones.
+  static std::vector<Candidate> GetDefaultCandidates();
+
+  // blocks for about the warm-up and the duration;
+  // returns early with "cancelled" once quit is set.
+  static boost::property_tree::ptree Measure(
+      const Candidate &candidate,
+      const std::chrono::seconds &duration,
+      const std::atomic<bool> &quit);
+
+ private:
+  class OutputData;
+
+  static const char *GetOutputName(void *type_data);
+  static void *CreateOutput(obs_data_t *settings, obs_output_t *output);
+  static void DestroyOutput(void *data);
+  static bool StartOutput(void *data);
+  static void StopOutput(void *data, uint64_t ts);
+  static void OnEncodedPacket(void *data, encoder_packet *packet);
+  static void GetOutputDataProc(void *data, calldata_t *params);
+};
+
+
+class ObsEncoderCapacityProbe::Candidate {
+ public:
+  // a bitrate of 0 is in proportion to the pixels. the candidate is fed
+  // headroom_percent of its own frame rate.
+  Candidate(
+      const std::string &name,
+      const Dimension<uint32_t> &output_size,
+      uint32_t fps,
+      uint32_t bitrate,
+      const std::string &preset,
+      uint32_t headroom_percent);
+  virtual ~Candidate();
+
+  const std::string &name() const { return name_; }
+  const Dimension<uint32_t> &output_size() const { return output_size_; }
+  uint32_t fps() const { return fps_; }
+  uint32_t bitrate() const { return bitrate_; }
+  const std::string &preset() const { return preset_; }
+  uint32_t headroom_percent() const { return headroom_percent_; }
+
+  uint64_t GetPixelRate() const;
+
+ private:
+  std::string name_;
+  Dimension<uint32_t> output_size_;
+  uint32_t fps_;
+  uint32_t bitrate_;
+  std::string preset_;
+  uint32_t headroom_percent_;
+};
+}  // namespace ncstreamer
+
+
+#endif  // NCSTREAMER_CEF_SRC_OBS_OBS_ENCODER_CAPACITY_PROBE_H_
@@ -0,0 +1,289 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#include "ncstreamer_cef/src/obs/obs_frame_change_detector.h"
+
+#include <emmintrin.h>
+
+#include <algorithm>
+#include <cstring>
+
+
+namespace {
+const uint32_t kBlockSize{16};
+
+// still means fewer changed blocks than this; a spinner or a blinking
+// cursor on a loading screen should not keep it busy.
+const double kStillChangedRatio{0.005};
+
+const uint32_t kIdleAfterSeconds{2};
+
+
+uint32_t CountBlocks(uint32_t width, uint32_t height) {
+  return ((width + kBlockSize - 1) / kBlockSize) *
+         ((height + kBlockSize - 1) / kBlockSize);
+}
+}  // unnamed namespace
+
+
+namespace ncstreamer {
+ObsFrameChangeDetector::ObsFrameChangeDetector()
+    : mutex_{},
+      active_{false},
+      output_size_{0, 0},
+      idle_after_frames_{0},
+      cpu_usage_{nullptr},
+      on_idle_changed_{},
+      hashes_{},
+      previous_hashes_{},
+      has_previous_{false},
+      frames_{0},
+      unchanged_frames_{0},
+      still_frames_{0},
+      idle_{false},
+      idle_periods_{0},
+      state_since_{},
+      idle_duration_{},
+      active_duration_{},
+      idle_cpu_seconds_{0.0},
+      active_cpu_seconds_{0.0},
+      idle_measured_sec_{0.0},
+      active_measured_sec_{0.0} {
+}
+
+
+ObsFrameChangeDetector::~ObsFrameChangeDetector() {
+  Stop();
+}
+
+
+void ObsFrameChangeDetector::Start(
+    const Dimension<uint32_t> &output_size,
+    uint32_t fps,
+    const CpuUsage *cpu_usage,
+    const OnIdleChanged &on_idle_changed) {
+  Stop();
+
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    active_ = true;
+    output_size_ = output_size;
+    idle_after_frames_ = fps * kIdleAfterSeconds;
+    cpu_usage_ = cpu_usage;
+    on_idle_changed_ = on_idle_changed;
+
+    // y, then the interleaved uv of half the height.
+    std::size_t blocks_size =
+        CountBlocks(output_size.width(), output_size.height()) +
+        CountBlocks(output_size.width(), output_size.height() / 2);
+    hashes_.assign(blocks_size, 0);
+    previous_hashes_.assign(blocks_size, 0);
+    has_previous_ = false;
+
+    frames_ = 0;
+    unchanged_frames_ = 0;
+    still_frames_ = 0;
+    idle_ = false;
+    idle_periods_ = 0;
+    state_since_ = CpuUsage::Clock::now();
+    idle_duration_ = CpuUsage::Clock::duration::zero();
+    active_duration_ = CpuUsage::Clock::duration::zero();
+    idle_cpu_seconds_ = 0.0;
+    active_cpu_seconds_ = 0.0;
+    idle_measured_sec_ = 0.0;
+    active_measured_sec_ = 0.0;
+  }
+
+  video_output_connect(obs_get_video(), nullptr, OnRawVideo, this);
+}
+
+
+void ObsFrameChangeDetector::Stop() {
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    if (active_ == false) {
+      return;
+    }
+    active_ = false;
+    UpdateCpuLocked(CpuUsage::Clock::now());
+  }
+
+  // returns after the last callback.
+  video_output_disconnect(obs_get_video(), OnRawVideo, this);
+
+  bool was_idle{false};
+  OnIdleChanged on_idle_changed;
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    was_idle = idle_;
+    idle_ = false;
+    on_idle_changed = on_idle_changed_;
+  }
+  if (was_idle == true && on_idle_changed) {
+    on_idle_changed(false);
+  }
+}
+
+
+bool ObsFrameChangeDetector::IsActive() const {
+  std::lock_guard<std::mutex> lock{mutex_};
+  return active_;
+}
+
+
+boost::property_tree::ptree ObsFrameChangeDetector::ToTree() const {
+  std::lock_guard<std::mutex> lock{mutex_};
+
+  // the current period is counted up to now.
+  auto now = CpuUsage::Clock::now();
+  auto idle_duration = idle_duration_;
+  auto active_duration = active_duration_;
+  if (active_ == true) {
+    (idle_ ? idle_duration : active_duration) += now - state_since_;
+  }
+  double idle_sec =
+      std::chrono::duration<double>(idle_duration).count();
+  double active_sec =
+      std::chrono::duration<double>(active_duration).count();
+
+  boost::property_tree::ptree cpu;
+  cpu.put("idle", (idle_measured_sec_ > 0) ?
+      idle_cpu_seconds_ / idle_measured_sec_ : -1.0);
+  cpu.put("active", (active_measured_sec_ > 0) ?
+      active_cpu_seconds_ / active_measured_sec_ : -1.0);
+
+  boost::property_tree::ptree tree;
+  tree.put("detecting", active_);
+  tree.put("idle", idle_);
+  tree.put("frames", frames_);
+  tree.put("unchangedFrames", unchanged_frames_);
+  tree.put("idlePeriods", idle_periods_);
+  tree.put("idleSec", idle_sec);
+  tree.put("activeSec", active_sec);
+  tree.add_child("cpu", cpu);
+  return std::move(tree);
+}
+
+
+void ObsFrameChangeDetector::OnRawVideo(void *param, video_data *frame) {
+  auto detector = static_cast<ObsFrameChangeDetector *>(param);
+  detector->OnFrame(*frame);
+}
+
+
+void ObsFrameChangeDetector::HashPlane(
+    const uint8_t *data,
+    uint32_t linesize,
+    uint32_t width,
+    uint32_t height,
+    std::vector<uint64_t>::iterator hashes) {
+  for (uint32_t y = 0; y < height; y += kBlockSize) {
+    uint32_t rows = (std::min)(kBlockSize, height - y);
+    for (uint32_t x = 0; x < width; x += kBlockSize) {
+      *hashes++ = HashBlock(data + y * linesize + x,
+                            linesize,
+                            (std::min)(kBlockSize, width - x),
+                            rows);
+    }
+  }
+}
+
+
+uint64_t ObsFrameChangeDetector::HashBlock(
+    const uint8_t *data,
+    uint32_t linesize,
+    uint32_t width,
+    uint32_t rows) {
+  // a rotate and an add per row, on two 64 bit lanes at once; both are
+  // reversible, so any single changed row always changes the hash.
+  __m128i hash = _mm_setzero_si128();
+  for (uint32_t i = 0; i < rows; ++i, data += linesize) {
+    __m128i row;
+    if (width == kBlockSize) {
+      row = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data));
+    } else {
+      uint8_t tail[kBlockSize]{};
+      std::memcpy(tail, data, width);
+      row = _mm_loadu_si128(reinterpret_cast<const __m128i *>(tail));
+    }
+    hash = _mm_or_si128(_mm_slli_epi64(hash, 5), _mm_srli_epi64(hash, 59));
+    hash = _mm_add_epi64(hash, row);
+  }
+
+  uint64_t lanes[2];
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(lanes), hash);
+  return lanes[0] ^ (lanes[1] * 0x9e3779b97f4a7c15ull);
+}
+
+
+void ObsFrameChangeDetector::OnFrame(const video_data &frame) {
+  bool idle_changed{false};
+  bool idle{false};
+  OnIdleChanged on_idle_changed;
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    if (active_ == false) {
+      return;
+    }
+
+    uint32_t width = output_size_.width();
+    uint32_t height = output_size_.height();
+    HashPlane(frame.data[0], frame.linesize[0], width, height,
+              hashes_.begin());
+    HashPlane(frame.data[1], frame.linesize[1], width, height / 2,
+              hashes_.begin() + CountBlocks(width, height));
+
+    std::size_t changed_blocks{0};
+    for (std::size_t i = 0; i < hashes_.size(); ++i) {
+      if (hashes_[i] != previous_hashes_[i]) {
+        ++changed_blocks;
+      }
+    }
+    bool still = has_previous_ &&
+        (changed_blocks < hashes_.size() * kStillChangedRatio);
+    hashes_.swap(previous_hashes_);
+    has_previous_ = true;
+
+    ++frames_;
+    if (changed_blocks == 0 && frames_ > 1) {
+      ++unchanged_frames_;
+    }
+    still_frames_ = still ? still_frames_ + 1 : 0;
+
+    // leaves the idle at the first change, but enters it only after
+    // a while of stillness, so that it does not flap.
+    bool next_idle = (still_frames_ >= idle_after_frames_);
+    if (next_idle != idle_) {
+      UpdateCpuLocked(CpuUsage::Clock::now());
+      idle_ = next_idle;
+      if (idle_ == true) {
+        ++idle_periods_;
+      }
+      idle_changed = true;
+      idle = idle_;
+      on_idle_changed = on_idle_changed_;
+    }
+  }
+
+  if (idle_changed == true && on_idle_changed) {
+    on_idle_changed(idle);
+  }
+}
+
+
+void ObsFrameChangeDetector::UpdateCpuLocked(
+    const CpuUsage::Clock::time_point &now) {
+  auto duration = now - state_since_;
+  (idle_ ? idle_duration_ : active_duration_) += duration;
+
+  double cpu = cpu_usage_ ? cpu_usage_->GetAverage(state_since_, now) : -1.0;
+  if (cpu >= 0) {
+    double sec = std::chrono::duration<double>(duration).count();
+    (idle_ ? idle_cpu_seconds_ : active_cpu_seconds_) += cpu * sec;
+    (idle_ ? idle_measured_sec_ : active_measured_sec_) += sec;
+  }
+  state_since_ = now;
+}
+}  // namespace ncstreamer
@@ -0,0 +1,90 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#ifndef NCSTREAMER_CEF_SRC_OBS_OBS_FRAME_CHANGE_DETECTOR_H_
+#define NCSTREAMER_CEF_SRC_OBS_OBS_FRAME_CHANGE_DETECTOR_H_
+
+
+#include <functional>
+#include <mutex>  // NOLINT
+#include <vector>
+
+#include "boost/property_tree/ptree.hpp"
+#include "obs-studio/libobs/obs.h"
+
+#include "ncstreamer_cef/src/lib/cpu_usage.h"
+#include "ncstreamer_cef/src/lib/dimension.h"
+
+
+namespace ncstreamer {
+// hashes the blocks of every output frame and tells when the picture
+// has been still long enough to be called idle.
+class ObsFrameChangeDetector {
+ public:
+  // called on the video thread; keep it short.
+  using OnIdleChanged = std::function<void(bool idle)>;
+
+  ObsFrameChangeDetector();
+  virtual ~ObsFrameChangeDetector();
+
+  // the output frames must be nv12 of the given size.
+  void Start(
+      const Dimension<uint32_t> &output_size,
+      uint32_t fps,
+      const CpuUsage *cpu_usage,
+      const OnIdleChanged &on_idle_changed);
+  void Stop();
+  bool IsActive() const;
+
+  boost::property_tree::ptree ToTree() const;
+
+ private:
+  static void OnRawVideo(void *param, video_data *frame);
+
+  static void HashPlane(
+      const uint8_t *data,
+      uint32_t linesize,
+      uint32_t width,
+      uint32_t height,
+      std::vector<uint64_t>::iterator hashes);
+  static uint64_t HashBlock(
+      const uint8_t *data,
+      uint32_t linesize,
+      uint32_t width,
+      uint32_t rows);
+
+  void OnFrame(const video_data &frame);
+  void UpdateCpuLocked(const CpuUsage::Clock::time_point &now);
+
+  mutable std::mutex mutex_;
+  bool active_;
+  Dimension<uint32_t> output_size_;
+  uint32_t idle_after_frames_;
+  const CpuUsage *cpu_usage_;
+  OnIdleChanged on_idle_changed_;
+
+  std::vector<uint64_t> hashes_;
+  std::vector<uint64_t> previous_hashes_;
+  bool has_previous_;
+
+  uint64_t frames_;
+  uint64_t unchanged_frames_;
+  uint32_t still_frames_;
+  bool idle_;
+  uint64_t idle_periods_;
+  CpuUsage::Clock::time_point state_since_;
+  CpuUsage::Clock::duration idle_duration_;
+  CpuUsage::Clock::duration active_duration_;
+  // cpu percent times seconds, to average over the periods later;
+  // a period too short to have a cpu sample is left out.
+  double idle_cpu_seconds_;
+  double active_cpu_seconds_;
+  double idle_measured_sec_;
+  double active_measured_sec_;
+};
+}  // namespace ncstreamer
+
+
+#endif  // NCSTREAMER_CEF_SRC_OBS_OBS_FRAME_CHANGE_DETECTOR_H_
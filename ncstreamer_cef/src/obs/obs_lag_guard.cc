@@ -0,0 +1,306 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#include "ncstreamer_cef/src/obs/obs_lag_guard.h"
+
+#include <algorithm>
+
+
+namespace {
+// the lag is judged over this many of the last seconds.
+const std::size_t kWindowSeconds{10};
+const double kStepDownRatio{0.05};
+
+// doubled each time a step up is followed by a step down, so that
+// a machine on the edge does not flap between two steps.
+const uint32_t kStepUpAfterSeconds{60};
+const uint32_t kMaxStepUpAfterSeconds{600};
+
+const std::size_t kMaxHistory{20};
+
+
+uint64_t GetPixelRate(
+    const ncstreamer::Dimension<uint32_t> &output_size,
+    uint32_t fps) {
+  return static_cast<uint64_t>(output_size.width()) *
+         output_size.height() * fps;
+}
+}  // unnamed namespace
+
+
+namespace ncstreamer {
+ObsLagGuard::ObsLagGuard()
+    : mutex_{},
+      quit_condition_{},
+      quit_{false},
+      active_{false},
+      ladder_{},
+      current_{0},
+      on_step_{},
+      start_time_{},
+      last_video_{nullptr},
+      last_rendered_{0},
+      last_lagged_{0},
+      last_skipped_{0},
+      window_{},
+      lag_ratio_{0.0},
+      calm_seconds_{0},
+      step_up_after_seconds_{kStepUpAfterSeconds},
+      stepped_up_{false},
+      lagged_frames_{0},
+      skipped_frames_{0},
+      history_{},
+      watch_thread_{} {
+}
+
+
+ObsLagGuard::~ObsLagGuard() {
+  Stop();
+}
+
+
+void ObsLagGuard::Start(
+    const Dimension<uint32_t> &output_size,
+    uint32_t fps,
+    const OnStep &on_step) {
+  Stop();
+
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    quit_ = false;
+    active_ = true;
+    ladder_ = BuildLadder(output_size, fps);
+    current_ = 0;
+    on_step_ = on_step;
+    start_time_ = Clock::now();
+    last_video_ = nullptr;
+    window_.clear();
+    lag_ratio_ = 0.0;
+    calm_seconds_ = 0;
+    step_up_after_seconds_ = kStepUpAfterSeconds;
+    stepped_up_ = false;
+    lagged_frames_ = 0;
+    skipped_frames_ = 0;
+    history_.clear();
+  }
+
+  watch_thread_ = std::thread{&ObsLagGuard::Watch, this};
+}
+
+
+void ObsLagGuard::Stop() {
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    quit_ = true;
+  }
+  quit_condition_.notify_all();
+  if (watch_thread_.joinable() == true) {
+    watch_thread_.join();
+  }
+
+  std::lock_guard<std::mutex> lock{mutex_};
+  active_ = false;
+}
+
+
+bool ObsLagGuard::IsActive() const {
+  std::lock_guard<std::mutex> lock{mutex_};
+  return active_;
+}
+
+
+boost::property_tree::ptree ObsLagGuard::ToTree() const {
+  std::lock_guard<std::mutex> lock{mutex_};
+
+  boost::property_tree::ptree ladder;
+  for (const auto &step : ladder_) {
+    ladder.push_back(std::make_pair("", step.ToTree()));
+  }
+
+  boost::property_tree::ptree history;
+  for (const auto &record : history_) {
+    history.push_back(std::make_pair("", record));
+  }
+
+  boost::property_tree::ptree tree;
+  tree.put("active", active_);
+  if (current_ < ladder_.size()) {
+    tree.add_child("step", ladder_[current_].ToTree());
+  }
+  tree.add_child("ladder", ladder);
+  tree.put("lagRatio", lag_ratio_);
+  tree.put("calmSec", calm_seconds_);
+  tree.put("stepUpAfterSec", step_up_after_seconds_);
+  tree.put("laggedFrames", lagged_frames_);
+  tree.put("skippedFrames", skipped_frames_);
+  tree.add_child("history", history);
+  return std::move(tree);
+}
+
+
+std::vector<ObsLagGuard::Step> ObsLagGuard::BuildLadder(
+    const Dimension<uint32_t> &output_size,
+    uint32_t fps) {
+  static const std::vector<Step> kSteps{
+      {"1080p60", {1920, 1080}, 60},
+      {"1080p30", {1920, 1080}, 30},
+      {"720p60", {1280, 720}, 60},
+      {"720p30", {1280, 720}, 30},
+      {"540p30", {960, 540}, 30},
+      {"480p30", {854, 480}, 30},
+      {"360p30", {640, 360}, 30}};
+
+  std::vector<Step> ladder{{
+      std::to_string(output_size.height()) + "p" + std::to_string(fps),
+      output_size,
+      fps}};
+  for (const auto &step : kSteps) {
+    if (step.output_size().width() <= output_size.width() &&
+        step.output_size().height() <= output_size.height() &&
+        step.fps() <= fps &&
+        GetPixelRate(step.output_size(), step.fps()) <
+            GetPixelRate(output_size, fps)) {
+      ladder.emplace_back(step);
+    }
+  }
+  return ladder;
+}
+
+
+void ObsLagGuard::Watch() {
+  static const std::chrono::seconds kSampleInterval{1};
+
+  std::unique_lock<std::mutex> lock{mutex_};
+  while (quit_condition_.wait_for(
+      lock, kSampleInterval, [this]() { return quit_; }) == false) {
+    std::size_t from = current_;
+    std::size_t to = SampleLocked();
+    if (to == from) {
+      continue;
+    }
+
+    // a step restarts the outputs; nothing should wait on the lock.
+    Step step{ladder_[to]};
+    std::string reason{(to > from) ? "lag" : "calm"};
+    OnStep on_step{on_step_};
+    lock.unlock();
+    bool taken = on_step(step, reason);
+    lock.lock();
+
+    RecordLocked(from, to, taken);
+  }
+}
+
+
+std::size_t ObsLagGuard::SampleLocked() {
+  video_t *video = obs_get_video();
+  uint32_t rendered = obs_get_total_frames();
+  uint32_t lagged = obs_get_lagged_frames();
+  uint32_t skipped = video_output_get_skipped_frames(video);
+
+  bool reset = (video != last_video_ ||
+                rendered < last_rendered_ ||
+                lagged < last_lagged_ ||
+                skipped < last_skipped_);
+  uint32_t lagged_delta = lagged - last_lagged_;
+  uint32_t skipped_delta = skipped - last_skipped_;
+  uint32_t total = rendered - last_rendered_;
+  last_video_ = video;
+  last_rendered_ = rendered;
+  last_lagged_ = lagged;
+  last_skipped_ = skipped;
+  if (reset == true) {
+    return current_;
+  }
+
+  uint32_t bad = lagged_delta + skipped_delta;
+  lagged_frames_ += lagged_delta;
+  skipped_frames_ += skipped_delta;
+  window_.emplace_back(bad, total);
+  if (window_.size() > kWindowSeconds) {
+    window_.pop_front();
+  }
+  calm_seconds_ = (bad == 0) ? calm_seconds_ + 1 : 0;
+
+  uint64_t bad_sum{0};
+  uint64_t total_sum{0};
+  for (const auto &second : window_) {
+    bad_sum += second.first;
+    total_sum += second.second;
+  }
+  lag_ratio_ = (total_sum == 0) ?
+      0.0 : static_cast<double>(bad_sum) / total_sum;
+
+  if (window_.size() == kWindowSeconds &&
+      lag_ratio_ > kStepDownRatio &&
+      current_ + 1 < ladder_.size()) {
+    return current_ + 1;
+  }
+  if (current_ > 0 && calm_seconds_ >= step_up_after_seconds_) {
+    return current_ - 1;
+  }
+  return current_;
+}
+
+
+void ObsLagGuard::RecordLocked(
+    std::size_t from,
+    std::size_t to,
+    bool taken) {
+  bool down = (to > from);
+
+  boost::property_tree::ptree record;
+  record.put("sec", std::chrono::duration_cast<std::chrono::seconds>(
+      Clock::now() - start_time_).count());
+  record.put("from", ladder_[from].name());
+  record.put("to", ladder_[to].name());
+  record.put("reason", down ? "lag" : "calm");
+  record.put("lagRatio", lag_ratio_);
+  record.put("taken", taken);
+  history_.emplace_back(record);
+  if (history_.size() > kMaxHistory) {
+    history_.pop_front();
+  }
+
+  if (taken == true) {
+    current_ = to;
+    if (down == true && stepped_up_ == true) {
+      step_up_after_seconds_ =
+          (std::min)(step_up_after_seconds_ * 2, kMaxStepUpAfterSeconds);
+    }
+    stepped_up_ = !down;
+  }
+
+  // judged afresh on the new video, or after a while if not taken.
+  last_video_ = nullptr;
+  window_.clear();
+  lag_ratio_ = 0.0;
+  calm_seconds_ = 0;
+}
+
+
+ObsLagGuard::Step::Step(
+    const std::string &name,
+    const Dimension<uint32_t> &output_size,
+    uint32_t fps)
+    : name_{name},
+      output_size_{output_size},
+      fps_{fps} {
+}
+
+
+ObsLagGuard::Step::~Step() {
+}
+
+
+boost::property_tree::ptree ObsLagGuard::Step::ToTree() const {
+  boost::property_tree::ptree tree;
+  tree.put("name", name_);
+  tree.put("width", output_size_.width());
+  tree.put("height", output_size_.height());
+  tree.put("fps", fps_);
+  return std::move(tree);
+}
+}  // namespace ncstreamer
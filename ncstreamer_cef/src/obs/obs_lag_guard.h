@@ -0,0 +1,116 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#ifndef NCSTREAMER_CEF_SRC_OBS_OBS_LAG_GUARD_H_
+#define NCSTREAMER_CEF_SRC_OBS_OBS_LAG_GUARD_H_
+
+
+#include <chrono>  // NOLINT
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <functional>
+#include <mutex>  // NOLINT
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "boost/property_tree/ptree.hpp"
+#include "obs-studio/libobs/obs.h"
+
+#include "ncstreamer_cef/src/lib/dimension.h"
+
+
+namespace ncstreamer {
+// counts the frames which the render thread missed and which the
+// encoder had no room for, and steps the video down a ladder while
+// they keep coming; steps back up after a long enough calm.
+class ObsLagGuard {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  class Step;
+  // called on the guard thread with "lag" or "calm";
+  // returns false if the step was not taken.
+  using OnStep = std::function<bool(
+      const Step &step,
+      const std::string &reason)>;
+
+  ObsLagGuard();
+  virtual ~ObsLagGuard();
+
+  // the given quality is the top of the ladder; it never goes above.
+  void Start(
+      const Dimension<uint32_t> &output_size,
+      uint32_t fps,
+      const OnStep &on_step);
+  void Stop();
+  bool IsActive() const;
+
+  boost::property_tree::ptree ToTree() const;
+
+ private:
+  static std::vector<Step> BuildLadder(
+      const Dimension<uint32_t> &output_size,
+      uint32_t fps);
+
+  void Watch();
+  // returns the index of the step to take, or the current one.
+  std::size_t SampleLocked();
+  void RecordLocked(std::size_t from, std::size_t to, bool taken);
+
+  mutable std::mutex mutex_;
+  std::condition_variable quit_condition_;
+  bool quit_;
+  bool active_;
+
+  std::vector<Step> ladder_;
+  std::size_t current_;
+  OnStep on_step_;
+  Clock::time_point start_time_;
+
+  // a reset of the video starts the counters over.
+  video_t *last_video_;
+  uint32_t last_rendered_;
+  uint32_t last_lagged_;
+  uint32_t last_skipped_;
+  // bad and total frames of each of the recent seconds.
+  std::deque<std::pair<uint32_t, uint32_t>> window_;
+  double lag_ratio_;
+  uint32_t calm_seconds_;
+  uint32_t step_up_after_seconds_;
+  bool stepped_up_;
+
+  uint64_t lagged_frames_;
+  uint64_t skipped_frames_;
+  std::deque<boost::property_tree::ptree> history_;
+
+  std::thread watch_thread_;
+};
+
+
+class ObsLagGuard::Step {
+ public:
+  Step(
+      const std::string &name,
+      const Dimension<uint32_t> &output_size,
+      uint32_t fps);
+  virtual ~Step();
+
+  const std::string &name() const { return name_; }
+  const Dimension<uint32_t> &output_size() const { return output_size_; }
+  uint32_t fps() const { return fps_; }
+
+  boost::property_tree::ptree ToTree() const;
+
+ private:
+  std::string name_;
+  Dimension<uint32_t> output_size_;
+  uint32_t fps_;
+};
+}  // namespace ncstreamer
+
+
+#endif  // NCSTREAMER_CEF_SRC_OBS_OBS_LAG_GUARD_H_
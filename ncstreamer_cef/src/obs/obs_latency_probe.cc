@@ -0,0 +1,257 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#include "ncstreamer_cef/src/obs/obs_latency_probe.h"
+
+#include <algorithm>
+#include <deque>
+#include <mutex>  // NOLINT
+
+
+namespace {
+const char *kOutputId{"ncstreamer_latency_probe"};
+}  // unnamed namespace
+
+
+namespace ncstreamer {
+class ObsLatencyProbe::OutputData {
+ public:
+  explicit OutputData(obs_output_t *output)
+      : output_{output},
+        mutex_{},
+        video_latencies_usec_{},
+        audio_latencies_usec_{},
+        video_packets_{0},
+        audio_packets_{0},
+        video_bytes_{0},
+        audio_bytes_{0} {
+  }
+
+  obs_output_t *output() const { return output_; }
+
+  void Clear() {
+    std::lock_guard<std::mutex> lock{mutex_};
+    video_latencies_usec_.clear();
+    audio_latencies_usec_.clear();
+    video_packets_ = 0;
+    audio_packets_ = 0;
+    video_bytes_ = 0;
+    audio_bytes_ = 0;
+  }
+
+  void Add(const encoder_packet &packet) {
+    // sys_dts_usec is the capture time on the same clock.
+    int64_t now_usec = static_cast<int64_t>(os_gettime_ns() / 1000);
+    int64_t latency_usec = now_usec - packet.sys_dts_usec;
+
+    std::lock_guard<std::mutex> lock{mutex_};
+    bool video = (packet.type == OBS_ENCODER_VIDEO);
+    auto *latencies = video ? &video_latencies_usec_ : &audio_latencies_usec_;
+    ++(video ? video_packets_ : audio_packets_);
+    (video ? video_bytes_ : audio_bytes_) += packet.size;
+    latencies->emplace_back(latency_usec);
+    if (latencies->size() > kMaxSamples) {
+      latencies->pop_front();
+    }
+  }
+
+  boost::property_tree::ptree ToTree() const {
+    std::lock_guard<std::mutex> lock{mutex_};
+
+    boost::property_tree::ptree tree;
+    tree.add_child("video", ToTree(
+        video_latencies_usec_, video_packets_, video_bytes_));
+    tree.add_child("audio", ToTree(
+        audio_latencies_usec_, audio_packets_, audio_bytes_));
+    return std::move(tree);
+  }
+
+ private:
+  static const std::size_t kMaxSamples{300};
+
+  static boost::property_tree::ptree ToTree(
+      const std::deque<int64_t> &latencies_usec,
+      uint64_t packets,
+      uint64_t bytes) {
+    int64_t sum{0};
+    int64_t max{0};
+    for (const auto &latency : latencies_usec) {
+      sum += latency;
+      max = (std::max)(max, latency);
+    }
+
+    boost::property_tree::ptree tree;
+    tree.put("samples", latencies_usec.size());
+    tree.put("averageMs", latencies_usec.empty() ?
+        -1.0 : sum / 1000.0 / latencies_usec.size());
+    tree.put("maxMs", latencies_usec.empty() ? -1.0 : max / 1000.0);
+    tree.put("packets", packets);
+    tree.put("bytes", bytes);
+    return std::move(tree);
+  }
+
+  obs_output_t *const output_;
+
+  mutable std::mutex mutex_;
+  std::deque<int64_t> video_latencies_usec_;
+  std::deque<int64_t> audio_latencies_usec_;
+  // totals since start, unlike the latency window.
+  uint64_t video_packets_;
+  uint64_t audio_packets_;
+  uint64_t video_bytes_;
+  uint64_t audio_bytes_;
+};
+
+
+void ObsLatencyProbe::RegisterOutputType() {
+  static obs_output_info info{};
+  info.id = kOutputId;
+  info.flags = OBS_OUTPUT_AV | OBS_OUTPUT_ENCODED;
+  info.get_name = GetOutputName;
+  info.create = CreateOutput;
+  info.destroy = DestroyOutput;
+  info.start = StartOutput;
+  info.stop = StopOutput;
+  info.encoded_packet = OnEncodedPacket;
+
+  obs_register_output(&info);
+}
+
+
+ObsLatencyProbe::ObsLatencyProbe()
+    : output_{obs_output_create(
+          kOutputId, "latency_probe_output", nullptr, nullptr)},
+      signal_handler_{obs_output_get_signal_handler(output_)},
+      output_data_{nullptr},
+      mutex_{},
+      on_stopped_{} {
+  calldata_t params = {0};
+  proc_handler_call(
+      obs_output_get_proc_handler(output_), "get_output_data", &params);
+  output_data_ = static_cast<OutputData *>(calldata_ptr(&params, "data"));
+  calldata_free(&params);
+
+  signal_handler_connect(signal_handler_, "stop", OnStopSignal, this);
+}
+
+
+ObsLatencyProbe::~ObsLatencyProbe() {
+  if (IsActive() == true) {
+    obs_output_force_stop(output_);
+  }
+  signal_handler_disconnect(signal_handler_, "stop", OnStopSignal, this);
+
+  obs_output_release(output_);
+  output_ = nullptr;
+  output_data_ = nullptr;
+}
+
+
+bool ObsLatencyProbe::Start(obs_encoder_t *audio_encoder,
+                            obs_encoder_t *video_encoder) {
+  if (IsActive() == true) {
+    return false;
+  }
+
+  obs_output_set_audio_encoder(output_, audio_encoder, 0);
+  obs_output_set_video_encoder(output_, video_encoder);
+  return obs_output_start(output_);
+}
+
+
+void ObsLatencyProbe::Stop(const OnStopped &on_stopped) {
+  if (IsActive() == false) {
+    if (on_stopped) {
+      on_stopped();
+    }
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    on_stopped_ = on_stopped;
+  }
+  obs_output_stop(output_);
+}
+
+
+bool ObsLatencyProbe::IsActive() const {
+  return obs_output_active(output_);
+}
+
+
+boost::property_tree::ptree ObsLatencyProbe::ToTree() const {
+  return output_data_->ToTree();
+}
+
+
+const char *ObsLatencyProbe::GetOutputName(void * /*type_data*/) {
+  return "NCStreamer Latency Probe";
+}
+
+
+void *ObsLatencyProbe::CreateOutput(
+    obs_data_t * /*settings*/, obs_output_t *output) {
+  OutputData *output_data = new OutputData{output};
+  proc_handler_add(
+      obs_output_get_proc_handler(output),
+      "void get_output_data(out ptr data)",
+      GetOutputDataProc,
+      output_data);
+  return output_data;
+}
+
+
+void ObsLatencyProbe::DestroyOutput(void *data) {
+  delete static_cast<OutputData *>(data);
+}
+
+
+bool ObsLatencyProbe::StartOutput(void *data) {
+  auto output_data = static_cast<OutputData *>(data);
+  obs_output_t *output = output_data->output();
+
+  if (obs_output_can_begin_data_capture(output, 0) == false) {
+    return false;
+  }
+  if (obs_output_initialize_encoders(output, 0) == false) {
+    return false;
+  }
+
+  output_data->Clear();
+  return obs_output_begin_data_capture(output, 0);
+}
+
+
+void ObsLatencyProbe::StopOutput(void *data, uint64_t /*ts*/) {
+  auto output_data = static_cast<OutputData *>(data);
+  obs_output_end_data_capture(output_data->output());
+}
+
+
+void ObsLatencyProbe::OnEncodedPacket(void *data, encoder_packet *packet) {
+  auto output_data = static_cast<OutputData *>(data);
+  output_data->Add(*packet);
+}
+
+
+void ObsLatencyProbe::GetOutputDataProc(void *data, calldata_t *params) {
+  calldata_set_ptr(params, "data", data);
+}
+
+
+void ObsLatencyProbe::OnStopSignal(void *data, calldata_t * /*params*/) {
+  auto self = reinterpret_cast<ObsLatencyProbe *>(data);
+
+  OnStopped on_stopped{};
+  {
+    std::lock_guard<std::mutex> lock{self->mutex_};
+    on_stopped.swap(self->on_stopped_);
+  }
+  if (on_stopped) {
+    on_stopped();
+  }
+}
+}  // namespace ncstreamer
@@ -0,0 +1,61 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#ifndef NCSTREAMER_CEF_SRC_OBS_OBS_LATENCY_PROBE_H_
+#define NCSTREAMER_CEF_SRC_OBS_OBS_LATENCY_PROBE_H_
+
+
+#include <functional>
+#include <mutex>  // NOLINT
+
+#include "boost/property_tree/ptree.hpp"
+#include "obs-studio/libobs/obs.h"
+
+
+namespace ncstreamer {
+// an output which only looks at the encoded packets, measuring
+// how long a frame takes from its capture to leaving the encoder.
+class ObsLatencyProbe {
+ public:
+  using OnStopped = std::function<void()>;
+
+  // registers the output type; call once after obs_startup().
+  static void RegisterOutputType();
+
+  ObsLatencyProbe();
+  virtual ~ObsLatencyProbe();
+
+  bool Start(obs_encoder_t *audio_encoder,
+             obs_encoder_t *video_encoder);
+  // on_stopped is called once the output has stopped; at once if it
+  // was not active.
+  void Stop(const OnStopped &on_stopped);
+
+  bool IsActive() const;
+  boost::property_tree::ptree ToTree() const;
+
+ private:
+  class OutputData;
+
+  static const char *GetOutputName(void *type_data);
+  static void *CreateOutput(obs_data_t *settings, obs_output_t *output);
+  static void DestroyOutput(void *data);
+  static bool StartOutput(void *data);
+  static void StopOutput(void *data, uint64_t ts);
+  static void OnEncodedPacket(void *data, encoder_packet *packet);
+  static void GetOutputDataProc(void *data, calldata_t *params);
+  static void OnStopSignal(void *data, calldata_t *params);
+
+  obs_output_t *output_;
+  signal_handler_t *const signal_handler_;
+  OutputData *output_data_;
+
+  std::mutex mutex_;
+  OnStopped on_stopped_;
+};
+}  // namespace ncstreamer
+
+
+#endif  // NCSTREAMER_CEF_SRC_OBS_OBS_LATENCY_PROBE_H_
@@ -5,28 +5,78 @@
 
 #include "ncstreamer_cef/src/obs/obs_output.h"
 
+#include <utility>
+
+
+namespace {
+const std::size_t kMaxIncidentHistory{20};
+
+
+int64_t ToMilliseconds(const std::chrono::steady_clock::duration &duration) {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+      duration).count();
+}
+}  // unnamed namespace
+
 
 namespace ncstreamer {
-ObsOutput::ObsOutput()
+ObsOutput::ObsOutput(const std::string &name,
+                     const ObsReconnectPolicy &reconnect_policy)
     : output_{obs_output_create(
-          "rtmp_output", "simple_stream", nullptr, nullptr)},
+          "rtmp_output", name.c_str(), nullptr, nullptr)},
       signal_handler_{obs_output_get_signal_handler(output_)},
+      mutex_{},
       on_started_{},
-      on_stopped_{} {
+      on_stopped_{},
+      starting_{false},
+      stopping_{false},
+      reconnect_policy_{reconnect_policy},
+      on_reconnect_{},
+      reconnect_condition_{},
+      quit_{false},
+      reconnect_state_{ReconnectState::kIdle},
+      incident_attempts_{0},
+      incident_start_{},
+      incidents_{0},
+      reconnects_{0},
+      give_ups_{0},
+      total_downtime_{Clock::duration::zero()},
+      incident_history_{},
+      last_stop_code_{OBS_OUTPUT_SUCCESS},
+      reconnect_thread_{} {
   obs_data_t *settings = obs_data_create();
   obs_data_set_string(settings, "bind_ip", "default");
   obs_output_update(output_, settings);
   obs_data_release(settings);
 
   obs_output_set_delay(output_, 0, OBS_OUTPUT_DELAY_PRESERVE);
-  obs_output_set_reconnect_settings(
-      output_, /*max_retries*/ 20, /*retry_delay*/ 10);
+  // libobs would retry at a fixed delay; the policy takes over instead.
+  obs_output_set_reconnect_settings(output_, 0, 0);
+
+  signal_handler_connect(signal_handler_, "start", OnStartSignal, this);
+  signal_handler_connect(signal_handler_, "stop", OnStopSignal, this);
+
+  reconnect_thread_ = std::thread{&ObsOutput::Reconnect, this};
+}
+
+
+ObsOutput::ObsOutput()
+    : ObsOutput{"simple_stream", ObsReconnectPolicy{}} {
 }
 
 
 ObsOutput::~ObsOutput() {
-  on_stopped_.reset();
-  on_started_.reset();
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    quit_ = true;
+  }
+  reconnect_condition_.notify_all();
+  if (reconnect_thread_.joinable() == true) {
+    reconnect_thread_.join();
+  }
+
+  signal_handler_disconnect(signal_handler_, "stop", OnStopSignal, this);
+  signal_handler_disconnect(signal_handler_, "start", OnStartSignal, this);
 
   obs_output_release(output_);
   output_ = nullptr;
@@ -41,35 +91,318 @@ bool ObsOutput::Start(obs_encoder_t *audio_encoder,
   obs_output_set_video_encoder(output_, video_encoder);
   obs_output_set_service(output_, service);
 
-  signal_handler_disconnect(
-      signal_handler_, "start", OnStartSignal, on_started_.get());
-  on_started_.reset(new OnStarted{on_started});
-  signal_handler_connect(
-      signal_handler_, "start", OnStartSignal, on_started_.get());
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    on_started_ = on_started;
+    starting_ = true;
+    stopping_ = false;
+  }
 
-  return obs_output_start(output_);
+  last_stop_code_ = OBS_OUTPUT_SUCCESS;
+  bool result = obs_output_start(output_);
+  if (result == false) {
+    std::lock_guard<std::mutex> lock{mutex_};
+    starting_ = false;
+  }
+  return result;
 }
 
 
 void ObsOutput::Stop(const OnStopped &on_stopped) {
-  signal_handler_disconnect(
-      signal_handler_, "stop", OnStopSignal, on_stopped_.get());
-  on_stopped_.reset(new OnStopped{on_stopped});
-  signal_handler_connect(
-      signal_handler_, "stop", OnStopSignal, on_stopped_.get());
+  std::unique_lock<std::mutex> lock{mutex_};
+  on_stopped_ = on_stopped;
+  starting_ = false;
+  if (reconnect_state_ == ReconnectState::kWaiting) {
+    // between attempts, nothing of libobs runs to signal the stop.
+    EndIncidentLocked("stopped");
+    lock.unlock();
+    reconnect_condition_.notify_all();
+    if (on_stopped) {
+      on_stopped();
+    }
+    return;
+  }
+
+  if (reconnect_state_ == ReconnectState::kConnecting) {
+    EndIncidentLocked("stopped");
+  }
+  stopping_ = true;
+  // libobs signals no stop of an inactive output; a late signal finds
+  // the callback taken.
+  const bool active = (obs_output_active(output_) == true);
+  if (active == false) {
+    on_stopped_ = nullptr;
+  }
+  lock.unlock();
+  reconnect_condition_.notify_all();
 
   obs_output_stop(output_);
+  if (active == false && on_stopped) {
+    on_stopped();
+  }
+}
+
+
+void ObsOutput::GiveUp(const std::string &reason) {
+  boost::property_tree::ptree event;
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    if (reconnect_state_ == ReconnectState::kIdle) {
+      incident_attempts_ = 0;
+      incident_start_ = Clock::now();
+      ++incidents_;
+    }
+    event = EndIncidentLocked("gaveUp");
+    event.put("reason", reason);
+  }
+  reconnect_condition_.notify_all();
+  NotifyReconnect(event);
+}
+
+
+void ObsOutput::Update(obs_data_t *settings) {
+  obs_output_update(output_, settings);
+}
+
+
+void ObsOutput::SetReconnectPolicy(
+    const ObsReconnectPolicy &reconnect_policy) {
+  std::lock_guard<std::mutex> lock{mutex_};
+  reconnect_policy_ = reconnect_policy;
+}
+
+
+void ObsOutput::SetOnReconnect(const OnReconnect &on_reconnect) {
+  std::lock_guard<std::mutex> lock{mutex_};
+  on_reconnect_ = on_reconnect;
+}
+
+
+bool ObsOutput::IsActive() const {
+  return obs_output_active(output_) || IsReconnecting();
+}
+
+
+bool ObsOutput::IsStarting() const {
+  std::lock_guard<std::mutex> lock{mutex_};
+  return starting_;
+}
+
+
+bool ObsOutput::IsReconnecting() const {
+  std::lock_guard<std::mutex> lock{mutex_};
+  return reconnect_state_ != ReconnectState::kIdle;
+}
+
+
+uint64_t ObsOutput::GetTotalBytes() const {
+  return obs_output_get_total_bytes(output_);
+}
+
+
+int ObsOutput::GetTotalFrames() const {
+  return obs_output_get_total_frames(output_);
+}
+
+
+int ObsOutput::GetFramesDropped() const {
+  return obs_output_get_frames_dropped(output_);
+}
+
+
+float ObsOutput::GetCongestion() const {
+  return obs_output_get_congestion(output_);
+}
+
+
+boost::property_tree::ptree ObsOutput::GetReconnectStatus() const {
+  static const char *kStates[]{"idle", "waiting", "connecting"};
+
+  std::lock_guard<std::mutex> lock{mutex_};
+
+  boost::property_tree::ptree history;
+  for (const auto &incident : incident_history_) {
+    history.push_back(std::make_pair("", incident));
+  }
+
+  boost::property_tree::ptree tree;
+  tree.put("state", kStates[static_cast<int>(reconnect_state_)]);
+  if (reconnect_state_ != ReconnectState::kIdle) {
+    tree.put("attempt", incident_attempts_);
+    tree.put("downtimeMs", ToMilliseconds(Clock::now() - incident_start_));
+  }
+  tree.put("incidents", incidents_);
+  tree.put("reconnects", reconnects_);
+  tree.put("gaveUp", give_ups_);
+  tree.put("totalDowntimeMs", ToMilliseconds(total_downtime_));
+  tree.add_child("policy", reconnect_policy_.ToTree());
+  tree.add_child("history", history);
+  return std::move(tree);
 }
 
 
 void ObsOutput::OnStartSignal(void *data, calldata_t * /*params*/) {
-  auto on_started = reinterpret_cast<OnStarted *>(data);
-  (*on_started)();
+  auto self = reinterpret_cast<ObsOutput *>(data);
+  self->OnStart();
+}
+
+
+void ObsOutput::OnStopSignal(void *data, calldata_t *params) {
+  auto self = reinterpret_cast<ObsOutput *>(data);
+  self->OnStop(static_cast<int>(calldata_int(params, "code")));
+}
+
+
+void ObsOutput::OnStart() {
+  std::unique_lock<std::mutex> lock{mutex_};
+  starting_ = false;
+  if (stopping_ == true) {
+    return;
+  }
+
+  if (reconnect_state_ == ReconnectState::kConnecting) {
+    const auto &event = EndIncidentLocked("reconnected");
+    lock.unlock();
+    reconnect_condition_.notify_all();
+    NotifyReconnect(event);
+    return;
+  }
+
+  OnStarted on_started{on_started_};
+  lock.unlock();
+  if (on_started) {
+    on_started();
+  }
+}
+
+
+void ObsOutput::OnStop(int code) {
+  last_stop_code_ = code;
+
+  std::unique_lock<std::mutex> lock{mutex_};
+  starting_ = false;
+  if (stopping_ == true) {
+    stopping_ = false;
+    OnStopped on_stopped{on_stopped_};
+    lock.unlock();
+    if (on_stopped) {
+      on_stopped();
+    }
+    return;
+  }
+
+  boost::property_tree::ptree event;
+  if (reconnect_state_ == ReconnectState::kConnecting) {
+    event = FailAttemptLocked();
+  } else if (reconnect_state_ == ReconnectState::kIdle &&
+             code == OBS_OUTPUT_DISCONNECTED &&
+             reconnect_policy_.max_attempts() > 0) {
+    reconnect_state_ = ReconnectState::kWaiting;
+    incident_attempts_ = 0;
+    incident_start_ = Clock::now();
+    ++incidents_;
+  }
+  lock.unlock();
+  reconnect_condition_.notify_all();
+
+  if (event.empty() == false) {
+    NotifyReconnect(event);
+  }
+}
+
+
+void ObsOutput::Reconnect() {
+  std::unique_lock<std::mutex> lock{mutex_};
+  while (true) {
+    reconnect_condition_.wait(lock, [this]() {
+      return quit_ || reconnect_state_ == ReconnectState::kWaiting;
+    });
+    if (quit_ == true) {
+      break;
+    }
+
+    std::chrono::milliseconds delay =
+        reconnect_policy_.GetDelay(incident_attempts_);
+    boost::property_tree::ptree event;
+    event.put("event", "reconnecting");
+    event.put("attempt", incident_attempts_ + 1);
+    event.put("delayMs", delay.count());
+    event.put("downtimeMs", ToMilliseconds(Clock::now() - incident_start_));
+    event.put("code", last_stop_code_.load());
+    lock.unlock();
+    NotifyReconnect(event);
+    lock.lock();
+
+    // stopped, or quit, while waiting.
+    if (reconnect_condition_.wait_for(lock, delay, [this]() {
+          return quit_ || reconnect_state_ != ReconnectState::kWaiting;
+        }) == true) {
+      continue;
+    }
+
+    ++incident_attempts_;
+    reconnect_state_ = ReconnectState::kConnecting;
+    lock.unlock();
+    bool started = obs_output_start(output_);
+    lock.lock();
+
+    // otherwise the stop signal tells how the attempt went.
+    if (started == false &&
+        reconnect_state_ == ReconnectState::kConnecting) {
+      const auto &failed = FailAttemptLocked();
+      if (failed.empty() == false) {
+        lock.unlock();
+        NotifyReconnect(failed);
+        lock.lock();
+      }
+    }
+  }
+}
+
+
+boost::property_tree::ptree ObsOutput::FailAttemptLocked() {
+  if (incident_attempts_ >= reconnect_policy_.max_attempts()) {
+    return EndIncidentLocked("gaveUp");
+  }
+  reconnect_state_ = ReconnectState::kWaiting;
+  return {};
+}
+
+
+boost::property_tree::ptree ObsOutput::EndIncidentLocked(
+    const std::string &result) {
+  Clock::duration downtime = Clock::now() - incident_start_;
+  total_downtime_ += downtime;
+  if (result == "reconnected") {
+    ++reconnects_;
+  } else if (result == "gaveUp") {
+    ++give_ups_;
+  }
+  reconnect_state_ = ReconnectState::kIdle;
+
+  boost::property_tree::ptree event;
+  event.put("event", result);
+  event.put("attempts", incident_attempts_);
+  event.put("downtimeMs", ToMilliseconds(downtime));
+  event.put("code", last_stop_code_.load());
+
+  incident_history_.emplace_back(event);
+  if (incident_history_.size() > kMaxIncidentHistory) {
+    incident_history_.pop_front();
+  }
+  return std::move(event);
 }
 
 
-void ObsOutput::OnStopSignal(void *data, calldata_t * /*params*/) {
-  auto on_stopped = reinterpret_cast<OnStarted *>(data);
-  (*on_stopped)();
+void ObsOutput::NotifyReconnect(
+    const boost::property_tree::ptree &event) const {
+  OnReconnect on_reconnect;
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    on_reconnect = on_reconnect_;
+  }
+  if (on_reconnect) {
+    on_reconnect(event);
+  }
 }
 }  // namespace ncstreamer
@@ -7,18 +7,38 @@
 #define NCSTREAMER_CEF_SRC_OBS_OBS_OUTPUT_H_
 
 
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <condition_variable>  // NOLINT
+#include <deque>
 #include <functional>
 #include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <thread>  // NOLINT
 
+#include "boost/property_tree/ptree.hpp"
 #include "obs-studio/libobs/obs.h"
 
+#include "ncstreamer_cef/src/obs/obs_reconnect_policy.h"
+
 
 namespace ncstreamer {
+// an rtmp output which reconnects by a policy of its own instead of
+// the fixed delay of libobs; it stays active while reconnecting.
 class ObsOutput {
  public:
+  using Clock = std::chrono::steady_clock;
+
   using OnStarted = std::function<void()>;
   using OnStopped = std::function<void()>;
+  // "reconnecting", "reconnected" or "gaveUp", with the attempt and
+  // the downtime so far; called on the reconnect or an obs thread.
+  using OnReconnect =
+      std::function<void(const boost::property_tree::ptree &event)>;
 
+  ObsOutput(const std::string &name,
+            const ObsReconnectPolicy &reconnect_policy);
   ObsOutput();
   virtual ~ObsOutput();
 
@@ -27,16 +47,73 @@ class ObsOutput {
              obs_service_t *service,
              const OnStarted &on_started);
   void Stop(const OnStopped &on_stopped);
+  // ends the stream as if the reconnect gave up; it is reported as
+  // "gaveUp" with the reason.
+  void GiveUp(const std::string &reason);
+  // applied on the next start.
+  void Update(obs_data_t *settings);
+  // applied from the next drop of the connection.
+  void SetReconnectPolicy(const ObsReconnectPolicy &reconnect_policy);
+  void SetOnReconnect(const OnReconnect &on_reconnect);
+
+  bool IsActive() const;
+  // started, but not yet connected; not active to libobs until then.
+  bool IsStarting() const;
+  bool IsReconnecting() const;
+
+  uint64_t GetTotalBytes() const;
+  int GetTotalFrames() const;
+  int GetFramesDropped() const;
+  float GetCongestion() const;
+  int last_stop_code() const { return last_stop_code_; }
+
+  boost::property_tree::ptree GetReconnectStatus() const;
 
  private:
+  enum class ReconnectState {
+    kIdle,
+    kWaiting,
+    kConnecting,
+  };
+
   static void OnStartSignal(void *data, calldata_t *params);
   static void OnStopSignal(void *data, calldata_t *params);
 
+  void OnStart();
+  void OnStop(int code);
+
+  void Reconnect();
+  // returns the event to report, if any.
+  boost::property_tree::ptree FailAttemptLocked();
+  // the incident ends with result: "reconnected", "gaveUp" or "stopped".
+  boost::property_tree::ptree EndIncidentLocked(const std::string &result);
+  void NotifyReconnect(const boost::property_tree::ptree &event) const;
+
   obs_output_t *output_;
   signal_handler_t *const signal_handler_;
 
-  std::unique_ptr<OnStarted> on_started_;
-  std::unique_ptr<OnStopped> on_stopped_;
+  mutable std::mutex mutex_;
+  OnStarted on_started_;
+  OnStopped on_stopped_;
+  bool starting_;
+  bool stopping_;
+
+  ObsReconnectPolicy reconnect_policy_;
+  OnReconnect on_reconnect_;
+  std::condition_variable reconnect_condition_;
+  bool quit_;
+  ReconnectState reconnect_state_;
+  uint32_t incident_attempts_;
+  Clock::time_point incident_start_;
+  uint32_t incidents_;
+  uint32_t reconnects_;
+  uint32_t give_ups_;
+  Clock::duration total_downtime_;
+  std::deque<boost::property_tree::ptree> incident_history_;
+
+  std::atomic<int> last_stop_code_;
+
+  std::thread reconnect_thread_;
 };
 }  // namespace ncstreamer
 
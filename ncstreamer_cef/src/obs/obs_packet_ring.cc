@@ -0,0 +1,160 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#include "ncstreamer_cef/src/obs/obs_packet_ring.h"
+
+
+namespace ncstreamer {
+ObsPacketRing::ObsPacketRing()
+    : mutex_{},
+      packets_{},
+      data_bytes_{0},
+      last_video_dts_usec_{0},
+      max_duration_usec_{30 * 1000 * 1000},
+      max_bytes_{256 * 1024 * 1024} {
+}
+
+
+ObsPacketRing::~ObsPacketRing() {
+  Clear();
+}
+
+
+void ObsPacketRing::SetLimits(
+    int64_t max_duration_usec, std::size_t max_bytes) {
+  std::lock_guard<std::mutex> lock{mutex_};
+
+  max_duration_usec_ = max_duration_usec;
+  max_bytes_ = max_bytes;
+}
+
+
+void ObsPacketRing::Push(const encoder_packet &packet) {
+  bool is_video = (packet.type == OBS_ENCODER_VIDEO);
+
+  std::lock_guard<std::mutex> lock{mutex_};
+
+  if (packets_.empty() == true &&
+      (is_video == false || packet.keyframe == false)) {
+    return;
+  }
+
+  encoder_packet copy;
+  obs_duplicate_encoder_packet(&copy, &packet);
+  packets_.emplace_back(copy);
+  data_bytes_ += copy.size;
+  if (is_video == true) {
+    last_video_dts_usec_ = copy.dts_usec;
+  }
+
+  while (data_bytes_ > max_bytes_ ||
+         GetDurationUsecWithoutLock() > max_duration_usec_) {
+    if (EvictFrontGop() == false) {
+      break;
+    }
+  }
+}
+
+
+void ObsPacketRing::Clear() {
+  std::lock_guard<std::mutex> lock{mutex_};
+
+  while (packets_.empty() == false) {
+    PopFront();
+  }
+}
+
+
+std::vector<encoder_packet> ObsPacketRing::CopyPackets() const {
+  std::lock_guard<std::mutex> lock{mutex_};
+
+  std::vector<encoder_packet> copies(packets_.size());
+  for (std::size_t i = 0; i < packets_.size(); ++i) {
+    obs_duplicate_encoder_packet(&copies[i], &packets_[i]);
+  }
+  return copies;
+}
+
+
+void ObsPacketRing::ReleasePackets(std::vector<encoder_packet> *packets) {
+  for (auto &packet : *packets) {
+    obs_free_encoder_packet(&packet);
+  }
+  packets->clear();
+}
+
+
+int64_t ObsPacketRing::GetDurationUsec() const {
+  std::lock_guard<std::mutex> lock{mutex_};
+  return GetDurationUsecWithoutLock();
+}
+
+
+std::size_t ObsPacketRing::GetDataBytes() const {
+  std::lock_guard<std::mutex> lock{mutex_};
+  return data_bytes_;
+}
+
+
+std::size_t ObsPacketRing::GetMemoryBytes() const {
+  std::lock_guard<std::mutex> lock{mutex_};
+  return data_bytes_ + packets_.size() * sizeof(encoder_packet);
+}
+
+
+std::size_t ObsPacketRing::GetPacketCount() const {
+  std::lock_guard<std::mutex> lock{mutex_};
+  return packets_.size();
+}
+
+
+int64_t ObsPacketRing::max_duration_usec() const {
+  std::lock_guard<std::mutex> lock{mutex_};
+  return max_duration_usec_;
+}
+
+
+std::size_t ObsPacketRing::max_bytes() const {
+  std::lock_guard<std::mutex> lock{mutex_};
+  return max_bytes_;
+}
+
+
+int64_t ObsPacketRing::GetDurationUsecWithoutLock() const {
+  if (packets_.empty() == true) {
+    return 0;
+  }
+  // the front is always a video keyframe.
+  return last_video_dts_usec_ - packets_.front().dts_usec;
+}
+
+
+bool ObsPacketRing::EvictFrontGop() {
+  std::size_t next_keyframe{0};
+  for (std::size_t i = 1; i < packets_.size(); ++i) {
+    const auto &packet = packets_[i];
+    if (packet.type == OBS_ENCODER_VIDEO && packet.keyframe == true) {
+      next_keyframe = i;
+      break;
+    }
+  }
+  if (next_keyframe == 0) {
+    return false;
+  }
+
+  for (std::size_t i = 0; i < next_keyframe; ++i) {
+    PopFront();
+  }
+  return true;
+}
+
+
+void ObsPacketRing::PopFront() {
+  encoder_packet &packet = packets_.front();
+  data_bytes_ -= packet.size;
+  obs_free_encoder_packet(&packet);
+  packets_.pop_front();
+}
+}  // namespace ncstreamer
@@ -0,0 +1,58 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#ifndef NCSTREAMER_CEF_SRC_OBS_OBS_PACKET_RING_H_
+#define NCSTREAMER_CEF_SRC_OBS_OBS_PACKET_RING_H_
+
+
+#include <deque>
+#include <mutex>  // NOLINT
+#include <vector>
+
+#include "obs-studio/libobs/obs.h"
+
+
+namespace ncstreamer {
+// recent encoded packets, always starting on a video keyframe.
+// whole GOPs are evicted from the front when either limit is exceeded,
+// but the newest GOP is never evicted.
+class ObsPacketRing {
+ public:
+  ObsPacketRing();
+  virtual ~ObsPacketRing();
+
+  void SetLimits(int64_t max_duration_usec, std::size_t max_bytes);
+
+  void Push(const encoder_packet &packet);
+  void Clear();
+
+  // the caller owns the copies; release them with ReleasePackets().
+  std::vector<encoder_packet> CopyPackets() const;
+  static void ReleasePackets(std::vector<encoder_packet> *packets);
+
+  int64_t GetDurationUsec() const;
+  std::size_t GetDataBytes() const;
+  std::size_t GetMemoryBytes() const;
+  std::size_t GetPacketCount() const;
+  int64_t max_duration_usec() const;
+  std::size_t max_bytes() const;
+
+ private:
+  int64_t GetDurationUsecWithoutLock() const;
+  bool EvictFrontGop();
+  void PopFront();
+
+  mutable std::mutex mutex_;
+  std::deque<encoder_packet> packets_;
+  std::size_t data_bytes_;
+  int64_t last_video_dts_usec_;
+
+  int64_t max_duration_usec_;
+  std::size_t max_bytes_;
+};
+}  // namespace ncstreamer
+
+
+#endif  // NCSTREAMER_CEF_SRC_OBS_OBS_PACKET_RING_H_
@@ -0,0 +1,75 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#include "ncstreamer_cef/src/obs/obs_reconnect_policy.h"
+
+#include <algorithm>
+
+
+namespace ncstreamer {
+ObsReconnectPolicy::ObsReconnectPolicy(
+    const std::chrono::milliseconds &first_delay,
+    const std::chrono::milliseconds &base_delay,
+    const std::chrono::milliseconds &max_delay,
+    uint32_t max_attempts)
+    : first_delay_{first_delay},
+      base_delay_{base_delay},
+      max_delay_{(std::max)(max_delay, first_delay)},
+      max_attempts_{max_attempts},
+      random_{std::random_device{}()} {
+}
+
+
+ObsReconnectPolicy::ObsReconnectPolicy(
+    const std::chrono::milliseconds &max_delay,
+    uint32_t max_attempts)
+    : ObsReconnectPolicy{
+          std::chrono::milliseconds{500},
+          std::chrono::milliseconds{2000},
+          max_delay,
+          max_attempts} {
+}
+
+
+ObsReconnectPolicy::ObsReconnectPolicy(
+    const std::chrono::milliseconds &max_delay)
+    : ObsReconnectPolicy{max_delay, 20} {
+}
+
+
+ObsReconnectPolicy::ObsReconnectPolicy()
+    : ObsReconnectPolicy{std::chrono::milliseconds{30000}} {
+}
+
+
+ObsReconnectPolicy::~ObsReconnectPolicy() {
+}
+
+
+std::chrono::milliseconds ObsReconnectPolicy::GetDelay(uint32_t attempt) {
+  // 2^20 times the base is past any sensible ceiling.
+  static const uint32_t kMaxShift{20};
+
+  std::chrono::milliseconds delay{first_delay_};
+  if (attempt > 0) {
+    uint32_t shift = (std::min)(attempt - 1, kMaxShift);
+    std::chrono::milliseconds doubled{base_delay_.count() << shift};
+    delay = (std::min)(doubled, max_delay_);
+  }
+
+  std::uniform_int_distribution<int64_t> jitter{0, delay.count() / 2};
+  return delay - std::chrono::milliseconds{jitter(random_)};
+}
+
+
+boost::property_tree::ptree ObsReconnectPolicy::ToTree() const {
+  boost::property_tree::ptree tree;
+  tree.put("firstDelayMs", first_delay_.count());
+  tree.put("baseDelayMs", base_delay_.count());
+  tree.put("maxDelayMs", max_delay_.count());
+  tree.put("maxAttempts", max_attempts_);
+  return std::move(tree);
+}
+}  // namespace ncstreamer
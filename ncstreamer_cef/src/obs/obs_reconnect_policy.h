@@ -0,0 +1,59 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#ifndef NCSTREAMER_CEF_SRC_OBS_OBS_RECONNECT_POLICY_H_
+#define NCSTREAMER_CEF_SRC_OBS_OBS_RECONNECT_POLICY_H_
+
+
+#include <chrono>  // NOLINT
+#include <cstdint>
+#include <random>
+
+#include "boost/property_tree/ptree.hpp"
+
+
+namespace ncstreamer {
+// when to try again after the connection drops: soon for a blip, then
+// twice as long each time up to a ceiling. each delay is jittered into
+// its upper half, so that many streamers cut off by the same outage do
+// not come back to the ingest all at once.
+class ObsReconnectPolicy {
+ public:
+  ObsReconnectPolicy(
+      const std::chrono::milliseconds &first_delay,
+      const std::chrono::milliseconds &base_delay,
+      const std::chrono::milliseconds &max_delay,
+      uint32_t max_attempts);
+  // the first retry in half a second, then from 2 seconds up to max_delay,
+  // max_attempts in all; 0 never retries.
+  ObsReconnectPolicy(
+      const std::chrono::milliseconds &max_delay,
+      uint32_t max_attempts);
+  // 20 attempts in all.
+  explicit ObsReconnectPolicy(const std::chrono::milliseconds &max_delay);
+  // a ceiling of 30 seconds.
+  ObsReconnectPolicy();
+  virtual ~ObsReconnectPolicy();
+
+  // before the attempt-th retry, counted from 0.
+  std::chrono::milliseconds GetDelay(uint32_t attempt);
+
+  const std::chrono::milliseconds &max_delay() const { return max_delay_; }
+  uint32_t max_attempts() const { return max_attempts_; }
+
+  boost::property_tree::ptree ToTree() const;
+
+ private:
+  std::chrono::milliseconds first_delay_;
+  std::chrono::milliseconds base_delay_;
+  std::chrono::milliseconds max_delay_;
+  uint32_t max_attempts_;
+
+  std::mt19937 random_;
+};
+}  // namespace ncstreamer
+
+
+#endif  // NCSTREAMER_CEF_SRC_OBS_OBS_RECONNECT_POLICY_H_
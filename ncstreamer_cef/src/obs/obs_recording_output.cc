@@ -0,0 +1,91 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#include "ncstreamer_cef/src/obs/obs_recording_output.h"
+
+
+namespace ncstreamer {
+ObsRecordingOutput::ObsRecordingOutput()
+    : output_{obs_output_create(
+          "ffmpeg_muxer", "simple_file_output", nullptr, nullptr)},
+      signal_handler_{obs_output_get_signal_handler(output_)},
+      path_{},
+      on_started_{},
+      on_stopped_{} {
+}
+
+
+ObsRecordingOutput::~ObsRecordingOutput() {
+  if (IsActive() == true) {
+    obs_output_force_stop(output_);
+  }
+
+  signal_handler_disconnect(
+      signal_handler_, "start", OnStartSignal, on_started_.get());
+  signal_handler_disconnect(
+      signal_handler_, "stop", OnStopSignal, on_stopped_.get());
+  on_stopped_.reset();
+  on_started_.reset();
+
+  obs_output_release(output_);
+  output_ = nullptr;
+}
+
+
+bool ObsRecordingOutput::Start(obs_encoder_t *audio_encoder,
+                               obs_encoder_t *video_encoder,
+                               const std::string &path,
+                               const OnStarted &on_started) {
+  if (IsActive() == true) {
+    return false;
+  }
+
+  path_ = path;
+
+  obs_data_t *settings = obs_data_create();
+  obs_data_set_string(settings, "path", path_.c_str());
+  obs_output_update(output_, settings);
+  obs_data_release(settings);
+
+  obs_output_set_audio_encoder(output_, audio_encoder, 0);
+  obs_output_set_video_encoder(output_, video_encoder);
+
+  signal_handler_disconnect(
+      signal_handler_, "start", OnStartSignal, on_started_.get());
+  on_started_.reset(new OnStarted{on_started});
+  signal_handler_connect(
+      signal_handler_, "start", OnStartSignal, on_started_.get());
+
+  return obs_output_start(output_);
+}
+
+
+void ObsRecordingOutput::Stop(const OnStopped &on_stopped) {
+  signal_handler_disconnect(
+      signal_handler_, "stop", OnStopSignal, on_stopped_.get());
+  on_stopped_.reset(new OnStopped{on_stopped});
+  signal_handler_connect(
+      signal_handler_, "stop", OnStopSignal, on_stopped_.get());
+
+  obs_output_stop(output_);
+}
+
+
+bool ObsRecordingOutput::IsActive() const {
+  return obs_output_active(output_);
+}
+
+
+void ObsRecordingOutput::OnStartSignal(void *data, calldata_t * /*params*/) {
+  auto on_started = reinterpret_cast<OnStarted *>(data);
+  (*on_started)();
+}
+
+
+void ObsRecordingOutput::OnStopSignal(void *data, calldata_t * /*params*/) {
+  auto on_stopped = reinterpret_cast<OnStopped *>(data);
+  (*on_stopped)();
+}
+}  // namespace ncstreamer
@@ -0,0 +1,49 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#ifndef NCSTREAMER_CEF_SRC_OBS_OBS_RECORDING_OUTPUT_H_
+#define NCSTREAMER_CEF_SRC_OBS_OBS_RECORDING_OUTPUT_H_
+
+
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "obs-studio/libobs/obs.h"
+
+
+namespace ncstreamer {
+class ObsRecordingOutput {
+ public:
+  using OnStarted = std::function<void()>;
+  using OnStopped = std::function<void()>;
+
+  ObsRecordingOutput();
+  virtual ~ObsRecordingOutput();
+
+  bool Start(obs_encoder_t *audio_encoder,
+             obs_encoder_t *video_encoder,
+             const std::string &path,
+             const OnStarted &on_started);
+  void Stop(const OnStopped &on_stopped);
+
+  bool IsActive() const;
+  const std::string &path() const { return path_; }
+
+ private:
+  static void OnStartSignal(void *data, calldata_t *params);
+  static void OnStopSignal(void *data, calldata_t *params);
+
+  obs_output_t *output_;
+  signal_handler_t *const signal_handler_;
+  std::string path_;
+
+  std::unique_ptr<OnStarted> on_started_;
+  std::unique_ptr<OnStopped> on_stopped_;
+};
+}  // namespace ncstreamer
+
+
+#endif  // NCSTREAMER_CEF_SRC_OBS_OBS_RECORDING_OUTPUT_H_
@@ -0,0 +1,161 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#include "ncstreamer_cef/src/obs/obs_rendition.h"
+
+#include <sstream>
+#include <utility>
+
+#include "boost/property_tree/json_parser.hpp"
+
+
+namespace {
+const std::chrono::seconds kBaselineDuration{3};
+// skips the first seconds in which x264 sets up its lookahead.
+const std::chrono::seconds kSettleDuration{2};
+const std::chrono::seconds kMeasureDuration{5};
+}  // unnamed namespace
+
+
+namespace ncstreamer {
+std::vector<ObsRendition::Spec> ObsRendition::ParseSpecs(
+    const std::string &json) {
+  std::vector<Spec> specs;
+  if (json.empty() == true) {
+    return specs;
+  }
+
+  boost::property_tree::ptree root;
+  std::stringstream root_ss{json};
+  try {
+    boost::property_tree::read_json(root_ss, root);
+    const auto &arr = root.get_child("renditions", {});
+    for (const auto &elem : arr) {
+      const boost::property_tree::ptree &obj = elem.second;
+      specs.emplace_back(
+          obj.get<std::string>("name"),
+          Dimension<uint32_t>{
+              obj.get<uint32_t>("width"),
+              obj.get<uint32_t>("height")},
+          obj.get<uint32_t>("bitrate"),
+          obj.get<std::string>("preset", "veryfast"));
+    }
+  } catch (const std::exception &/*e*/) {
+    specs.clear();
+  }
+  return specs;
+}
+
+
+ObsRendition::ObsRendition(const Spec &spec)
+    : spec_{new Spec{spec}},
+      video_encoder_{CreateVideoEncoder(spec)},
+      started_time_{},
+      baseline_cpu_{-1.0},
+      overlapped_{false} {
+}
+
+
+ObsRendition::~ObsRendition() {
+  obs_encoder_release(video_encoder_);
+  video_encoder_ = nullptr;
+}
+
+
+void ObsRendition::Prepare() {
+  if (obs_encoder_active(video_encoder_) == true) {
+    return;
+  }
+
+  obs_encoder_set_scaled_size(
+      video_encoder_,
+      spec_->output_size().width(),
+      spec_->output_size().height());
+  obs_encoder_set_video(video_encoder_, obs_get_video());
+}
+
+
+void ObsRendition::MarkStarted(const CpuUsage &cpu_usage) {
+  started_time_ = CpuUsage::Clock::now();
+  baseline_cpu_ = cpu_usage.GetRecentAverage(kBaselineDuration);
+  overlapped_ = false;
+}
+
+
+void ObsRendition::MarkOverlapped() {
+  baseline_cpu_ = -1.0;
+  overlapped_ = true;
+}
+
+
+bool ObsRendition::IsMeasuring() const {
+  if (baseline_cpu_ < 0.0 && overlapped_ == false) {
+    return false;
+  }
+  return CpuUsage::Clock::now() <
+      started_time_ + kSettleDuration + kMeasureDuration;
+}
+
+
+const std::string &ObsRendition::name() const {
+  return spec_->name();
+}
+
+
+boost::property_tree::ptree ObsRendition::ToTree(
+    const CpuUsage &cpu_usage) const {
+  double cpu_cost{-1.0};
+  if (baseline_cpu_ >= 0.0) {
+    double cpu = cpu_usage.GetAverage(
+        started_time_ + kSettleDuration,
+        started_time_ + kSettleDuration + kMeasureDuration);
+    if (cpu >= 0.0) {
+      cpu_cost = cpu - baseline_cpu_;
+    }
+  }
+
+  boost::property_tree::ptree tree;
+  tree.put("name", spec_->name());
+  tree.put("width", spec_->output_size().width());
+  tree.put("height", spec_->output_size().height());
+  tree.put("bitrate", spec_->bitrate());
+  tree.put("preset", spec_->preset());
+  tree.put("active", obs_encoder_active(video_encoder_));
+  // the process cpu after the start less that before; -1 until measured,
+  // or if another encoder started in the window, as told by overlapped.
+  tree.put("cpuCost", cpu_cost);
+  tree.put("cpuCostOverlapped", overlapped_);
+  return std::move(tree);
+}
+
+
+obs_encoder_t *ObsRendition::CreateVideoEncoder(const Spec &spec) {
+  obs_data_t *settings = obs_data_create();
+  obs_data_set_string(settings, "rate_control", "CBR");
+  obs_data_set_int(settings, "bitrate", spec.bitrate());
+  obs_data_set_string(settings, "preset", spec.preset().c_str());
+
+  obs_encoder_t *encoder = obs_video_encoder_create(
+      "obs_x264", ("rendition_" + spec.name()).c_str(), settings, nullptr);
+  obs_data_release(settings);
+  return encoder;
+}
+
+
+ObsRendition::Spec::Spec(
+    const std::string &name,
+    const Dimension<uint32_t> &output_size,
+    uint32_t bitrate,
+    const std::string &preset)
+    : name_{name},
+      output_size_{output_size},
+      bitrate_{bitrate},
+      preset_{preset} {
+}
+
+
+ObsRendition::Spec::~Spec() {
+}
+}  // namespace ncstreamer
@@ -0,0 +1,87 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#ifndef NCSTREAMER_CEF_SRC_OBS_OBS_RENDITION_H_
+#define NCSTREAMER_CEF_SRC_OBS_OBS_RENDITION_H_
+
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "boost/property_tree/ptree.hpp"
+#include "obs-studio/libobs/obs.h"
+
+#include "ncstreamer_cef/src/lib/cpu_usage.h"
+#include "ncstreamer_cef/src/lib/dimension.h"
+
+
+namespace ncstreamer {
+// an extra video encoder scaled down from the shared canvas,
+// one rung of the encoding ladder.
+class ObsRendition {
+ public:
+  class Spec;
+
+  static std::vector<Spec> ParseSpecs(const std::string &json);
+
+  explicit ObsRendition(const Spec &spec);
+  virtual ~ObsRendition();
+
+  // attaches the encoder to the current video; no-op while encoding.
+  void Prepare();
+  // remembers the cpu usage right before the encoder started, so that
+  // its own cost can be measured as the difference afterward. the usage
+  // is of the whole process: another rendition starting in the window
+  // is marked as overlapped by the caller, and any other change of the
+  // load is counted in.
+  void MarkStarted(const CpuUsage &cpu_usage);
+  // after MarkStarted(); the cost is not measured, as another encoder
+  // started in the window.
+  void MarkOverlapped();
+  // from the baseline before the start to the end of the measurement.
+  bool IsMeasuring() const;
+
+  obs_encoder_t *video_encoder() const { return video_encoder_; }
+  const std::string &name() const;
+
+  boost::property_tree::ptree ToTree(const CpuUsage &cpu_usage) const;
+
+ private:
+  static obs_encoder_t *CreateVideoEncoder(const Spec &spec);
+
+  const std::unique_ptr<const Spec> spec_;
+  obs_encoder_t *video_encoder_;
+
+  CpuUsage::Clock::time_point started_time_;
+  double baseline_cpu_;
+  bool overlapped_;
+};
+
+
+class ObsRendition::Spec {
+ public:
+  Spec(
+      const std::string &name,
+      const Dimension<uint32_t> &output_size,
+      uint32_t bitrate,
+      const std::string &preset);
+  virtual ~Spec();
+
+  const std::string &name() const { return name_; }
+  const Dimension<uint32_t> &output_size() const { return output_size_; }
+  uint32_t bitrate() const { return bitrate_; }
+  const std::string &preset() const { return preset_; }
+
+ private:
+  std::string name_;
+  Dimension<uint32_t> output_size_;
+  uint32_t bitrate_;
+  std::string preset_;
+};
+}  // namespace ncstreamer
+
+
+#endif  // NCSTREAMER_CEF_SRC_OBS_OBS_RENDITION_H_
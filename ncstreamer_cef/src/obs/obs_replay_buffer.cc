@@ -0,0 +1,440 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#include "ncstreamer_cef/src/obs/obs_replay_buffer.h"
+
+#include <codecvt>
+#include <cstdio>
+#include <fstream>
+#include <locale>
+
+#include "boost/algorithm/string.hpp"
+#include "obs-studio/libobs/obs-avc.h"
+#include "windows.h"  // NOLINT
+
+
+namespace {
+const char *kOutputId{"ncstreamer_replay_buffer"};
+
+
+void WriteBigEndian(std::ostream *out, uint32_t value, std::size_t bytes) {
+  for (std::size_t i = bytes; i > 0; --i) {
+    out->put(static_cast<char>((value >> ((i - 1) * 8)) & 0xff));
+  }
+}
+
+
+void WriteFlvTag(
+    std::ostream *out,
+    uint8_t tag_type,
+    uint32_t timestamp,
+    const std::vector<uint8_t> &prefix,
+    const uint8_t *data,
+    std::size_t size) {
+  uint32_t data_size = static_cast<uint32_t>(prefix.size() + size);
+
+  out->put(static_cast<char>(tag_type));
+  WriteBigEndian(out, data_size, 3);
+  WriteBigEndian(out, timestamp & 0xffffff, 3);
+  WriteBigEndian(out, timestamp >> 24, 1);
+  WriteBigEndian(out, 0, 3);  // stream id.
+  out->write(reinterpret_cast<const char *>(prefix.data()), prefix.size());
+  out->write(reinterpret_cast<const char *>(data), size);
+  WriteBigEndian(out, 11 + data_size, 4);
+}
+}  // unnamed namespace
+
+
+namespace ncstreamer {
+class ObsReplayBuffer::OutputData {
+ public:
+  explicit OutputData(obs_output_t *output)
+      : output_{output},
+        ring_{} {
+  }
+
+  obs_output_t *output() const { return output_; }
+  ObsPacketRing *ring() { return &ring_; }
+
+ private:
+  obs_output_t *const output_;
+  ObsPacketRing ring_;
+};
+
+
+void ObsReplayBuffer::RegisterOutputType() {
+  static obs_output_info info{};
+  info.id = kOutputId;
+  info.flags = OBS_OUTPUT_AV | OBS_OUTPUT_ENCODED;
+  info.get_name = GetOutputName;
+  info.create = CreateOutput;
+  info.destroy = DestroyOutput;
+  info.start = StartOutput;
+  info.stop = StopOutput;
+  info.encoded_packet = OnEncodedPacket;
+
+  obs_register_output(&info);
+}
+
+
+ObsReplayBuffer::ObsReplayBuffer()
+    : output_{obs_output_create(
+          kOutputId, "replay_buffer_output", nullptr, nullptr)},
+      ring_{nullptr},
+      audio_encoder_{nullptr},
+      video_encoder_{nullptr},
+      save_hotkey_{OBS_INVALID_HOTKEY_ID},
+      hotkey_directory_{},
+      save_mutex_{},
+      save_thread_{},
+      saving_{false},
+      last_saved_path_{} {
+  calldata_t params = {0};
+  proc_handler_call(
+      obs_output_get_proc_handler(output_), "get_packet_ring", &params);
+  ring_ = static_cast<ObsPacketRing *>(calldata_ptr(&params, "ring"));
+  calldata_free(&params);
+
+  save_hotkey_ = obs_hotkey_register_output(
+      output_, "ncstreamer.replay_buffer.save", "Save Replay",
+      OnSaveHotkey, this);
+}
+
+
+ObsReplayBuffer::~ObsReplayBuffer() {
+  obs_hotkey_unregister(save_hotkey_);
+
+  if (save_thread_.joinable() == true) {
+    save_thread_.join();
+  }
+
+  if (IsActive() == true) {
+    obs_output_force_stop(output_);
+  }
+
+  obs_output_release(output_);
+  output_ = nullptr;
+  ring_ = nullptr;
+}
+
+
+bool ObsReplayBuffer::Start(obs_encoder_t *audio_encoder,
+                            obs_encoder_t *video_encoder,
+                            int64_t max_duration_usec,
+                            std::size_t max_bytes) {
+  if (IsActive() == true) {
+    return false;
+  }
+
+  ring_->SetLimits(max_duration_usec, max_bytes);
+
+  audio_encoder_ = audio_encoder;
+  video_encoder_ = video_encoder;
+  obs_output_set_audio_encoder(output_, audio_encoder_, 0);
+  obs_output_set_video_encoder(output_, video_encoder_);
+
+  return obs_output_start(output_);
+}
+
+
+void ObsReplayBuffer::Stop() {
+  obs_output_stop(output_);
+}
+
+
+bool ObsReplayBuffer::Save(const std::string &path, const OnSaved &on_saved) {
+  std::lock_guard<std::mutex> lock{save_mutex_};
+
+  if (IsActive() == false || saving_ == true) {
+    return false;
+  }
+  if (save_thread_.joinable() == true) {
+    save_thread_.join();
+  }
+
+  // the headers are only available while the encoders are running.
+  std::vector<uint8_t> video_header = GetVideoHeader(video_encoder_);
+  std::vector<uint8_t> audio_header = GetAudioHeader(audio_encoder_);
+  if (video_header.empty() == true || audio_header.empty() == true) {
+    return false;
+  }
+
+  std::vector<encoder_packet> packets = ring_->CopyPackets();
+  if (packets.empty() == true) {
+    return false;
+  }
+
+  saving_ = true;
+  save_thread_ = std::thread{[
+      this,
+      path,
+      video_header,
+      audio_header,
+      packets = std::move(packets),
+      on_saved]() mutable {
+    std::string error = WriteFlv(path, video_header, audio_header, packets);
+    ObsPacketRing::ReleasePackets(&packets);
+
+    if (error.empty() == true) {
+      std::lock_guard<std::mutex> lock{save_mutex_};
+      last_saved_path_ = path;
+    }
+    saving_ = false;
+    on_saved(error);
+  }};
+  return true;
+}
+
+
+void ObsReplayBuffer::BindSaveHotkey(
+    const std::string &keys, const std::string &directory) {
+  {
+    std::lock_guard<std::mutex> lock{save_mutex_};
+    hotkey_directory_ = directory;
+  }
+
+  std::vector<std::string> tokens;
+  boost::split(tokens, keys, boost::is_any_of("+"));
+
+  obs_data_t *binding = obs_data_create();
+  std::string key{};
+  for (const auto &token : tokens) {
+    std::string modifier = boost::to_lower_copy(token);
+    if (modifier == "ctrl") {
+      obs_data_set_bool(binding, "control", true);
+    } else if (modifier == "shift") {
+      obs_data_set_bool(binding, "shift", true);
+    } else if (modifier == "alt") {
+      obs_data_set_bool(binding, "alt", true);
+    } else {
+      key = "OBS_KEY_" + boost::to_upper_copy(token);
+    }
+  }
+
+  if (key.empty() == false) {
+    obs_data_set_string(binding, "key", key.c_str());
+
+    obs_data_array_t *bindings = obs_data_array_create();
+    obs_data_array_push_back(bindings, binding);
+    obs_hotkey_load(save_hotkey_, bindings);
+    obs_data_array_release(bindings);
+
+    // the game, not ncstreamer, has the focus while playing.
+    obs_hotkey_enable_background_press(true);
+  }
+  obs_data_release(binding);
+}
+
+
+bool ObsReplayBuffer::IsActive() const {
+  return obs_output_active(output_);
+}
+
+
+boost::property_tree::ptree ObsReplayBuffer::ToTree() const {
+  boost::property_tree::ptree tree;
+  tree.put("status", IsActive() ? "buffering" : "standby");
+  tree.put("seconds", ring_->GetDurationUsec() / 1000000.0);
+  tree.put("maxSeconds", ring_->max_duration_usec() / 1000000.0);
+  tree.put("dataBytes", ring_->GetDataBytes());
+  tree.put("memoryBytes", ring_->GetMemoryBytes());
+  tree.put("maxBytes", ring_->max_bytes());
+  tree.put("packets", ring_->GetPacketCount());
+  tree.put("saving", saving_ == true);
+  {
+    std::lock_guard<std::mutex> lock{save_mutex_};
+    tree.put("lastSavedPath", last_saved_path_);
+  }
+  return std::move(tree);
+}
+
+
+const char *ObsReplayBuffer::GetOutputName(void * /*type_data*/) {
+  return "NCStreamer Replay Buffer";
+}
+
+
+void *ObsReplayBuffer::CreateOutput(
+    obs_data_t * /*settings*/, obs_output_t *output) {
+  OutputData *output_data = new OutputData{output};
+  proc_handler_add(
+      obs_output_get_proc_handler(output),
+      "void get_packet_ring(out ptr ring)",
+      GetPacketRingProc,
+      output_data);
+  return output_data;
+}
+
+
+void ObsReplayBuffer::DestroyOutput(void *data) {
+  delete static_cast<OutputData *>(data);
+}
+
+
+bool ObsReplayBuffer::StartOutput(void *data) {
+  auto output_data = static_cast<OutputData *>(data);
+  obs_output_t *output = output_data->output();
+
+  if (obs_output_can_begin_data_capture(output, 0) == false) {
+    return false;
+  }
+  if (obs_output_initialize_encoders(output, 0) == false) {
+    return false;
+  }
+
+  output_data->ring()->Clear();
+  return obs_output_begin_data_capture(output, 0);
+}
+
+
+void ObsReplayBuffer::StopOutput(void *data, uint64_t /*ts*/) {
+  auto output_data = static_cast<OutputData *>(data);
+
+  obs_output_end_data_capture(output_data->output());
+  output_data->ring()->Clear();
+}
+
+
+void ObsReplayBuffer::OnEncodedPacket(void *data, encoder_packet *packet) {
+  auto output_data = static_cast<OutputData *>(data);
+  output_data->ring()->Push(*packet);
+}
+
+
+void ObsReplayBuffer::GetPacketRingProc(void *data, calldata_t *params) {
+  auto output_data = static_cast<OutputData *>(data);
+  calldata_set_ptr(params, "ring", output_data->ring());
+}
+
+
+void ObsReplayBuffer::OnSaveHotkey(
+    void *data, obs_hotkey_id /*id*/, obs_hotkey_t * /*hotkey*/,
+    bool pressed) {
+  if (pressed == false) {
+    return;
+  }
+
+  auto self = static_cast<ObsReplayBuffer *>(data);
+  std::string directory;
+  {
+    std::lock_guard<std::mutex> lock{self->save_mutex_};
+    directory = self->hotkey_directory_;
+  }
+  if (directory.empty() == true) {
+    return;
+  }
+
+  SYSTEMTIME now;
+  ::GetLocalTime(&now);
+  char file_name[64];
+  std::snprintf(file_name, sizeof(file_name),
+      "replay_%04d%02d%02d_%02d%02d%02d.flv",
+      now.wYear, now.wMonth, now.wDay,
+      now.wHour, now.wMinute, now.wSecond);
+  std::string path = directory + "\\" + file_name;
+
+  bool result = self->Save(path, [path](const std::string &error) {
+    if (error.empty() == true) {
+      blog(LOG_INFO, "replay saved: %s", path.c_str());
+    } else {
+      blog(LOG_WARNING, "replay not saved: %s", error.c_str());
+    }
+  });
+  if (result == false) {
+    blog(LOG_WARNING, "replay not ready to save.");
+  }
+}
+
+
+std::string ObsReplayBuffer::WriteFlv(
+    const std::string &path,
+    const std::vector<uint8_t> &video_header,
+    const std::vector<uint8_t> &audio_header,
+    const std::vector<encoder_packet> &packets) {
+  static const uint8_t kVideoTag{9};
+  static const uint8_t kAudioTag{8};
+
+  std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
+  std::ofstream out{converter.from_bytes(path), std::ios::binary};
+  if (!out) {
+    return "file open";
+  }
+
+  // signature, version 1, audio and video, header size 9.
+  static const char kFlvHeader[]{'F', 'L', 'V', 1, 5, 0, 0, 0, 9};
+  out.write(kFlvHeader, sizeof(kFlvHeader));
+  WriteBigEndian(&out, 0, 4);
+
+  // keyframe + AVC, sequence header, composition time 0.
+  WriteFlvTag(&out, kVideoTag, 0, {0x17, 0, 0, 0, 0},
+              video_header.data(), video_header.size());
+  // AAC 44kHz 16bit stereo, sequence header.
+  WriteFlvTag(&out, kAudioTag, 0, {0xaf, 0},
+              audio_header.data(), audio_header.size());
+
+  // the ring starts on a keyframe; audio just before it is clamped to 0.
+  int64_t start_usec = packets.front().dts_usec;
+  for (const auto &packet : packets) {
+    int64_t offset_usec = packet.dts_usec - start_usec;
+    uint32_t timestamp =
+        static_cast<uint32_t>(offset_usec > 0 ? offset_usec / 1000 : 0);
+
+    if (packet.type == OBS_ENCODER_VIDEO) {
+      int32_t composition_time = static_cast<int32_t>(
+          (packet.pts - packet.dts) * 1000 *
+          packet.timebase_num / packet.timebase_den);
+
+      encoder_packet avc_packet;
+      obs_parse_avc_packet(&avc_packet, &packet);
+      WriteFlvTag(&out, kVideoTag, timestamp, {
+          static_cast<uint8_t>(packet.keyframe ? 0x17 : 0x27),
+          1,
+          static_cast<uint8_t>((composition_time >> 16) & 0xff),
+          static_cast<uint8_t>((composition_time >> 8) & 0xff),
+          static_cast<uint8_t>(composition_time & 0xff)},
+          avc_packet.data, avc_packet.size);
+      obs_free_encoder_packet(&avc_packet);
+    } else {
+      WriteFlvTag(&out, kAudioTag, timestamp, {0xaf, 1},
+                  packet.data, packet.size);
+    }
+  }
+
+  out.close();
+  if (!out) {
+    return "file write";
+  }
+  return "";
+}
+
+
+std::vector<uint8_t> ObsReplayBuffer::GetVideoHeader(
+    obs_encoder_t *encoder) {
+  uint8_t *extra_data{nullptr};
+  std::size_t extra_size{0};
+  if (obs_encoder_get_extra_data(encoder, &extra_data, &extra_size) == false) {
+    return {};
+  }
+
+  // the encoder gives annex-b; flv wants an AVCDecoderConfigurationRecord.
+  uint8_t *header{nullptr};
+  std::size_t header_size = obs_parse_avc_header(
+      &header, extra_data, extra_size);
+  std::vector<uint8_t> result{header, header + header_size};
+  bfree(header);
+  return result;
+}
+
+
+std::vector<uint8_t> ObsReplayBuffer::GetAudioHeader(
+    obs_encoder_t *encoder) {
+  uint8_t *extra_data{nullptr};
+  std::size_t extra_size{0};
+  if (obs_encoder_get_extra_data(encoder, &extra_data, &extra_size) == false) {
+    return {};
+  }
+  return {extra_data, extra_data + extra_size};
+}
+}  // namespace ncstreamer
@@ -0,0 +1,89 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#ifndef NCSTREAMER_CEF_SRC_OBS_OBS_REPLAY_BUFFER_H_
+#define NCSTREAMER_CEF_SRC_OBS_OBS_REPLAY_BUFFER_H_
+
+
+#include <atomic>
+#include <functional>
+#include <mutex>  // NOLINT
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "boost/property_tree/ptree.hpp"
+#include "obs-studio/libobs/obs.h"
+
+#include "ncstreamer_cef/src/obs/obs_packet_ring.h"
+
+
+namespace ncstreamer {
+// keeps the last seconds of the shared encoders' packets in memory,
+// and dumps them into a flv file without touching the live outputs.
+class ObsReplayBuffer {
+ public:
+  using OnSaved = std::function<void(const std::string &error)>;
+
+  // registers the output type; call once after obs_startup().
+  static void RegisterOutputType();
+
+  ObsReplayBuffer();
+  virtual ~ObsReplayBuffer();
+
+  bool Start(obs_encoder_t *audio_encoder,
+             obs_encoder_t *video_encoder,
+             int64_t max_duration_usec,
+             std::size_t max_bytes);
+  void Stop();
+
+  // writes on a separate thread; on_saved is called from there.
+  bool Save(const std::string &path, const OnSaved &on_saved);
+
+  // keys are like "ctrl+shift+F10"; hotkey saves go into directory.
+  void BindSaveHotkey(const std::string &keys, const std::string &directory);
+
+  bool IsActive() const;
+  boost::property_tree::ptree ToTree() const;
+
+ private:
+  class OutputData;
+
+  static const char *GetOutputName(void *type_data);
+  static void *CreateOutput(obs_data_t *settings, obs_output_t *output);
+  static void DestroyOutput(void *data);
+  static bool StartOutput(void *data);
+  static void StopOutput(void *data, uint64_t ts);
+  static void OnEncodedPacket(void *data, encoder_packet *packet);
+  static void GetPacketRingProc(void *data, calldata_t *params);
+
+  static void OnSaveHotkey(
+      void *data, obs_hotkey_id id, obs_hotkey_t *hotkey, bool pressed);
+
+  static std::string WriteFlv(
+      const std::string &path,
+      const std::vector<uint8_t> &video_header,
+      const std::vector<uint8_t> &audio_header,
+      const std::vector<encoder_packet> &packets);
+  static std::vector<uint8_t> GetVideoHeader(obs_encoder_t *encoder);
+  static std::vector<uint8_t> GetAudioHeader(obs_encoder_t *encoder);
+
+  obs_output_t *output_;
+  ObsPacketRing *ring_;
+  obs_encoder_t *audio_encoder_;
+  obs_encoder_t *video_encoder_;
+
+  obs_hotkey_id save_hotkey_;
+  std::string hotkey_directory_;
+
+  mutable std::mutex save_mutex_;
+  std::thread save_thread_;
+  std::atomic<bool> saving_;
+  std::string last_saved_path_;
+};
+}  // namespace ncstreamer
+
+
+#endif  // NCSTREAMER_CEF_SRC_OBS_OBS_REPLAY_BUFFER_H_
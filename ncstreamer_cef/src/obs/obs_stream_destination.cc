@@ -0,0 +1,101 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#include "ncstreamer_cef/src/obs/obs_stream_destination.h"
+
+#include <utility>
+
+
+namespace ncstreamer {
+ObsStreamDestination::ObsStreamDestination(
+    const std::string &id,
+    const std::string &service_provider,
+    const std::string &rendition,
+    obs_service_t *service,
+    const ObsReconnectPolicy &reconnect_policy,
+    const OnEvent &on_event)
+    : id_{id},
+      service_provider_{service_provider},
+      rendition_{rendition},
+      service_{service},
+      on_event_{on_event},
+      output_{new ObsOutput{"simulcast_" + id, reconnect_policy}} {
+  output_->SetOnReconnect([this](const boost::property_tree::ptree &event) {
+    NotifyEvent(event);
+  });
+}
+
+
+ObsStreamDestination::~ObsStreamDestination() {
+  output_.reset();
+  obs_service_release(service_);
+  service_ = nullptr;
+}
+
+
+bool ObsStreamDestination::Start(
+    obs_encoder_t *audio_encoder,
+    obs_encoder_t *video_encoder,
+    const ObsOutput::OnStarted &on_started) {
+  return output_->Start(
+      audio_encoder, video_encoder, service_, [this, on_started]() {
+    boost::property_tree::ptree event;
+    event.put("event", "started");
+    NotifyEvent(event);
+    if (on_started) {
+      on_started();
+    }
+  });
+}
+
+
+void ObsStreamDestination::Stop(const ObsOutput::OnStopped &on_stopped) {
+  output_->Stop([this, on_stopped]() {
+    boost::property_tree::ptree event;
+    event.put("event", "stopped");
+    NotifyEvent(event);
+    if (on_stopped) {
+      on_stopped();
+    }
+  });
+}
+
+
+bool ObsStreamDestination::IsActive() const {
+  return output_->IsActive();
+}
+
+
+bool ObsStreamDestination::IsStarting() const {
+  return output_->IsStarting();
+}
+
+
+boost::property_tree::ptree ObsStreamDestination::ToTree() const {
+  boost::property_tree::ptree tree;
+  tree.put("id", id_);
+  tree.put("serviceProvider", service_provider_);
+  tree.put("rendition", rendition_);
+  tree.put("status", IsActive() ? "onAir" : "standby");
+  tree.put("totalBytes", output_->GetTotalBytes());
+  tree.put("totalFrames", output_->GetTotalFrames());
+  tree.put("framesDropped", output_->GetFramesDropped());
+  tree.put("congestion", output_->GetCongestion());
+  tree.put("lastStopCode", output_->last_stop_code());
+  tree.add_child("reconnect", output_->GetReconnectStatus());
+  return std::move(tree);
+}
+
+
+void ObsStreamDestination::NotifyEvent(
+    const boost::property_tree::ptree &event) const {
+  if (!on_event_) {
+    return;
+  }
+  boost::property_tree::ptree tree{event};
+  tree.put("destination", id_);
+  on_event_(tree);
+}
+}  // namespace ncstreamer
@@ -0,0 +1,66 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#ifndef NCSTREAMER_CEF_SRC_OBS_OBS_STREAM_DESTINATION_H_
+#define NCSTREAMER_CEF_SRC_OBS_OBS_STREAM_DESTINATION_H_
+
+
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "boost/property_tree/ptree.hpp"
+#include "obs-studio/libobs/obs.h"
+
+#include "ncstreamer_cef/src/obs/obs_output.h"
+
+
+namespace ncstreamer {
+// one of the extra RTMP destinations fed by the shared encoders.
+// it owns its service and output, so it starts, stops and fails alone.
+class ObsStreamDestination {
+ public:
+  // "started" and "stopped", and those of the reconnect, each with the
+  // id of the destination; called on an obs or the reconnect thread.
+  using OnEvent =
+      std::function<void(const boost::property_tree::ptree &event)>;
+
+  ObsStreamDestination(
+      const std::string &id,
+      const std::string &service_provider,
+      const std::string &rendition,
+      obs_service_t *service,
+      const ObsReconnectPolicy &reconnect_policy,
+      const OnEvent &on_event);
+  virtual ~ObsStreamDestination();
+
+  bool Start(obs_encoder_t *audio_encoder,
+             obs_encoder_t *video_encoder,
+             const ObsOutput::OnStarted &on_started);
+  void Stop(const ObsOutput::OnStopped &on_stopped);
+
+  bool IsActive() const;
+  bool IsStarting() const;
+
+  const std::string &id() const { return id_; }
+  const std::string &service_provider() const { return service_provider_; }
+  const std::string &rendition() const { return rendition_; }
+
+  boost::property_tree::ptree ToTree() const;
+
+ private:
+  void NotifyEvent(const boost::property_tree::ptree &event) const;
+
+  const std::string id_;
+  const std::string service_provider_;
+  const std::string rendition_;
+  obs_service_t *service_;
+  const OnEvent on_event_;
+  std::unique_ptr<ObsOutput> output_;
+};
+}  // namespace ncstreamer
+
+
+#endif  // NCSTREAMER_CEF_SRC_OBS_OBS_STREAM_DESTINATION_H_
@@ -0,0 +1,99 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#include "ncstreamer_cef/src/obs/obs_stream_profile.h"
+
+#include <unordered_map>
+
+
+namespace ncstreamer {
+const ObsStreamProfile *ObsStreamProfile::Find(const std::string &name) {
+  static const std::unordered_map<std::string, ObsStreamProfile> kProfiles{
+      {"normal", {
+          "normal",
+          /*preset*/ "veryfast",
+          /*tune*/ "",
+          /*threads*/ 0,
+          /*keyint_sec*/ 0,
+          /*new_socket_loop*/ false,
+          /*low_latency_mode*/ false,
+          /*drop_threshold_ms*/ 700,
+          /*use_device_timing*/ false}},
+      // no lookahead nor b-frames, sliced threads, and frames dropped
+      // rather than queued when the network falls behind.
+      {"low-latency", {
+          "low-latency",
+          /*preset*/ "veryfast",
+          /*tune*/ "zerolatency",
+          /*threads*/ 4,
+          /*keyint_sec*/ 1,
+          /*new_socket_loop*/ true,
+          /*low_latency_mode*/ true,
+          /*drop_threshold_ms*/ 300,
+          /*use_device_timing*/ true}}};
+
+  auto i = kProfiles.find(name);
+  if (i == kProfiles.end()) {
+    return nullptr;
+  }
+  return &i->second;
+}
+
+
+const ObsStreamProfile &ObsStreamProfile::GetDefault() {
+  return *Find("normal");
+}
+
+
+ObsStreamProfile::ObsStreamProfile(
+    const std::string &name,
+    const std::string &preset,
+    const std::string &tune,
+    int threads,
+    int keyint_sec,
+    bool new_socket_loop,
+    bool low_latency_mode,
+    int drop_threshold_ms,
+    bool use_device_timing)
+    : name_{name},
+      preset_{preset},
+      tune_{tune},
+      threads_{threads},
+      keyint_sec_{keyint_sec},
+      new_socket_loop_{new_socket_loop},
+      low_latency_mode_{low_latency_mode},
+      drop_threshold_ms_{drop_threshold_ms},
+      use_device_timing_{use_device_timing} {
+}
+
+
+ObsStreamProfile::~ObsStreamProfile() {
+}
+
+
+void ObsStreamProfile::ApplyToVideoEncoder(obs_data_t *settings) const {
+  obs_data_set_string(settings, "preset", preset_.c_str());
+  obs_data_set_string(settings, "tune", tune_.c_str());
+  obs_data_set_int(settings, "keyint_sec", keyint_sec_);
+
+  std::string x264opts{};
+  if (threads_ > 0) {
+    x264opts = "threads=" + std::to_string(threads_);
+  }
+  obs_data_set_string(settings, "x264opts", x264opts.c_str());
+}
+
+
+void ObsStreamProfile::ApplyToOutput(obs_data_t *settings) const {
+  obs_data_set_bool(settings, "new_socket_loop_enabled", new_socket_loop_);
+  obs_data_set_bool(settings, "low_latency_mode_enabled", low_latency_mode_);
+  obs_data_set_int(settings, "drop_threshold_ms", drop_threshold_ms_);
+}
+
+
+void ObsStreamProfile::ApplyToAudioSource(obs_data_t *settings) const {
+  obs_data_set_bool(settings, "use_device_timing", use_device_timing_);
+}
+}  // namespace ncstreamer
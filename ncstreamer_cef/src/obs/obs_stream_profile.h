@@ -0,0 +1,63 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#ifndef NCSTREAMER_CEF_SRC_OBS_OBS_STREAM_PROFILE_H_
+#define NCSTREAMER_CEF_SRC_OBS_OBS_STREAM_PROFILE_H_
+
+
+#include <string>
+
+#include "obs-studio/libobs/obs.h"
+
+
+namespace ncstreamer {
+// a named set of encoder, output and audio capture settings
+// trading quality and robustness against end-to-end latency.
+class ObsStreamProfile {
+ public:
+  // nullptr for an unknown name.
+  static const ObsStreamProfile *Find(const std::string &name);
+  static const ObsStreamProfile &GetDefault();
+
+  ObsStreamProfile(
+      const std::string &name,
+      const std::string &preset,
+      const std::string &tune,
+      int threads,
+      int keyint_sec,
+      bool new_socket_loop,
+      bool low_latency_mode,
+      int drop_threshold_ms,
+      bool use_device_timing);
+  virtual ~ObsStreamProfile();
+
+  void ApplyToVideoEncoder(obs_data_t *settings) const;
+  void ApplyToOutput(obs_data_t *settings) const;
+  void ApplyToAudioSource(obs_data_t *settings) const;
+
+  const std::string &name() const { return name_; }
+  int drop_threshold_ms() const { return drop_threshold_ms_; }
+
+ private:
+  std::string name_;
+
+  // x264; 0 or empty keeps the encoder default.
+  std::string preset_;
+  std::string tune_;
+  int threads_;
+  int keyint_sec_;
+
+  // rtmp output.
+  bool new_socket_loop_;
+  bool low_latency_mode_;
+  int drop_threshold_ms_;
+
+  // wasapi capture.
+  bool use_device_timing_;
+};
+}  // namespace ncstreamer
+
+
+#endif  // NCSTREAMER_CEF_SRC_OBS_OBS_STREAM_PROFILE_H_
@@ -0,0 +1,408 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#include "ncstreamer_cef/src/obs/obs_synthetic_source.h"
+
+#include <chrono>  // NOLINT
+#include <cmath>
+#include <condition_variable>  // NOLINT
+#include <functional>
+#include <mutex>  // NOLINT
+#include <thread>  // NOLINT
+#include <vector>
+
+
+namespace {
+const char *kVideoSourceId{"ncstreamer_synthetic_video"};
+const char *kAudioSourceId{"ncstreamer_synthetic_audio"};
+
+
+// calls on_tick(index) at start + index * interval until destroyed.
+// a late tick is not skipped, so the content never depends on timing.
+class PacedLoop {
+ public:
+  using Clock = std::chrono::steady_clock;
+  using OnTick = std::function<void(uint64_t index)>;
+
+  PacedLoop(const Clock::duration &interval, const OnTick &on_tick)
+      : mutex_{},
+        quit_condition_{},
+        quit_{false},
+        thread_{} {
+    thread_ = std::thread{[this, interval, on_tick]() {
+      Clock::time_point start{Clock::now()};
+      std::unique_lock<std::mutex> lock{mutex_};
+      for (uint64_t index = 0; ; ++index) {
+        if (quit_condition_.wait_until(
+            lock, start + interval * index, [this]() { return quit_; })) {
+          break;
+        }
+        lock.unlock();
+        on_tick(index);
+        lock.lock();
+      }
+    }};
+  }
+
+  virtual ~PacedLoop() {
+    {
+      std::lock_guard<std::mutex> lock{mutex_};
+      quit_ = true;
+    }
+    quit_condition_.notify_all();
+    if (thread_.joinable() == true) {
+      thread_.join();
+    }
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable quit_condition_;
+  bool quit_;
+  std::thread thread_;
+};
+
+
+// xorshift32; cheap, and the same sequence on every platform.
+uint32_t NextRandom(uint32_t *state) {
+  uint32_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
+
+
+// y, u, v of white, yellow, cyan, green, magenta, red, blue, black.
+const uint8_t kBars[][3]{
+    {235, 128, 128}, {210, 16, 146}, {170, 166, 16}, {145, 54, 34},
+    {106, 202, 222}, {81, 90, 240}, {41, 240, 110}, {16, 128, 128}};
+const uint32_t kBarsSize{8};
+
+
+uint32_t Hash(uint32_t a, uint32_t b, uint32_t c) {
+  uint32_t state = (a * 73856093u) ^ (b * 19349663u) ^ (c * 83492791u);
+  state |= 1;
+  return NextRandom(&state);
+}
+}  // unnamed namespace
+
+
+namespace ncstreamer {
+class ObsSyntheticSource::VideoGenerator {
+ public:
+  VideoGenerator(obs_data_t *settings, obs_source_t *source)
+      : source_{source},
+        width_{static_cast<uint32_t>(obs_data_get_int(settings, "width"))},
+        height_{static_cast<uint32_t>(obs_data_get_int(settings, "height"))},
+        fps_{static_cast<uint32_t>(obs_data_get_int(settings, "fps"))},
+        pattern_{obs_data_get_string(settings, "pattern")},
+        y_(width_ * height_),
+        u_((width_ / 2) * (height_ / 2), 128),
+        v_((width_ / 2) * (height_ / 2), 128),
+        start_ns_{os_gettime_ns()},
+        loop_{} {
+    std::chrono::nanoseconds interval{1000000000ull / fps_};
+    loop_.reset(new PacedLoop{interval, [this](uint64_t index) {
+      Render(index);
+      Output(index);
+    }});
+  }
+
+  virtual ~VideoGenerator() {
+    loop_.reset();
+  }
+
+ private:
+  void Render(uint64_t index) {
+    bool still = (pattern_ != "noise" && pattern_ != "scroll");
+    if (still == true && index > 0) {
+      return;
+    }
+
+    RenderLuma(pattern_, index, width_, height_, y_.data(), width_);
+    if (pattern_ == "noise") {
+      RenderNoiseChroma(index);
+    } else if (still == true) {
+      RenderBarsChroma();
+    }
+  }
+
+  void RenderBarsChroma() {
+    uint32_t chroma_width = width_ / 2;
+    for (uint32_t y = 0; y < height_ / 2; ++y) {
+      for (uint32_t x = 0; x < chroma_width; ++x) {
+        const uint8_t *bar = kBars[x * kBarsSize / chroma_width];
+        u_[y * chroma_width + x] = bar[1];
+        v_[y * chroma_width + x] = bar[2];
+      }
+    }
+  }
+
+  void RenderNoiseChroma(uint64_t index) {
+    uint32_t state = static_cast<uint32_t>(~index * 2654435761u) | 1;
+    for (std::size_t i = 0; i < u_.size(); ++i) {
+      uint32_t random = NextRandom(&state);
+      u_[i] = static_cast<uint8_t>(16 + (random & 0xff) % 225);
+      v_[i] = static_cast<uint8_t>(16 + ((random >> 8) & 0xff) % 225);
+    }
+  }
+
+  void Output(uint64_t index) {
+    obs_source_frame frame{};
+    frame.data[0] = y_.data();
+    frame.data[1] = u_.data();
+    frame.data[2] = v_.data();
+    frame.linesize[0] = width_;
+    frame.linesize[1] = width_ / 2;
+    frame.linesize[2] = width_ / 2;
+    frame.width = width_;
+    frame.height = height_;
+    frame.format = VIDEO_FORMAT_I420;
+    frame.full_range = false;
+    frame.timestamp = start_ns_ + index * 1000000000ull / fps_;
+    video_format_get_parameters(VIDEO_CS_601, VIDEO_RANGE_PARTIAL,
+        frame.color_matrix, frame.color_range_min, frame.color_range_max);
+
+    obs_source_output_video(source_, &frame);
+  }
+
+  obs_source_t *const source_;
+  const uint32_t width_;
+  const uint32_t height_;
+  const uint32_t fps_;
+  const std::string pattern_;
+
+  std::vector<uint8_t> y_;
+  std::vector<uint8_t> u_;
+  std::vector<uint8_t> v_;
+
+  const uint64_t start_ns_;
+  std::unique_ptr<PacedLoop> loop_;
+};
+
+
+class ObsSyntheticSource::AudioGenerator {
+ public:
+  AudioGenerator(obs_data_t *settings, obs_source_t *source)
+      : source_{source},
+        signal_{obs_data_get_string(settings, "signal")},
+        samples_per_sec_{GetSamplesPerSec(settings)},
+        left_(samples_per_sec_ / kChunksPerSec),
+        right_(samples_per_sec_ / kChunksPerSec),
+        random_state_{1},
+        start_ns_{os_gettime_ns()},
+        loop_{} {
+    std::chrono::nanoseconds interval{1000000000ull / kChunksPerSec};
+    loop_.reset(new PacedLoop{interval, [this](uint64_t index) {
+      Render(index);
+      Output(index);
+    }});
+  }
+
+  virtual ~AudioGenerator() {
+    loop_.reset();
+  }
+
+ private:
+  static const uint32_t kChunksPerSec{100};
+
+  // a rate other than the pipeline's gets resampled by libobs.
+  static uint32_t GetSamplesPerSec(obs_data_t *settings) {
+    uint32_t samples_per_sec = static_cast<uint32_t>(
+        obs_data_get_int(settings, "samples_per_sec"));
+    if (samples_per_sec != 0) {
+      return samples_per_sec;
+    }
+
+    obs_audio_info info;
+    if (obs_get_audio_info(&info) == false) {
+      return 44100;
+    }
+    return info.samples_per_sec;
+  }
+
+  void Render(uint64_t index) {
+    static const double kPi{3.14159265358979323846};
+    static const double kFrequency{440.0};
+    static const float kAmplitude{0.25f};
+
+    uint64_t first_sample = index * left_.size();
+    for (std::size_t i = 0; i < left_.size(); ++i) {
+      float value{0.0f};
+      if (signal_ == "noise") {
+        value = kAmplitude *
+            (NextRandom(&random_state_) / 2147483648.0f - 1.0f);
+      } else {
+        uint64_t sample = first_sample + i;
+        value = kAmplitude * static_cast<float>(std::sin(
+            2.0 * kPi * kFrequency * sample / samples_per_sec_));
+      }
+      left_[i] = value;
+      right_[i] = value;
+    }
+  }
+
+  void Output(uint64_t index) {
+    obs_source_audio audio{};
+    audio.data[0] = reinterpret_cast<const uint8_t *>(left_.data());
+    audio.data[1] = reinterpret_cast<const uint8_t *>(right_.data());
+    audio.frames = static_cast<uint32_t>(left_.size());
+    audio.speakers = SPEAKERS_STEREO;
+    audio.format = AUDIO_FORMAT_FLOAT_PLANAR;
+    audio.samples_per_sec = samples_per_sec_;
+    audio.timestamp = start_ns_ + index * 1000000000ull / kChunksPerSec;
+
+    obs_source_output_audio(source_, &audio);
+  }
+
+  obs_source_t *const source_;
+  const std::string signal_;
+  const uint32_t samples_per_sec_;
+
+  std::vector<float> left_;
+  std::vector<float> right_;
+  uint32_t random_state_;
+
+  const uint64_t start_ns_;
+  std::unique_ptr<PacedLoop> loop_;
+};
+
+
+void ObsSyntheticSource::RegisterSourceTypes() {
+  static obs_source_info video_info{};
+  video_info.id = kVideoSourceId;
+  video_info.type = OBS_SOURCE_TYPE_INPUT;
+  video_info.output_flags = OBS_SOURCE_ASYNC_VIDEO;
+  video_info.get_name = GetVideoSourceName;
+  video_info.create = CreateVideoGenerator;
+  video_info.destroy = DestroyVideoGenerator;
+  obs_register_source(&video_info);
+
+  static obs_source_info audio_info{};
+  audio_info.id = kAudioSourceId;
+  audio_info.type = OBS_SOURCE_TYPE_INPUT;
+  audio_info.output_flags = OBS_SOURCE_AUDIO;
+  audio_info.get_name = GetAudioSourceName;
+  audio_info.create = CreateAudioGenerator;
+  audio_info.destroy = DestroyAudioGenerator;
+  obs_register_source(&audio_info);
+}
+
+
+void ObsSyntheticSource::RenderLuma(
+    const std::string &pattern,
+    uint64_t index,
+    uint32_t width,
+    uint32_t height,
+    uint8_t *luma,
+    uint32_t linesize) {
+  if (pattern == "noise") {
+    uint32_t state = static_cast<uint32_t>(index * 2654435761u) | 1;
+    for (uint32_t y = 0; y < height; ++y) {
+      uint8_t *line = luma + y * linesize;
+      for (uint32_t x = 0; x < width; ++x) {
+        line[x] = static_cast<uint8_t>(16 + NextRandom(&state) % 220);
+      }
+    }
+  } else if (pattern == "scroll") {
+    static const uint32_t kGlyphWidth{8};
+    static const uint32_t kGlyphHeight{16};
+    static const uint32_t kPixelsPerFrame{4};
+
+    uint32_t offset = static_cast<uint32_t>(index * kPixelsPerFrame);
+    for (uint32_t y = 0; y < height; ++y) {
+      uint8_t *line = luma + y * linesize;
+      uint32_t row = y / kGlyphHeight;
+      uint32_t glyph_y = y % kGlyphHeight;
+      for (uint32_t x = 0; x < width; ++x) {
+        uint32_t text_x = x + offset;
+        uint32_t column = text_x / kGlyphWidth;
+        uint32_t glyph_x = text_x % kGlyphWidth;
+
+        // a 3x4 grid of strokes inside a margin, like a tiny font.
+        bool lit{false};
+        if (glyph_x >= 1 && glyph_x <= 6 && glyph_y >= 2 && glyph_y <= 13) {
+          lit = (Hash(column, row, (glyph_x - 1) / 2 * 4 +
+                                   (glyph_y - 2) / 3) & 1) != 0;
+        }
+        line[x] = lit ? 235 : 16;
+      }
+    }
+  } else {
+    for (uint32_t y = 0; y < height; ++y) {
+      uint8_t *line = luma + y * linesize;
+      for (uint32_t x = 0; x < width; ++x) {
+        line[x] = kBars[x * kBarsSize / width][0];
+      }
+    }
+  }
+}
+
+
+obs_source_t *ObsSyntheticSource::CreateVideoSource(
+    const Dimension<uint32_t> &size,
+    uint32_t fps,
+    const std::string &pattern) {
+  obs_data_t *settings = obs_data_create();
+  // i420 needs even dimensions.
+  obs_data_set_int(settings, "width", size.width() & ~1u);
+  obs_data_set_int(settings, "height", size.height() & ~1u);
+  obs_data_set_int(settings, "fps", fps == 0 ? 30 : fps);
+  obs_data_set_string(settings, "pattern", pattern.c_str());
+
+  obs_source_t *source = obs_source_create(
+      kVideoSourceId, "Synthetic Video", settings, nullptr);
+  obs_data_release(settings);
+  return source;
+}
+
+
+obs_source_t *ObsSyntheticSource::CreateAudioSource(
+    const std::string &signal,
+    uint32_t samples_per_sec) {
+  obs_data_t *settings = obs_data_create();
+  obs_data_set_string(settings, "signal", signal.c_str());
+  obs_data_set_int(settings, "samples_per_sec", samples_per_sec);
+
+  obs_source_t *source = obs_source_create(
+      kAudioSourceId, "Synthetic Audio", settings, nullptr);
+  obs_data_release(settings);
+  return source;
+}
+
+
+const char *ObsSyntheticSource::GetVideoSourceName(void * /*type_data*/) {
+  return "NCStreamer Synthetic Video";
+}
+
+
+void *ObsSyntheticSource::CreateVideoGenerator(
+    obs_data_t *settings, obs_source_t *source) {
+  return new VideoGenerator{settings, source};
+}
+
+
+void ObsSyntheticSource::DestroyVideoGenerator(void *data) {
+  delete static_cast<VideoGenerator *>(data);
+}
+
+
+const char *ObsSyntheticSource::GetAudioSourceName(void * /*type_data*/) {
+  return "NCStreamer Synthetic Audio";
+}
+
+
+void *ObsSyntheticSource::CreateAudioGenerator(
+    obs_data_t *settings, obs_source_t *source) {
+  return new AudioGenerator{settings, source};
+}
+
+
+void ObsSyntheticSource::DestroyAudioGenerator(void *data) {
+  delete static_cast<AudioGenerator *>(data);
+}
+}  // namespace ncstreamer
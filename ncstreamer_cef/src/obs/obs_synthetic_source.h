@@ -0,0 +1,62 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#ifndef NCSTREAMER_CEF_SRC_OBS_OBS_SYNTHETIC_SOURCE_H_
+#define NCSTREAMER_CEF_SRC_OBS_OBS_SYNTHETIC_SOURCE_H_
+
+
+#include <string>
+
+#include "obs-studio/libobs/obs.h"
+
+#include "ncstreamer_cef/src/lib/dimension.h"
+
+
+namespace ncstreamer {
+// generated video and audio, the same for every run, so that the encode
+// path can be measured without any live capture.
+class ObsSyntheticSource {
+ public:
+  // registers the source types; call once after obs_startup().
+  static void RegisterSourceTypes();
+
+  // pattern: "static" (color bars), "scroll" (scrolling text-like
+  // glyphs) or "noise" (new noise every frame).
+  static obs_source_t *CreateVideoSource(
+      const Dimension<uint32_t> &size,
+      uint32_t fps,
+      const std::string &pattern);
+  // signal: "tone" (440Hz sine) or "noise".
+  // samples_per_sec: 0 for the rate of the audio pipeline.
+  static obs_source_t *CreateAudioSource(
+      const std::string &signal,
+      uint32_t samples_per_sec);
+
+  // the luma of a frame of the pattern, for feeding an encoder without
+  // a source; the chroma is up to the caller.
+  static void RenderLuma(
+      const std::string &pattern,
+      uint64_t index,
+      uint32_t width,
+      uint32_t height,
+      uint8_t *luma,
+      uint32_t linesize);
+
+ private:
+  class VideoGenerator;
+  class AudioGenerator;
+
+  static const char *GetVideoSourceName(void *type_data);
+  static void *CreateVideoGenerator(obs_data_t *settings, obs_source_t *source);
+  static void DestroyVideoGenerator(void *data);
+
+  static const char *GetAudioSourceName(void *type_data);
+  static void *CreateAudioGenerator(obs_data_t *settings, obs_source_t *source);
+  static void DestroyAudioGenerator(void *data);
+};
+}  // namespace ncstreamer
+
+
+#endif  // NCSTREAMER_CEF_SRC_OBS_OBS_SYNTHETIC_SOURCE_H_
@@ -22,6 +22,55 @@ class RemoteMessage {
     kSettingsQualityUpdateResponse,
     kNcStreamerExitRequest,
     kNcStreamerExitResponse,  // not used.
+    kRecordingStatusRequest,
+    kRecordingStatusResponse,
+    kRecordingStartRequest,
+    kRecordingStartResponse,
+    kRecordingStopRequest,
+    kRecordingStopResponse,
+    kSimulcastStatusRequest,
+    kSimulcastStatusResponse,
+    kSimulcastStartRequest,
+    kSimulcastStartResponse,
+    kSimulcastStopRequest,
+    kSimulcastStopResponse,
+    kRenditionStatusRequest,
+    kRenditionStatusResponse,
+    kReplayBufferStatusRequest,
+    kReplayBufferStatusResponse,
+    kReplayBufferStartRequest,
+    kReplayBufferStartResponse,
+    kReplayBufferStopRequest,
+    kReplayBufferStopResponse,
+    kReplayBufferSaveRequest,
+    kReplayBufferSaveResponse,
+    kStreamingProfileUpdateRequest,
+    kStreamingProfileUpdateResponse,
+    kStreamingLatencyStatusRequest,
+    kStreamingLatencyStatusResponse,
+    kIngestStatusRequest,
+    kIngestStatusResponse,
+    kStreamingIdleStatusRequest,
+    kStreamingIdleStatusResponse,
+    kEncoderCapacityStatusRequest,
+    kEncoderCapacityStatusResponse,
+    kStreamingLagGuardStatusRequest,
+    kStreamingLagGuardStatusResponse,
+    kStreamingQualityStepEvent,  // not a response; sent to all.
+    kStreamingAudioStatusRequest,
+    kStreamingAudioStatusResponse,
+    kStreamingReconnectStatusRequest,
+    kStreamingReconnectStatusResponse,
+    kStreamingReconnectEvent,  // not a response; sent to all.
+    kBandwidthTestStartRequest,
+    kBandwidthTestStartResponse,
+    kBandwidthTestStopRequest,
+    kBandwidthTestStopResponse,
+    kBandwidthTestStatusRequest,
+    kBandwidthTestStatusResponse,
+    kHttpStatusRequest,
+    kHttpStatusResponse,
+    kSimulcastEvent,  // not a response; sent to all.
   };
 };
 }  // namespace ncstreamer
@@ -5,14 +5,24 @@
 
 #include "ncstreamer_cef/src/remote_server.h"
 
+#include <algorithm>
 #include <cassert>
+#include <chrono>  // NOLINT
 #include <functional>
 #include <sstream>
 #include <unordered_map>
 
 #include "boost/property_tree/json_parser.hpp"
+#include "include/base/cef_bind.h"
+#include "include/wrapper/cef_closure_task.h"
 
+#include "ncstreamer_cef/src/bandwidth_test.h"
+#include "ncstreamer_cef/src/encoder_capacity.h"
+#include "ncstreamer_cef/src/headless_controller.h"
 #include "ncstreamer_cef/src/js_executor.h"
+#include "ncstreamer_cef/src/lib/http_metrics.h"
+#include "ncstreamer_cef/src/lib/rtmp_ingest_server.h"
+#include "ncstreamer_cef/src/obs.h"
 #include "ncstreamer_cef/src/remote_message_types.h"
 
 
@@ -159,6 +169,719 @@ void RemoteServer::RespondSettingsQualityUpdate(
 }
 
 
+void RemoteServer::RespondRecordingStatus(
+    int request_key,
+    const std::string &status,
+    const std::string &path) {
+  websocketpp::connection_hdl connection = request_cache_.CheckOut(request_key);
+  if (!connection.lock()) {
+    LogWarning("RespondRecordingStatus: !connection.lock()");
+    return;
+  }
+
+  std::stringstream msg;
+  {
+    boost::property_tree::ptree tree;
+    tree.put("type", static_cast<int>(
+        RemoteMessage::MessageType::kRecordingStatusResponse));
+    tree.put("status", status);
+    tree.put("path", path);
+    boost::property_tree::write_json(msg, tree, false);
+  }
+
+  websocketpp::lib::error_code ec;
+  server_.send(connection, msg.str(), websocketpp::frame::opcode::text, ec);
+  if (ec) {
+    LogError(ec.message());
+    return;
+  }
+}
+
+
+void RemoteServer::RespondRecordingStart(
+    int request_key,
+    const std::string &error) {
+  websocketpp::connection_hdl connection = request_cache_.CheckOut(request_key);
+  if (!connection.lock()) {
+    LogWarning("RespondRecordingStart: !connection.lock()");
+    return;
+  }
+
+  std::stringstream msg;
+  {
+    boost::property_tree::ptree tree;
+    tree.put("type", static_cast<int>(
+        RemoteMessage::MessageType::kRecordingStartResponse));
+    tree.put("error", error);
+    boost::property_tree::write_json(msg, tree, false);
+  }
+
+  websocketpp::lib::error_code ec;
+  server_.send(connection, msg.str(), websocketpp::frame::opcode::text, ec);
+  if (ec) {
+    LogError(ec.message());
+    return;
+  }
+}
+
+
+void RemoteServer::RespondRecordingStop(
+    int request_key,
+    const std::string &error) {
+  websocketpp::connection_hdl connection = request_cache_.CheckOut(request_key);
+  if (!connection.lock()) {
+    LogWarning("RespondRecordingStop: !connection.lock()");
+    return;
+  }
+
+  std::stringstream msg;
+  {
+    boost::property_tree::ptree tree;
+    tree.put("type", static_cast<int>(
+        RemoteMessage::MessageType::kRecordingStopResponse));
+    tree.put("error", error);
+    boost::property_tree::write_json(msg, tree, false);
+  }
+
+  websocketpp::lib::error_code ec;
+  server_.send(connection, msg.str(), websocketpp::frame::opcode::text, ec);
+  if (ec) {
+    LogError(ec.message());
+    return;
+  }
+}
+
+
+void RemoteServer::RespondSimulcastStatus(
+    int request_key,
+    const std::vector<boost::property_tree::ptree> &destinations) {
+  websocketpp::connection_hdl connection = request_cache_.CheckOut(request_key);
+  if (!connection.lock()) {
+    LogWarning("RespondSimulcastStatus: !connection.lock()");
+    return;
+  }
+
+  std::stringstream msg;
+  {
+    boost::property_tree::ptree tree;
+    tree.put("type", static_cast<int>(
+        RemoteMessage::MessageType::kSimulcastStatusResponse));
+    tree.add_child("destinations", JsExecutor::ToPtree(destinations));
+    boost::property_tree::write_json(msg, tree, false);
+  }
+
+  websocketpp::lib::error_code ec;
+  server_.send(connection, msg.str(), websocketpp::frame::opcode::text, ec);
+  if (ec) {
+    LogError(ec.message());
+    return;
+  }
+}
+
+
+void RemoteServer::RespondSimulcastStart(
+    int request_key,
+    const std::string &destination,
+    const std::string &error) {
+  websocketpp::connection_hdl connection = request_cache_.CheckOut(request_key);
+  if (!connection.lock()) {
+    LogWarning("RespondSimulcastStart: !connection.lock()");
+    return;
+  }
+
+  std::stringstream msg;
+  {
+    boost::property_tree::ptree tree;
+    tree.put("type", static_cast<int>(
+        RemoteMessage::MessageType::kSimulcastStartResponse));
+    tree.put("destination", destination);
+    tree.put("error", error);
+    boost::property_tree::write_json(msg, tree, false);
+  }
+
+  websocketpp::lib::error_code ec;
+  server_.send(connection, msg.str(), websocketpp::frame::opcode::text, ec);
+  if (ec) {
+    LogError(ec.message());
+    return;
+  }
+}
+
+
+void RemoteServer::RespondSimulcastStop(
+    int request_key,
+    const std::string &destination,
+    const std::string &error) {
+  websocketpp::connection_hdl connection = request_cache_.CheckOut(request_key);
+  if (!connection.lock()) {
+    LogWarning("RespondSimulcastStop: !connection.lock()");
+    return;
+  }
+
+  std::stringstream msg;
+  {
+    boost::property_tree::ptree tree;
+    tree.put("type", static_cast<int>(
+        RemoteMessage::MessageType::kSimulcastStopResponse));
+    tree.put("destination", destination);
+    tree.put("error", error);
+    boost::property_tree::write_json(msg, tree, false);
+  }
+
+  websocketpp::lib::error_code ec;
+  server_.send(connection, msg.str(), websocketpp::frame::opcode::text, ec);
+  if (ec) {
+    LogError(ec.message());
+    return;
+  }
+}
+
+
+void RemoteServer::RespondRenditionStatus(
+    int request_key,
+    double cpu_usage,
+    const std::vector<boost::property_tree::ptree> &renditions) {
+  websocketpp::connection_hdl connection = request_cache_.CheckOut(request_key);
+  if (!connection.lock()) {
+    LogWarning("RespondRenditionStatus: !connection.lock()");
+    return;
+  }
+
+  std::stringstream msg;
+  {
+    boost::property_tree::ptree tree;
+    tree.put("type", static_cast<int>(
+        RemoteMessage::MessageType::kRenditionStatusResponse));
+    tree.put("cpuUsage", cpu_usage);
+    tree.add_child("renditions", JsExecutor::ToPtree(renditions));
+    boost::property_tree::write_json(msg, tree, false);
+  }
+
+  websocketpp::lib::error_code ec;
+  server_.send(connection, msg.str(), websocketpp::frame::opcode::text, ec);
+  if (ec) {
+    LogError(ec.message());
+    return;
+  }
+}
+
+
+void RemoteServer::RespondReplayBufferStatus(
+    int request_key,
+    const boost::property_tree::ptree &replay_buffer) {
+  websocketpp::connection_hdl connection = request_cache_.CheckOut(request_key);
+  if (!connection.lock()) {
+    LogWarning("RespondReplayBufferStatus: !connection.lock()");
+    return;
+  }
+
+  std::stringstream msg;
+  {
+    boost::property_tree::ptree tree;
+    tree.put("type", static_cast<int>(
+        RemoteMessage::MessageType::kReplayBufferStatusResponse));
+    tree.add_child("replayBuffer", replay_buffer);
+    boost::property_tree::write_json(msg, tree, false);
+  }
+
+  websocketpp::lib::error_code ec;
+  server_.send(connection, msg.str(), websocketpp::frame::opcode::text, ec);
+  if (ec) {
+    LogError(ec.message());
+    return;
+  }
+}
+
+
+void RemoteServer::RespondReplayBufferStart(
+    int request_key,
+    const std::string &error) {
+  websocketpp::connection_hdl connection = request_cache_.CheckOut(request_key);
+  if (!connection.lock()) {
+    LogWarning("RespondReplayBufferStart: !connection.lock()");
+    return;
+  }
+
+  std::stringstream msg;
+  {
+    boost::property_tree::ptree tree;
+    tree.put("type", static_cast<int>(
+        RemoteMessage::MessageType::kReplayBufferStartResponse));
+    tree.put("error", error);
+    boost::property_tree::write_json(msg, tree, false);
+  }
+
+  websocketpp::lib::error_code ec;
+  server_.send(connection, msg.str(), websocketpp::frame::opcode::text, ec);
+  if (ec) {
+    LogError(ec.message());
+    return;
+  }
+}
+
+
+void RemoteServer::RespondReplayBufferStop(
+    int request_key,
+    const std::string &error) {
+  websocketpp::connection_hdl connection = request_cache_.CheckOut(request_key);
+  if (!connection.lock()) {
+    LogWarning("RespondReplayBufferStop: !connection.lock()");
+    return;
+  }
+
+  std::stringstream msg;
+  {
+    boost::property_tree::ptree tree;
+    tree.put("type", static_cast<int>(
+        RemoteMessage::MessageType::kReplayBufferStopResponse));
+    tree.put("error", error);
+    boost::property_tree::write_json(msg, tree, false);
+  }
+
+  websocketpp::lib::error_code ec;
+  server_.send(connection, msg.str(), websocketpp::frame::opcode::text, ec);
+  if (ec) {
+    LogError(ec.message());
+    return;
+  }
+}
+
+
+void RemoteServer::RespondReplayBufferSave(
+    int request_key,
+    const std::string &path,
+    const std::string &error) {
+  websocketpp::connection_hdl connection = request_cache_.CheckOut(request_key);
+  if (!connection.lock()) {
+    LogWarning("RespondReplayBufferSave: !connection.lock()");
+    return;
+  }
+
+  std::stringstream msg;
+  {
+    boost::property_tree::ptree tree;
+    tree.put("type", static_cast<int>(
+        RemoteMessage::MessageType::kReplayBufferSaveResponse));
+    tree.put("path", path);
+    tree.put("error", error);
+    boost::property_tree::write_json(msg, tree, false);
+  }
+
+  websocketpp::lib::error_code ec;
+  server_.send(connection, msg.str(), websocketpp::frame::opcode::text, ec);
+  if (ec) {
+    LogError(ec.message());
+    return;
+  }
+}
+
+
+void RemoteServer::RespondStreamingProfileUpdate(
+    int request_key,
+    const std::string &error) {
+  websocketpp::connection_hdl connection = request_cache_.CheckOut(request_key);
+  if (!connection.lock()) {
+    LogWarning("RespondStreamingProfileUpdate: !connection.lock()");
+    return;
+  }
+
+  std::stringstream msg;
+  {
+    boost::property_tree::ptree tree;
+    tree.put("type", static_cast<int>(
+        RemoteMessage::MessageType::kStreamingProfileUpdateResponse));
+    tree.put("error", error);
+    boost::property_tree::write_json(msg, tree, false);
+  }
+
+  websocketpp::lib::error_code ec;
+  server_.send(connection, msg.str(), websocketpp::frame::opcode::text, ec);
+  if (ec) {
+    LogError(ec.message());
+    return;
+  }
+}
+
+
+void RemoteServer::RespondStreamingLatencyStatus(
+    int request_key,
+    const boost::property_tree::ptree &latency) {
+  websocketpp::connection_hdl connection = request_cache_.CheckOut(request_key);
+  if (!connection.lock()) {
+    LogWarning("RespondStreamingLatencyStatus: !connection.lock()");
+    return;
+  }
+
+  std::stringstream msg;
+  {
+    boost::property_tree::ptree tree;
+    tree.put("type", static_cast<int>(
+        RemoteMessage::MessageType::kStreamingLatencyStatusResponse));
+    tree.add_child("latency", latency);
+    boost::property_tree::write_json(msg, tree, false);
+  }
+
+  websocketpp::lib::error_code ec;
+  server_.send(connection, msg.str(), websocketpp::frame::opcode::text, ec);
+  if (ec) {
+    LogError(ec.message());
+    return;
+  }
+}
+
+
+void RemoteServer::RespondIngestStatus(
+    int request_key,
+    const boost::property_tree::ptree &ingest) {
+  websocketpp::connection_hdl connection = request_cache_.CheckOut(request_key);
+  if (!connection.lock()) {
+    LogWarning("RespondIngestStatus: !connection.lock()");
+    return;
+  }
+
+  std::stringstream msg;
+  {
+    boost::property_tree::ptree tree;
+    tree.put("type", static_cast<int>(
+        RemoteMessage::MessageType::kIngestStatusResponse));
+    tree.add_child("ingest", ingest);
+    boost::property_tree::write_json(msg, tree, false);
+  }
+
+  websocketpp::lib::error_code ec;
+  server_.send(connection, msg.str(), websocketpp::frame::opcode::text, ec);
+  if (ec) {
+    LogError(ec.message());
+    return;
+  }
+}
+
+
+void RemoteServer::RespondStreamingIdleStatus(
+    int request_key,
+    const boost::property_tree::ptree &idle) {
+  websocketpp::connection_hdl connection = request_cache_.CheckOut(request_key);
+  if (!connection.lock()) {
+    LogWarning("RespondStreamingIdleStatus: !connection.lock()");
+    return;
+  }
+
+  std::stringstream msg;
+  {
+    boost::property_tree::ptree tree;
+    tree.put("type", static_cast<int>(
+        RemoteMessage::MessageType::kStreamingIdleStatusResponse));
+    tree.add_child("idle", idle);
+    boost::property_tree::write_json(msg, tree, false);
+  }
+
+  websocketpp::lib::error_code ec;
+  server_.send(connection, msg.str(), websocketpp::frame::opcode::text, ec);
+  if (ec) {
+    LogError(ec.message());
+    return;
+  }
+}
+
+
+void RemoteServer::RespondEncoderCapacityStatus(
+    int request_key,
+    const boost::property_tree::ptree &capacity) {
+  websocketpp::connection_hdl connection = request_cache_.CheckOut(request_key);
+  if (!connection.lock()) {
+    LogWarning("RespondEncoderCapacityStatus: !connection.lock()");
+    return;
+  }
+
+  std::stringstream msg;
+  {
+    boost::property_tree::ptree tree;
+    tree.put("type", static_cast<int>(
+        RemoteMessage::MessageType::kEncoderCapacityStatusResponse));
+    tree.add_child("capacity", capacity);
+    boost::property_tree::write_json(msg, tree, false);
+  }
+
+  websocketpp::lib::error_code ec;
+  server_.send(connection, msg.str(), websocketpp::frame::opcode::text, ec);
+  if (ec) {
+    LogError(ec.message());
+    return;
+  }
+}
+
+
+void RemoteServer::RespondStreamingLagGuardStatus(
+    int request_key,
+    const boost::property_tree::ptree &lag_guard) {
+  websocketpp::connection_hdl connection = request_cache_.CheckOut(request_key);
+  if (!connection.lock()) {
+    LogWarning("RespondStreamingLagGuardStatus: !connection.lock()");
+    return;
+  }
+
+  std::stringstream msg;
+  {
+    boost::property_tree::ptree tree;
+    tree.put("type", static_cast<int>(
+        RemoteMessage::MessageType::kStreamingLagGuardStatusResponse));
+    tree.add_child("lagGuard", lag_guard);
+    boost::property_tree::write_json(msg, tree, false);
+  }
+
+  websocketpp::lib::error_code ec;
+  server_.send(connection, msg.str(), websocketpp::frame::opcode::text, ec);
+  if (ec) {
+    LogError(ec.message());
+    return;
+  }
+}
+
+
+void RemoteServer::RespondStreamingAudioStatus(
+    int request_key,
+    const boost::property_tree::ptree &audio) {
+  websocketpp::connection_hdl connection = request_cache_.CheckOut(request_key);
+  if (!connection.lock()) {
+    LogWarning("RespondStreamingAudioStatus: !connection.lock()");
+    return;
+  }
+
+  std::stringstream msg;
+  {
+    boost::property_tree::ptree tree;
+    tree.put("type", static_cast<int>(
+        RemoteMessage::MessageType::kStreamingAudioStatusResponse));
+    tree.add_child("audio", audio);
+    boost::property_tree::write_json(msg, tree, false);
+  }
+
+  websocketpp::lib::error_code ec;
+  server_.send(connection, msg.str(), websocketpp::frame::opcode::text, ec);
+  if (ec) {
+    LogError(ec.message());
+    return;
+  }
+}
+
+
+void RemoteServer::RespondStreamingReconnectStatus(
+    int request_key,
+    const boost::property_tree::ptree &reconnect) {
+  websocketpp::connection_hdl connection = request_cache_.CheckOut(request_key);
+  if (!connection.lock()) {
+    LogWarning("RespondStreamingReconnectStatus: !connection.lock()");
+    return;
+  }
+
+  std::stringstream msg;
+  {
+    boost::property_tree::ptree tree;
+    tree.put("type", static_cast<int>(
+        RemoteMessage::MessageType::kStreamingReconnectStatusResponse));
+    tree.add_child("reconnect", reconnect);
+    boost::property_tree::write_json(msg, tree, false);
+  }
+
+  websocketpp::lib::error_code ec;
+  server_.send(connection, msg.str(), websocketpp::frame::opcode::text, ec);
+  if (ec) {
+    LogError(ec.message());
+    return;
+  }
+}
+
+
+void RemoteServer::RespondBandwidthTestStart(
+    int request_key,
+    const std::string &error) {
+  websocketpp::connection_hdl connection = request_cache_.CheckOut(request_key);
+  if (!connection.lock()) {
+    LogWarning("RespondBandwidthTestStart: !connection.lock()");
+    return;
+  }
+
+  std::stringstream msg;
+  {
+    boost::property_tree::ptree tree;
+    tree.put("type", static_cast<int>(
+        RemoteMessage::MessageType::kBandwidthTestStartResponse));
+    tree.put("error", error);
+    boost::property_tree::write_json(msg, tree, false);
+  }
+
+  websocketpp::lib::error_code ec;
+  server_.send(connection, msg.str(), websocketpp::frame::opcode::text, ec);
+  if (ec) {
+    LogError(ec.message());
+    return;
+  }
+}
+
+
+void RemoteServer::RespondBandwidthTestStop(
+    int request_key,
+    const std::string &error) {
+  websocketpp::connection_hdl connection = request_cache_.CheckOut(request_key);
+  if (!connection.lock()) {
+    LogWarning("RespondBandwidthTestStop: !connection.lock()");
+    return;
+  }
+
+  std::stringstream msg;
+  {
+    boost::property_tree::ptree tree;
+    tree.put("type", static_cast<int>(
+        RemoteMessage::MessageType::kBandwidthTestStopResponse));
+    tree.put("error", error);
+    boost::property_tree::write_json(msg, tree, false);
+  }
+
+  websocketpp::lib::error_code ec;
+  server_.send(connection, msg.str(), websocketpp::frame::opcode::text, ec);
+  if (ec) {
+    LogError(ec.message());
+    return;
+  }
+}
+
+
+void RemoteServer::RespondBandwidthTestStatus(
+    int request_key,
+    const boost::property_tree::ptree &bandwidth_test) {
+  websocketpp::connection_hdl connection = request_cache_.CheckOut(request_key);
+  if (!connection.lock()) {
+    LogWarning("RespondBandwidthTestStatus: !connection.lock()");
+    return;
+  }
+
+  std::stringstream msg;
+  {
+    boost::property_tree::ptree tree;
+    tree.put("type", static_cast<int>(
+        RemoteMessage::MessageType::kBandwidthTestStatusResponse));
+    tree.add_child("bandwidthTest", bandwidth_test);
+    boost::property_tree::write_json(msg, tree, false);
+  }
+
+  websocketpp::lib::error_code ec;
+  server_.send(connection, msg.str(), websocketpp::frame::opcode::text, ec);
+  if (ec) {
+    LogError(ec.message());
+    return;
+  }
+}
+
+
+void RemoteServer::RespondHttpStatus(
+    int request_key,
+    const boost::property_tree::ptree &http) {
+  websocketpp::connection_hdl connection = request_cache_.CheckOut(request_key);
+  if (!connection.lock()) {
+    LogWarning("RespondHttpStatus: !connection.lock()");
+    return;
+  }
+
+  std::stringstream msg;
+  {
+    boost::property_tree::ptree tree;
+    tree.put("type", static_cast<int>(
+        RemoteMessage::MessageType::kHttpStatusResponse));
+    tree.add_child("http", http);
+    boost::property_tree::write_json(msg, tree, false);
+  }
+
+  websocketpp::lib::error_code ec;
+  server_.send(connection, msg.str(), websocketpp::frame::opcode::text, ec);
+  if (ec) {
+    LogError(ec.message());
+    return;
+  }
+}
+
+
+void RemoteServer::NotifyStreamingQualityStep(
+    const boost::property_tree::ptree &step) {
+  if (browser_app_) {
+    // not a response; the ui is told as if it were.
+    JsExecutor::Execute(
+        browser_app_->GetMainBrowser(),
+        "cef.onResponse",
+        "streaming/quality_step",
+        step);
+  }
+
+  std::stringstream msg;
+  {
+    boost::property_tree::ptree tree{step};
+    tree.put("type", static_cast<int>(
+        RemoteMessage::MessageType::kStreamingQualityStepEvent));
+    boost::property_tree::write_json(msg, tree, false);
+  }
+
+  std::lock_guard<std::mutex> lock{connections_mutex_};
+  for (const auto &connection : connections_) {
+    websocketpp::lib::error_code ec;
+    server_.send(connection, msg.str(), websocketpp::frame::opcode::text, ec);
+    if (ec) {
+      LogError(ec.message());
+    }
+  }
+}
+
+
+void RemoteServer::NotifyStreamingReconnect(
+    const boost::property_tree::ptree &event) {
+  if (browser_app_) {
+    // not a response; the ui is told as if it were.
+    JsExecutor::Execute(
+        browser_app_->GetMainBrowser(),
+        "cef.onResponse",
+        "streaming/reconnect",
+        event);
+  }
+
+  std::stringstream msg;
+  {
+    boost::property_tree::ptree tree{event};
+    tree.put("type", static_cast<int>(
+        RemoteMessage::MessageType::kStreamingReconnectEvent));
+    boost::property_tree::write_json(msg, tree, false);
+  }
+
+  std::lock_guard<std::mutex> lock{connections_mutex_};
+  for (const auto &connection : connections_) {
+    websocketpp::lib::error_code ec;
+    server_.send(connection, msg.str(), websocketpp::frame::opcode::text, ec);
+    if (ec) {
+      LogError(ec.message());
+    }
+  }
+}
+
+
+// the ui knows no destination; only the remote clients are told.
+void RemoteServer::NotifySimulcastEvent(
+    const boost::property_tree::ptree &event) {
+  std::stringstream msg;
+  {
+    boost::property_tree::ptree tree{event};
+    tree.put("type", static_cast<int>(
+        RemoteMessage::MessageType::kSimulcastEvent));
+    boost::property_tree::write_json(msg, tree, false);
+  }
+
+  std::lock_guard<std::mutex> lock{connections_mutex_};
+  for (const auto &connection : connections_) {
+    websocketpp::lib::error_code ec;
+    server_.send(connection, msg.str(), websocketpp::frame::opcode::text, ec);
+    if (ec) {
+      LogError(ec.message());
+    }
+  }
+}
+
+
 RemoteServer::RequestCache::RequestCache()
     : mutex_{},
       cache_{},
@@ -166,249 +889,838 @@ RemoteServer::RequestCache::RequestCache()
 }
 
 
-RemoteServer::RequestCache::~RequestCache() {
+RemoteServer::RequestCache::~RequestCache() {
+}
+
+
+int RemoteServer::RequestCache::CheckIn(
+    websocketpp::connection_hdl connection) {
+  int last_key{0};
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+
+    ++last_key_;
+    cache_.emplace(last_key_, connection);
+    last_key = last_key_;
+  }
+  return last_key;
+}
+
+
+websocketpp::connection_hdl RemoteServer::RequestCache::CheckOut(
+    int key) {
+  websocketpp::connection_hdl connection{};
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+
+    auto i = cache_.find(key);
+    if (i != cache_.end()) {
+      connection = i->second;
+      cache_.erase(i);
+    }
+  }
+  return connection;
+}
+
+
+RemoteServer::RemoteServer(
+    const BrowserApp *browser_app,
+    uint16_t port)
+    : browser_app_{browser_app},
+      io_service_{},
+      io_service_work_{io_service_},
+      server_{},
+      server_threads_{},
+      server_log_{},
+      request_cache_{},
+      connections_mutex_{},
+      connections_{} {
+  server_log_.open("remote_server.log");
+  server_.set_access_channels(websocketpp::log::alevel::all);
+  server_.set_access_channels(websocketpp::log::elevel::all);
+  server_.get_alog().set_ostream(&server_log_);
+  server_.get_elog().set_ostream(&server_log_);
+
+  {
+    websocketpp::lib::error_code ec;
+    server_.init_asio(&io_service_, ec);
+    if (ec) {
+      LogError(ec.message());
+      return;
+    }
+  }
+
+  server_.set_fail_handler(websocketpp::lib::bind(
+      &RemoteServer::OnFail, this, placeholders::_1));
+  server_.set_open_handler(websocketpp::lib::bind(
+      &RemoteServer::OnOpen, this, placeholders::_1));
+  server_.set_close_handler(websocketpp::lib::bind(
+      &RemoteServer::OnClose, this, placeholders::_1));
+  server_.set_message_handler(websocketpp::lib::bind(
+      &RemoteServer::OnMessage, this, placeholders::_1, placeholders::_2));
+
+  {
+    websocketpp::lib::error_code ec;
+    server_.listen({boost::asio::ip::address::from_string("::1"), port}, ec);
+    if (ec) {
+      LogError(ec.message());
+      return;
+    }
+  }
+  server_.start_accept();
+
+  static const std::size_t kServerThreadsSize{1};  // just one enough.
+  for (std::size_t i = 0; i < kServerThreadsSize; ++i) {
+    server_threads_.emplace_back([this]() {
+      server_.run();
+    });
+  }
+
+  Obs::Get()->SetOnVideoQualityStepped(
+      [this](const boost::property_tree::ptree &step) {
+    NotifyStreamingQualityStep(step);
+  });
+  Obs::Get()->SetOnStreamingReconnect(
+      [this](const boost::property_tree::ptree &event) {
+    NotifyStreamingReconnect(event);
+  });
+  Obs::Get()->SetOnSimulcastEvent(
+      [this](const boost::property_tree::ptree &event) {
+    NotifySimulcastEvent(event);
+  });
+}
+
+
+RemoteServer::~RemoteServer() {
+  Obs::Get()->SetOnSimulcastEvent(nullptr);
+  Obs::Get()->SetOnStreamingReconnect(nullptr);
+  Obs::Get()->SetOnVideoQualityStepped(nullptr);
+
+  server_.stop_listening();
+  server_.stop();
+  for (auto &t : server_threads_) {
+    if (t.joinable() == true) {
+      t.join();
+    }
+  }
+}
+
+
+void RemoteServer::OnFail(websocketpp::connection_hdl connection) {
+  LogError("OnFail");
+}
+
+
+void RemoteServer::OnOpen(websocketpp::connection_hdl connection) {
+  LogInfo("OnOpen");
+
+  std::lock_guard<std::mutex> lock{connections_mutex_};
+  connections_.emplace(connection);
+}
+
+
+void RemoteServer::OnClose(websocketpp::connection_hdl connection) {
+  LogInfo("OnClose");
+
+  std::lock_guard<std::mutex> lock{connections_mutex_};
+  connections_.erase(connection);
+}
+
+
+void RemoteServer::OnMessage(
+    websocketpp::connection_hdl connection,
+    websocketpp::connection<websocketpp::config::asio>::message_ptr msg) {
+  boost::property_tree::ptree msg_tree;
+  auto msg_type{RemoteMessage::MessageType::kUndefined};
+
+  std::stringstream ss{msg->get_payload()};
+  try {
+    boost::property_tree::read_json(ss, msg_tree);
+    msg_type = static_cast<RemoteMessage::MessageType>(
+        msg_tree.get<int>("type"));
+  } catch (const std::exception &/*e*/) {
+    msg_type = RemoteMessage::MessageType::kUndefined;
+  }
+
+  using MessageHandler = std::function<void(
+      const websocketpp::connection_hdl &,
+      const boost::property_tree::ptree &/*msg*/)>;
+  static const std::unordered_map<RemoteMessage::MessageType,
+                                  MessageHandler> kMessageHandlers{
+      {RemoteMessage::MessageType::kStreamingStatusRequest,
+       std::bind(&RemoteServer::OnStreamingStatusRequest,
+           this, std::placeholders::_1, std::placeholders::_2)},
+      {RemoteMessage::MessageType::kStreamingStartRequest,
+       std::bind(&RemoteServer::OnStreamingStartRequest,
+           this, std::placeholders::_1, std::placeholders::_2)},
+      {RemoteMessage::MessageType::kStreamingStopRequest,
+       std::bind(&RemoteServer::OnStreamingStopRequest,
+           this, std::placeholders::_1, std::placeholders::_2)},
+      {RemoteMessage::MessageType::kSettingsQualityUpdateRequest,
+       std::bind(&RemoteServer::OnSettingsQualityUpdateRequest,
+           this, std::placeholders::_1, std::placeholders::_2)},
+      {RemoteMessage::MessageType::kNcStreamerExitRequest,
+       std::bind(&RemoteServer::OnNcStreamerExitRequest,
+           this, std::placeholders::_1, std::placeholders::_2)},
+      {RemoteMessage::MessageType::kRecordingStatusRequest,
+       std::bind(&RemoteServer::OnRecordingStatusRequest,
+           this, std::placeholders::_1, std::placeholders::_2)},
+      {RemoteMessage::MessageType::kRecordingStartRequest,
+       std::bind(&RemoteServer::OnRecordingStartRequest,
+           this, std::placeholders::_1, std::placeholders::_2)},
+      {RemoteMessage::MessageType::kRecordingStopRequest,
+       std::bind(&RemoteServer::OnRecordingStopRequest,
+           this, std::placeholders::_1, std::placeholders::_2)},
+      {RemoteMessage::MessageType::kSimulcastStatusRequest,
+       std::bind(&RemoteServer::OnSimulcastStatusRequest,
+           this, std::placeholders::_1, std::placeholders::_2)},
+      {RemoteMessage::MessageType::kSimulcastStartRequest,
+       std::bind(&RemoteServer::OnSimulcastStartRequest,
+           this, std::placeholders::_1, std::placeholders::_2)},
+      {RemoteMessage::MessageType::kSimulcastStopRequest,
+       std::bind(&RemoteServer::OnSimulcastStopRequest,
+           this, std::placeholders::_1, std::placeholders::_2)},
+      {RemoteMessage::MessageType::kRenditionStatusRequest,
+       std::bind(&RemoteServer::OnRenditionStatusRequest,
+           this, std::placeholders::_1, std::placeholders::_2)},
+      {RemoteMessage::MessageType::kReplayBufferStatusRequest,
+       std::bind(&RemoteServer::OnReplayBufferStatusRequest,
+           this, std::placeholders::_1, std::placeholders::_2)},
+      {RemoteMessage::MessageType::kReplayBufferStartRequest,
+       std::bind(&RemoteServer::OnReplayBufferStartRequest,
+           this, std::placeholders::_1, std::placeholders::_2)},
+      {RemoteMessage::MessageType::kReplayBufferStopRequest,
+       std::bind(&RemoteServer::OnReplayBufferStopRequest,
+           this, std::placeholders::_1, std::placeholders::_2)},
+      {RemoteMessage::MessageType::kReplayBufferSaveRequest,
+       std::bind(&RemoteServer::OnReplayBufferSaveRequest,
+           this, std::placeholders::_1, std::placeholders::_2)},
+      {RemoteMessage::MessageType::kStreamingProfileUpdateRequest,
+       std::bind(&RemoteServer::OnStreamingProfileUpdateRequest,
+           this, std::placeholders::_1, std::placeholders::_2)},
+      {RemoteMessage::MessageType::kStreamingLatencyStatusRequest,
+       std::bind(&RemoteServer::OnStreamingLatencyStatusRequest,
+           this, std::placeholders::_1, std::placeholders::_2)},
+      {RemoteMessage::MessageType::kIngestStatusRequest,
+       std::bind(&RemoteServer::OnIngestStatusRequest,
+           this, std::placeholders::_1, std::placeholders::_2)},
+      {RemoteMessage::MessageType::kStreamingIdleStatusRequest,
+       std::bind(&RemoteServer::OnStreamingIdleStatusRequest,
+           this, std::placeholders::_1, std::placeholders::_2)},
+      {RemoteMessage::MessageType::kEncoderCapacityStatusRequest,
+       std::bind(&RemoteServer::OnEncoderCapacityStatusRequest,
+           this, std::placeholders::_1, std::placeholders::_2)},
+      {RemoteMessage::MessageType::kStreamingLagGuardStatusRequest,
+       std::bind(&RemoteServer::OnStreamingLagGuardStatusRequest,
+           this, std::placeholders::_1, std::placeholders::_2)},
+      {RemoteMessage::MessageType::kStreamingAudioStatusRequest,
+       std::bind(&RemoteServer::OnStreamingAudioStatusRequest,
+           this, std::placeholders::_1, std::placeholders::_2)},
+      {RemoteMessage::MessageType::kStreamingReconnectStatusRequest,
+       std::bind(&RemoteServer::OnStreamingReconnectStatusRequest,
+           this, std::placeholders::_1, std::placeholders::_2)},
+      {RemoteMessage::MessageType::kBandwidthTestStartRequest,
+       std::bind(&RemoteServer::OnBandwidthTestStartRequest,
+           this, std::placeholders::_1, std::placeholders::_2)},
+      {RemoteMessage::MessageType::kBandwidthTestStopRequest,
+       std::bind(&RemoteServer::OnBandwidthTestStopRequest,
+           this, std::placeholders::_1, std::placeholders::_2)},
+      {RemoteMessage::MessageType::kBandwidthTestStatusRequest,
+       std::bind(&RemoteServer::OnBandwidthTestStatusRequest,
+           this, std::placeholders::_1, std::placeholders::_2)},
+      {RemoteMessage::MessageType::kHttpStatusRequest,
+       std::bind(&RemoteServer::OnHttpStatusRequest,
+           this, std::placeholders::_1, std::placeholders::_2)}};
+
+  auto i = kMessageHandlers.find(msg_type);
+  if (i == kMessageHandlers.end()) {
+    std::stringstream err;
+    err << "unknown message type: " << static_cast<int>(msg_type);
+    LogError(err.str());
+    return;
+  }
+  i->second(connection, msg_tree);
+}
+
+
+void RemoteServer::OnStreamingStatusRequest(
+    const websocketpp::connection_hdl &connection,
+    const boost::property_tree::ptree &/*tree*/) {
+  int request_key = request_cache_.CheckIn(connection);
+
+  if (!browser_app_) {
+    HeadlessController::Get()->OnStreamingStatusRequest(request_key);
+    return;
+  }
+
+  JsExecutor::Execute(
+      browser_app_->GetMainBrowser(),
+      "remote.onStreamingStatusRequest",
+      request_key);
+}
+
+
+void RemoteServer::OnStreamingStartRequest(
+    const websocketpp::connection_hdl &connection,
+    const boost::property_tree::ptree &tree) {
+  const std::string &title = tree.get("title", "");
+  if (title.empty()) {
+    LogError("OnStreamingStartRequest: title empty.");
+    return;
+  }
+
+  boost::property_tree::ptree args;
+  args.add("sourceTitle", title);
+
+  int request_key = request_cache_.CheckIn(connection);
+
+  if (!browser_app_) {
+    HeadlessController::Get()->OnStreamingStartRequest(
+        request_key,
+        title,
+        tree.get("serviceProvider", "Facebook Live"),
+        tree.get("streamUrl", ""),
+        tree.get("mic", false));
+    return;
+  }
+
+  JsExecutor::Execute(
+      browser_app_->GetMainBrowser(),
+      "remote.onStreamingStartRequest",
+      request_key,
+      args);
+}
+
+
+void RemoteServer::OnStreamingStopRequest(
+    const websocketpp::connection_hdl &connection,
+    const boost::property_tree::ptree &tree) {
+  const std::string &title = tree.get("title", "");
+  if (title.empty()) {
+    LogError("OnStreamingStopRequest: title empty.");
+    return;
+  }
+
+  boost::property_tree::ptree args;
+  args.add("sourceTitle", title);
+
+  int request_key = request_cache_.CheckIn(connection);
+
+  if (!browser_app_) {
+    HeadlessController::Get()->OnStreamingStopRequest(request_key, title);
+    return;
+  }
+
+  JsExecutor::Execute(
+      browser_app_->GetMainBrowser(),
+      "remote.onStreamingStopRequest",
+      request_key,
+      args);
+}
+
+
+void RemoteServer::OnSettingsQualityUpdateRequest(
+    const websocketpp::connection_hdl &connection,
+    const boost::property_tree::ptree &tree) {
+  const std::string &quality = tree.get("quality", "");
+  if (quality.empty()) {
+    LogError("OnSettingsQualityUpdateRequest: quality empty.");
+    return;
+  }
+
+  boost::property_tree::ptree args;
+  args.add("quality", quality);
+
+  int request_key = request_cache_.CheckIn(connection);
+
+  if (!browser_app_) {
+    HeadlessController::Get()->OnSettingsQualityUpdateRequest(
+        request_key, quality);
+    return;
+  }
+
+  JsExecutor::Execute(
+      browser_app_->GetMainBrowser(),
+      "remote.onSettingsQualityUpdateRequest",
+      request_key,
+      args);
+}
+
+
+void RemoteServer::OnNcStreamerExitRequest(
+    const websocketpp::connection_hdl &/*connection*/,
+    const boost::property_tree::ptree &/*tree*/) {
+  if (!browser_app_) {
+    HeadlessController::Get()->Quit();
+    return;
+  }
+
+  HWND wnd = browser_app_->GetMainBrowser()->GetHost()->GetWindowHandle();
+  ::PostMessage(wnd, WM_CLOSE, NULL, NULL);
+}
+
+
+void RemoteServer::OnRecordingStatusRequest(
+    const websocketpp::connection_hdl &connection,
+    const boost::property_tree::ptree &/*tree*/) {
+  int request_key = request_cache_.CheckIn(connection);
+
+  bool recording = Obs::Get()->IsRecording();
+  RespondRecordingStatus(
+      request_key,
+      recording ? "recording" : "standby",
+      recording ? Obs::Get()->GetRecordingPath() : "");
+}
+
+
+void RemoteServer::OnRecordingStartRequest(
+    const websocketpp::connection_hdl &connection,
+    const boost::property_tree::ptree &tree) {
+  const std::string &path = tree.get("path", "");
+  if (path.empty()) {
+    LogError("OnRecordingStartRequest: path empty.");
+    return;
+  }
+
+  const std::string title = tree.get("title", "");
+  const bool dedicated_encoder = (tree.get("encoder", "shared") == "dedicated");
+  bool mic = tree.get("mic", false);
+
+  int request_key = request_cache_.CheckIn(connection);
+
+  PostToObsThread([this, request_key, path, title, dedicated_encoder, mic]() {
+    if (Obs::Get()->IsRecording() == true) {
+      RespondRecordingStart(request_key, "not standby");
+      return;
+    }
+
+    // a recording alone captures its own source; otherwise, it shares
+    // the one already being streamed, or connecting to be.
+    std::string source{};
+    if (Obs::Get()->IsCapturing() == false) {
+      source = Obs::Get()->FindSourceByTitle(title);
+      if (source.empty()) {
+        RespondRecordingStart(request_key, "unknown title");
+        return;
+      }
+    }
+
+    bool result = Obs::Get()->StartRecording(
+        source,
+        mic,
+        path,
+        dedicated_encoder,
+        [this, request_key]() {
+      RespondRecordingStart(request_key, "");
+    });
+    if (result == false) {
+      RespondRecordingStart(request_key, "obs internal");
+    }
+  });
+}
+
+
+void RemoteServer::OnRecordingStopRequest(
+    const websocketpp::connection_hdl &connection,
+    const boost::property_tree::ptree &/*tree*/) {
+  int request_key = request_cache_.CheckIn(connection);
+
+  PostToObsThread([this, request_key]() {
+    if (Obs::Get()->IsRecording() == false) {
+      RespondRecordingStop(request_key, "not recording");
+      return;
+    }
+
+    Obs::Get()->StopRecording([this, request_key]() {
+      RespondRecordingStop(request_key, "");
+    });
+  });
+}
+
+
+void RemoteServer::OnSimulcastStatusRequest(
+    const websocketpp::connection_hdl &connection,
+    const boost::property_tree::ptree &/*tree*/) {
+  int request_key = request_cache_.CheckIn(connection);
+
+  RespondSimulcastStatus(
+      request_key,
+      Obs::Get()->GetSimulcastStatus());
+}
+
+
+void RemoteServer::OnSimulcastStartRequest(
+    const websocketpp::connection_hdl &connection,
+    const boost::property_tree::ptree &tree) {
+  const std::string &destination = tree.get("destination", "");
+  if (destination.empty()) {
+    LogError("OnSimulcastStartRequest: destination empty.");
+    return;
+  }
+
+  const std::string &stream_url = tree.get("streamUrl", "");
+  if (stream_url.empty()) {
+    LogError("OnSimulcastStartRequest: streamUrl empty.");
+    return;
+  }
+
+  const std::string &service_provider =
+      tree.get("serviceProvider", "Facebook Live");
+  const std::string &rendition = tree.get("rendition", "");
+  const std::string &title = tree.get("title", "");
+  bool mic = tree.get("mic", false);
+
+  // the reconnect of the stream, unless the destination has its own.
+  const ObsReconnectPolicy stream_policy{Obs::Get()->GetReconnectPolicy()};
+  const ObsReconnectPolicy reconnect_policy{
+      std::chrono::seconds{tree.get<int64_t>(
+          "reconnectMaxDelay",
+          std::chrono::duration_cast<std::chrono::seconds>(
+              stream_policy.max_delay()).count())},
+      tree.get<uint32_t>(
+          "reconnectMaxAttempts", stream_policy.max_attempts())};
+
+  int request_key = request_cache_.CheckIn(connection);
+
+  std::string source{};
+  if (Obs::Get()->IsCapturing() == false) {
+    source = Obs::Get()->FindSourceByTitle(title);
+    if (source.empty()) {
+      RespondSimulcastStart(request_key, destination, "unknown title");
+      return;
+    }
+  }
+
+  bool result = Obs::Get()->StartSimulcast(
+      destination,
+      source,
+      mic,
+      service_provider,
+      stream_url,
+      rendition,
+      reconnect_policy,
+      [this, request_key, destination]() {
+    RespondSimulcastStart(request_key, destination, "");
+  });
+  if (result == false) {
+    RespondSimulcastStart(request_key, destination, "obs internal");
+  }
+}
+
+
+void RemoteServer::OnSimulcastStopRequest(
+    const websocketpp::connection_hdl &connection,
+    const boost::property_tree::ptree &tree) {
+  const std::string &destination = tree.get("destination", "");
+  if (destination.empty()) {
+    LogError("OnSimulcastStopRequest: destination empty.");
+    return;
+  }
+
+  int request_key = request_cache_.CheckIn(connection);
+
+  bool result = Obs::Get()->StopSimulcast(
+      destination,
+      [this, request_key, destination]() {
+    RespondSimulcastStop(request_key, destination, "");
+  });
+  if (result == false) {
+    RespondSimulcastStop(request_key, destination, "not onAir");
+  }
+}
+
+
+void RemoteServer::OnRenditionStatusRequest(
+    const websocketpp::connection_hdl &connection,
+    const boost::property_tree::ptree &/*tree*/) {
+  int request_key = request_cache_.CheckIn(connection);
+
+  RespondRenditionStatus(
+      request_key,
+      Obs::Get()->GetCpuUsage(),
+      Obs::Get()->GetRenditionStatus());
 }
 
 
-int RemoteServer::RequestCache::CheckIn(
-    websocketpp::connection_hdl connection) {
-  int last_key{0};
-  {
-    std::lock_guard<std::mutex> lock{mutex_};
+void RemoteServer::OnReplayBufferStatusRequest(
+    const websocketpp::connection_hdl &connection,
+    const boost::property_tree::ptree &/*tree*/) {
+  int request_key = request_cache_.CheckIn(connection);
 
-    ++last_key_;
-    cache_.emplace(last_key_, connection);
-    last_key = last_key_;
-  }
-  return last_key;
+  RespondReplayBufferStatus(
+      request_key,
+      Obs::Get()->GetReplayBufferStatus());
 }
 
 
-websocketpp::connection_hdl RemoteServer::RequestCache::CheckOut(
-    int key) {
-  websocketpp::connection_hdl connection{};
-  {
-    std::lock_guard<std::mutex> lock{mutex_};
+void RemoteServer::OnReplayBufferStartRequest(
+    const websocketpp::connection_hdl &connection,
+    const boost::property_tree::ptree &tree) {
+  const std::string &title = tree.get("title", "");
+  bool mic = tree.get("mic", false);
+  int seconds = tree.get("seconds", 30);
+  int megabytes = tree.get("megabytes", 256);
+  if (seconds <= 0 || megabytes <= 0) {
+    LogError("OnReplayBufferStartRequest: limits not positive.");
+    return;
+  }
 
-    auto i = cache_.find(key);
-    if (i != cache_.end()) {
-      connection = i->second;
-      cache_.erase(i);
+  int request_key = request_cache_.CheckIn(connection);
+
+  if (Obs::Get()->IsReplayBuffering() == true) {
+    RespondReplayBufferStart(request_key, "not standby");
+    return;
+  }
+
+  std::string source{};
+  if (Obs::Get()->IsCapturing() == false) {
+    source = Obs::Get()->FindSourceByTitle(title);
+    if (source.empty()) {
+      RespondReplayBufferStart(request_key, "unknown title");
+      return;
     }
   }
-  return connection;
+
+  bool result = Obs::Get()->StartReplayBuffer(
+      source,
+      mic,
+      static_cast<int64_t>(seconds) * 1000 * 1000,
+      static_cast<std::size_t>(megabytes) * 1024 * 1024);
+  RespondReplayBufferStart(request_key, result ? "" : "obs internal");
 }
 
 
-RemoteServer::RemoteServer(
-    const BrowserApp *browser_app,
-    uint16_t port)
-    : browser_app_{browser_app},
-      io_service_{},
-      io_service_work_{io_service_},
-      server_{},
-      server_threads_{},
-      server_log_{},
-      request_cache_{} {
-  server_log_.open("remote_server.log");
-  server_.set_access_channels(websocketpp::log::alevel::all);
-  server_.set_access_channels(websocketpp::log::elevel::all);
-  server_.get_alog().set_ostream(&server_log_);
-  server_.get_elog().set_ostream(&server_log_);
+void RemoteServer::OnReplayBufferStopRequest(
+    const websocketpp::connection_hdl &connection,
+    const boost::property_tree::ptree &/*tree*/) {
+  int request_key = request_cache_.CheckIn(connection);
 
-  {
-    websocketpp::lib::error_code ec;
-    server_.init_asio(&io_service_, ec);
-    if (ec) {
-      LogError(ec.message());
-      return;
-    }
+  if (Obs::Get()->IsReplayBuffering() == false) {
+    RespondReplayBufferStop(request_key, "not buffering");
+    return;
   }
 
-  server_.set_fail_handler(websocketpp::lib::bind(
-      &RemoteServer::OnFail, this, placeholders::_1));
-  server_.set_open_handler(websocketpp::lib::bind(
-      &RemoteServer::OnOpen, this, placeholders::_1));
-  server_.set_close_handler(websocketpp::lib::bind(
-      &RemoteServer::OnClose, this, placeholders::_1));
-  server_.set_message_handler(websocketpp::lib::bind(
-      &RemoteServer::OnMessage, this, placeholders::_1, placeholders::_2));
+  Obs::Get()->StopReplayBuffer();
+  RespondReplayBufferStop(request_key, "");
+}
 
-  {
-    websocketpp::lib::error_code ec;
-    server_.listen({boost::asio::ip::address::from_string("::1"), port}, ec);
-    if (ec) {
-      LogError(ec.message());
-      return;
-    }
+
+void RemoteServer::OnReplayBufferSaveRequest(
+    const websocketpp::connection_hdl &connection,
+    const boost::property_tree::ptree &tree) {
+  const std::string &path = tree.get("path", "");
+  if (path.empty()) {
+    LogError("OnReplayBufferSaveRequest: path empty.");
+    return;
   }
-  server_.start_accept();
 
-  static const std::size_t kServerThreadsSize{1};  // just one enough.
-  for (std::size_t i = 0; i < kServerThreadsSize; ++i) {
-    server_threads_.emplace_back([this]() {
-      server_.run();
-    });
+  int request_key = request_cache_.CheckIn(connection);
+
+  bool result = Obs::Get()->SaveReplayBuffer(
+      path,
+      [this, request_key, path](const std::string &error) {
+    RespondReplayBufferSave(request_key, path, error);
+  });
+  if (result == false) {
+    RespondReplayBufferSave(request_key, path, "not ready");
   }
 }
 
 
-RemoteServer::~RemoteServer() {
-  server_.stop_listening();
-  server_.stop();
-  for (auto &t : server_threads_) {
-    if (t.joinable() == true) {
-      t.join();
-    }
+void RemoteServer::OnStreamingProfileUpdateRequest(
+    const websocketpp::connection_hdl &connection,
+    const boost::property_tree::ptree &tree) {
+  const std::string &profile = tree.get("profile", "");
+  if (profile.empty()) {
+    LogError("OnStreamingProfileUpdateRequest: profile empty.");
+    return;
   }
-}
 
+  bool measure_latency = tree.get("measureLatency", false);
 
-void RemoteServer::OnFail(websocketpp::connection_hdl connection) {
-  LogError("OnFail");
+  int request_key = request_cache_.CheckIn(connection);
+
+  if (Obs::Get()->IsCapturing() == true) {
+    RespondStreamingProfileUpdate(request_key, "not standby");
+    return;
+  }
+
+  bool result = Obs::Get()->UpdateStreamProfile(profile, measure_latency);
+  RespondStreamingProfileUpdate(request_key, result ? "" : "unknown profile");
 }
 
 
-void RemoteServer::OnOpen(websocketpp::connection_hdl connection) {
-  LogInfo("OnOpen");
+void RemoteServer::OnStreamingLatencyStatusRequest(
+    const websocketpp::connection_hdl &connection,
+    const boost::property_tree::ptree &/*tree*/) {
+  int request_key = request_cache_.CheckIn(connection);
+
+  RespondStreamingLatencyStatus(
+      request_key,
+      Obs::Get()->GetLatencyStatus());
 }
 
 
-void RemoteServer::OnClose(websocketpp::connection_hdl connection) {
-  LogInfo("OnClose");
+void RemoteServer::OnIngestStatusRequest(
+    const websocketpp::connection_hdl &connection,
+    const boost::property_tree::ptree &/*tree*/) {
+  int request_key = request_cache_.CheckIn(connection);
+
+  boost::property_tree::ptree ingest = RtmpIngestServer::Get()->ToTree();
+
+  // an approximation of two halves: capture to encode as the latency
+  // probe sees it, and the queueing after the encoder as the delay at
+  // the ingest, above the fastest transit; the transit itself, and the
+  // flv timestamps against the clock of the ingest, are left out.
+  const auto &latency = Obs::Get()->GetLatencyStatus();
+  double encode_ms = latency.get("encoder.video.averageMs", -1.0);
+  double delay_ms = ingest.get("video.delay.averageMs", -1.0);
+  ingest.put("captureToIngestMs",
+      (encode_ms < 0 || delay_ms < 0) ? -1.0 : encode_ms + delay_ms);
+
+  RespondIngestStatus(request_key, ingest);
 }
 
 
-void RemoteServer::OnMessage(
-    websocketpp::connection_hdl connection,
-    websocketpp::connection<websocketpp::config::asio>::message_ptr msg) {
-  boost::property_tree::ptree msg_tree;
-  auto msg_type{RemoteMessage::MessageType::kUndefined};
+void RemoteServer::OnStreamingIdleStatusRequest(
+    const websocketpp::connection_hdl &connection,
+    const boost::property_tree::ptree &/*tree*/) {
+  int request_key = request_cache_.CheckIn(connection);
 
-  std::stringstream ss{msg->get_payload()};
-  try {
-    boost::property_tree::read_json(ss, msg_tree);
-    msg_type = static_cast<RemoteMessage::MessageType>(
-        msg_tree.get<int>("type"));
-  } catch (const std::exception &/*e*/) {
-    msg_type = RemoteMessage::MessageType::kUndefined;
-  }
+  RespondStreamingIdleStatus(
+      request_key,
+      Obs::Get()->GetIdleStatus());
+}
 
-  using MessageHandler = std::function<void(
-      const websocketpp::connection_hdl &,
-      const boost::property_tree::ptree &/*msg*/)>;
-  static const std::unordered_map<RemoteMessage::MessageType,
-                                  MessageHandler> kMessageHandlers{
-      {RemoteMessage::MessageType::kStreamingStatusRequest,
-       std::bind(&RemoteServer::OnStreamingStatusRequest,
-           this, std::placeholders::_1, std::placeholders::_2)},
-      {RemoteMessage::MessageType::kStreamingStartRequest,
-       std::bind(&RemoteServer::OnStreamingStartRequest,
-           this, std::placeholders::_1, std::placeholders::_2)},
-      {RemoteMessage::MessageType::kStreamingStopRequest,
-       std::bind(&RemoteServer::OnStreamingStopRequest,
-           this, std::placeholders::_1, std::placeholders::_2)},
-      {RemoteMessage::MessageType::kSettingsQualityUpdateRequest,
-       std::bind(&RemoteServer::OnSettingsQualityUpdateRequest,
-           this, std::placeholders::_1, std::placeholders::_2)},
-      {RemoteMessage::MessageType::kNcStreamerExitRequest,
-       std::bind(&RemoteServer::OnNcStreamerExitRequest,
-           this, std::placeholders::_1, std::placeholders::_2)}};
 
-  auto i = kMessageHandlers.find(msg_type);
-  if (i == kMessageHandlers.end()) {
-    std::stringstream err;
-    err << "unknown message type: " << static_cast<int>(msg_type);
-    LogError(err.str());
-    return;
-  }
-  i->second(connection, msg_tree);
+void RemoteServer::OnEncoderCapacityStatusRequest(
+    const websocketpp::connection_hdl &connection,
+    const boost::property_tree::ptree &/*tree*/) {
+  int request_key = request_cache_.CheckIn(connection);
+
+  RespondEncoderCapacityStatus(
+      request_key,
+      EncoderCapacity::Get()->ToTree());
 }
 
 
-void RemoteServer::OnStreamingStatusRequest(
+void RemoteServer::OnStreamingLagGuardStatusRequest(
     const websocketpp::connection_hdl &connection,
     const boost::property_tree::ptree &/*tree*/) {
   int request_key = request_cache_.CheckIn(connection);
 
-  JsExecutor::Execute(
-      browser_app_->GetMainBrowser(),
-      "remote.onStreamingStatusRequest",
-      request_key);
+  RespondStreamingLagGuardStatus(
+      request_key,
+      Obs::Get()->GetLagGuardStatus());
 }
 
 
-void RemoteServer::OnStreamingStartRequest(
+void RemoteServer::OnStreamingAudioStatusRequest(
     const websocketpp::connection_hdl &connection,
-    const boost::property_tree::ptree &tree) {
-  const std::string &title = tree.get("title", "");
-  if (title.empty()) {
-    LogError("OnStreamingStartRequest: title empty.");
-    return;
-  }
+    const boost::property_tree::ptree &/*tree*/) {
+  int request_key = request_cache_.CheckIn(connection);
 
-  boost::property_tree::ptree args;
-  args.add("sourceTitle", title);
+  RespondStreamingAudioStatus(
+      request_key,
+      Obs::Get()->GetAudioStatus());
+}
 
+
+void RemoteServer::OnStreamingReconnectStatusRequest(
+    const websocketpp::connection_hdl &connection,
+    const boost::property_tree::ptree &/*tree*/) {
   int request_key = request_cache_.CheckIn(connection);
 
-  JsExecutor::Execute(
-      browser_app_->GetMainBrowser(),
-      "remote.onStreamingStartRequest",
+  RespondStreamingReconnectStatus(
       request_key,
-      args);
+      Obs::Get()->GetReconnectStatus());
 }
 
 
-void RemoteServer::OnStreamingStopRequest(
+void RemoteServer::OnBandwidthTestStartRequest(
     const websocketpp::connection_hdl &connection,
     const boost::property_tree::ptree &tree) {
-  const std::string &title = tree.get("title", "");
-  if (title.empty()) {
-    LogError("OnStreamingStopRequest: title empty.");
+  const std::string &service_provider =
+      tree.get("serviceProvider", "Facebook Live");
+  const std::string &stream_url = tree.get("streamUrl", "");
+  int step_seconds = tree.get("stepSec", 5);
+  std::vector<uint32_t> bitrates;
+  for (const auto &elem : tree.get_child("bitrates", {})) {
+    bitrates.emplace_back(elem.second.get_value<uint32_t>(0));
+  }
+  if (bitrates.empty() == true) {
+    bitrates = BandwidthTest::GetDefaultBitrates();
+  }
+  if (step_seconds <= 0 ||
+      std::find(bitrates.begin(), bitrates.end(), 0) != bitrates.end()) {
+    LogError("OnBandwidthTestStartRequest: not positive.");
     return;
   }
 
-  boost::property_tree::ptree args;
-  args.add("sourceTitle", title);
-
   int request_key = request_cache_.CheckIn(connection);
 
-  JsExecutor::Execute(
-      browser_app_->GetMainBrowser(),
-      "remote.onStreamingStopRequest",
-      request_key,
-      args);
+  if (BandwidthTest::Get()->IsRunning() == true) {
+    RespondBandwidthTestStart(request_key, "not standby");
+    return;
+  }
+
+  bool result = BandwidthTest::Get()->Start(
+      service_provider,
+      stream_url,
+      bitrates,
+      std::chrono::seconds{step_seconds});
+  RespondBandwidthTestStart(request_key, result ? "" : "not standby");
 }
 
 
-void RemoteServer::OnSettingsQualityUpdateRequest(
+void RemoteServer::OnBandwidthTestStopRequest(
     const websocketpp::connection_hdl &connection,
-    const boost::property_tree::ptree &tree) {
-  const std::string &quality = tree.get("quality", "");
-  if (quality.empty()) {
-    LogError("OnSettingsQualityUpdateRequest: quality empty.");
+    const boost::property_tree::ptree &/*tree*/) {
+  int request_key = request_cache_.CheckIn(connection);
+
+  if (BandwidthTest::Get()->IsRunning() == false) {
+    RespondBandwidthTestStop(request_key, "not testing");
     return;
   }
 
-  boost::property_tree::ptree args;
-  args.add("quality", quality);
+  BandwidthTest::Get()->Stop();
+  RespondBandwidthTestStop(request_key, "");
+}
+
 
+void RemoteServer::OnBandwidthTestStatusRequest(
+    const websocketpp::connection_hdl &connection,
+    const boost::property_tree::ptree &/*tree*/) {
   int request_key = request_cache_.CheckIn(connection);
 
-  JsExecutor::Execute(
-      browser_app_->GetMainBrowser(),
-      "remote.onSettingsQualityUpdateRequest",
+  RespondBandwidthTestStatus(
       request_key,
-      args);
+      BandwidthTest::Get()->ToTree());
 }
 
 
-void RemoteServer::OnNcStreamerExitRequest(
-    const websocketpp::connection_hdl &/*connection*/,
+void RemoteServer::OnHttpStatusRequest(
+    const websocketpp::connection_hdl &connection,
     const boost::property_tree::ptree &/*tree*/) {
-  HWND wnd = browser_app_->GetMainBrowser()->GetHost()->GetWindowHandle();
-  ::PostMessage(wnd, WM_CLOSE, NULL, NULL);
+  int request_key = request_cache_.CheckIn(connection);
+
+  RespondHttpStatus(
+      request_key,
+      HttpMetrics::Get()->ToTree());
+}
+
+
+void RemoteServer::PostToObsThread(const std::function<void()> &task) {
+  if (!browser_app_) {
+    HeadlessController::Get()->Post(task);
+    return;
+  }
+  ::CefPostTask(TID_UI, base::Bind(&RemoteServer::RunTask, task));
+}
+
+
+void RemoteServer::RunTask(const std::function<void()> &task) {
+  task();
 }
 
 
@@ -8,7 +8,10 @@
 
 
 #include <fstream>
+#include <functional>
+#include <memory>
 #include <mutex>  // NOLINT
+#include <set>
 #include <string>
 #include <thread>  // NOLINT
 #include <vector>
@@ -25,6 +28,7 @@
 namespace ncstreamer {
 class RemoteServer {
  public:
+  // browser_app is null in the headless mode.
   static void SetUp(
       const BrowserApp *browser_app,
       uint16_t port);
@@ -51,6 +55,111 @@ class RemoteServer {
       int request_key,
       const std::string &error);
 
+  void RespondRecordingStatus(
+      int request_key,
+      const std::string &status,
+      const std::string &path);
+
+  void RespondRecordingStart(
+      int request_key,
+      const std::string &error);
+
+  void RespondRecordingStop(
+      int request_key,
+      const std::string &error);
+
+  void RespondSimulcastStatus(
+      int request_key,
+      const std::vector<boost::property_tree::ptree> &destinations);
+
+  void RespondSimulcastStart(
+      int request_key,
+      const std::string &destination,
+      const std::string &error);
+
+  void RespondSimulcastStop(
+      int request_key,
+      const std::string &destination,
+      const std::string &error);
+
+  void RespondRenditionStatus(
+      int request_key,
+      double cpu_usage,
+      const std::vector<boost::property_tree::ptree> &renditions);
+
+  void RespondReplayBufferStatus(
+      int request_key,
+      const boost::property_tree::ptree &replay_buffer);
+
+  void RespondReplayBufferStart(
+      int request_key,
+      const std::string &error);
+
+  void RespondReplayBufferStop(
+      int request_key,
+      const std::string &error);
+
+  void RespondReplayBufferSave(
+      int request_key,
+      const std::string &path,
+      const std::string &error);
+
+  void RespondStreamingProfileUpdate(
+      int request_key,
+      const std::string &error);
+
+  void RespondStreamingLatencyStatus(
+      int request_key,
+      const boost::property_tree::ptree &latency);
+
+  void RespondIngestStatus(
+      int request_key,
+      const boost::property_tree::ptree &ingest);
+
+  void RespondStreamingIdleStatus(
+      int request_key,
+      const boost::property_tree::ptree &idle);
+
+  void RespondEncoderCapacityStatus(
+      int request_key,
+      const boost::property_tree::ptree &capacity);
+
+  void RespondStreamingLagGuardStatus(
+      int request_key,
+      const boost::property_tree::ptree &lag_guard);
+
+  void RespondStreamingAudioStatus(
+      int request_key,
+      const boost::property_tree::ptree &audio);
+
+  void RespondStreamingReconnectStatus(
+      int request_key,
+      const boost::property_tree::ptree &reconnect);
+
+  void RespondBandwidthTestStart(
+      int request_key,
+      const std::string &error);
+
+  void RespondBandwidthTestStop(
+      int request_key,
+      const std::string &error);
+
+  void RespondBandwidthTestStatus(
+      int request_key,
+      const boost::property_tree::ptree &bandwidth_test);
+
+  void RespondHttpStatus(
+      int request_key,
+      const boost::property_tree::ptree &http);
+
+  // to every open connection, and to the ui if any.
+  void NotifyStreamingQualityStep(
+      const boost::property_tree::ptree &step);
+  void NotifyStreamingReconnect(
+      const boost::property_tree::ptree &event);
+  void NotifySimulcastEvent(
+      const boost::property_tree::ptree &event);
+
  private:
   class RequestCache {
    public:
@@ -99,6 +208,103 @@ class RemoteServer {
       const websocketpp::connection_hdl &connection,
       const boost::property_tree::ptree &tree);
 
+  void OnRecordingStatusRequest(
+      const websocketpp::connection_hdl &connection,
+      const boost::property_tree::ptree &tree);
+
+  void OnRecordingStartRequest(
+      const websocketpp::connection_hdl &connection,
+      const boost::property_tree::ptree &tree);
+
+  void OnRecordingStopRequest(
+      const websocketpp::connection_hdl &connection,
+      const boost::property_tree::ptree &tree);
+
+  void OnSimulcastStatusRequest(
+      const websocketpp::connection_hdl &connection,
+      const boost::property_tree::ptree &tree);
+
+  void OnSimulcastStartRequest(
+      const websocketpp::connection_hdl &connection,
+      const boost::property_tree::ptree &tree);
+
+  void OnSimulcastStopRequest(
+      const websocketpp::connection_hdl &connection,
+      const boost::property_tree::ptree &tree);
+
+  void OnRenditionStatusRequest(
+      const websocketpp::connection_hdl &connection,
+      const boost::property_tree::ptree &tree);
+
+  void OnReplayBufferStatusRequest(
+      const websocketpp::connection_hdl &connection,
+      const boost::property_tree::ptree &tree);
+
+  void OnReplayBufferStartRequest(
+      const websocketpp::connection_hdl &connection,
+      const boost::property_tree::ptree &tree);
+
+  void OnReplayBufferStopRequest(
+      const websocketpp::connection_hdl &connection,
+      const boost::property_tree::ptree &tree);
+
+  void OnReplayBufferSaveRequest(
+      const websocketpp::connection_hdl &connection,
+      const boost::property_tree::ptree &tree);
+
+  void OnStreamingProfileUpdateRequest(
+      const websocketpp::connection_hdl &connection,
+      const boost::property_tree::ptree &tree);
+
+  void OnStreamingLatencyStatusRequest(
+      const websocketpp::connection_hdl &connection,
+      const boost::property_tree::ptree &tree);
+
+  void OnIngestStatusRequest(
+      const websocketpp::connection_hdl &connection,
+      const boost::property_tree::ptree &tree);
+
+  void OnStreamingIdleStatusRequest(
+      const websocketpp::connection_hdl &connection,
+      const boost::property_tree::ptree &tree);
+
+  void OnEncoderCapacityStatusRequest(
+      const websocketpp::connection_hdl &connection,
+      const boost::property_tree::ptree &tree);
+
+  void OnStreamingLagGuardStatusRequest(
+      const websocketpp::connection_hdl &connection,
+      const boost::property_tree::ptree &tree);
+
+  void OnStreamingAudioStatusRequest(
+      const websocketpp::connection_hdl &connection,
+      const boost::property_tree::ptree &tree);
+
+  void OnStreamingReconnectStatusRequest(
+      const websocketpp::connection_hdl &connection,
+      const boost::property_tree::ptree &tree);
+
+  void OnBandwidthTestStartRequest(
+      const websocketpp::connection_hdl &connection,
+      const boost::property_tree::ptree &tree);
+
+  void OnBandwidthTestStopRequest(
+      const websocketpp::connection_hdl &connection,
+      const boost::property_tree::ptree &tree);
+
+  void OnBandwidthTestStatusRequest(
+      const websocketpp::connection_hdl &connection,
+      const boost::property_tree::ptree &tree);
+
+  void OnHttpStatusRequest(
+      const websocketpp::connection_hdl &connection,
+      const boost::property_tree::ptree &tree);
+
+  // runs the task on the thread which owns obs: the ui thread of cef,
+  // or the main thread if headless.
+  void PostToObsThread(const std::function<void()> &task);
+  static void RunTask(const std::function<void()> &task);
+
   void LogError(const std::string &err_msg);
   void LogWarning(const std::string &warn_msg);
   void LogInfo(const std::string &info_msg);
@@ -114,6 +320,10 @@ class RemoteServer {
   std::ofstream server_log_;
 
   RequestCache request_cache_;
+
+  mutable std::mutex connections_mutex_;
+  std::set<websocketpp::connection_hdl,
+           std::owner_less<websocketpp::connection_hdl>> connections_;
 };
 }  // namespace ncstreamer
 
@@ -7,13 +7,17 @@
 
 #include <cassert>
 
+#include "ncstreamer_cef/src/streaming_service/custom_rtmp.h"
 #include "ncstreamer_cef/src/streaming_service/facebook.h"
 
 
 namespace ncstreamer {
-void StreamingService::SetUp() {
+void StreamingService::SetUp(
+    const std::string &custom_rtmp_url,
+    bool prepares_live_video) {
   assert(!static_instance);
-  static_instance = new StreamingService{};
+  static_instance =
+      new StreamingService{custom_rtmp_url, prepares_live_video};
 }
 
 
@@ -30,11 +34,19 @@ StreamingService *StreamingService::Get() {
 }
 
 
-StreamingService::StreamingService()
+StreamingService::StreamingService(
+    const std::string &custom_rtmp_url,
+    bool prepares_live_video)
     : service_providers_{
           {"Facebook Live", std::shared_ptr<Facebook>{new Facebook{}}}},
       current_service_provider_id_{nullptr},
-      current_service_provider_{} {
+      current_service_provider_{},
+      prepares_live_video_{prepares_live_video} {
+  if (custom_rtmp_url.empty() == false) {
+    service_providers_.emplace(
+        "Custom RTMP",
+        std::shared_ptr<CustomRtmp>{new CustomRtmp{custom_rtmp_url}});
+  }
 }
 
 
@@ -47,7 +59,8 @@ void StreamingService::LogIn(
     HWND parent,
     const std::wstring &locale,
     const OnFailed &on_failed,
-    const OnLoggedIn &on_logged_in) {
+    const OnLoggedIn &on_logged_in,
+    const OnUserUpdated &on_user_updated) {
   auto i = service_providers_.find(service_provider_id);
   if (i == service_providers_.end()) {
     on_failed(FailMessage::ToUnknownServiceProvider(service_provider_id));
@@ -60,7 +73,8 @@ void StreamingService::LogIn(
       parent,
       locale,
       on_failed,
-      on_logged_in);
+      on_logged_in,
+      on_user_updated);
 }
 
 
@@ -108,6 +122,18 @@ void StreamingService::PostLiveVideo(
 }
 
 
+void StreamingService::PrepareLiveVideo(
+    const std::string &user_page_id,
+    const std::string &privacy) {
+  if (prepares_live_video_ == false ||
+      !current_service_provider_) {
+    return;
+  }
+
+  current_service_provider_->PrepareLiveVideo(user_page_id, privacy);
+}
+
+
 void StreamingService::LogOutAll() {
   for (const auto &elem : service_providers_) {
     auto service_provider = elem.second;
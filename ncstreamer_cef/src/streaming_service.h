@@ -21,12 +21,17 @@ class StreamingService {
  public:
   using OnFailed = StreamingServiceProvider::OnFailed;
   using OnLoggedIn = StreamingServiceProvider::OnLoggedIn;
+  using OnUserUpdated = StreamingServiceProvider::OnUserUpdated;
   using OnLoggedOut = StreamingServiceProvider::OnLoggedOut;
   using OnLiveVideoPosted =
       std::function<void(const std::string &service_provider,
                          const std::string &stream_url)>;
 
-  static void SetUp();
+  // registers "Custom RTMP" too, if custom_rtmp_url is not empty.
+  // the live videos are prepared only if prepares_live_video.
+  static void SetUp(
+      const std::string &custom_rtmp_url,
+      bool prepares_live_video);
   static void ShutDown();
   static StreamingService *Get();
 
@@ -35,7 +40,8 @@ class StreamingService {
       HWND parent,
       const std::wstring &locale,
       const OnFailed &on_failed,
-      const OnLoggedIn &on_logged_in);
+      const OnLoggedIn &on_logged_in,
+      const OnUserUpdated &on_user_updated);
 
   void LogOut(
       const std::string &service_provider_id,
@@ -50,6 +56,11 @@ class StreamingService {
       const OnFailed &on_failed,
       const OnLiveVideoPosted &on_live_video_posted);
 
+  // by the current service provider, if logged in.
+  void PrepareLiveVideo(
+      const std::string &user_page_id,
+      const std::string &privacy);
+
   void LogOutAll();
 
  private:
@@ -60,7 +71,9 @@ class StreamingService {
     static std::string ToNotLoggedIn();
   };
 
-  StreamingService();
+  StreamingService(
+      const std::string &custom_rtmp_url,
+      bool prepares_live_video);
   virtual ~StreamingService();
 
   static StreamingService *static_instance;
@@ -71,6 +84,8 @@ class StreamingService {
 
   const std::string *current_service_provider_id_;
   std::shared_ptr<StreamingServiceProvider> current_service_provider_;
+
+  const bool prepares_live_video_;
 };
 }  // namespace ncstreamer
 
@@ -0,0 +1,52 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#include "ncstreamer_cef/src/streaming_service/custom_rtmp.h"
+
+
+namespace ncstreamer {
+CustomRtmp::CustomRtmp(const std::string &stream_url)
+    : stream_url_{stream_url} {
+}
+
+
+CustomRtmp::~CustomRtmp() {
+}
+
+
+void CustomRtmp::LogIn(
+    HWND /*parent*/,
+    const std::wstring &/*locale*/,
+    const OnFailed &/*on_failed*/,
+    const OnLoggedIn &on_logged_in,
+    const OnUserUpdated &/*on_user_updated*/) {
+  on_logged_in("Custom RTMP", stream_url_, {});
+}
+
+
+void CustomRtmp::LogOut(
+    const OnFailed &/*on_failed*/,
+    const OnLoggedOut &on_logged_out) {
+  on_logged_out();
+}
+
+
+void CustomRtmp::PostLiveVideo(
+    const std::string &/*user_page_id*/,
+    const std::string &/*privacy*/,
+    const std::string &/*title*/,
+    const std::string &/*description*/,
+    const OnFailed &/*on_failed*/,
+    const OnLiveVideoPosted &on_live_video_posted) {
+  on_live_video_posted(stream_url_);
+}
+
+
+void CustomRtmp::PrepareLiveVideo(
+    const std::string &/*user_page_id*/,
+    const std::string &/*privacy*/) {
+  // nothing to post ahead.
+}
+}  // namespace ncstreamer
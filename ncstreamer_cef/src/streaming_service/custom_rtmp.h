@@ -0,0 +1,52 @@
+/**
+ * Copyright (C) 2017 NCSOFT Corporation
+ */
+
+
+#ifndef NCSTREAMER_CEF_SRC_STREAMING_SERVICE_CUSTOM_RTMP_H_
+#define NCSTREAMER_CEF_SRC_STREAMING_SERVICE_CUSTOM_RTMP_H_
+
+
+#include <string>
+
+#include "ncstreamer_cef/src/streaming_service/streaming_service_provider.h"
+
+
+namespace ncstreamer {
+// a fixed rtmp url, such as the local ingest server;
+// no account, so logging in always succeeds.
+class CustomRtmp : public StreamingServiceProvider {
+ public:
+  explicit CustomRtmp(const std::string &stream_url);
+  virtual ~CustomRtmp();
+
+  void LogIn(
+      HWND parent,
+      const std::wstring &locale,
+      const OnFailed &on_failed,
+      const OnLoggedIn &on_logged_in,
+      const OnUserUpdated &on_user_updated) override;
+
+  void LogOut(
+      const OnFailed &on_failed,
+      const OnLoggedOut &on_logged_out) override;
+
+  void PostLiveVideo(
+      const std::string &user_page_id,
+      const std::string &privacy,
+      const std::string &title,
+      const std::string &description,
+      const OnFailed &on_failed,
+      const OnLiveVideoPosted &on_live_video_posted) override;
+
+  void PrepareLiveVideo(
+      const std::string &user_page_id,
+      const std::string &privacy) override;
+
+ private:
+  const std::string stream_url_;
+};
+}  // namespace ncstreamer
+
+
+#endif  // NCSTREAMER_CEF_SRC_STREAMING_SERVICE_CUSTOM_RTMP_H_
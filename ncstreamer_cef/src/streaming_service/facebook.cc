@@ -5,8 +5,11 @@
 
 #include "ncstreamer_cef/src/streaming_service/facebook.h"
 
+#include <algorithm>
 #include <cassert>
+#include <chrono>  // NOLINT
 #include <functional>
+#include <sstream>
 #include <string>
 #include <unordered_map>
 
@@ -20,24 +23,53 @@
 
 #include "ncstreamer_cef/src/lib/cef_types.h"
 #include "ncstreamer_cef/src/lib/display.h"
+#include "ncstreamer_cef/src/lib/http_cache.h"
+#include "ncstreamer_cef/src/lib/http_metrics.h"
 #include "ncstreamer_cef/src/lib/http_types.h"
 #include "ncstreamer_cef/src/lib/uri.h"
 #include "ncstreamer_cef/src/lib/windows_types.h"
 #include "ncstreamer_cef/src/streaming_service/facebook_api.h"
 
 
+namespace {
+int64_t ToMilliseconds(const std::chrono::steady_clock::duration &duration) {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+      duration).count();
+}
+}  // unnamed namespace
+
+
 namespace ncstreamer {
 Facebook::Facebook()
     : login_client_{},
-      http_request_service_{},
       access_token_mutex_{},
       access_token_{},
       me_info_mutex_{},
-      me_info_{} {
+      me_info_{},
+      prepared_mutex_{},
+      prepared_{},
+      pending_requests_condition_{},
+      pending_requests_{0},
+      http_request_service_{} {
 }
 
 
 Facebook::~Facebook() {
+  // the live video prepared would stay on the page of the user; the
+  // access token is still good here, unlike at the next launch.
+  std::shared_ptr<PreparedLiveVideo> discarded{};
+  {
+    std::lock_guard<std::mutex> lock{prepared_mutex_};
+    discarded.swap(prepared_);
+  }
+  if (discarded) {
+    DiscardPreparedLiveVideo(discarded);
+  }
+
+  std::unique_lock<std::mutex> lock{prepared_mutex_};
+  pending_requests_condition_.wait(lock, [this]() {
+    return pending_requests_ == 0;
+  });
 }
 
 
@@ -45,7 +77,8 @@ void Facebook::LogIn(
     HWND parent,
     const std::wstring &locale,
     const OnFailed &on_failed,
-    const OnLoggedIn &on_logged_in) {
+    const OnLoggedIn &on_logged_in,
+    const OnUserUpdated &on_user_updated) {
   static const char *kNcStreamerAppId{[]() {
     static const char *kProduction{
         "1789696898019802"};
@@ -65,6 +98,11 @@ void Facebook::LogIn(
 
   static const Dimension<int> kPopupDimension{429, 402};
 
+  // the graph api is called right after the login; its handshakes are
+  // done while the user is still on the login popup.
+  http_request_service_.PreConnect(
+      FacebookApi::Graph::Me::static_uri().uri_string());
+
   const Rectangle &parent_rect = Windows::GetWindowRectangle(parent);
   const Rectangle &popup_rect = parent_rect.Center(
       Display::Scale(kPopupDimension));
@@ -77,7 +115,7 @@ void Facebook::LogIn(
   CefString(&browser_settings.accept_language_list) = locale;
 
   login_client_ = new LoginClient{
-      this, parent, on_failed, on_logged_in};
+      this, parent, on_failed, on_logged_in, on_user_updated};
 
   CefBrowserHost::CreateBrowser(
       window_info,
@@ -98,6 +136,16 @@ void Facebook::LogOut(
     return;
   }
 
+  std::shared_ptr<PreparedLiveVideo> discarded{};
+  {
+    std::lock_guard<std::mutex> lock{prepared_mutex_};
+    discarded.swap(prepared_);
+  }
+  // while its access token is still good.
+  if (discarded) {
+    DiscardPreparedLiveVideo(discarded);
+  }
+
   class LogoutCallback : public CefDeleteCookiesCallback {
    public:
     LogoutCallback(
@@ -114,6 +162,8 @@ void Facebook::LogOut(
     void OnComplete(int /*num_deleted*/) override {
       caller_->SetAccessToken("");
       caller_->SetMeInfo({"", "", "", {}});
+      // the values of the user are not to outlive the login.
+      HttpCache::Get()->Clear();
       on_logged_out_();
     }
 
@@ -141,6 +191,100 @@ void Facebook::PostLiveVideo(
     const std::string &description,
     const OnFailed &on_failed,
     const OnLiveVideoPosted &on_live_video_posted) {
+  const Clock::time_point &started_at = Clock::now();
+
+  std::shared_ptr<PreparedLiveVideo> prepared{};
+  std::shared_ptr<PreparedLiveVideo> discarded{};
+  {
+    std::lock_guard<std::mutex> lock{prepared_mutex_};
+    if (prepared_ && prepared_->IsFor(user_page_id, privacy) == true) {
+      prepared.swap(prepared_);
+      if (prepared->IsPosting() == true) {
+        prepared->SetOnPosted([this, prepared, title, description,
+                               started_at, on_failed,
+                               on_live_video_posted]() {
+          UsePreparedLiveVideo(prepared, title, description, started_at,
+                               on_failed, on_live_video_posted);
+        });
+        return;
+      }
+    } else {
+      discarded.swap(prepared_);
+    }
+  }
+
+  if (discarded) {
+    DiscardPreparedLiveVideo(discarded);
+  }
+
+  if (!prepared) {
+    PostNewLiveVideo(user_page_id, privacy, title, description, started_at,
+                     on_failed, on_live_video_posted);
+    return;
+  }
+
+  UsePreparedLiveVideo(prepared, title, description, started_at,
+                       on_failed, on_live_video_posted);
+}
+
+
+void Facebook::PrepareLiveVideo(
+    const std::string &user_page_id,
+    const std::string &privacy) {
+  const std::string &access_token = (user_page_id == "me") ?
+      GetAccessToken() : GetPageAccessToken(user_page_id);
+  if (access_token.empty() == true) {
+    return;
+  }
+
+  std::shared_ptr<PreparedLiveVideo> prepared{
+      new PreparedLiveVideo{user_page_id, privacy, access_token}};
+  std::shared_ptr<PreparedLiveVideo> discarded{};
+  {
+    std::lock_guard<std::mutex> lock{prepared_mutex_};
+    if (prepared_ && prepared_->IsFor(user_page_id, privacy) == true) {
+      return;  // reused.
+    }
+    discarded.swap(prepared_);
+    prepared_ = prepared;
+  }
+
+  if (discarded) {
+    DiscardPreparedLiveVideo(discarded);
+  }
+
+  Uri live_video_uri{FacebookApi::Graph::LiveVideos::BuildUri(
+      user_page_id)};
+
+  // ended by OnLiveVideoPrepared.
+  BeginPendingRequest();
+  http_request_service_.PostJson(
+      live_video_uri.uri_string(),
+      FacebookApi::Graph::LiveVideos::BuildPostContent(
+          access_token,
+          privacy,
+          "",
+          ""),
+      {"id", "stream_url"},
+      [this, prepared](const boost::system::error_code &/*ec*/) {
+    OnLiveVideoPrepared(prepared, "", "");
+  }, [this, prepared](const boost::property_tree::ptree &tree) {
+    OnLiveVideoPrepared(
+        prepared,
+        tree.get<std::string>("id", ""),
+        tree.get<std::string>("stream_url", ""));
+  });
+}
+
+
+void Facebook::PostNewLiveVideo(
+    const std::string &user_page_id,
+    const std::string &privacy,
+    const std::string &title,
+    const std::string &description,
+    const Clock::time_point &started_at,
+    const OnFailed &on_failed,
+    const OnLiveVideoPosted &on_live_video_posted) {
   Uri live_video_uri{FacebookApi::Graph::LiveVideos::BuildUri(
       user_page_id)};
 
@@ -160,40 +304,189 @@ void Facebook::PostLiveVideo(
           title,
           description)};
 
-  http_request_service_.Post(
+  http_request_service_.PostJson(
       live_video_uri.uri_string(),
       post_content,
+      {"stream_url"},
       [on_failed](const boost::system::error_code &ec) {
     std::string msg{ec.message()};
     on_failed(msg);
-  }, [on_failed, on_live_video_posted](const std::string &str) {
-    boost::property_tree::ptree tree;
-    std::stringstream ss{str};
-    std::string stream_url{};
-    try {
-      boost::property_tree::read_json(ss, tree);
-      stream_url = tree.get<std::string>("stream_url");
-    } catch (const std::exception &/*e*/) {
-      stream_url = "";
-    }
+  }, [on_failed, on_live_video_posted, started_at](
+      const boost::property_tree::ptree &tree) {
+    const std::string &stream_url = tree.get<std::string>("stream_url", "");
 
     if (stream_url.empty() == true) {
       std::stringstream msg;
-      msg << "could not get stream_url from: " << str;
+      msg << "could not get stream_url from: ";
+      boost::property_tree::write_json(msg, tree, false);
       on_failed(msg.str());
       return;
     }
 
     OutputDebugStringA((stream_url + "/stream_url\r\n").c_str());
+    OutputDebugStringA(
+        (HttpMetrics::Get()->ToString() + "\r\n").c_str());
+    LogStartLatency(started_at, nullptr);
 
     on_live_video_posted(stream_url);
   });
 }
 
 
+void Facebook::OnLiveVideoPrepared(
+    const std::shared_ptr<PreparedLiveVideo> &prepared,
+    const std::string &live_video_id,
+    const std::string &stream_url) {
+  PreparedLiveVideo::OnPosted on_posted{};
+  bool discarded{false};
+  {
+    std::lock_guard<std::mutex> lock{prepared_mutex_};
+    prepared->SetPosted(live_video_id, stream_url);
+    // the next selection tries again.
+    if (stream_url.empty() == true && prepared_ == prepared) {
+      prepared_.reset();
+    }
+    on_posted = prepared->ReleaseOnPosted();
+    discarded = prepared->discarded();
+  }
+
+  if (discarded == true) {
+    if (live_video_id.empty() == false) {
+      DeleteLiveVideo(live_video_id, prepared->access_token());
+    }
+  } else if (on_posted) {
+    on_posted();
+  }
+  EndPendingRequest();
+}
+
+
+void Facebook::UsePreparedLiveVideo(
+    const std::shared_ptr<PreparedLiveVideo> &prepared,
+    const std::string &title,
+    const std::string &description,
+    const Clock::time_point &started_at,
+    const OnFailed &on_failed,
+    const OnLiveVideoPosted &on_live_video_posted) {
+  const auto &post_new = [this, prepared, title, description, started_at,
+                          on_failed, on_live_video_posted]() {
+    if (prepared->live_video_id().empty() == false) {
+      DeleteLiveVideo(prepared->live_video_id(), prepared->access_token());
+    }
+    PostNewLiveVideo(prepared->user_page_id(), prepared->privacy(),
+                     title, description, started_at,
+                     on_failed, on_live_video_posted);
+  };
+
+  if (prepared->stream_url().empty() == true) {
+    post_new();
+    return;
+  }
+
+  Uri live_video_uri{FacebookApi::Graph::LiveVideo::BuildUri(
+      prepared->live_video_id())};
+
+  http_request_service_.PostJson(
+      live_video_uri.uri_string(),
+      FacebookApi::Graph::LiveVideo::BuildUpdateContent(
+          prepared->access_token(),
+          title,
+          description),
+      {"id"},
+      [post_new](const boost::system::error_code &/*ec*/) {
+    post_new();
+  }, [prepared, started_at, on_live_video_posted, post_new](
+      const boost::property_tree::ptree &tree) {
+    if (tree.get<std::string>("id", "").empty() == true) {
+      post_new();
+      return;
+    }
+
+    OutputDebugStringA(
+        (prepared->stream_url() + "/stream_url\r\n").c_str());
+    OutputDebugStringA(
+        (HttpMetrics::Get()->ToString() + "\r\n").c_str());
+    LogStartLatency(started_at, prepared.get());
+
+    on_live_video_posted(prepared->stream_url());
+  });
+}
+
+
+void Facebook::DiscardPreparedLiveVideo(
+    const std::shared_ptr<PreparedLiveVideo> &prepared) {
+  bool posting{false};
+  {
+    std::lock_guard<std::mutex> lock{prepared_mutex_};
+    prepared->Discard();
+    posting = prepared->IsPosting();
+  }
+
+  if (posting == false &&
+      prepared->live_video_id().empty() == false) {
+    DeleteLiveVideo(prepared->live_video_id(), prepared->access_token());
+  }
+}
+
+
+void Facebook::DeleteLiveVideo(
+    const std::string &live_video_id,
+    const std::string &access_token) {
+  Uri live_video_uri{FacebookApi::Graph::LiveVideo::BuildUri(
+      live_video_id)};
+
+  BeginPendingRequest();
+  http_request_service_.PostJson(
+      live_video_uri.uri_string(),
+      FacebookApi::Graph::LiveVideo::BuildDeleteContent(access_token),
+      {"success"},
+      [this, live_video_id](const boost::system::error_code &ec) {
+    OutputDebugStringA(("could not delete live video " + live_video_id +
+                        ": " + ec.message() + "\r\n").c_str());
+    EndPendingRequest();
+  }, [this](const boost::property_tree::ptree &/*tree*/) {
+    EndPendingRequest();
+  });
+}
+
+
+void Facebook::BeginPendingRequest() {
+  std::lock_guard<std::mutex> lock{prepared_mutex_};
+  ++pending_requests_;
+}
+
+
+void Facebook::EndPendingRequest() {
+  // under the lock; the destruction may go on as soon as it is let go.
+  std::lock_guard<std::mutex> lock{prepared_mutex_};
+  --pending_requests_;
+  pending_requests_condition_.notify_all();
+}
+
+
+void Facebook::LogStartLatency(
+    const Clock::time_point &started_at,
+    const PreparedLiveVideo *prepared) {
+  std::stringstream ss;
+  ss << ToMilliseconds(Clock::now() - started_at)
+     << "ms from the start to the stream url";
+  if (prepared) {
+    // the part of its post before the start; the update is still on
+    // the way, within the time to the stream url.
+    const Clock::time_point &ahead_until =
+        (std::min)(prepared->posted_at(), started_at);
+    ss << ", prepared " << ToMilliseconds(ahead_until - prepared->prepared_at())
+       << "ms ahead";
+  }
+  ss << "/start_latency\r\n";
+  OutputDebugStringA(ss.str().c_str());
+}
+
+
 std::vector<StreamingServiceProvider::UserPage>
     Facebook::ExtractAccountAll(
-        const boost::property_tree::ptree &tree) {
+        const boost::property_tree::ptree &tree,
+        const PageTokenMap &page_tokens) {
   std::vector<UserPage> accounts;
 
   const auto &arr = tree.get_child("data");
@@ -202,90 +495,176 @@ std::vector<StreamingServiceProvider::UserPage>
     const auto &id = account.get<std::string>("id");
     const auto &name = account.get<std::string>("name");
     const auto &link = account.get<std::string>("link");
-    const auto &access_token = account.get<std::string>("access_token");
-    accounts.emplace_back(id, name, link, access_token);
+    auto i = page_tokens.find(id);
+    if (i == page_tokens.end()) {
+      continue;
+    }
+    accounts.emplace_back(id, name, link, i->second);
   }
 
   return accounts;
 }
 
 
-void Facebook::GetMe(
+void Facebook::GetMeTokens(
     const OnFailed &on_failed,
-    const OnMeGotten &on_me_gotten) {
+    const OnMeTokensGotten &on_me_tokens_gotten) {
   Uri me_uri{FacebookApi::Graph::Me::BuildUri(
       GetAccessToken(),
       {"id",
-       "name",
-       "link",
-       "accounts{id,name,link,access_token}"})};
+       "accounts{id,access_token}"})};
 
-  http_request_service_.Get(
+  http_request_service_.GetJson(
       me_uri.uri_string(),
+      {"id",
+       "accounts.data.*.id",
+       "accounts.data.*.access_token"},
       [on_failed](const boost::system::error_code &ec) {
     std::string msg{ec.message()};
     on_failed(msg);
-  }, [on_failed, on_me_gotten](const std::string &str) {
-    boost::property_tree::ptree me;
-    std::stringstream me_ss{str};
-    std::string me_id{};
-    std::string me_name{};
-    std::string me_link{};
-    try {
-      boost::property_tree::read_json(me_ss, me);
-      me_id = me.get<std::string>("id");
-      me_name = me.get<std::string>("name");
-      me_link = me.get<std::string>("link");
-    } catch (const std::exception &/*e*/) {
-      me_id = "";
-      me_name = "";
-      me_link = "";
-    }
-
+  }, [on_failed, on_me_tokens_gotten](const boost::property_tree::ptree &me) {
+    const std::string &me_id = me.get<std::string>("id", "");
     if (me_id.empty() == true) {
       std::stringstream msg;
-      msg << "could not get me from: " << str;
+      msg << "could not get me from: ";
+      boost::property_tree::write_json(msg, me, false);
       on_failed(msg.str());
       return;
     }
 
-    std::vector<UserPage> me_accounts;
-    try {
-      me_accounts = ExtractAccountAll(me.get_child("accounts"));
-    } catch (...) {
+    PageTokenMap page_tokens;
+    static const boost::property_tree::ptree kEmpty{};
+    for (const auto &elem : me.get_child("accounts.data", kEmpty)) {
+      const auto &account = elem.second;
+      page_tokens.emplace(
+          account.get<std::string>("id", ""),
+          account.get<std::string>("access_token", ""));
     }
+    on_me_tokens_gotten(me_id, page_tokens);
+  });
+}
+
+
+void Facebook::GetMe(
+    const std::string &me_id,
+    const PageTokenMap &page_tokens,
+    const OnFailed &on_failed,
+    const OnMeGotten &on_me_gotten,
+    const OnMeGotten &on_me_refreshed) {
+  Uri me_uri{FacebookApi::Graph::Me::BuildUri(
+      GetAccessToken(),
+      {"id",
+       "name",
+       "link",
+       "accounts{id,name,link}"})};
+
+  // a returning user gets the me of the last launch once its id is
+  // known, which takes only the small request of the tokens.
+  static const std::chrono::minutes kMeTtl{10};
+
+  static const OnFailed kDefaultOnFailed{
+      [](const std::string &/*fail*/) {}};
 
-    on_me_gotten(me_id, me_name, me_link, me_accounts);
+  // the rest of the body, as the other fields of the accounts, is not
+  // kept while it is read.
+  http_request_service_.GetCachedJson(
+      me_uri.uri_string(),
+      {"id",
+       "name",
+       "link",
+       "accounts.data.*.id",
+       "accounts.data.*.name",
+       "accounts.data.*.link"},
+      me_id,
+      kMeTtl,
+      [on_failed](const boost::system::error_code &ec) {
+    std::string msg{ec.message()};
+    on_failed(msg);
+  }, [page_tokens, on_failed, on_me_gotten](
+      const boost::property_tree::ptree &me) {
+    ExtractMe(me, page_tokens, on_failed, on_me_gotten);
+  }, [this, on_me_refreshed](const boost::property_tree::ptree &me) {
+    // a page new since the last launch has no token yet.
+    GetMeTokens(kDefaultOnFailed, [me, on_me_refreshed](
+        const std::string &/*me_id*/,
+        const PageTokenMap &page_tokens) {
+      ExtractMe(me, page_tokens, kDefaultOnFailed, on_me_refreshed);
+    });
   });
 }
 
 
+void Facebook::ExtractMe(
+    const boost::property_tree::ptree &me,
+    const PageTokenMap &page_tokens,
+    const OnFailed &on_failed,
+    const OnMeGotten &on_me_gotten) {
+  const std::string &me_id = me.get<std::string>("id", "");
+  const std::string &me_name = me.get<std::string>("name", "");
+  const std::string &me_link = me.get<std::string>("link", "");
+
+  if (me_id.empty() == true) {
+    std::stringstream msg;
+    msg << "could not get me from: ";
+    boost::property_tree::write_json(msg, me, false);
+    on_failed(msg.str());
+    return;
+  }
+
+  std::vector<UserPage> me_accounts;
+  try {
+    me_accounts = ExtractAccountAll(me.get_child("accounts"), page_tokens);
+  } catch (...) {
+  }
+
+  on_me_gotten(me_id, me_name, me_link, me_accounts);
+}
+
+
 void Facebook::OnLoginSuccess(
     const std::string &access_token,
     const OnFailed &on_failed,
-    const OnLoggedIn &on_logged_in) {
+    const OnLoggedIn &on_logged_in,
+    const OnUserUpdated &on_user_updated) {
   SetAccessToken(access_token);
 
-  GetMe(on_failed, [this, on_logged_in](
+  GetMeTokens(on_failed, [this, access_token, on_failed, on_logged_in,
+                          on_user_updated](
       const std::string &me_id,
-      const std::string &me_name,
-      const std::string &me_link,
-      const std::vector<UserPage> &me_accounts) {
-    AccountMap me_accounts_as_map{};
-    for (const auto &account : me_accounts) {
-      me_accounts_as_map.emplace(account.id(), account);
+      const PageTokenMap &page_tokens) {
+    // the user has logged out, or in again, meanwhile.
+    if (GetAccessToken() != access_token) {
+      return;
     }
 
-    SetMeInfo({
-        me_id, me_name, me_link, me_accounts_as_map});
-
-    OutputDebugStringA((me_id + "/id\r\n").c_str());
-    OutputDebugStringA((me_name + "/name\r\n").c_str());
-    OutputDebugStringA((me_link + "/link\r\n").c_str());
-    OutputDebugStringA(
-        (std::to_string(me_accounts.size()) + "/accounts\r\n").c_str());
-
-    on_logged_in(me_name, me_link, me_accounts);
+    GetMe(me_id, page_tokens, on_failed, [this, on_logged_in](
+        const std::string &me_id,
+        const std::string &me_name,
+        const std::string &me_link,
+        const std::vector<UserPage> &me_accounts) {
+      SetMeInfo(me_id, me_name, me_link, me_accounts);
+
+      OutputDebugStringA((me_id + "/id\r\n").c_str());
+      OutputDebugStringA((me_name + "/name\r\n").c_str());
+      OutputDebugStringA((me_link + "/link\r\n").c_str());
+      OutputDebugStringA(
+          (std::to_string(me_accounts.size()) + "/accounts\r\n").c_str());
+      OutputDebugStringA(
+          (HttpMetrics::Get()->ToString() + "\r\n").c_str());
+
+      on_logged_in(me_name, me_link, me_accounts);
+    }, [this, access_token, on_user_updated](
+        const std::string &me_id,
+        const std::string &me_name,
+        const std::string &me_link,
+        const std::vector<UserPage> &me_accounts) {
+      if (GetAccessToken() != access_token) {
+        return;
+      }
+      // the pages of the user may have changed since the last launch.
+      SetMeInfo(me_id, me_name, me_link, me_accounts);
+      on_user_updated(me_name, me_link, me_accounts);
+    });
   });
 }
 
@@ -329,15 +708,80 @@ void Facebook::SetMeInfo(const MeInfo &me_info) {
 }
 
 
+void Facebook::SetMeInfo(
+    const std::string &me_id,
+    const std::string &me_name,
+    const std::string &me_link,
+    const std::vector<UserPage> &me_accounts) {
+  AccountMap me_accounts_as_map{};
+  for (const auto &account : me_accounts) {
+    me_accounts_as_map.emplace(account.id(), account);
+  }
+
+  SetMeInfo({
+      me_id, me_name, me_link, me_accounts_as_map});
+}
+
+
+Facebook::PreparedLiveVideo::PreparedLiveVideo(
+    const std::string &user_page_id,
+    const std::string &privacy,
+    const std::string &access_token)
+    : user_page_id_{user_page_id},
+      privacy_{privacy},
+      access_token_{access_token},
+      posting_{true},
+      live_video_id_{},
+      stream_url_{},
+      on_posted_{},
+      discarded_{false},
+      prepared_at_{Clock::now()},
+      posted_at_{} {
+}
+
+
+Facebook::PreparedLiveVideo::~PreparedLiveVideo() {
+}
+
+
+bool Facebook::PreparedLiveVideo::IsFor(
+    const std::string &user_page_id,
+    const std::string &privacy) const {
+  return user_page_id_ == user_page_id &&
+         privacy_ == privacy;
+}
+
+
+void Facebook::PreparedLiveVideo::SetPosted(
+    const std::string &live_video_id,
+    const std::string &stream_url) {
+  posting_ = false;
+  live_video_id_ = live_video_id;
+  stream_url_ = stream_url;
+  posted_at_ = Clock::now();
+}
+
+
+Facebook::PreparedLiveVideo::OnPosted
+    Facebook::PreparedLiveVideo::ReleaseOnPosted() {
+  // the handler holds this; it is let go once called.
+  OnPosted on_posted{};
+  on_posted.swap(on_posted_);
+  return on_posted;
+}
+
+
 Facebook::LoginClient::LoginClient(
     Facebook *const owner,
     const HWND &base_window,
     const OnFailed &on_failed,
-    const OnLoggedIn &on_logged_in)
+    const OnLoggedIn &on_logged_in,
+    const OnUserUpdated &on_user_updated)
     : owner_{owner},
       base_window_{base_window},
       on_failed_{on_failed},
-      on_logged_in_{on_logged_in} {
+      on_logged_in_{on_logged_in},
+      on_user_updated_{on_user_updated} {
 }
 
 
@@ -408,7 +852,7 @@ bool Facebook::LoginClient::OnLoginRedirected(
     // login canceled.
   } else {
     owner_->OnLoginSuccess(
-        access_token, on_failed_, on_logged_in_);
+        access_token, on_failed_, on_logged_in_, on_user_updated_);
   }
 
   browser->GetHost()->CloseBrowser(false);
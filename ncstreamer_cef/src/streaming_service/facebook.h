@@ -7,6 +7,10 @@
 #define NCSTREAMER_CEF_SRC_STREAMING_SERVICE_FACEBOOK_H_
 
 
+#include <chrono>  // NOLINT
+#include <condition_variable>  // NOLINT
+#include <functional>
+#include <memory>
 #include <mutex>  // NOLINT
 #include <string>
 #include <tuple>
@@ -33,7 +37,8 @@ class Facebook : public StreamingServiceProvider {
       HWND parent,
       const std::wstring &locale,
       const OnFailed &on_failed,
-      const OnLoggedIn &on_logged_in) override;
+      const OnLoggedIn &on_logged_in,
+      const OnUserUpdated &on_user_updated) override;
 
   void LogOut(
       const OnFailed &on_failed,
@@ -47,6 +52,12 @@ class Facebook : public StreamingServiceProvider {
       const OnFailed &on_failed,
       const OnLiveVideoPosted &on_live_video_posted) override;
 
+  // the live video is posted with no title and no description, which
+  // are given at the start. one of another page or privacy is deleted.
+  void PrepareLiveVideo(
+      const std::string &user_page_id,
+      const std::string &privacy) override;
+
  private:
   using AccountMap =
       std::unordered_map<std::string /*id*/, UserPage>;
@@ -57,34 +68,103 @@ class Facebook : public StreamingServiceProvider {
       std::string /*me_link*/,
       AccountMap /*me_accounts*/>;
 
+  using PageTokenMap =
+      std::unordered_map<std::string /*page_id*/,
+                         std::string /*access_token*/>;
+
   using OnMeGotten = std::function<void(
       const std::string &me_id,
       const std::string &me_name,
       const std::string &me_link,
       const std::vector<UserPage> &me_accounts)>;
+  using OnMeTokensGotten = std::function<void(
+      const std::string &me_id,
+      const PageTokenMap &page_tokens)>;
 
   class LoginClient;
+  class PreparedLiveVideo;
+
+  using Clock = std::chrono::steady_clock;
 
+  // a page without its access token is left out.
   static std::vector<UserPage> ExtractAccountAll(
-      const boost::property_tree::ptree &tree);
+      const boost::property_tree::ptree &tree,
+      const PageTokenMap &page_tokens);
 
-  void GetMe(
+  static void ExtractMe(
+      const boost::property_tree::ptree &me,
+      const PageTokenMap &page_tokens,
       const OnFailed &on_failed,
       const OnMeGotten &on_me_gotten);
 
+  // never from the http cache, which is not to keep the tokens.
+  void GetMeTokens(
+      const OnFailed &on_failed,
+      const OnMeTokensGotten &on_me_tokens_gotten);
+  // the me may be from the http cache, of the user of me_id; the
+  // refreshed one, if any, comes after, with the tokens got again.
+  void GetMe(
+      const std::string &me_id,
+      const PageTokenMap &page_tokens,
+      const OnFailed &on_failed,
+      const OnMeGotten &on_me_gotten,
+      const OnMeGotten &on_me_refreshed);
+
+  // without a prepared live video; started_at is of the start.
+  void PostNewLiveVideo(
+      const std::string &user_page_id,
+      const std::string &privacy,
+      const std::string &title,
+      const std::string &description,
+      const Clock::time_point &started_at,
+      const OnFailed &on_failed,
+      const OnLiveVideoPosted &on_live_video_posted);
+
+  void OnLiveVideoPrepared(
+      const std::shared_ptr<PreparedLiveVideo> &prepared,
+      const std::string &live_video_id,
+      const std::string &stream_url);
+  // gives it the title and the description; a new one is posted
+  // instead if it could not be.
+  void UsePreparedLiveVideo(
+      const std::shared_ptr<PreparedLiveVideo> &prepared,
+      const std::string &title,
+      const std::string &description,
+      const Clock::time_point &started_at,
+      const OnFailed &on_failed,
+      const OnLiveVideoPosted &on_live_video_posted);
+  // deleted now, or once its post is over.
+  void DiscardPreparedLiveVideo(
+      const std::shared_ptr<PreparedLiveVideo> &prepared);
+  void DeleteLiveVideo(
+      const std::string &live_video_id,
+      const std::string &access_token);
+  void BeginPendingRequest();
+  void EndPendingRequest();
+
+  // how long the start took to get the stream url, for the log.
+  static void LogStartLatency(
+      const Clock::time_point &started_at,
+      const PreparedLiveVideo *prepared);
+
   void OnLoginSuccess(
       const std::string &access_token,
       const OnFailed &on_failed,
-      const OnLoggedIn &on_logged_in);
+      const OnLoggedIn &on_logged_in,
+      const OnUserUpdated &on_user_updated);
 
   std::string GetAccessToken() const;
   std::string GetPageAccessToken(const std::string &page_id) const;
 
   void SetAccessToken(const std::string &access_token);
   void SetMeInfo(const MeInfo &me_info);
+  void SetMeInfo(
+      const std::string &me_id,
+      const std::string &me_name,
+      const std::string &me_link,
+      const std::vector<UserPage> &me_accounts);
 
   CefRefPtr<LoginClient> login_client_;
-  HttpRequestService http_request_service_;
 
   // TODO(khpark): refactoring this by AccessToken class.
   mutable std::mutex access_token_mutex_;
@@ -93,6 +173,71 @@ class Facebook : public StreamingServiceProvider {
   // TODO(khpark): refactoring this by MeInfo class.
   mutable std::mutex me_info_mutex_;
   MeInfo me_info_;
+
+  // the completions of its post come on the io thread of the requests.
+  std::mutex prepared_mutex_;
+  std::shared_ptr<PreparedLiveVideo> prepared_;
+  // the posts of the prepared live videos and the deletes in flight;
+  // the destruction waits for them, which the deadlines of the requests
+  // keep short.
+  std::condition_variable pending_requests_condition_;
+  int pending_requests_;
+
+  // the last, so destroyed the first; its io thread is joined before
+  // the members its handlers touch are gone.
+  HttpRequestService http_request_service_;
+};
+
+
+// posted ahead of the start; guarded by the mutex of the owner.
+// once taken by a start or discarded, it is no longer the prepared one
+// of the owner, but its post may not be over yet.
+class Facebook::PreparedLiveVideo {
+ public:
+  using OnPosted = std::function<void()>;
+
+  PreparedLiveVideo(
+      const std::string &user_page_id,
+      const std::string &privacy,
+      const std::string &access_token);
+  virtual ~PreparedLiveVideo();
+
+  bool IsFor(
+      const std::string &user_page_id,
+      const std::string &privacy) const;
+  bool IsPosting() const { return posting_; }
+  // the post has failed if the stream url is empty.
+  void SetPosted(
+      const std::string &live_video_id,
+      const std::string &stream_url);
+
+  // for a start while it is still posting.
+  void SetOnPosted(const OnPosted &on_posted) { on_posted_ = on_posted; }
+  OnPosted ReleaseOnPosted();
+  void Discard() { discarded_ = true; }
+
+  const std::string &user_page_id() const { return user_page_id_; }
+  const std::string &privacy() const { return privacy_; }
+  const std::string &access_token() const { return access_token_; }
+  const std::string &live_video_id() const { return live_video_id_; }
+  const std::string &stream_url() const { return stream_url_; }
+  bool discarded() const { return discarded_; }
+  const Clock::time_point &prepared_at() const { return prepared_at_; }
+  const Clock::time_point &posted_at() const { return posted_at_; }
+
+ private:
+  const std::string user_page_id_;
+  const std::string privacy_;
+  const std::string access_token_;
+
+  bool posting_;
+  std::string live_video_id_;
+  std::string stream_url_;
+  OnPosted on_posted_;
+  bool discarded_;
+
+  const Clock::time_point prepared_at_;
+  Clock::time_point posted_at_;
 };
 
 
@@ -105,7 +250,8 @@ class Facebook::LoginClient
       Facebook *const owner,
       const HWND &base_window,
       const OnFailed &on_failed,
-      const OnLoggedIn &on_logged_in);
+      const OnLoggedIn &on_logged_in,
+      const OnUserUpdated &on_user_updated);
   virtual ~LoginClient();
 
  protected:
@@ -137,6 +283,7 @@ class Facebook::LoginClient
 
   OnFailed on_failed_;
   OnLoggedIn on_logged_in_;
+  OnUserUpdated on_user_updated_;
 
   IMPLEMENT_REFCOUNTING(LoginClient);
 };
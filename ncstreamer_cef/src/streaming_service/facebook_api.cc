@@ -12,10 +12,31 @@
 
 
 namespace ncstreamer {
+void FacebookApi::SetUpServer(const Uri &server) {
+  static_server_scheme = server.scheme();
+  static_server_authority = server.authority();
+}
+
+
+std::string FacebookApi::scheme() {
+  return static_server_scheme.empty() ? kScheme : static_server_scheme;
+}
+
+
 const char *FacebookApi::kScheme{"https"};
 const char *FacebookApi::kVersion{"v2.8"};
 
 
+std::string FacebookApi::static_server_scheme{};
+std::string FacebookApi::static_server_authority{};
+
+
+std::string FacebookApi::Login::authority() {
+  return static_server_authority.empty() ?
+      kAuthority : static_server_authority;
+}
+
+
 const char *FacebookApi::Login::kAuthority{"www.facebook.com"};
 
 
@@ -25,7 +46,7 @@ Uri FacebookApi::Login::Oauth::BuildUri(
     const std::string &response_type,
     const std::string &display,
     const std::vector<std::string> &scope) {
-  return {kScheme, kAuthority, static_path(), Uri::Query{{
+  return {scheme(), authority(), static_path(), Uri::Query{{
       {"client_id", client_id},
       {"redirect_uri", redirect_uri.uri_string()},
       {"response_type", response_type},
@@ -45,7 +66,7 @@ const std::string &FacebookApi::Login::Oauth::static_path() {
 
 
 const Uri &FacebookApi::Login::Redirect::static_uri() {
-  static const Uri kUri{kScheme, kAuthority, "/connect/login_success.html"};
+  static const Uri kUri{scheme(), authority(), "/connect/login_success.html"};
   return kUri;
 }
 
@@ -56,11 +77,17 @@ std::string FacebookApi::Login::Redirect::ExtractAccessToken(
 }
 
 
+std::string FacebookApi::Graph::authority() {
+  return static_server_authority.empty() ?
+      kAuthority : static_server_authority;
+}
+
+
 const char *FacebookApi::Graph::kAuthority{"graph.facebook.com"};
 
 
 const Uri &FacebookApi::Graph::Me::static_uri() {
-  static const Uri kUri{kScheme, kAuthority, static_path()};
+  static const Uri kUri{scheme(), authority(), static_path()};
   return kUri;
 }
 
@@ -68,7 +95,7 @@ const Uri &FacebookApi::Graph::Me::static_uri() {
 Uri FacebookApi::Graph::Me::BuildUri(
     const std::string &access_token,
     const std::vector<std::string> &fields) {
-  return {kScheme, kAuthority, static_path(), Uri::Query{{
+  return {scheme(), authority(), static_path(), Uri::Query{{
       {"access_token", access_token},
       {"fields", String::Join(fields, ",")}}}};
 }
@@ -86,7 +113,7 @@ const std::string &FacebookApi::Graph::Me::static_path() {
 
 Uri FacebookApi::Graph::LiveVideos::BuildUri(
     const std::string &user_page_id) {
-  return {kScheme, kAuthority, BuildPath(user_page_id)};
+  return {scheme(), authority(), BuildPath(user_page_id)};
 }
 
 
@@ -120,4 +147,39 @@ std::string FacebookApi::Graph::LiveVideos::BuildPath(
   ss << "/" << user_page_id << "/live_videos";
   return ss.str();
 }
+
+
+Uri FacebookApi::Graph::LiveVideo::BuildUri(
+    const std::string &live_video_id) {
+  return {scheme(), authority(), "/" + live_video_id};
+}
+
+
+boost::property_tree::ptree
+    FacebookApi::Graph::LiveVideo::BuildUpdateContent(
+        const std::string &access_token,
+        const std::string &title,
+        const std::string &description) {
+  boost::property_tree::ptree post_content;
+  post_content.add<std::string>(
+      "access_token", access_token);
+  post_content.add<std::string>(
+      "title", title);
+  post_content.add<std::string>(
+      "description", description);
+  return std::move(post_content);
+}
+
+
+boost::property_tree::ptree
+    FacebookApi::Graph::LiveVideo::BuildDeleteContent(
+        const std::string &access_token) {
+  boost::property_tree::ptree post_content;
+  post_content.add<std::string>(
+      "access_token", access_token);
+  // the graph api takes the method of a post in place of a delete.
+  post_content.add<std::string>(
+      "method", "delete");
+  return std::move(post_content);
+}
 }  // namespace ncstreamer
@@ -21,9 +21,19 @@ class FacebookApi {
   class Login;
   class Graph;
 
+  // the login and the graph api go to the given server instead, as in
+  // "http://127.0.0.1:8080"; before any uri of them is built.
+  static void SetUpServer(const Uri &server);
+
  private:
+  static std::string scheme();
+
   static const char *kScheme;
   static const char *kVersion;
+
+  // empty unless set up.
+  static std::string static_server_scheme;
+  static std::string static_server_authority;
 };
 
 
@@ -33,6 +43,8 @@ class FacebookApi::Login {
   class Redirect;
 
  private:
+  static std::string authority();
+
   static const char *kAuthority;
 };
 
@@ -63,8 +75,11 @@ class FacebookApi::Graph {
  public:
   class Me;
   class LiveVideos;
+  class LiveVideo;
 
  private:
+  static std::string authority();
+
   static const char *kAuthority;
 };
 
@@ -96,6 +111,22 @@ class FacebookApi::Graph::LiveVideos {
   static std::string BuildPath(
       const std::string &user_page_id);
 };
+
+
+// one posted already.
+class FacebookApi::Graph::LiveVideo {
+ public:
+  static Uri BuildUri(
+      const std::string &live_video_id);
+
+  static boost::property_tree::ptree BuildUpdateContent(
+      const std::string &access_token,
+      const std::string &title,
+      const std::string &description);
+
+  static boost::property_tree::ptree BuildDeleteContent(
+      const std::string &access_token);
+};
 }  // namespace ncstreamer
 
 
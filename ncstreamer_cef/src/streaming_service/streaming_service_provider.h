@@ -27,6 +27,8 @@ class StreamingServiceProvider {
       std::function<void(const std::string &user_name,
                          const std::string &user_link,
                          const std::vector<UserPage> &user_pages)>;
+  // the user has changed since the login, as a page added.
+  using OnUserUpdated = OnLoggedIn;
   using OnLoggedOut =
       std::function<void()>;
   using OnLiveVideoPosted =
@@ -39,7 +41,8 @@ class StreamingServiceProvider {
       HWND parent,
       const std::wstring &locale,
       const OnFailed &on_failed,
-      const OnLoggedIn &on_logged_in) = 0;
+      const OnLoggedIn &on_logged_in,
+      const OnUserUpdated &on_user_updated) = 0;
 
   virtual void LogOut(
       const OnFailed &on_failed,
@@ -52,6 +55,12 @@ class StreamingServiceProvider {
       const std::string &description,
       const OnFailed &on_failed,
       const OnLiveVideoPosted &on_live_video_posted) = 0;
+
+  // ahead of the start, for the user page and the privacy selected; the
+  // post of the start may then go without a live video of its own.
+  virtual void PrepareLiveVideo(
+      const std::string &user_page_id,
+      const std::string &privacy) = 0;
 };
 
 
@@ -24,6 +24,11 @@ const cef = (function() {
       request: ['serviceProvider'],
       response: ['userName', 'userLink', 'userPages', 'userPage', 'privacy'],
     },
+    // told by the app, after the log in; never requested.
+    'service_provider/user/update': {
+      request: [],
+      response: ['userName', 'userLink', 'userPages'],
+    },
     'service_provider/log_out': {
       request: ['serviceProvider'],
       response: ['error'],
@@ -37,6 +42,16 @@ const cef = (function() {
       request: [],
       response: ['error'],
     },
+    // told by the app, while streaming; never requested.
+    'streaming/quality_step': {
+      request: [],
+      response: ['step', 'reason', 'applied', 'error'],
+    },
+    // told by the app, while streaming; never requested.
+    'streaming/reconnect': {
+      request: [],
+      response: ['event', 'attempt', 'downtimeMs', 'reason'],
+    },
     'settings/video_quality/update': {
       request: ['width', 'height', 'fps', 'bitrate'],
       response: ['error'],
@@ -196,6 +196,38 @@ function setProviderUserName(userName) {
 }
 
 
+function setUpOwnPages(userPages) {
+  app.service.user.pages = {};
+  for (const userPage of userPages) {
+    app.service.user.pages[userPage.id] = userPage;
+  }
+
+  const ownPageSelect = app.dom.ownPageSelect;
+  const display = ownPageSelect.children[0];
+  const contents = ownPageSelect.children[1];
+  while (contents.firstChild) {
+    contents.removeChild(contents.firstChild);
+  }
+
+  if (userPages.length == 0) {
+    ncsoft.select.disable(ownPageSelect);
+  } else {
+    ncsoft.select.enable(ownPageSelect);
+    for (const ownPage of userPages) {
+      const li = document.createElement('li');
+      const aTag = document.createElement('a');
+      aTag.textContent = ownPage.name;
+      li.setAttribute('data-value', ownPage.id);
+      li.appendChild(aTag);
+      contents.appendChild(li);
+    }
+    display.value = contents.firstChild.getAttribute('data-value');
+    display.innerHTML = contents.firstChild.firstChild.textContent +
+                        '<span class="caret"></span>';
+  }
+}
+
+
 function getCurrentUserPage() {
   return (app.dom.mePageSelect.children[0].value == 2) ?
       app.dom.ownPageSelect.children[0].value : 'me';
@@ -548,6 +580,12 @@ function showErrorText() {
     case 'game select empty':
        error.textContent = '%NO_SELECT_GAME%';
        break;
+    case 'streaming lags':
+      error.textContent = '%LAG_WARNING_MESSAGE%';
+      break;
+    case 'streaming reconnects':
+      error.textContent = '%RECONNECTING_MESSAGE%';
+      break;
     default:
       error.TextContent = '%ERROR_MESSAGE%';
       break;
@@ -586,9 +624,6 @@ cef.serviceProviderLogIn.onResponse = function(
     link: userLink,
     pages: {},
   };
-  for (const userPage of userPages) {
-    app.service.user.pages[userPage.id] = userPage;
-  }
 
   for (const element of app.dom.loginPagePanel) {
     element.style.display = 'none';
@@ -604,30 +639,7 @@ cef.serviceProviderLogIn.onResponse = function(
   app.dom.minimizeButton.style.display = 'inline';
 
   setProviderUserName(userName);
-
-  const ownPageSelect = app.dom.ownPageSelect;
-  const display = ownPageSelect.children[0];
-  const contents = ownPageSelect.children[1];
-  while (contents.firstChild) {
-    contents.removeChild(contents.firstChild);
-  }
-
-  if (userPages.length == 0) {
-    ncsoft.select.disable(ownPageSelect);
-  } else {
-    ncsoft.select.enable(ownPageSelect);
-    for (const ownPage of userPages) {
-      const li = document.createElement('li');
-      const aTag = document.createElement('a');
-      aTag.textContent = ownPage.name;
-      li.setAttribute('data-value', ownPage.id);
-      li.appendChild(aTag);
-      contents.appendChild(li);
-    }
-    display.value = contents.firstChild.getAttribute('data-value');
-    display.innerHTML = contents.firstChild.firstChild.textContent +
-                        '<span class="caret"></span>';
-  }
+  setUpOwnPages(userPages);
 
   setUpUserPage(userPage);
   setUpPrivacy(privacy);
@@ -636,6 +648,21 @@ cef.serviceProviderLogIn.onResponse = function(
 };
 
 
+cef.serviceProviderUserUpdate.onResponse = function(
+    userName, userLink, userPages) {
+  // the page selected stays, unless it is gone.
+  const userPage = getCurrentUserPage();
+
+  app.service.user.name = userName;
+  app.service.user.link = userLink;
+
+  setProviderUserName(userName);
+  setUpOwnPages(userPages);
+
+  setUpUserPage(userPage);
+};
+
+
 cef.serviceProviderLogOut.onResponse = function(error) {
   if (error) {
     // TODO(khpark): TBD
@@ -701,6 +728,53 @@ cef.streamingStop.onResponse = function(error) {
 };
 
 
+cef.streamingQualityStep.onResponse = function(
+    step, reason, applied, error) {
+  console.info(JSON.stringify({
+    qualityStep: step,
+    reason: reason,
+    applied: applied,
+    error: error,
+  }));
+
+  // a step not applied is left to the user.
+  if (applied != 'true' && app.streaming.status == 'onAir') {
+    setUpError('streaming lags');
+  }
+};
+
+
+cef.streamingReconnect.onResponse = function(
+    event, attempt, downtimeMs, reason) {
+  console.info(JSON.stringify({
+    reconnect: event,
+    attempt: attempt,
+    downtimeMs: downtimeMs,
+    reason: reason,
+  }));
+
+  if (app.streaming.status != 'onAir') {
+    return;
+  }
+  switch (event) {
+    case 'reconnecting':
+      setUpError('streaming reconnects');
+      break;
+    case 'reconnected':
+      if (app.errorType == 'streaming reconnects') {
+        app.dom.errorText.style.display = 'none';
+      }
+      break;
+    case 'gaveUp':
+      // the stream is over; stopped as if by the user.
+      cef.streamingStop.request();
+      updateStreamingStatus('stopping');
+      setUpError('fail streaming');
+      break;
+  }
+};
+
+
 cef.settingsVideoQualityUpdate.onResponse = function(error) {
   if (remote.qualityUpdateRequestKey) {
     cef.remoteQualityUpdate.request(remote.qualityUpdateRequestKey, error);